@@ -91,6 +91,10 @@ void ClientKnobs::initialize(Randomize randomize) {
 	init( MAX_BATCH_SIZE,                         1000 ); if( randomize && BUGGIFY ) MAX_BATCH_SIZE = 1;
 	init( GRV_BATCH_TIMEOUT,                     0.005 ); if( randomize && BUGGIFY ) GRV_BATCH_TIMEOUT = 0.1;
 	init( BROADCAST_BATCH_SIZE,                     20 ); if( randomize && BUGGIFY ) BROADCAST_BATCH_SIZE = 1;
+	init( GRV_MULTIPLEX_BATCHES,                 false ); if( randomize && BUGGIFY ) GRV_MULTIPLEX_BATCHES = true;
+	init( GET_VALUES_BATCHING,                   false ); if( randomize && BUGGIFY ) GET_VALUES_BATCHING = true;
+	init( GET_VALUES_BATCH_WINDOW,                 0.0 ); if( randomize && BUGGIFY ) GET_VALUES_BATCH_WINDOW = deterministicRandom()->random01() * 0.005;
+	init( GET_VALUES_BATCH_MAX_KEYS,               100 ); if( randomize && BUGGIFY ) GET_VALUES_BATCH_MAX_KEYS = deterministicRandom()->randomInt(1, 10);
 	init( TRANSACTION_TIMEOUT_DELAY_INTERVAL,     10.0 ); if( randomize && BUGGIFY ) TRANSACTION_TIMEOUT_DELAY_INTERVAL = 1.0;
 
 	init( LOCATION_CACHE_EVICTION_SIZE,         600000 );
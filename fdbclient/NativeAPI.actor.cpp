@@ -191,6 +191,8 @@ void DatabaseContext::addTssMapping(StorageServerInterface const& ssi, StorageSe
 		// data requests duplicated for load and data comparison
 		queueModel.updateTssEndpoint(ssi.getValue.getEndpoint().token.first(),
 		                             TSSEndpointData(tssi.id(), tssi.getValue.getEndpoint(), metrics));
+		queueModel.updateTssEndpoint(ssi.getValues.getEndpoint().token.first(),
+		                             TSSEndpointData(tssi.id(), tssi.getValues.getEndpoint(), metrics));
 		queueModel.updateTssEndpoint(ssi.getKey.getEndpoint().token.first(),
 		                             TSSEndpointData(tssi.id(), tssi.getKey.getEndpoint(), metrics));
 		queueModel.updateTssEndpoint(ssi.getKeyValues.getEndpoint().token.first(),
@@ -226,6 +228,7 @@ void DatabaseContext::removeTssMapping(StorageServerInterface const& ssi) {
 		tssMetrics.erase(ssi.id());
 		tssMapping.erase(result);
 		queueModel.removeTssEndpoint(ssi.getValue.getEndpoint().token.first());
+		queueModel.removeTssEndpoint(ssi.getValues.getEndpoint().token.first());
 		queueModel.removeTssEndpoint(ssi.getKey.getEndpoint().token.first());
 		queueModel.removeTssEndpoint(ssi.getKeyValues.getEndpoint().token.first());
 		queueModel.removeTssEndpoint(ssi.getMappedKeyValues.getEndpoint().token.first());
@@ -3634,6 +3637,162 @@ Future<Void> Transaction::warmRange(KeyRange keys) {
 	return warmRange_impl(trState, keys);
 }
 
+// Sends a batch of point reads collected by the getValuesBatcher, which are all served by the same storage team, and
+// answers each of them from the reply
+ACTOR Future<Void> sendGetValuesBatch(DatabaseContext* cx, std::vector<DatabaseContext::GetValueBatchRequest> batch) {
+	state Reference<LocationInfo> locations = batch.front().locations;
+	state QueueModel* model = cx->enableLocalityLoadBalance ? &cx->queueModel : nullptr;
+	state GetValuesRequest req;
+	try {
+		if (batch.size() == 1) {
+			// The caller waits on the reply of the original request, so loadBalance gets a copy with its own reply, and
+			// the original one is only answered here
+			GetValueRequest single = batch.front().request;
+			resetReply(single);
+			GetValueReply reply = wait(loadBalance(cx,
+			                                       locations,
+			                                       &StorageServerInterface::getValue,
+			                                       single,
+			                                       TaskPriority::DefaultPromiseEndpoint,
+			                                       AtMostOnce::False,
+			                                       model));
+			batch.front().request.reply.send(reply);
+			return Void();
+		}
+
+		// The batch key guarantees that the rest of the request is the same for all of the reads
+		const GetValueRequest& first = batch.front().request;
+		req.spanContext = first.spanContext;
+		req.tenantInfo = first.tenantInfo;
+		req.version = first.version;
+		req.options = first.options;
+		req.ssLatestCommitVersions = first.ssLatestCommitVersions;
+		req.keys.reserve(req.arena, batch.size());
+		for (const auto& r : batch) {
+			req.keys.push_back_deep(req.arena, r.request.key);
+		}
+
+		GetValuesReply reply = wait(loadBalance(cx,
+		                                        locations,
+		                                        &StorageServerInterface::getValues,
+		                                        req,
+		                                        TaskPriority::DefaultPromiseEndpoint,
+		                                        AtMostOnce::False,
+		                                        model));
+		ASSERT(reply.values.size() == batch.size());
+		for (int i = 0; i < batch.size(); i++) {
+			Optional<Value> value;
+			if (reply.values[i].present()) {
+				value = Value(reply.values[i].get(), reply.arena);
+			}
+			batch[i].request.reply.send(GetValueReply(value, reply.cached));
+		}
+	} catch (Error& e) {
+		if (e.code() == error_code_actor_cancelled) {
+			throw;
+		}
+		for (auto& r : batch) {
+			r.request.reply.sendError(e);
+		}
+	}
+	return Void();
+}
+
+// The point reads that can share one GetValuesRequest: the same storage team, version, tenant and read options
+struct GetValuesBatchKey {
+	std::vector<UID> servers;
+	Version version;
+	int64_t tenantId;
+	bool hasOptions;
+	int type;
+	bool cacheResult;
+	bool lockAware;
+
+	explicit GetValuesBatchKey(const DatabaseContext::GetValueBatchRequest& req)
+	  : version(req.request.version), tenantId(req.request.tenantInfo.tenantId),
+	    hasOptions(req.request.options.present()), type(0), cacheResult(false), lockAware(false) {
+		servers.reserve(req.locations->size());
+		for (int i = 0; i < req.locations->size(); i++) {
+			servers.push_back(req.locations->getId(i));
+		}
+		std::sort(servers.begin(), servers.end());
+		if (hasOptions) {
+			type = static_cast<int>(req.request.options.get().type);
+			cacheResult = req.request.options.get().cacheResult;
+			lockAware = req.request.options.get().lockAware;
+		}
+	}
+
+	bool operator<(const GetValuesBatchKey& r) const {
+		return std::tie(servers, version, tenantId, hasOptions, type, cacheResult, lockAware) <
+		       std::tie(r.servers, r.version, r.tenantId, r.hasOptions, r.type, r.cacheResult, r.lockAware);
+	}
+};
+
+// Groups the point reads submitted through batchGetValue into GetValuesRequests, see CLIENT_KNOBS->GET_VALUES_BATCHING
+ACTOR Future<Void> getValuesBatcher(DatabaseContext* cx,
+                                    FutureStream<DatabaseContext::GetValueBatchRequest> requestStream) {
+	state std::map<GetValuesBatchKey, std::vector<DatabaseContext::GetValueBatchRequest>> batches;
+	state PromiseStream<Future<Void>> addActor;
+	state Future<Void> collection = actorCollection(addActor.getFuture());
+	state Future<Void> flush;
+	loop {
+		choose {
+			when(DatabaseContext::GetValueBatchRequest req = waitNext(requestStream)) {
+				GetValuesBatchKey key(req);
+				auto batch = batches.try_emplace(std::move(key)).first;
+				batch->second.push_back(std::move(req));
+				if (batch->second.size() >= CLIENT_KNOBS->GET_VALUES_BATCH_MAX_KEYS) {
+					addActor.send(sendGetValuesBatch(cx, std::move(batch->second)));
+					batches.erase(batch);
+				} else if (!flush.isValid()) {
+					flush = delay(CLIENT_KNOBS->GET_VALUES_BATCH_WINDOW);
+				}
+			}
+			when(wait(flush.isValid() ? flush : Never())) {
+				for (auto& [_, batch] : batches) {
+					addActor.send(sendGetValuesBatch(cx, std::move(batch)));
+				}
+				batches.clear();
+				flush = Future<Void>();
+			}
+			when(wait(collection)) {} // for errors
+		}
+	}
+}
+
+// Sends a point read through the DatabaseContext's getValuesBatcher
+Future<GetValueReply> batchGetValue(DatabaseContext* cx, Reference<LocationInfo> locations, GetValueRequest req) {
+	if (!cx->getValuesBatcher.isValid()) {
+		cx->getValuesBatcher = getValuesBatcher(cx, cx->getValueBatchRequests.getFuture());
+	}
+	Future<GetValueReply> reply = req.reply.getFuture();
+	cx->getValueBatchRequests.send(DatabaseContext::GetValueBatchRequest(std::move(locations), std::move(req)));
+	return reply;
+}
+
+// Sends the point read of getValue, batched with other concurrent reads when that doesn't change how it is served
+Future<GetValueReply> sendGetValueRequest(Reference<TransactionState> trState,
+                                          Reference<LocationInfo> locations,
+                                          GetValueRequest req) {
+	DatabaseContext* cx = trState->cx.getPtr();
+	if (CLIENT_KNOBS->GET_VALUES_BATCHING && !req.tags.present() && !req.tenantInfo.token.present() &&
+	    req.ssLatestCommitVersions.empty() && !trState->options.enableReplicaConsistencyCheck &&
+	    (!req.options.present() ||
+	     (!req.options.get().debugID.present() && !req.options.get().consistencyCheckStartVersion.present()))) {
+		return batchGetValue(cx, locations, std::move(req));
+	}
+	return loadBalance(cx,
+	                   locations,
+	                   &StorageServerInterface::getValue,
+	                   req,
+	                   TaskPriority::DefaultPromiseEndpoint,
+	                   AtMostOnce::False,
+	                   cx->enableLocalityLoadBalance ? &cx->queueModel : nullptr,
+	                   trState->options.enableReplicaConsistencyCheck,
+	                   trState->options.requiredReplicas);
+}
+
 ACTOR Future<Optional<Value>> getValue(Reference<TransactionState> trState,
                                        Key key,
                                        UseTenant useTenant,
@@ -3693,22 +3852,17 @@ ACTOR Future<Optional<Value>> getValue(Reference<TransactionState> trState,
 						throw transaction_too_old();
 					}
 					when(GetValueReply _reply = wait(
-					         loadBalance(trState->cx.getPtr(),
-					                     locationInfo.locations,
-					                     &StorageServerInterface::getValue,
-					                     GetValueRequest(span.context,
-					                                     useTenant ? trState->getTenantInfo() : TenantInfo(),
-					                                     key,
-					                                     trState->readVersion(),
-					                                     trState->cx->sampleReadTags() ? trState->options.readTags
-					                                                                   : Optional<TagSet>(),
-					                                     readOptions,
-					                                     ssLatestCommitVersions),
-					                     TaskPriority::DefaultPromiseEndpoint,
-					                     AtMostOnce::False,
-					                     trState->cx->enableLocalityLoadBalance ? &trState->cx->queueModel : nullptr,
-					                     trState->options.enableReplicaConsistencyCheck,
-					                     trState->options.requiredReplicas))) {
+					         sendGetValueRequest(trState,
+					                             locationInfo.locations,
+					                             GetValueRequest(span.context,
+					                                             useTenant ? trState->getTenantInfo() : TenantInfo(),
+					                                             key,
+					                                             trState->readVersion(),
+					                                             trState->cx->sampleReadTags()
+					                                                 ? trState->options.readTags
+					                                                 : Optional<TagSet>(),
+					                                             readOptions,
+					                                             ssLatestCommitVersions)))) {
 						reply = _reply;
 					}
 				}
@@ -7319,6 +7473,47 @@ void Transaction::setOption(FDBTransactionOptions::Option option, Optional<Strin
 	}
 }
 
+// Updates the client's tag throttles, version vector cache and minimum acceptable read version from the reply to a GRV
+// request for a batch of transactions. Returns false if the reply came from a GRV proxy that is no longer current, in
+// which case the request has to be retried.
+static bool processReadVersionReply(DatabaseContext* cx,
+                                    TransactionPriority priority,
+                                    TransactionTagMap<uint32_t> const& tags,
+                                    Optional<UID> debugID,
+                                    GetReadVersionReply const& v) {
+	CODE_PROBE(v.proxyTagThrottledDuration > 0.0,
+	           "getConsistentReadVersion received GetReadVersionReply delayed by proxy tag throttling");
+	if (tags.size() != 0) {
+		auto& priorityThrottledTags = cx->throttledTags[priority];
+		for (auto& tag : tags) {
+			auto itr = v.tagThrottleInfo.find(tag.first);
+			if (itr == v.tagThrottleInfo.end()) {
+				CODE_PROBE(true, "Removing client throttle");
+				priorityThrottledTags.erase(tag.first);
+			} else {
+				CODE_PROBE(true, "Setting client throttle");
+				auto result = priorityThrottledTags.try_emplace(tag.first, itr->second);
+				if (!result.second) {
+					result.first->second.update(itr->second);
+				}
+			}
+		}
+	}
+
+	if (debugID.present())
+		g_traceBatch.addEvent("TransactionDebug", debugID.get().first(), "NativeAPI.getConsistentReadVersion.After");
+	ASSERT(v.version > 0);
+	cx->minAcceptableReadVersion = std::min(cx->minAcceptableReadVersion, v.version);
+	if (cx->versionVectorCacheActive(v.ssVersionVectorDelta)) {
+		if (cx->isCurrentGrvProxy(v.proxyId)) {
+			cx->ssVersionVectorCache.applyDelta(v.ssVersionVectorDelta);
+		} else {
+			return false; // stale GRV reply, retry
+		}
+	}
+	return true;
+}
+
 ACTOR Future<GetReadVersionReply> getConsistentReadVersion(SpanContext parentSpan,
                                                            DatabaseContext* cx,
                                                            uint32_t transactionCount,
@@ -7352,36 +7547,8 @@ ACTOR Future<GetReadVersionReply> getConsistentReadVersion(SpanContext parentSpa
 				                               &GrvProxyInterface::getConsistentReadVersion,
 				                               req,
 				                               cx->taskID))) {
-					CODE_PROBE(v.proxyTagThrottledDuration > 0.0,
-					           "getConsistentReadVersion received GetReadVersionReply delayed by proxy tag throttling");
-					if (tags.size() != 0) {
-						auto& priorityThrottledTags = cx->throttledTags[priority];
-						for (auto& tag : tags) {
-							auto itr = v.tagThrottleInfo.find(tag.first);
-							if (itr == v.tagThrottleInfo.end()) {
-								CODE_PROBE(true, "Removing client throttle");
-								priorityThrottledTags.erase(tag.first);
-							} else {
-								CODE_PROBE(true, "Setting client throttle");
-								auto result = priorityThrottledTags.try_emplace(tag.first, itr->second);
-								if (!result.second) {
-									result.first->second.update(itr->second);
-								}
-							}
-						}
-					}
-
-					if (debugID.present())
-						g_traceBatch.addEvent(
-						    "TransactionDebug", debugID.get().first(), "NativeAPI.getConsistentReadVersion.After");
-					ASSERT(v.version > 0);
-					cx->minAcceptableReadVersion = std::min(cx->minAcceptableReadVersion, v.version);
-					if (cx->versionVectorCacheActive(v.ssVersionVectorDelta)) {
-						if (cx->isCurrentGrvProxy(v.proxyId)) {
-							cx->ssVersionVectorCache.applyDelta(v.ssVersionVectorDelta);
-						} else {
-							continue; // stale GRV reply, retry
-						}
+					if (!processReadVersionReply(cx, priority, tags, debugID, v)) {
+						continue;
 					}
 					return v;
 				}
@@ -7395,6 +7562,119 @@ ACTOR Future<GetReadVersionReply> getConsistentReadVersion(SpanContext parentSpa
 	}
 }
 
+// Sends several GRV batches to a GRV proxy in a single GetReadVersionsRequest, and hands each batch its own reply. As
+// with getConsistentReadVersion(), a batch that is throttled fails with its own error, and only the batches whose reply
+// came from a GRV proxy that is no longer current are sent again.
+ACTOR Future<Void> getConsistentReadVersions(DatabaseContext* cx,
+                                             std::vector<DatabaseContext::ReadVersionBatchRequest> requests) {
+	state Span span("NAPI:getConsistentReadVersions"_loc);
+
+	cx->transactionReadVersionBatches += requests.size();
+	for (auto const& r : requests) {
+		span.addLink(r.batch.spanContext);
+		if (r.batch.debugID.present()) {
+			g_traceBatch.addEvent(
+			    "TransactionDebug", r.batch.debugID.get().first(), "NativeAPI.getConsistentReadVersion.Before");
+		}
+	}
+	try {
+		loop {
+			state GetReadVersionsRequest req;
+			req.batches.reserve(requests.size());
+			for (auto const& r : requests) {
+				req.batches.push_back(r.batch);
+				req.batches.back().maxVersion = cx->ssVersionVectorCache.getMaxVersion();
+			}
+			state Future<Void> onProxiesChanged = cx->onProxiesChanged();
+
+			choose {
+				when(wait(onProxiesChanged)) {}
+				when(GetReadVersionsReply rep = wait(basicLoadBalance(cx->getGrvProxies(UseProvisionalProxies::False),
+				                                                      &GrvProxyInterface::getConsistentReadVersions,
+				                                                      req,
+				                                                      cx->taskID))) {
+					ASSERT(rep.replies.size() == requests.size());
+					std::vector<DatabaseContext::ReadVersionBatchRequest> stale;
+					for (int i = 0; i < requests.size(); i++) {
+						auto const& batch = requests[i].batch;
+						if (!rep.replies[i].present()) {
+							requests[i].reply.sendError(rep.replies[i].getError());
+						} else if (processReadVersionReply(
+						               cx, batch.priority(), batch.tags, batch.debugID, rep.replies[i].get())) {
+							requests[i].reply.send(rep.replies[i].get());
+						} else {
+							stale.push_back(requests[i]);
+						}
+					}
+					if (stale.empty()) {
+						return Void();
+					}
+					requests = std::move(stale);
+				}
+			}
+		}
+	} catch (Error& e) {
+		if (e.code() == error_code_actor_cancelled) {
+			throw;
+		}
+		if (e.code() != error_code_broken_promise && e.code() != error_code_batch_transaction_throttled &&
+		    e.code() != error_code_grv_proxy_memory_limit_exceeded && e.code() != error_code_proxy_tag_throttled) {
+			TraceEvent(SevError, "GetConsistentReadVersionsError").error(e);
+		}
+		for (auto& r : requests) {
+			r.reply.sendError(e);
+		}
+	}
+	return Void();
+}
+
+// Collects the batches of the readVersionBatchers that are sent at the same time, so that they reach a GRV proxy in as
+// few requests as possible. The proxy replies to a request once all its batches have started, so only batches with
+// the same flags, and so the same priority, that are all tagged or all untagged share a request. Otherwise an
+// IMMEDIATE batch could wait for a BATCH priority or tag throttled one, or a causal read risky batch for one that
+// confirms the epoch is live.
+ACTOR Future<Void> readVersionMultiplexer(DatabaseContext* cx,
+                                          FutureStream<DatabaseContext::ReadVersionBatchRequest> batchStream) {
+	state std::map<std::pair<uint32_t, bool>, std::vector<DatabaseContext::ReadVersionBatchRequest>> requests;
+	state PromiseStream<Future<Void>> addActor;
+	state Future<Void> collection = actorCollection(addActor.getFuture());
+	state Future<Void> flush;
+	loop {
+		choose {
+			when(DatabaseContext::ReadVersionBatchRequest req = waitNext(batchStream)) {
+				requests[std::make_pair(req.batch.flags, !req.batch.tags.empty())].push_back(req);
+				if (!flush.isValid()) {
+					flush = delay(0, TaskPriority::GetConsistentReadVersion);
+				}
+			}
+			when(wait(flush.isValid() ? flush : Never())) {
+				for (auto& [_, group] : requests) {
+					addActor.send(getConsistentReadVersions(cx, std::move(group)));
+				}
+				requests.clear();
+				flush = Future<Void>();
+			}
+			when(wait(collection)) {} // for errors
+		}
+	}
+}
+
+// Sends a GRV batch through the DatabaseContext's readVersionMultiplexer
+Future<GetReadVersionReply> getMultiplexedReadVersion(SpanContext spanContext,
+                                                      DatabaseContext* cx,
+                                                      uint32_t transactionCount,
+                                                      uint32_t flags,
+                                                      TransactionTagMap<uint32_t> tags,
+                                                      Optional<UID> debugID) {
+	if (!cx->readVersionMultiplexer.isValid()) {
+		cx->readVersionMultiplexer = readVersionMultiplexer(cx, cx->readVersionBatches.getFuture());
+	}
+	DatabaseContext::ReadVersionBatchRequest req(
+	    GetReadVersionBatch(spanContext, transactionCount, flags, std::move(tags), debugID, invalidVersion));
+	cx->readVersionBatches.send(req);
+	return req.reply.getFuture();
+}
+
 ACTOR Future<Void> readVersionBatcher(DatabaseContext* cx,
                                       FutureStream<DatabaseContext::VersionRequest> versionStream,
                                       TransactionPriority priority,
@@ -7472,10 +7752,15 @@ ACTOR Future<Void> readVersionBatcher(DatabaseContext* cx,
 			requests.push_back(GRVReply);
 			addActor.send(ready(timeReply(GRVReply.getFuture(), replyTimes)));
 
-			Future<Void> batch = incrementalBroadcastWithError(
-			    getConsistentReadVersion(span.context, cx, count, priority, flags, std::move(tags), std::move(debugID)),
-			    std::move(requests),
-			    CLIENT_KNOBS->BROADCAST_BATCH_SIZE);
+			Future<GetReadVersionReply> reply;
+			if (CLIENT_KNOBS->GRV_MULTIPLEX_BATCHES && !(flags & GetReadVersionRequest::FLAG_USE_PROVISIONAL_PROXIES)) {
+				reply = getMultiplexedReadVersion(span.context, cx, count, flags, std::move(tags), std::move(debugID));
+			} else {
+				reply = getConsistentReadVersion(
+				    span.context, cx, count, priority, flags, std::move(tags), std::move(debugID));
+			}
+			Future<Void> batch =
+			    incrementalBroadcastWithError(reply, std::move(requests), CLIENT_KNOBS->BROADCAST_BATCH_SIZE);
 
 			span = Span("NAPI:readVersionBatcher"_loc);
 			tags.clear();
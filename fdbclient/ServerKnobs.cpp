@@ -72,6 +72,10 @@ void ServerKnobs::initialize(Randomize randomize, ClientKnobs* clientKnobs, IsSi
 	init( MAX_MESSAGE_SIZE,            std::max<int>(LOG_SYSTEM_PUSHED_DATA_BLOCK_SIZE, 1e5 + 2e4 + 1) + 8 ); // VALUE_SIZE_LIMIT + SYSTEM_KEY_SIZE_LIMIT + 9 bytes (4 bytes for length, 4 bytes for sequence number, and 1 byte for mutation type)
 	init( TLOG_MESSAGE_BLOCK_BYTES,                             10e6 );
 	init( TLOG_MESSAGE_BLOCK_OVERHEAD_FACTOR,      double(TLOG_MESSAGE_BLOCK_BYTES) / (TLOG_MESSAGE_BLOCK_BYTES - MAX_MESSAGE_SIZE) ); //1.0121466709838096006362758832473
+	init( TLOG_COMPRESS_MESSAGES,                              false ); if( randomize && BUGGIFY ) TLOG_COMPRESS_MESSAGES = true;
+	init( TLOG_MESSAGE_COMPRESSION_FILTER,                    "ZSTD" ); if( randomize && BUGGIFY ) TLOG_MESSAGE_COMPRESSION_FILTER = CompressionUtils::toString(CompressionUtils::getRandomFilter());
+	init( TLOG_COMPRESS_MESSAGES_MIN_UNCOMPRESSED_BYTES,       200e6 ); if( randomize && BUGGIFY ) TLOG_COMPRESS_MESSAGES_MIN_UNCOMPRESSED_BYTES = deterministicRandom()->randomInt(0, 1e6);
+	init( TLOG_COMPRESSED_MESSAGES_CHUNK_BYTES,              64<<10 ); if( randomize && BUGGIFY ) TLOG_COMPRESSED_MESSAGES_CHUNK_BYTES = deterministicRandom()->randomInt(1, 1<<16);
 	init( PEEK_TRACKER_EXPIRATION_TIME,                          600 ); if( randomize && BUGGIFY ) PEEK_TRACKER_EXPIRATION_TIME = 120; // Cannot be buggified lower without changing the following assert in LogSystemPeekCursor.actor.cpp: ASSERT_WE_THINK(e.code() == error_code_operation_obsolete || SERVER_KNOBS->PEEK_TRACKER_EXPIRATION_TIME < 10);
 	init( PEEK_USING_STREAMING,                                false ); if( randomize && isSimulated && BUGGIFY ) PEEK_USING_STREAMING = true;
 	init( PARALLEL_GET_MORE_REQUESTS,                             32 ); if( randomize && BUGGIFY ) PARALLEL_GET_MORE_REQUESTS = 2;
@@ -87,6 +91,7 @@ void ServerKnobs::initialize(Randomize randomize, ClientKnobs* clientKnobs, IsSi
 	init( TLOG_SPILL_REFERENCE_MAX_PEEK_MEMORY_BYTES,            2e9 ); if ( randomize && BUGGIFY ) TLOG_SPILL_REFERENCE_MAX_PEEK_MEMORY_BYTES = 2e6;
 	init( TLOG_SPILL_REFERENCE_MAX_BATCHES_PER_PEEK,           100 ); if ( randomize && BUGGIFY ) TLOG_SPILL_REFERENCE_MAX_BATCHES_PER_PEEK = 1;
 	init( TLOG_SPILL_REFERENCE_MAX_BYTES_PER_BATCH,           16<<10 ); if ( randomize && BUGGIFY ) TLOG_SPILL_REFERENCE_MAX_BYTES_PER_BATCH = 500;
+	init( TLOG_SPILL_REFERENCE_READ_GAP_BYTES,               128<<10 ); if ( randomize && BUGGIFY ) TLOG_SPILL_REFERENCE_READ_GAP_BYTES = deterministicRandom()->coinflip() ? 0 : 1<<20;
 	init( DISK_QUEUE_FILE_EXTENSION_BYTES,                    10<<20 ); // BUGGIFYd per file within the DiskQueue
 	init( DISK_QUEUE_FILE_SHRINK_BYTES,                      100<<20 ); // BUGGIFYd per file within the DiskQueue
 	init( DISK_QUEUE_MAX_TRUNCATE_BYTES,                     2LL<<30 ); if ( randomize && BUGGIFY ) DISK_QUEUE_MAX_TRUNCATE_BYTES = 0;
@@ -701,6 +706,12 @@ void ServerKnobs::initialize(Randomize randomize, ClientKnobs* clientKnobs, IsSi
 	init( COMMIT_TRANSACTION_BATCH_BYTES_MAX,                  100000 ); if( randomize && BUGGIFY ) { COMMIT_TRANSACTION_BATCH_BYTES_MIN = COMMIT_TRANSACTION_BATCH_BYTES_MAX = 1000000; }
 	init( COMMIT_TRANSACTION_BATCH_BYTES_SCALE_BASE,           100000 );
 	init( COMMIT_TRANSACTION_BATCH_BYTES_SCALE_POWER,             0.0 );
+	init( COMMIT_BATCHING_ADAPTIVE,                             false ); if( randomize && BUGGIFY ) COMMIT_BATCHING_ADAPTIVE = true;
+	init( COMMIT_BATCHING_LATENCY_SLO,                          0.025 ); if( randomize && BUGGIFY ) COMMIT_BATCHING_LATENCY_SLO = deterministicRandom()->random01() * 0.1;
+	init( COMMIT_BATCHING_MODEL_ALPHA,                           0.02 );
+	init( COMMIT_BATCHING_ARRIVAL_RATE_WINDOW,                    1.0 );
+	init( COMMIT_BATCHING_ADAPTIVE_BYTES_MIN,                   10000 );
+	init( COMMIT_BATCHING_ADAPTIVE_BYTES_MAX,                 1000000 ); if( randomize && BUGGIFY ) COMMIT_BATCHING_ADAPTIVE_BYTES_MAX = COMMIT_BATCHING_ADAPTIVE_BYTES_MIN;
 
 	init( RESOLVER_COALESCE_TIME,                                1.0 );
 	init( BUGGIFIED_ROW_LIMIT,                  APPLY_MUTATION_BYTES ); if( randomize && BUGGIFY ) BUGGIFIED_ROW_LIMIT = deterministicRandom()->randomInt(3, 30);
@@ -722,6 +733,8 @@ void ServerKnobs::initialize(Randomize randomize, ClientKnobs* clientKnobs, IsSi
 	init( TXN_STATE_SEND_AMOUNT,                                    4 );
 	init( REPORT_TRANSACTION_COST_ESTIMATION_DELAY,               0.1 );
 	init( PROXY_REJECT_BATCH_QUEUED_TOO_LONG,                    true );
+	init( PROXY_ASSIGN_MUTATIONS_THREADS,                           0 ); if( randomize && BUGGIFY ) PROXY_ASSIGN_MUTATIONS_THREADS = deterministicRandom()->randomInt(1, 5);
+	init( PROXY_ASSIGN_MUTATIONS_CHUNK_BYTES,                  100000 ); if( randomize && BUGGIFY ) PROXY_ASSIGN_MUTATIONS_CHUNK_BYTES = deterministicRandom()->randomInt(100, 10000);
 
 	bool buggfyUseResolverPrivateMutations = randomize && BUGGIFY && !ENABLE_VERSION_VECTOR_TLOG_UNICAST;
 	init( PROXY_USE_RESOLVER_PRIVATE_MUTATIONS,                 false ); if( buggfyUseResolverPrivateMutations ) PROXY_USE_RESOLVER_PRIVATE_MUTATIONS = deterministicRandom()->coinflip();
@@ -761,6 +774,8 @@ void ServerKnobs::initialize(Randomize randomize, ClientKnobs* clientKnobs, IsSi
 	init( SAMPLE_EXPIRATION_TIME,                                1.0 );
 	init( SAMPLE_POLL_TIME,                                      0.1 );
 	init( RESOLVER_STATE_MEMORY_LIMIT,                           1e6 );
+	init( RESOLVER_CONFLICT_SET_PARTITIONS,                        1 ); if( randomize && BUGGIFY ) RESOLVER_CONFLICT_SET_PARTITIONS = deterministicRandom()->randomInt(2, 9);
+	init( RESOLVER_CONFLICT_SET_PARALLEL_MIN_RANGES,            1000 ); if( randomize && BUGGIFY ) RESOLVER_CONFLICT_SET_PARALLEL_MIN_RANGES = deterministicRandom()->randomInt(0, 10);
 	init( LAST_LIMITED_RATIO,                                    2.0 );
 
 	// Backup Worker
@@ -1019,6 +1034,9 @@ void ServerKnobs::initialize(Randomize randomize, ClientKnobs* clientKnobs, IsSi
 	init( FETCH_KEYS_PARALLELISM_BYTES,                          4e6 ); if( randomize && BUGGIFY ) FETCH_KEYS_PARALLELISM_BYTES = 3e6;
 	init( FETCH_KEYS_PARALLELISM,                                  2 );
 	init( FETCH_KEYS_PARALLELISM_CHANGE_FEED,                      6 );
+	init( FETCH_KEYS_PARALLEL_RANGES,                              1 ); if( randomize && BUGGIFY ) FETCH_KEYS_PARALLEL_RANGES = deterministicRandom()->randomInt(2, 5);
+	init( FETCH_KEYS_PARALLEL_RANGE_BYTES,                      20e6 ); if( randomize && BUGGIFY ) FETCH_KEYS_PARALLEL_RANGE_BYTES = deterministicRandom()->randomInt(1e3, 1e5);
+	init( FETCH_KEYS_PARALLEL_BYTES,                           200e6 ); if( randomize && BUGGIFY ) FETCH_KEYS_PARALLEL_BYTES = deterministicRandom()->randomInt(1e3, 1e6);
 	init( FETCH_KEYS_LOWER_PRIORITY,                               0 );
 	init( SERVE_FETCH_CHECKPOINT_PARALLELISM,                      4 );
 	init( SERVE_AUDIT_STORAGE_PARALLELISM,                         1 );
@@ -1044,6 +1062,8 @@ void ServerKnobs::initialize(Randomize randomize, ClientKnobs* clientKnobs, IsSi
 	init( STORAGE_DURABILITY_LAG_REJECT_THRESHOLD,              0.25 );
 	init( STORAGE_DURABILITY_LAG_MIN_RATE,                       0.1 );
 	init( STORAGE_COMMIT_INTERVAL,                               0.5 ); if( randomize && BUGGIFY ) STORAGE_COMMIT_INTERVAL = 2.0;
+	init( STORAGE_UPDATE_PREPARE_THREADS,                          0 ); if( randomize && BUGGIFY ) STORAGE_UPDATE_PREPARE_THREADS = deterministicRandom()->randomInt(1, 5);
+	init( STORAGE_UPDATE_PREPARE_CHUNK_BYTES,                 100000 ); if( randomize && BUGGIFY ) STORAGE_UPDATE_PREPARE_CHUNK_BYTES = deterministicRandom()->randomInt(100, 10000);
 
 	// Constants which affect the fraction of data which is sampled
 	// by storage severs to estimate key-range sizes and splits.
@@ -1064,6 +1084,7 @@ void ServerKnobs::initialize(Randomize randomize, ClientKnobs* clientKnobs, IsSi
 	init( MIN_BYTE_SAMPLING_PROBABILITY,                           0 );
 
 	init( MAX_STORAGE_SERVER_WATCH_BYTES,                      100e6 ); if( randomize && BUGGIFY ) MAX_STORAGE_SERVER_WATCH_BYTES = 10e3;
+	init( STORAGE_SERVER_WATCH_INDEX,                          false ); if( randomize && BUGGIFY ) STORAGE_SERVER_WATCH_INDEX = true;
 	init( MAX_BYTE_SAMPLE_CLEAR_MAP_SIZE,                        1e9 ); if( randomize && BUGGIFY ) MAX_BYTE_SAMPLE_CLEAR_MAP_SIZE = 1e3;
 	init( LONG_BYTE_SAMPLE_RECOVERY_DELAY,                      60.0 );
 	init( BYTE_SAMPLE_LOAD_PARALLELISM,                            8 ); if( randomize && BUGGIFY ) BYTE_SAMPLE_LOAD_PARALLELISM = 1;
@@ -1082,7 +1103,11 @@ void ServerKnobs::initialize(Randomize randomize, ClientKnobs* clientKnobs, IsSi
 	init( FETCH_KEYS_TOO_LONG_TIME_CRITERIA,                   300.0 );
 	init( MAX_STORAGE_COMMIT_TIME,                             200.0 ); //The max fsync stall time on the storage server and tlog before marking a disk as failed
 	init( RANGESTREAM_LIMIT_BYTES,                               2e6 ); if( randomize && BUGGIFY ) RANGESTREAM_LIMIT_BYTES = 1;
+	init( RANGESTREAM_READ_AHEAD_CHUNKS,                           4 ); if( randomize && BUGGIFY ) RANGESTREAM_READ_AHEAD_CHUNKS = deterministicRandom()->randomInt(1, 10);
 	init( CHANGEFEEDSTREAM_LIMIT_BYTES,                          1e6 ); if( randomize && BUGGIFY ) CHANGEFEEDSTREAM_LIMIT_BYTES = 1;
+	init( CHANGE_FEED_SHARE_MUTATIONS,                          true ); if( randomize && BUGGIFY ) CHANGE_FEED_SHARE_MUTATIONS = false;
+	init( CHANGE_FEED_DURABLE_COMPRESSION_FILTER,             "NONE" );
+	init( CHANGE_FEED_DURABLE_COMPRESSION_MIN_BYTES,             1000 ); if( randomize && BUGGIFY ) CHANGE_FEED_DURABLE_COMPRESSION_MIN_BYTES = deterministicRandom()->randomInt(0, 1000);
 	init( BLOBWORKERSTATUSSTREAM_LIMIT_BYTES,                    1e4 ); if( randomize && BUGGIFY ) BLOBWORKERSTATUSSTREAM_LIMIT_BYTES = 1;
 	init( ENABLE_CLEAR_RANGE_EAGER_READS,                       true ); if( randomize && BUGGIFY ) ENABLE_CLEAR_RANGE_EAGER_READS = deterministicRandom()->coinflip();
 	init( CHECKPOINT_TRANSFER_BLOCK_BYTES,                      40e6 );
@@ -1094,6 +1119,7 @@ void ServerKnobs::initialize(Randomize randomize, ClientKnobs* clientKnobs, IsSi
 	init( QUICK_GET_KEY_VALUES_LIMIT,                           2000 );
 	init( QUICK_GET_KEY_VALUES_LIMIT_BYTES,                      1e7 );
 	init( STORAGE_FEED_QUERY_HARD_LIMIT,                      100000 );
+	init( STORAGE_VERSIONED_DATA_BPLUS_TREE,                   false ); if( randomize && BUGGIFY ) STORAGE_VERSIONED_DATA_BPLUS_TREE = deterministicRandom()->coinflip();
 	// Read priority definitions in the form of a list of their relative concurrency share weights
 	init( STORAGESERVER_READ_PRIORITIES,           "120,10,20,40,60" );
 	// The total concurrency which will be shared by active priorities according to their relative weights
@@ -1228,6 +1254,13 @@ void ServerKnobs::initialize(Randomize randomize, ClientKnobs* clientKnobs, IsSi
 	init( REDWOOD_DEFAULT_EXTENT_READ_SIZE,              1024 * 1024 );
 	init( REDWOOD_EXTENT_CONCURRENT_READS,                         4 );
 	init( REDWOOD_KVSTORE_RANGE_PREFETCH,                       true );
+	init( REDWOOD_COLUMNAR_LEAF_SCANS,                         false ); if( randomize && BUGGIFY ) { REDWOOD_COLUMNAR_LEAF_SCANS = true; }
+	init( REDWOOD_SCAN_AHEAD_MIN_ROWS,                          1000 ); if( randomize && BUGGIFY ) { REDWOOD_SCAN_AHEAD_MIN_ROWS = deterministicRandom()->randomInt(1, 2000); }
+	init( REDWOOD_SCAN_AHEAD_PAGES,                               16 ); if( randomize && BUGGIFY ) { REDWOOD_SCAN_AHEAD_PAGES = deterministicRandom()->randomInt(0, 64); }
+	init( REDWOOD_SCAN_AHEAD_BYTES,                  4 * 1024 * 1024 ); if( randomize && BUGGIFY ) { REDWOOD_SCAN_AHEAD_BYTES = deterministicRandom()->randomInt(0, 1024 * 1024); }
+	init( REDWOOD_PAGE_CACHE_S3FIFO,                           false ); if( randomize && BUGGIFY ) { REDWOOD_PAGE_CACHE_S3FIFO = true; }
+	init( REDWOOD_PAGE_CACHE_S3FIFO_SMALL_FRACTION,             0.10 ); if( randomize && BUGGIFY ) { REDWOOD_PAGE_CACHE_S3FIFO_SMALL_FRACTION = deterministicRandom()->random01() / 2; }
+	init( REDWOOD_PAGE_ENCODE_THREADS,                             0 ); if( randomize && BUGGIFY ) { REDWOOD_PAGE_ENCODE_THREADS = deterministicRandom()->randomInt(1, 4); }
 	init( REDWOOD_PAGE_REBUILD_MAX_SLACK,                       0.33 );
 	init( REDWOOD_PAGE_REBUILD_SLACK_DISTRIBUTION,              0.50 );
 	init( REDWOOD_LAZY_CLEAR_BATCH_SIZE_PAGES,                    10 );
@@ -58,6 +58,42 @@ void TSS_traceMismatch(TraceEvent& event,
 	            tss.value.present() ? traceChecksumValue(tss.value.get()) : "missing");
 }
 
+// batched point reads
+template <>
+bool TSS_doCompare(const GetValuesReply& src, const GetValuesReply& tss) {
+	return src.values == tss.values;
+}
+
+template <>
+const char* LB_mismatchTraceName(const GetValuesRequest& req, const ComparisonType& type) {
+	return type == TSS_COMPARISON ? "TSSMismatchGetValues" : "ReplicaMismatchGetValues";
+}
+
+template <>
+void TSS_traceMismatch(TraceEvent& event,
+                       const GetValuesRequest& req,
+                       const GetValuesReply& src,
+                       const GetValuesReply& tss,
+                       const ComparisonType& type) {
+	// Only the first key whose values differ is traced
+	int i = 0;
+	while (i < req.keys.size() && i < src.values.size() && i < tss.values.size() && src.values[i] == tss.values[i]) {
+		i++;
+	}
+	auto traceValue = [i](const GetValuesReply& reply) -> std::string {
+		if (i >= reply.values.size()) {
+			return "none";
+		}
+		return reply.values[i].present() ? traceChecksumValue(reply.values[i].get()) : "missing";
+	};
+	event.detail("Key", i < req.keys.size() ? req.keys[i] : KeyRef())
+	    .detail("KeyCount", req.keys.size())
+	    .detail("Tenant", req.tenantInfo.tenantId)
+	    .detail("Version", req.version)
+	    .detail(type == TSS_COMPARISON ? "SSReply" : "SourceSSReply", traceValue(src))
+	    .detail(type == TSS_COMPARISON ? "TSSReply" : "ReplicaSSReply", traceValue(tss));
+}
+
 // key selector reads
 template <>
 bool TSS_doCompare(const GetKeyReply& src, const GetKeyReply& tss) {
@@ -449,6 +485,9 @@ void TSSMetrics::recordLatency(const GetValueRequest& req, double ssLatency, dou
 	TSSgetValueLatency.addSample(tssLatency);
 }
 
+template <>
+void TSSMetrics::recordLatency(const GetValuesRequest& req, double ssLatency, double tssLatency) {}
+
 template <>
 void TSSMetrics::recordLatency(const GetKeyRequest& req, double ssLatency, double tssLatency) {
 	SSgetKeyLatency.addSample(ssLatency);
@@ -1579,16 +1579,38 @@ std::pair<Key, Version> decodeChangeFeedDurableKey(ValueRef const& key) {
 	reader >> version;
 	return std::make_pair(feed, bigEndian64(version));
 }
-const Value changeFeedDurableValue(Standalone<VectorRef<MutationRef>> const& mutations, Version knownCommittedVersion) {
+// Uncompressed values start with a protocol version, whose seventh byte is 0xDB, so they never start with this prefix
+const KeyRef changeFeedCompressedValuePrefix = "\xff\xff/cfz/"_sr;
+
+const Value changeFeedDurableValue(Standalone<VectorRef<MutationRef>> const& mutations,
+                                   Version knownCommittedVersion,
+                                   CompressionFilter compression) {
 	BinaryWriter wr(IncludeVersion(ProtocolVersion::withChangeFeed()));
 	wr << mutations;
 	wr << knownCommittedVersion;
-	return wr.toValue();
+	if (compression == CompressionFilter::NONE) {
+		return wr.toValue();
+	}
+	Arena arena;
+	StringRef compressed = CompressionUtils::compress(compression, wr.toValue(), arena);
+	BinaryWriter cwr(Unversioned());
+	cwr.serializeBytes(changeFeedCompressedValuePrefix);
+	cwr << static_cast<uint8_t>(compression);
+	cwr.serializeBytes(compressed);
+	return cwr.toValue();
 }
 std::pair<Standalone<VectorRef<MutationRef>>, Version> decodeChangeFeedDurableValue(ValueRef const& value) {
 	Standalone<VectorRef<MutationRef>> mutations;
 	Version knownCommittedVersion;
-	BinaryReader reader(value, IncludeVersion());
+	StringRef serialized = value;
+	Arena decompressed;
+	if (value.startsWith(changeFeedCompressedValuePrefix)) {
+		ASSERT(value.size() > changeFeedCompressedValuePrefix.size());
+		CompressionFilter compression = static_cast<CompressionFilter>(value[changeFeedCompressedValuePrefix.size()]);
+		serialized = CompressionUtils::decompress(
+		    compression, value.substr(changeFeedCompressedValuePrefix.size() + 1), decompressed);
+	}
+	BinaryReader reader(serialized, IncludeVersion());
 	reader >> mutations;
 	reader >> knownCommittedVersion;
 	return std::make_pair(mutations, knownCommittedVersion);
@@ -2247,3 +2269,30 @@ TEST_CASE("noSim/SystemData/DataMoveId") {
 
 	return Void();
 }
+
+TEST_CASE("/SystemData/ChangeFeedDurableValue") {
+	Standalone<VectorRef<MutationRef>> mutations;
+	for (int i = 0; i < 100; i++) {
+		mutations.push_back_deep(mutations.arena(),
+		                         MutationRef(MutationRef::SetValue,
+		                                     StringRef(format("key%05d", i)),
+		                                     StringRef(std::string(deterministicRandom()->randomInt(0, 200), 'v'))));
+	}
+	mutations.push_back_deep(mutations.arena(), MutationRef(MutationRef::ClearRange, "a"_sr, "b"_sr));
+	const Version knownCommittedVersion = deterministicRandom()->randomInt64(0, 1e12);
+
+	for (auto compression : CompressionUtils::supportedFilters) {
+		Value value = changeFeedDurableValue(mutations, knownCommittedVersion, compression);
+		ASSERT_EQ(value.startsWith(changeFeedCompressedValuePrefix), compression != CompressionFilter::NONE);
+		auto [decoded, decodedVersion] = decodeChangeFeedDurableValue(value);
+		ASSERT_EQ(decodedVersion, knownCommittedVersion);
+		ASSERT_EQ(decoded.size(), mutations.size());
+		for (int i = 0; i < mutations.size(); i++) {
+			ASSERT(decoded[i].type == mutations[i].type);
+			ASSERT(decoded[i].param1 == mutations[i].param1);
+			ASSERT(decoded[i].param2 == mutations[i].param2);
+		}
+	}
+
+	return Void();
+}
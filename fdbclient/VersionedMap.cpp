@@ -18,13 +18,14 @@
  * limitations under the License.
  */
 
+#include "fdbclient/VersionedBPlusTree.h"
 #include "fdbclient/VersionedMap.h"
 #include "flow/TreeBenchmark.h"
 #include "flow/UnitTest.h"
 
-template <typename K>
+template <typename K, template <class, class> class Map = VersionedMap>
 struct VersionedMapHarness {
-	using map = VersionedMap<K, int>;
+	using map = Map<K, int>;
 	using key_type = K;
 
 	struct result {
@@ -74,4 +75,94 @@ TEST_CASE("performance/map/StringRef/VersionedMap") {
 	return Void();
 }
 
+TEST_CASE("performance/map/int/VersionedBPlusTree") {
+	VersionedMapHarness<int, VersionedBPlusTree> tree;
+
+	treeBenchmark(tree, *randomInt);
+
+	return Void();
+}
+
+TEST_CASE("performance/map/StringRef/VersionedBPlusTree") {
+	Arena arena;
+	VersionedMapHarness<StringRef, VersionedBPlusTree> tree;
+
+	treeBenchmark(tree, [&arena]() { return randomStr(arena); });
+
+	return Void();
+}
+
+// Applies the same random sets and clears to both kinds of map, and checks that every retained version reads the same
+TEST_CASE("/fdbclient/VersionedBPlusTree/MatchesVersionedMap") {
+	VersionedMap<int, int> expected;
+	VersionedBPlusTree<int, int> tree;
+	const int keySpace = deterministicRandom()->randomInt(10, 20000);
+	const int window = deterministicRandom()->randomInt(1, 20);
+
+	auto check = [&](Version v) {
+		auto e = expected.at(v);
+		auto t = tree.at(v);
+		t.validate();
+		auto i = e.begin();
+		auto j = t.begin();
+		for (; i != e.end(); ++i, ++j) {
+			ASSERT(j != t.end());
+			ASSERT(i.key() == j.key() && *i == *j && i.insertVersion() == j.insertVersion());
+		}
+		ASSERT(j == t.end());
+		for (int n = 0; n < 100; n++) {
+			int k = deterministicRandom()->randomInt(-1, keySpace + 1);
+			auto a = e.lastLessOrEqual(k);
+			auto b = t.lastLessOrEqual(k);
+			ASSERT(bool(a) == bool(b) && (!a || a.key() == b.key()));
+			a = e.lastLess(k);
+			b = t.lastLess(k);
+			ASSERT(bool(a) == bool(b) && (!a || a.key() == b.key()));
+			a = e.upper_bound(k);
+			b = t.upper_bound(k);
+			ASSERT(bool(a) == bool(b) && (!a || a.key() == b.key()));
+			ASSERT((e.find(k) == e.end()) == (t.find(k) == t.end()));
+		}
+	};
+
+	for (Version v = 1; v <= 200; v++) {
+		expected.createNewVersion(v);
+		tree.createNewVersion(v);
+		int mutations = deterministicRandom()->randomInt(0, 1000);
+		for (int m = 0; m < mutations; m++) {
+			int k = deterministicRandom()->randomInt(0, keySpace);
+			if (deterministicRandom()->random01() < 0.8) {
+				expected.insert(k, m);
+				tree.insert(k, m);
+			} else if (deterministicRandom()->coinflip()) {
+				int end = k + deterministicRandom()->randomInt(1, keySpace / 5 + 2);
+				expected.erase(k, end);
+				tree.erase(k, end);
+			} else {
+				auto i = tree.atLatest().lower_bound(k);
+				if (i) {
+					int key = i.key();
+					expected.erase(key);
+					tree.erase(i);
+				}
+			}
+		}
+		if (v > window) {
+			expected.forgetVersionsBefore(v - window);
+			tree.forgetVersionsBefore(v - window);
+		}
+		for (int n = 0; n < 3; n++) {
+			check(deterministicRandom()->randomInt(std::max<Version>(v - window, 0), v + 1));
+		}
+	}
+
+	// Once the versions that could read them are forgotten, the chunks of replaced nodes are freed
+	tree.erase(0, keySpace);
+	tree.createNewVersion(201);
+	tree.forgetVersionsBefore(201);
+	ASSERT(!tree.atLatest().begin());
+	ASSERT_LE(tree.getBytesAllocated(), (VersionedBPlusTree<int, int>::chunkBytes));
+	return Void();
+}
+
 void forceLinkVersionedMapTests() {}
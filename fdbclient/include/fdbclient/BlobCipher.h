@@ -613,9 +613,10 @@ static_assert(sizeof(BlobCipherEncryptHeader) == BlobCipherEncryptHeader::header
 
 // This interface is in-memory representation of CipherKey used for encryption/decryption information.
 // It caches base encryption key properties as well as caches the 'derived encryption' key obtained by applying
-// HMAC-SHA-256 derivation technique.
+// HMAC-SHA-256 derivation technique. The reference count is atomic since commit proxy helper threads encrypt with
+// keys shared with the network thread.
 
-class BlobCipherKey : public ReferenceCounted<BlobCipherKey>, NonCopyable {
+class BlobCipherKey : public ThreadSafeReferenceCounted<BlobCipherKey>, NonCopyable {
 public:
 	BlobCipherKey(const EncryptCipherDomainId& domainId,
 	              const EncryptCipherBaseKeyId& baseCiphId,
@@ -87,6 +87,15 @@ public:
 	int MAX_BATCH_SIZE;
 	double GRV_BATCH_TIMEOUT;
 	int BROADCAST_BATCH_SIZE;
+	// If true, the GRV batches with the same flags that are ready at the same time are sent to one GRV proxy in a
+	// single GetReadVersionsRequest
+	bool GRV_MULTIPLEX_BATCHES;
+	// If true, concurrent point reads of keys served by the same storage team at the same version are sent together in
+	// one GetValuesRequest. A batch is sent when it has GET_VALUES_BATCH_MAX_KEYS keys, or GET_VALUES_BATCH_WINDOW
+	// seconds after its first read; a window of zero only batches the reads issued in the same pass of the run loop.
+	bool GET_VALUES_BATCHING;
+	double GET_VALUES_BATCH_WINDOW;
+	int GET_VALUES_BATCH_MAX_KEYS;
 	double TRANSACTION_TIMEOUT_DELAY_INTERVAL;
 
 	// When locationCache in DatabaseContext gets to be this size, items will be evicted
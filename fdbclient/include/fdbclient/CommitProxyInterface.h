@@ -360,24 +360,93 @@ struct GetReadVersionRequest : TimedRequest {
 
 	bool isTagged() const { return !tags.empty(); }
 
+	static TransactionPriority priorityFromFlags(uint32_t flags) {
+		if ((flags & PRIORITY_SYSTEM_IMMEDIATE) == PRIORITY_SYSTEM_IMMEDIATE) {
+			return TransactionPriority::IMMEDIATE;
+		} else if ((flags & PRIORITY_DEFAULT) == PRIORITY_DEFAULT) {
+			return TransactionPriority::DEFAULT;
+		} else if ((flags & PRIORITY_BATCH) == PRIORITY_BATCH) {
+			return TransactionPriority::BATCH;
+		} else {
+			return TransactionPriority::DEFAULT;
+		}
+	}
+
 	template <class Ar>
 	void serialize(Ar& ar) {
 		serializer(ar, transactionCount, flags, tags, debugID, reply, spanContext, maxVersion);
 
 		if (ar.isDeserializing) {
-			if ((flags & PRIORITY_SYSTEM_IMMEDIATE) == PRIORITY_SYSTEM_IMMEDIATE) {
-				priority = TransactionPriority::IMMEDIATE;
-			} else if ((flags & PRIORITY_DEFAULT) == PRIORITY_DEFAULT) {
-				priority = TransactionPriority::DEFAULT;
-			} else if ((flags & PRIORITY_BATCH) == PRIORITY_BATCH) {
-				priority = TransactionPriority::BATCH;
-			} else {
-				priority = TransactionPriority::DEFAULT;
-			}
+			priority = priorityFromFlags(flags);
 		}
 	}
 };
 
+// One batch of transactions in a GetReadVersionsRequest. It carries everything a GetReadVersionRequest does except
+// for the reply promise, since the batches of a request share its reply.
+struct GetReadVersionBatch {
+	constexpr static FileIdentifier file_identifier = 6120884;
+
+	SpanContext spanContext;
+	uint32_t transactionCount;
+	uint32_t flags;
+	TransactionTagMap<uint32_t> tags;
+	Optional<UID> debugID;
+	Version maxVersion;
+
+	GetReadVersionBatch() : transactionCount(1), flags(0), maxVersion(invalidVersion) {}
+	GetReadVersionBatch(SpanContext spanContext,
+	                    uint32_t transactionCount,
+	                    uint32_t flags,
+	                    TransactionTagMap<uint32_t> tags,
+	                    Optional<UID> debugID,
+	                    Version maxVersion)
+	  : spanContext(spanContext), transactionCount(transactionCount), flags(flags), tags(std::move(tags)),
+	    debugID(debugID), maxVersion(maxVersion) {}
+
+	TransactionPriority priority() const { return GetReadVersionRequest::priorityFromFlags(flags); }
+
+	// The request the GRV proxy queues and starts for this batch
+	GetReadVersionRequest toRequest() const {
+		return GetReadVersionRequest(spanContext, transactionCount, priority(), maxVersion, flags, tags, debugID);
+	}
+
+	template <class Ar>
+	void serialize(Ar& ar) {
+		serializer(ar, spanContext, transactionCount, flags, tags, debugID, maxVersion);
+	}
+};
+
+struct GetReadVersionsReply : public BasicLoadBalancedReply {
+	constexpr static FileIdentifier file_identifier = 3960255;
+
+	// The reply to each batch of the request, in the same order. A batch that could not be started, e.g. because it
+	// was throttled, gets the error its own GetReadVersionRequest would have failed with.
+	std::vector<ErrorOr<GetReadVersionReply>> replies;
+
+	template <class Ar>
+	void serialize(Ar& ar) {
+		serializer(ar, BasicLoadBalancedReply::processBusyTime, replies);
+	}
+};
+
+// Several GetReadVersionRequests sent to a GRV proxy as one message. Each batch is queued and throttled on its own, as
+// if it had been sent separately, but the reply waits for all of them. Clients therefore only combine batches with the
+// same flags, so that a higher priority batch never waits for a lower priority one.
+struct GetReadVersionsRequest : TimedRequest {
+	constexpr static FileIdentifier file_identifier = 4187343;
+
+	std::vector<GetReadVersionBatch> batches;
+	ReplyPromise<GetReadVersionsReply> reply;
+
+	bool verify() const { return true; }
+
+	template <class Ar>
+	void serialize(Ar& ar) {
+		serializer(ar, batches, reply);
+	}
+};
+
 struct GetTenantIdReply {
 	constexpr static FileIdentifier file_identifier = 11441284;
 	int64_t tenantId = TenantInfo::INVALID_TENANT;
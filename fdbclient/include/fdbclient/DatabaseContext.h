@@ -524,6 +524,27 @@ public:
 	};
 	std::map<uint32_t, VersionBatcher> versionBatcher;
 
+	// A batch of a VersionBatcher waiting for the readVersionMultiplexer, see CLIENT_KNOBS->GRV_MULTIPLEX_BATCHES
+	struct ReadVersionBatchRequest {
+		GetReadVersionBatch batch;
+		Promise<GetReadVersionReply> reply;
+
+		explicit ReadVersionBatchRequest(GetReadVersionBatch batch) : batch(std::move(batch)) {}
+	};
+	PromiseStream<ReadVersionBatchRequest> readVersionBatches;
+	Future<Void> readVersionMultiplexer;
+
+	// A point read waiting in the getValuesBatcher, see CLIENT_KNOBS->GET_VALUES_BATCHING
+	struct GetValueBatchRequest {
+		Reference<LocationInfo> locations;
+		GetValueRequest request;
+
+		GetValueBatchRequest(Reference<LocationInfo> locations, GetValueRequest request)
+		  : locations(std::move(locations)), request(std::move(request)) {}
+	};
+	PromiseStream<GetValueBatchRequest> getValueBatchRequests;
+	Future<Void> getValuesBatcher;
+
 	AsyncTrigger connectionFileChangedTrigger;
 
 	// Disallow any reads at a read version lower than minAcceptableReadVersion.  This way the client does not have to
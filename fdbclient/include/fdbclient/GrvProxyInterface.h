@@ -44,6 +44,8 @@ struct GrvProxyInterface {
 	RequestStream<ReplyPromise<Void>> waitFailure; // reports heartbeat to master.
 	RequestStream<struct GetHealthMetricsRequest> getHealthMetrics;
 	PublicRequestStream<struct GlobalConfigRefreshRequest> refreshGlobalConfig;
+	// Serves several batches of getConsistentReadVersion requests in one round trip, see GetReadVersionsRequest
+	PublicRequestStream<struct GetReadVersionsRequest> getConsistentReadVersions;
 
 	UID id() const { return getConsistentReadVersion.getEndpoint().token; }
 	std::string toString() const { return id().shortString(); }
@@ -62,6 +64,8 @@ struct GrvProxyInterface {
 			    getConsistentReadVersion.getEndpoint().getAdjustedEndpoint(2));
 			refreshGlobalConfig = PublicRequestStream<struct GlobalConfigRefreshRequest>(
 			    getConsistentReadVersion.getEndpoint().getAdjustedEndpoint(3));
+			getConsistentReadVersions = PublicRequestStream<struct GetReadVersionsRequest>(
+			    getConsistentReadVersion.getEndpoint().getAdjustedEndpoint(4));
 		}
 	}
 
@@ -71,6 +75,7 @@ struct GrvProxyInterface {
 		streams.push_back(waitFailure.getReceiver());
 		streams.push_back(getHealthMetrics.getReceiver());
 		streams.push_back(refreshGlobalConfig.getReceiver());
+		streams.push_back(getConsistentReadVersions.getReceiver(TaskPriority::ReadSocket));
 		FlowTransport::transport().addEndpoints(streams);
 	}
 };
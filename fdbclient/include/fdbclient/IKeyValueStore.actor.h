@@ -33,6 +33,7 @@
 #include "fdbclient/IClosable.h"
 #include "fdbclient/KeyRangeMap.h"
 #include "flow/flow.h"
+#include "flow/genericactors.actor.h"
 
 #include "flow/actorcompiler.h" // This must be the last #include.
 
@@ -75,6 +76,19 @@ public:
 	                                                int maxLength,
 	                                                Optional<ReadOptions> options = Optional<ReadOptions>()) = 0;
 
+	// Like readValue() for each of keys, with the values returned in the order of keys. The keys only need to be
+	// valid for the duration of the call. Engines that can look up a batch of keys more cheaply than one at a time
+	// override this, and read keys given in ascending order most efficiently.
+	virtual Future<std::vector<Optional<Value>>> readValues(VectorRef<KeyRef> keys,
+	                                                        Optional<ReadOptions> options = Optional<ReadOptions>()) {
+		std::vector<Future<Optional<Value>>> values;
+		values.reserve(keys.size());
+		for (const auto& key : keys) {
+			values.push_back(readValue(key, options));
+		}
+		return getAll(values);
+	}
+
 	// If rowLimit>=0, reads first rows sorted ascending, otherwise reads last rows sorted descending
 	// The total size of the returned value (less the last entry) will be less than byteLimit
 	virtual Future<RangeResult> readRange(KeyRangeRef keys,
@@ -73,6 +73,10 @@ public:
 	bool ENABLE_DETAILED_TLOG_POP_TRACE;
 	double TLOG_MESSAGE_BLOCK_OVERHEAD_FACTOR;
 	int64_t TLOG_MESSAGE_BLOCK_BYTES;
+	bool TLOG_COMPRESS_MESSAGES; // Compress the messages of the oldest versions a TLog holds in memory
+	std::string TLOG_MESSAGE_COMPRESSION_FILTER;
+	int64_t TLOG_COMPRESS_MESSAGES_MIN_UNCOMPRESSED_BYTES; // Message bytes of the newest versions kept uncompressed
+	int TLOG_COMPRESSED_MESSAGES_CHUNK_BYTES; // Uncompressed size of the chunks a tag's messages are compressed in
 	int64_t MAX_MESSAGE_SIZE;
 	int LOG_SYSTEM_PUSHED_DATA_BLOCK_SIZE;
 	double PEEK_TRACKER_EXPIRATION_TIME;
@@ -89,6 +93,7 @@ public:
 	int64_t TLOG_SPILL_REFERENCE_MAX_PEEK_MEMORY_BYTES;
 	int64_t TLOG_SPILL_REFERENCE_MAX_BATCHES_PER_PEEK;
 	int64_t TLOG_SPILL_REFERENCE_MAX_BYTES_PER_BATCH;
+	int64_t TLOG_SPILL_REFERENCE_READ_GAP_BYTES; // Spilled versions this close in the disk queue are read together
 	int64_t DISK_QUEUE_FILE_EXTENSION_BYTES; // When we grow the disk queue, by how many bytes should it grow?
 	int64_t DISK_QUEUE_FILE_SHRINK_BYTES; // When we shrink the disk queue, by how many bytes should it shrink?
 	int64_t DISK_QUEUE_MAX_TRUNCATE_BYTES; // A truncate larger than this will cause the file to be replaced instead.
@@ -666,6 +671,14 @@ public:
 	int COMMIT_TRANSACTION_BATCH_BYTES_MAX;
 	double COMMIT_TRANSACTION_BATCH_BYTES_SCALE_BASE;
 	double COMMIT_TRANSACTION_BATCH_BYTES_SCALE_POWER;
+	// Choose the commit batch interval and size from an online model of resolver and TLog latency per batch size,
+	// instead of the knobs above, so that predicted commit latency stays within COMMIT_BATCHING_LATENCY_SLO
+	bool COMMIT_BATCHING_ADAPTIVE;
+	double COMMIT_BATCHING_LATENCY_SLO;
+	double COMMIT_BATCHING_MODEL_ALPHA; // Weight of each new batch in the latency model
+	double COMMIT_BATCHING_ARRIVAL_RATE_WINDOW; // e-folding time of the smoothed commit byte arrival rate
+	int COMMIT_BATCHING_ADAPTIVE_BYTES_MIN;
+	int COMMIT_BATCHING_ADAPTIVE_BYTES_MAX;
 	int64_t COMMIT_BATCHES_MEM_BYTES_HARD_LIMIT;
 	double COMMIT_BATCHES_MEM_FRACTION_OF_TOTAL;
 	double COMMIT_BATCHES_MEM_TO_TOTAL_MEM_SCALE_FACTOR;
@@ -690,6 +703,10 @@ public:
 	int TXN_STATE_SEND_AMOUNT;
 	double REPORT_TRANSACTION_COST_ESTIMATION_DELAY;
 	bool PROXY_REJECT_BATCH_QUEUED_TOO_LONG;
+	// Number of helper threads that look up shards and encrypt mutations for the commit proxy's second pass over a
+	// batch, in chunks of about PROXY_ASSIGN_MUTATIONS_CHUNK_BYTES. 0 keeps all of it on the network thread.
+	int PROXY_ASSIGN_MUTATIONS_THREADS;
+	int PROXY_ASSIGN_MUTATIONS_CHUNK_BYTES;
 	bool PROXY_USE_RESOLVER_PRIVATE_MUTATIONS;
 	bool BURSTINESS_METRICS_ENABLED;
 	// Interval on which to emit burstiness metrics on the commit proxy (in
@@ -725,6 +742,10 @@ public:
 	double SAMPLE_EXPIRATION_TIME;
 	double SAMPLE_POLL_TIME;
 	int64_t RESOLVER_STATE_MEMORY_LIMIT;
+	// Number of key range partitions a batch is resolved in. Outside of simulation, each partition beyond the first
+	// runs on its own worker thread. Batches with fewer conflict ranges than the minimum are resolved serially.
+	int RESOLVER_CONFLICT_SET_PARTITIONS;
+	int RESOLVER_CONFLICT_SET_PARALLEL_MIN_RANGES;
 
 	// Backup Worker
 	double BACKUP_TIMEOUT; // master's reaction time for backup failure
@@ -1062,6 +1083,9 @@ public:
 	int FETCH_KEYS_PARALLELISM_BYTES;
 	int FETCH_KEYS_PARALLELISM;
 	int FETCH_KEYS_PARALLELISM_CHANGE_FEED;
+	int FETCH_KEYS_PARALLEL_RANGES; // Sub-ranges of a fetched shard read at once from the source servers
+	int FETCH_KEYS_PARALLEL_RANGE_BYTES; // Size of the sub-ranges, by the byte sample of the source servers
+	int FETCH_KEYS_PARALLEL_BYTES; // Budget of a storage server for sub-ranges being read ahead of being written
 	int FETCH_KEYS_LOWER_PRIORITY;
 	int SERVE_FETCH_CHECKPOINT_PARALLELISM;
 	int SERVE_AUDIT_STORAGE_PARALLELISM;
@@ -1087,11 +1111,17 @@ public:
 	int STORAGE_FETCH_BYTES;
 	int STORAGE_ROCKSDB_FETCH_BYTES;
 	double STORAGE_COMMIT_INTERVAL;
+	// Threads that decrypt and validate the mutations a storage server pulls from the TLogs, in chunks of about
+	// STORAGE_UPDATE_PREPARE_CHUNK_BYTES. 0 keeps all of it on the network thread.
+	int STORAGE_UPDATE_PREPARE_THREADS;
+	int STORAGE_UPDATE_PREPARE_CHUNK_BYTES;
 	int BYTE_SAMPLING_FACTOR;
 	int BYTE_SAMPLING_OVERHEAD;
 	double MIN_BYTE_SAMPLING_PROBABILITY; // Adjustable only for test of PhysicalShardMove. Should always be 0 for other
 	                                      // cases
 	int MAX_STORAGE_SERVER_WATCH_BYTES;
+	bool STORAGE_SERVER_WATCH_INDEX; // Check watched keys against applied mutations in bulk, rather than by an actor
+	                                 // per watched key
 	int MAX_BYTE_SAMPLE_CLEAR_MAP_SIZE;
 	double LONG_BYTE_SAMPLE_RECOVERY_DELAY;
 	int BYTE_SAMPLE_LOAD_PARALLELISM;
@@ -1116,7 +1146,14 @@ public:
 	double FETCH_KEYS_TOO_LONG_TIME_CRITERIA;
 	double MAX_STORAGE_COMMIT_TIME;
 	int64_t RANGESTREAM_LIMIT_BYTES;
+	int RANGESTREAM_READ_AHEAD_CHUNKS; // Chunks of a range stream that can be read before the earlier ones are sent
 	int64_t CHANGEFEEDSTREAM_LIMIT_BYTES;
+	bool CHANGE_FEED_SHARE_MUTATIONS; // Copy a mutation added to several change feeds once, rather than once per feed
+	// Compression of the change feed mutations a storage server makes durable, for versions with at least
+	// CHANGE_FEED_DURABLE_COMPRESSION_MIN_BYTES of them. Versions that predate it cannot read compressed
+	// values, so it is not buggified: downgrade restarting tests would break.
+	std::string CHANGE_FEED_DURABLE_COMPRESSION_FILTER;
+	int CHANGE_FEED_DURABLE_COMPRESSION_MIN_BYTES;
 	int64_t BLOBWORKERSTATUSSTREAM_LIMIT_BYTES;
 	bool ENABLE_CLEAR_RANGE_EAGER_READS;
 	bool QUICK_GET_VALUE_FALLBACK;
@@ -1128,6 +1165,7 @@ public:
 	int QUICK_GET_KEY_VALUES_LIMIT;
 	int QUICK_GET_KEY_VALUES_LIMIT_BYTES;
 	int STORAGE_FEED_QUERY_HARD_LIMIT;
+	bool STORAGE_VERSIONED_DATA_BPLUS_TREE; // Keep the MVCC window of storage servers in a VersionedBPlusTree
 	std::string STORAGESERVER_READ_PRIORITIES;
 	int STORAGE_SERVER_READ_CONCURRENCY;
 	std::string STORAGESERVER_READTYPE_PRIORITY_MAP;
@@ -1284,6 +1322,13 @@ public:
 	int REDWOOD_DEFAULT_EXTENT_READ_SIZE; // Extent read size for Redwood files
 	int REDWOOD_EXTENT_CONCURRENT_READS; // Max number of simultaneous extent disk reads in progress.
 	bool REDWOOD_KVSTORE_RANGE_PREFETCH; // Whether to use range read prefetching
+	bool REDWOOD_COLUMNAR_LEAF_SCANS; // Whether range reads scan a columnar image of leaf pages cached with the page
+	int REDWOOD_SCAN_AHEAD_MIN_ROWS; // Range reads with at least this row limit read ahead of the scan
+	int REDWOOD_SCAN_AHEAD_PAGES; // Max leaf pages read ahead of a range read, 0 to disable
+	int REDWOOD_SCAN_AHEAD_BYTES; // Max page bytes read ahead of a range read
+	bool REDWOOD_PAGE_CACHE_S3FIFO; // Whether the page cache evicts with scan resistant S3-FIFO instead of LRU
+	double REDWOOD_PAGE_CACHE_S3FIFO_SMALL_FRACTION; // Fraction of the page cache given to S3-FIFO's small queue
+	int REDWOOD_PAGE_ENCODE_THREADS; // Threads that checksum and encrypt BTree pages being written, 0 to do it inline
 	double REDWOOD_PAGE_REBUILD_MAX_SLACK; // When rebuilding pages, max slack to allow in page before extending it
 	double REDWOOD_PAGE_REBUILD_SLACK_DISTRIBUTION; // When rebuilding pages, use this ratio of slack distribution
 	                                                // between the rightmost (new) page and the previous page. Defaults
@@ -41,6 +41,7 @@
 #include "fdbclient/Tracing.h"
 #include "flow/UnitTest.h"
 #include "fdbclient/VersionVector.h"
+#include "fdbclient/VersionedBPlusTree.h"
 
 // Dead code, removed in the next protocol version
 struct VersionReply {
@@ -128,6 +129,9 @@ struct StorageServerInterface {
 	RequestStream<struct GetStorageCheckSumRequest> getCheckSum;
 	RequestStream<struct BulkDumpRequest> bulkdump;
 
+	// Point reads of several keys at the same version, answered with a single version wait
+	PublicRequestStream<struct GetValuesRequest> getValues;
+
 private:
 	bool acceptingRequests;
 
@@ -197,6 +201,7 @@ public:
 			getCheckSum =
 			    RequestStream<struct GetStorageCheckSumRequest>(getValue.getEndpoint().getAdjustedEndpoint(25));
 			bulkdump = RequestStream<struct BulkDumpRequest>(getValue.getEndpoint().getAdjustedEndpoint(26));
+			getValues = PublicRequestStream<struct GetValuesRequest>(getValue.getEndpoint().getAdjustedEndpoint(27));
 		}
 	}
 	bool operator==(StorageServerInterface const& s) const { return uniqueID == s.uniqueID; }
@@ -230,6 +235,7 @@ public:
 		streams.push_back(getHotShards.getReceiver());
 		streams.push_back(getCheckSum.getReceiver());
 		streams.push_back(bulkdump.getReceiver());
+		streams.push_back(getValues.getReceiver(TaskPriority::LoadBalancedEndpoint));
 		FlowTransport::transport().addEndpoints(streams);
 	}
 };
@@ -313,6 +319,45 @@ struct GetValueRequest : TimedRequest {
 	}
 };
 
+struct GetValuesReply : public LoadBalancedReply {
+	constexpr static FileIdentifier file_identifier = 1378930;
+	Arena arena;
+	VectorRef<Optional<ValueRef>> values; // in the order of GetValuesRequest::keys
+	bool cached;
+
+	GetValuesReply() : cached(false) {}
+
+	template <class Ar>
+	void serialize(Ar& ar) {
+		serializer(ar, LoadBalancedReply::penalty, LoadBalancedReply::error, values, cached, arena);
+	}
+};
+
+// The batched form of GetValueRequest. All of the keys must be in shards of the same storage team, and are read at the
+// same version.
+struct GetValuesRequest : TimedRequest {
+	constexpr static FileIdentifier file_identifier = 8454531;
+	SpanContext spanContext;
+	TenantInfo tenantInfo;
+	Arena arena;
+	VectorRef<KeyRef> keys;
+	Version version;
+	Optional<TagSet> tags;
+	ReplyPromise<GetValuesReply> reply;
+	Optional<ReadOptions> options;
+	VersionVector ssLatestCommitVersions; // includes the latest commit versions, as known
+	                                      // to this client, of all storage replicas that
+	                                      // serve the given keys
+	GetValuesRequest() {}
+
+	bool verify() const { return tenantInfo.isAuthorized(); }
+
+	template <class Ar>
+	void serialize(Ar& ar) {
+		serializer(ar, keys, version, tags, reply, spanContext, tenantInfo, options, ssLatestCommitVersions, arena);
+	}
+};
+
 struct WatchValueReply {
 	constexpr static FileIdentifier file_identifier = 3;
 
@@ -1317,8 +1362,14 @@ struct BulkDumpRequest {
 	}
 };
 
-// Memory size for storing mutation in the mutation log and the versioned map.
-inline int mvccStorageBytes(int mutationBytes) {
+// Memory size for storing mutation in the mutation log and the versioned map. bPlusTree is true if the versioned map is
+// a VersionedBPlusTree rather than a VersionedMap.
+inline int mvccStorageBytes(int mutationBytes, bool bPlusTree = false) {
+	// The mutation will be stored in both mutation log and versioned map
+	if (bPlusTree) {
+		return VersionedBPlusTree<KeyRef, ValueOrClearToRef>::overheadPerItem +
+		       (mutationBytes + MutationRef::OVERHEAD_BYTES) * 2;
+	}
 	// Why * 2:
 	// - 1 insertion into version map costs 2 nodes in avg;
 	// - The mutation will be stored in both mutation log and versioned map;
@@ -32,6 +32,7 @@
 #include "fdbclient/RangeLock.h"
 #include "fdbclient/StorageServerInterface.h"
 #include "fdbclient/Tenant.h"
+#include "flow/CompressionUtils.h"
 
 // Don't warn on constants being defined in this file.
 #pragma clang diagnostic push
@@ -730,7 +731,12 @@ extern const KeyRef changeFeedDurablePrefix;
 
 const Value changeFeedDurableKey(Key const& feed, Version version);
 std::pair<Key, Version> decodeChangeFeedDurableKey(ValueRef const& key);
-const Value changeFeedDurableValue(Standalone<VectorRef<MutationRef>> const& mutations, Version knownCommittedVersion);
+// Values written with a compression filter other than NONE start with changeFeedCompressedValuePrefix, and can only be
+// decoded by versions that know about it.
+extern const KeyRef changeFeedCompressedValuePrefix;
+const Value changeFeedDurableValue(Standalone<VectorRef<MutationRef>> const& mutations,
+                                   Version knownCommittedVersion,
+                                   CompressionFilter compression = CompressionFilter::NONE);
 std::pair<Standalone<VectorRef<MutationRef>>, Version> decodeChangeFeedDurableValue(ValueRef const& value);
 
 extern const KeyRangeRef changeFeedCacheKeys;
@@ -0,0 +1,835 @@
+/*
+ * VersionedBPlusTree.h
+ *
+ * This source file is part of the FoundationDB open source project
+ *
+ * Copyright 2013-2024 Apple Inc. and the FoundationDB project authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FDBCLIENT_VERSIONEDBPLUSTREE_H
+#define FDBCLIENT_VERSIONEDBPLUSTREE_H
+#pragma once
+
+#include <algorithm>
+#include <deque>
+#include <type_traits>
+#include <variant>
+
+#include "flow/flow.h"
+#include "fdbclient/VersionedMap.h"
+
+// VersionedBPlusTree has the interface of VersionedMap, but instead of a partially persistent treap with an item per
+// node it is a copy-on-write B+tree with wide nodes. The keys of a node are contiguous, so a lookup touches a few
+// cache lines per level and a scan walks along arrays instead of following a pointer per item.
+//
+// A node is changed in place only at the version that created it. Changing it at a later version copies it, along
+// with its ancestors, and the old node is then reachable only from the roots of older versions. Nodes are carved out
+// of large chunks in the order they are created, and rather than counting references to each node, a chunk counts its
+// nodes which have not been replaced yet. Replaced nodes are remembered along with the version that replaced them, and
+// forgetVersionsBefore() releases them and frees every chunk whose nodes are all gone.
+//
+// Keys and values are copied around with the nodes, so they must be trivially copyable. Like VersionedMap, the tree
+// doesn't own the memory they refer to.
+template <class K, class T>
+class VersionedBPlusTree : NonCopyable {
+	static_assert(std::is_trivially_copyable_v<K> && std::is_trivially_copyable_v<T>);
+
+public:
+	// Entries per node
+	static constexpr int nodeCapacity = 32;
+	// Nodes other than the root are kept at least this full
+	static constexpr int minNodeEntries = nodeCapacity / 4;
+	// Since every node but the root has at least minNodeEntries children, this is deeper than any tree can get
+	static constexpr int maxHeight = 16;
+	static constexpr int chunkBytes = 64 << 10;
+
+private:
+	struct Chunk {
+		Chunk* prev;
+		Chunk* next;
+		int used; // Bytes handed out, including this header
+		int live; // Nodes carved out of this chunk which haven't been released
+	};
+
+	struct Node {
+		Chunk* chunk;
+		Version version; // The version that created this node, which is the only one it may be changed at
+		int count;
+		bool leaf;
+		// In an internal node, keys[i] <= every key under children[i] < keys[i + 1]. keys[0] is not used for searches.
+		K keys[nodeCapacity];
+	};
+
+	struct Leaf : Node {
+		Version insertVersions[nodeCapacity];
+		alignas(T) uint8_t valueBytes[sizeof(T) * nodeCapacity];
+
+		T* values() { return reinterpret_cast<T*>(valueBytes); }
+		T const* values() const { return reinterpret_cast<T const*>(valueBytes); }
+	};
+
+	struct Internal : Node {
+		Node* children[nodeCapacity];
+	};
+
+	static_assert(alignof(Leaf) <= 8 && alignof(Internal) <= 8);
+
+public:
+	// Memory a mutation adds to the MVCC window. Changing a key at a new version copies its leaf and the internal nodes
+	// above it, but the keys changed at the same version share the copies of the upper levels, so an item is charged
+	// a leaf and one internal node.
+	static constexpr int overheadPerItem = sizeof(Leaf) + sizeof(Internal);
+	// Memory a version adds: its entry in roots and the copy of the root that its first change makes
+	static constexpr int overheadPerVersion = sizeof(std::pair<Version, Node*>) + sizeof(Internal);
+
+private:
+
+	static Leaf* asLeaf(Node* n) { return static_cast<Leaf*>(n); }
+	static Leaf const* asLeaf(Node const* n) { return static_cast<Leaf const*>(n); }
+	static Internal* asInternal(Node* n) { return static_cast<Internal*>(n); }
+	static Internal const* asInternal(Node const* n) { return static_cast<Internal const*>(n); }
+
+	// Index of the child of an internal node whose keys may include key
+	template <class X>
+	static int childIndex(Node const* n, const X& key) {
+		return std::upper_bound(n->keys + 1, n->keys + n->count, key) - n->keys - 1;
+	}
+	// Index of the first key of a leaf which is >= key, or count
+	template <class X>
+	static int lowerIndex(Node const* n, const X& key) {
+		return std::lower_bound(n->keys, n->keys + n->count, key) - n->keys;
+	}
+	// Index of the first key of a leaf which is > key, or count
+	template <class X>
+	static int upperIndex(Node const* n, const X& key) {
+		return std::upper_bound(n->keys, n->keys + n->count, key) - n->keys;
+	}
+
+	// Copies n entries of a node to a node of the same kind, which may be the same node if to is before from
+	static void copyEntries(Node const* from, int begin, int n, Node* to, int at) {
+		std::copy(from->keys + begin, from->keys + begin + n, to->keys + at);
+		if (from->leaf) {
+			std::copy(asLeaf(from)->insertVersions + begin,
+			          asLeaf(from)->insertVersions + begin + n,
+			          asLeaf(to)->insertVersions + at);
+			std::copy(asLeaf(from)->values() + begin, asLeaf(from)->values() + begin + n, asLeaf(to)->values() + at);
+		} else {
+			std::copy(asInternal(from)->children + begin,
+			          asInternal(from)->children + begin + n,
+			          asInternal(to)->children + at);
+		}
+	}
+
+	// Makes room for n entries before index at
+	static void openGap(Node* node, int at, int n) {
+		int end = node->count;
+		std::copy_backward(node->keys + at, node->keys + end, node->keys + end + n);
+		if (node->leaf) {
+			Leaf* leaf = asLeaf(node);
+			std::copy_backward(leaf->insertVersions + at, leaf->insertVersions + end, leaf->insertVersions + end + n);
+			std::copy_backward(leaf->values() + at, leaf->values() + end, leaf->values() + end + n);
+		} else {
+			Internal* internal = asInternal(node);
+			std::copy_backward(internal->children + at, internal->children + end, internal->children + end + n);
+		}
+		node->count += n;
+	}
+
+	// Removes the n entries starting at index at
+	static void removeEntries(Node* node, int at, int n) {
+		copyEntries(node, at + n, node->count - at - n, node, at);
+		node->count -= n;
+	}
+
+	static void setEntry(Leaf* leaf, int i, const K& key, const T& value, Version insertVersion) {
+		leaf->keys[i] = key;
+		leaf->values()[i] = value;
+		leaf->insertVersions[i] = insertVersion;
+	}
+
+	static void setEntry(Internal* internal, int i, const K& key, Node* child) {
+		internal->keys[i] = key;
+		internal->children[i] = child;
+	}
+
+public:
+	struct iterator {
+		explicit iterator(Node const* root, Version at) : root(root), at(at) {}
+
+		K const& key() const { return nodes[height - 1]->keys[index[height - 1]]; }
+		// Returns the version at which the current item was inserted
+		Version insertVersion() const { return asLeaf(nodes[height - 1])->insertVersions[index[height - 1]]; }
+		operator bool() const { return height != 0; }
+		bool operator<(const K& key) const { return this->key() < key; }
+
+		T const& operator*() const { return asLeaf(nodes[height - 1])->values()[index[height - 1]]; }
+		T const* operator->() const { return &**this; }
+		void operator++() {
+			if (height)
+				next();
+			else
+				descend(root, false);
+		}
+		void operator--() {
+			if (height)
+				previous();
+			else
+				descend(root, true);
+		}
+		bool operator==(const iterator& r) const {
+			if (height && r.height)
+				return nodes[height - 1] == r.nodes[r.height - 1] && index[height - 1] == r.index[r.height - 1];
+			else
+				return height == r.height;
+		}
+		bool operator!=(const iterator& r) const { return !(*this == r); }
+
+	private:
+		friend class VersionedBPlusTree<K, T>;
+
+		// Moves to the first or last item under n, which is at depth height
+		void descend(Node const* n, bool last) {
+			if (!n)
+				return;
+			while (true) {
+				int i = last ? n->count - 1 : 0;
+				nodes[height] = n;
+				index[height++] = i;
+				if (n->leaf)
+					return;
+				n = asInternal(n)->children[i];
+			}
+		}
+
+		void next() {
+			for (int level = height - 1; level >= 0; --level) {
+				if (++index[level] < nodes[level]->count) {
+					height = level + 1;
+					if (!nodes[level]->leaf)
+						descend(asInternal(nodes[level])->children[index[level]], false);
+					return;
+				}
+			}
+			height = 0;
+		}
+
+		void previous() {
+			for (int level = height - 1; level >= 0; --level) {
+				if (index[level] > 0) {
+					--index[level];
+					height = level + 1;
+					if (!nodes[level]->leaf)
+						descend(asInternal(nodes[level])->children[index[level]], true);
+					return;
+				}
+			}
+			height = 0;
+		}
+
+		// Moves to the first item >= key, or > key if upper
+		template <class X>
+		void seek(const X& key, bool upper) {
+			height = 0;
+			Node const* n = root;
+			if (!n)
+				return;
+			while (!n->leaf) {
+				int i = childIndex(n, key);
+				nodes[height] = n;
+				index[height++] = i;
+				n = asInternal(n)->children[i];
+			}
+			int i = upper ? upperIndex(n, key) : lowerIndex(n, key);
+			nodes[height] = n;
+			if (i < n->count) {
+				index[height++] = i;
+			} else {
+				// Every key of this leaf is before key, so the item is the first one of the next leaf
+				index[height++] = n->count - 1;
+				next();
+			}
+		}
+
+		Node const* root;
+		Version at;
+		Node const* nodes[maxHeight];
+		int index[maxHeight];
+		int height = 0;
+	};
+
+	class ViewAtVersion {
+	public:
+		ViewAtVersion(Node const* root, Version at) : root(root), at(at) {}
+
+		iterator begin() const {
+			iterator i(root, at);
+			++i;
+			return i;
+		}
+		iterator end() const { return iterator(root, at); }
+
+		// Returns x such that key==*x, or end()
+		template <class X>
+		iterator find(const X& key) const {
+			iterator i(root, at);
+			i.seek(key, false);
+			if (i && i.key() == key)
+				return i;
+			else
+				return end();
+		}
+
+		// Returns the smallest x such that *x>=key, or end()
+		template <class X>
+		iterator lower_bound(const X& key) const {
+			iterator i(root, at);
+			i.seek(key, false);
+			return i;
+		}
+
+		// Returns the smallest x such that *x>key, or end()
+		template <class X>
+		iterator upper_bound(const X& key) const {
+			iterator i(root, at);
+			i.seek(key, true);
+			return i;
+		}
+
+		// Returns the largest x such that *x<=key, or end()
+		template <class X>
+		iterator lastLessOrEqual(const X& key) const {
+			iterator i = upper_bound(key);
+			--i;
+			return i;
+		}
+
+		// Returns the largest x such that *x<key, or end()
+		template <class X>
+		iterator lastLess(const X& key) const {
+			iterator i = lower_bound(key);
+			--i;
+			return i;
+		}
+
+		void validate() const {
+			if (root) {
+				int count = 0;
+				validate(root, nullptr, nullptr, true, count);
+			}
+		}
+
+	private:
+		// Checks the ordering and fullness of the subtree under n, whose keys are in [lo, hi), and returns its height
+		static int validate(Node const* n, K const* lo, K const* hi, bool isRoot, int& count) {
+			ASSERT(n->count > 0 && n->count <= nodeCapacity);
+			ASSERT(isRoot || n->count >= minNodeEntries);
+			if (n->leaf) {
+				for (int i = 0; i < n->count; i++) {
+					ASSERT(!lo || !(n->keys[i] < *lo));
+					ASSERT(!hi || n->keys[i] < *hi);
+					ASSERT(i == 0 || n->keys[i - 1] < n->keys[i]);
+				}
+				count += n->count;
+				return 1;
+			}
+			ASSERT(!isRoot || n->count >= 2);
+			int height = 0;
+			for (int i = 0; i < n->count; i++) {
+				K const* childLo = i ? &n->keys[i] : lo;
+				K const* childHi = i + 1 < n->count ? &n->keys[i + 1] : hi;
+				ASSERT(i == 0 || !lo || !(n->keys[i] < *lo));
+				ASSERT(i == 0 || !hi || n->keys[i] < *hi);
+				ASSERT(i < 2 || n->keys[i - 1] < n->keys[i]);
+				int h = validate(asInternal(n)->children[i], childLo, childHi, false, count);
+				ASSERT(i == 0 || h == height);
+				height = h;
+			}
+			return height + 1;
+		}
+
+		Node const* root;
+		Version at;
+	};
+
+	VersionedBPlusTree() : oldestVersion(0), latestVersion(0) { roots.emplace_back(0, nullptr); }
+	VersionedBPlusTree(VersionedBPlusTree&& v) noexcept : VersionedBPlusTree() { swap(v); }
+	void operator=(VersionedBPlusTree&& v) noexcept { swap(v); }
+	~VersionedBPlusTree() {
+		while (chunks)
+			freeChunk(chunks);
+	}
+
+	Version getLatestVersion() const { return latestVersion; }
+	Version getOldestVersion() const { return oldestVersion; }
+
+	// Memory held by the chunks of the tree, including replaced nodes which older versions may still read
+	int64_t getBytesAllocated() const { return int64_t(chunkCount) * chunkBytes; }
+
+	void forgetVersionsBefore(Version newOldestVersion) {
+		ASSERT(newOldestVersion <= latestVersion);
+		auto r = upper_bound(roots.begin(), roots.end(), newOldestVersion, rootsComparator());
+		auto upper = r;
+		--r;
+		// if the specified newOldestVersion does not exist, insert a new
+		// entry-pair with newOldestVersion and the root from next lower version
+		if (r->first != newOldestVersion) {
+			Node* root = r->second;
+			r = roots.emplace(upper, newOldestVersion, root);
+		}
+
+		UNSTOPPABLE_ASSERT(r->first == newOldestVersion);
+		roots.erase(roots.begin(), r);
+		oldestVersion = newOldestVersion;
+
+		// A node replaced at version v is not reachable from the root of any version >= v
+		while (!released.empty() && released.front().first <= newOldestVersion) {
+			Chunk* chunk = released.front().second;
+			released.pop_front();
+			if (--chunk->live == 0 && chunk != chunks) {
+				freeChunk(chunk);
+			}
+		}
+	}
+
+	// Freeing whole chunks is cheap enough that there is nothing to defer
+	Future<Void> forgetVersionsBeforeAsync(Version newOldestVersion,
+	                                       TaskPriority taskID = TaskPriority::DefaultYield) {
+		forgetVersionsBefore(newOldestVersion);
+		return Void();
+	}
+
+	void createNewVersion(Version version) { // following sets and erases are into the given version, which may now be
+		                                     // passed to at().  Must be called in monotonically increasing order.
+		if (version > latestVersion) {
+			latestVersion = version;
+			Node* r = roots.back().second;
+			roots.emplace_back(version, r);
+		} else
+			ASSERT(version == latestVersion);
+	}
+
+	// insert() and erase() invalidate atLatest() and all iterators into it
+	void insert(const K& k, const T& t) { insert(k, t, latestVersion); }
+	void insert(const K& k, const T& t, Version insertAt) {
+		// k and t may refer to an entry which is about to move
+		const K key = k;
+		const T value = t;
+
+		Node*& root = roots.back().second;
+		if (!root) {
+			Leaf* leaf = newNode<Leaf>();
+			leaf->count = 1;
+			setEntry(leaf, 0, key, value, insertAt);
+			root = leaf;
+			return;
+		}
+
+		Path path;
+		writablePath(key, path);
+		Leaf* leaf = asLeaf(path.nodes[path.height - 1]);
+		int i = path.index[path.height - 1];
+		if (i < leaf->count && leaf->keys[i] == key) {
+			setEntry(leaf, i, key, value, insertAt);
+			return;
+		}
+		if (leaf->count < nodeCapacity) {
+			openGap(leaf, i, 1);
+			setEntry(leaf, i, key, value, insertAt);
+			return;
+		}
+
+		// Split the leaf, and then its ancestors for as long as they are full
+		Node* right = split(leaf);
+		if (i <= leaf->count) {
+			openGap(leaf, i, 1);
+			setEntry(leaf, i, key, value, insertAt);
+		} else {
+			openGap(right, i - leaf->count, 1);
+			setEntry(asLeaf(right), i - leaf->count, key, value, insertAt);
+		}
+		for (int level = path.height - 2; level >= 0; --level) {
+			Internal* parent = asInternal(path.nodes[level]);
+			int j = path.index[level] + 1;
+			if (parent->count < nodeCapacity) {
+				openGap(parent, j, 1);
+				setEntry(parent, j, right->keys[0], right);
+				return;
+			}
+			Node* parentRight = split(parent);
+			Internal* to = asInternal(j <= parent->count ? parent : parentRight);
+			j = j <= parent->count ? j : j - parent->count;
+			openGap(to, j, 1);
+			setEntry(to, j, right->keys[0], right);
+			right = parentRight;
+		}
+		Internal* newRoot = newNode<Internal>();
+		newRoot->count = 2;
+		setEntry(newRoot, 0, root->keys[0], root);
+		setEntry(newRoot, 1, right->keys[0], right);
+		root = newRoot;
+	}
+
+	void erase(const K& begin, const K& end) {
+		const K b = begin;
+		const K e = end;
+		// Remove the keys in the range a leaf at a time
+		while (true) {
+			iterator i = atLatest().lower_bound(b);
+			if (!i || !(i.key() < e))
+				return;
+			Path path;
+			writablePath(i.key(), path);
+			Node* leaf = path.nodes[path.height - 1];
+			int first = path.index[path.height - 1];
+			removeEntries(leaf, first, lowerIndex(leaf, e) - first);
+			rebalance(path);
+		}
+	}
+	void erase(const K& key) { // key must be present
+		const K k = key;
+		Path path;
+		writablePath(k, path);
+		Node* leaf = path.nodes[path.height - 1];
+		int i = path.index[path.height - 1];
+		ASSERT(i < leaf->count && leaf->keys[i] == k);
+		removeEntries(leaf, i, 1);
+		rebalance(path);
+	}
+	void erase(iterator const& item) { // iterator must be in latest version!
+		ASSERT_EQ(item.at, latestVersion);
+		erase(item.key());
+	}
+
+	ViewAtVersion at(Version v) const {
+		if (v == ::latestVersion) {
+			return atLatest();
+		}
+
+		auto r = upper_bound(roots.begin(), roots.end(), v, rootsComparator());
+		--r;
+		return ViewAtVersion(r->second, v);
+	}
+	ViewAtVersion atLatest() const { return ViewAtVersion(roots.back().second, latestVersion); }
+
+	bool isClearContaining(ViewAtVersion const& view, KeyRef key) {
+		auto i = view.lastLessOrEqual(key);
+		return i && i->isClearTo() && i->getEndKey() > key;
+	}
+
+private:
+	struct rootsComparator {
+		bool operator()(const std::pair<Version, Node*>& value, const Version& key) { return (value.first < key); }
+		bool operator()(const Version& key, const std::pair<Version, Node*>& value) { return (key < value.first); }
+	};
+
+	// The writable nodes from the root to a leaf, with the index of the child taken at each internal node and of the
+	// first key >= the searched key in the leaf
+	struct Path {
+		Node* nodes[maxHeight];
+		int index[maxHeight];
+		int height = 0;
+	};
+
+	void* allocate(int bytes) {
+		bytes = (bytes + 7) & ~7;
+		if (!chunks || chunks->used + bytes > chunkBytes) {
+			Chunk* chunk = static_cast<Chunk*>(allocateFast(chunkBytes));
+			chunk->prev = nullptr;
+			chunk->next = chunks;
+			chunk->used = sizeof(Chunk);
+			chunk->live = 0;
+			Chunk* full = chunks;
+			chunks = chunk;
+			++chunkCount;
+			if (full) {
+				full->prev = chunk;
+				if (full->live == 0) {
+					freeChunk(full);
+				}
+			}
+		}
+		void* p = reinterpret_cast<uint8_t*>(chunks) + chunks->used;
+		chunks->used += bytes;
+		++chunks->live;
+		return p;
+	}
+
+	void freeChunk(Chunk* chunk) {
+		if (chunk->prev)
+			chunk->prev->next = chunk->next;
+		else
+			chunks = chunk->next;
+		if (chunk->next)
+			chunk->next->prev = chunk->prev;
+		freeFast(chunkBytes, chunk);
+		--chunkCount;
+	}
+
+	template <class N>
+	N* newNode() {
+		N* n = new (allocate(sizeof(N))) N;
+		n->chunk = chunks;
+		n->version = latestVersion;
+		n->count = 0;
+		n->leaf = std::is_same_v<N, Leaf>;
+		return n;
+	}
+
+	// Returns a node that can be changed in the latest version in place of n
+	Node* writable(Node* n) {
+		if (n->version == latestVersion)
+			return n;
+		Node* copy = n->leaf ? static_cast<Node*>(new (allocate(sizeof(Leaf))) Leaf(*asLeaf(n)))
+		                     : static_cast<Node*>(new (allocate(sizeof(Internal))) Internal(*asInternal(n)));
+		copy->chunk = chunks;
+		copy->version = latestVersion;
+		release(n);
+		return copy;
+	}
+
+	// n is no longer reachable from the latest version
+	void release(Node* n) { released.emplace_back(latestVersion, n->chunk); }
+
+	template <class X>
+	void writablePath(const X& key, Path& path) {
+		Node*& root = roots.back().second;
+		root = writable(root);
+		Node* n = root;
+		path.height = 0;
+		while (!n->leaf) {
+			Internal* internal = asInternal(n);
+			int i = childIndex(n, key);
+			internal->children[i] = writable(internal->children[i]);
+			path.nodes[path.height] = n;
+			path.index[path.height++] = i;
+			n = internal->children[i];
+		}
+		path.nodes[path.height] = n;
+		path.index[path.height++] = lowerIndex(n, key);
+	}
+
+	// Moves the upper half of a full node to a new node, which is returned
+	Node* split(Node* n) {
+		Node* right = n->leaf ? static_cast<Node*>(newNode<Leaf>()) : static_cast<Node*>(newNode<Internal>());
+		int half = n->count / 2;
+		copyEntries(n, half, n->count - half, right, 0);
+		right->count = n->count - half;
+		n->count = half;
+		return right;
+	}
+
+	// After entries were removed from the leaf of path, merges or refills the nodes on it which became too empty
+	void rebalance(Path& path) {
+		for (int level = path.height - 1; level > 0 && path.nodes[level]->count < minNodeEntries; --level) {
+			Internal* parent = asInternal(path.nodes[level - 1]);
+			int l = std::max(path.index[level - 1] - 1, 0);
+			Node* left = parent->children[l] = writable(parent->children[l]);
+			Node* right = parent->children[l + 1] = writable(parent->children[l + 1]);
+			if (!left->leaf) {
+				// So that the keys of left and right line up as the keys of their children
+				right->keys[0] = parent->keys[l + 1];
+			}
+			int total = left->count + right->count;
+			if (total <= nodeCapacity) {
+				copyEntries(right, 0, right->count, left, left->count);
+				left->count = total;
+				removeEntries(parent, l + 1, 1);
+				release(right);
+				continue;
+			}
+			int leftCount = total / 2;
+			if (left->count < leftCount) {
+				int n = leftCount - left->count;
+				copyEntries(right, 0, n, left, left->count);
+				left->count = leftCount;
+				removeEntries(right, 0, n);
+			} else {
+				int n = left->count - leftCount;
+				openGap(right, 0, n);
+				copyEntries(left, leftCount, n, right, 0);
+				left->count = leftCount;
+			}
+			parent->keys[l + 1] = right->keys[0];
+		}
+
+		Node*& root = roots.back().second;
+		if (root->count == 0) {
+			release(root);
+			root = nullptr;
+		} else if (!root->leaf && root->count == 1) {
+			release(root);
+			root = asInternal(root)->children[0];
+		}
+	}
+
+	void swap(VersionedBPlusTree& v) {
+		std::swap(oldestVersion, v.oldestVersion);
+		std::swap(latestVersion, v.latestVersion);
+		std::swap(roots, v.roots);
+		std::swap(released, v.released);
+		std::swap(chunks, v.chunks);
+		std::swap(chunkCount, v.chunkCount);
+	}
+
+	Version oldestVersion, latestVersion;
+	// The root of the tree at each version, in increasing order of version
+	std::deque<std::pair<Version, Node*>> roots;
+	// The chunks of replaced nodes, in increasing order of the versions that replaced them
+	std::deque<std::pair<Version, Chunk*>> released;
+	// All chunks, starting with the one nodes are being allocated from
+	Chunk* chunks = nullptr;
+	int chunkCount = 0;
+};
+
+// A VersionedMap or a VersionedBPlusTree, chosen when it is constructed, behind the interface they share
+template <class K, class T>
+class SelectableVersionedMap : NonCopyable {
+	using PTreeMap = VersionedMap<K, T>;
+	using BPlusTreeMap = VersionedBPlusTree<K, T>;
+
+public:
+	struct iterator {
+		template <class I>
+		explicit iterator(I const& i) : impl(i) {}
+
+		K const& key() const {
+			return std::visit([](auto const& i) -> K const& { return i.key(); }, impl);
+		}
+		Version insertVersion() const {
+			return std::visit([](auto const& i) { return i.insertVersion(); }, impl);
+		}
+		operator bool() const {
+			return std::visit([](auto const& i) { return bool(i); }, impl);
+		}
+		bool operator<(const K& key) const { return this->key() < key; }
+
+		T const& operator*() {
+			return std::visit([](auto& i) -> T const& { return *i; }, impl);
+		}
+		T const* operator->() { return &**this; }
+		void operator++() {
+			std::visit([](auto& i) { ++i; }, impl);
+		}
+		void operator--() {
+			std::visit([](auto& i) { --i; }, impl);
+		}
+		bool operator==(const iterator& r) const {
+			return std::visit([&r](auto const& i) { return i == std::get<std::decay_t<decltype(i)>>(r.impl); }, impl);
+		}
+		bool operator!=(const iterator& r) const { return !(*this == r); }
+
+	private:
+		friend class SelectableVersionedMap<K, T>;
+		std::variant<typename PTreeMap::iterator, typename BPlusTreeMap::iterator> impl;
+	};
+
+	class ViewAtVersion {
+	public:
+		template <class V>
+		explicit ViewAtVersion(V const& v) : impl(v) {}
+
+		iterator begin() const {
+			return std::visit([](auto const& v) { return iterator(v.begin()); }, impl);
+		}
+		iterator end() const {
+			return std::visit([](auto const& v) { return iterator(v.end()); }, impl);
+		}
+		template <class X>
+		iterator find(const X& key) const {
+			return std::visit([&key](auto const& v) { return iterator(v.find(key)); }, impl);
+		}
+		template <class X>
+		iterator lower_bound(const X& key) const {
+			return std::visit([&key](auto const& v) { return iterator(v.lower_bound(key)); }, impl);
+		}
+		template <class X>
+		iterator upper_bound(const X& key) const {
+			return std::visit([&key](auto const& v) { return iterator(v.upper_bound(key)); }, impl);
+		}
+		template <class X>
+		iterator lastLessOrEqual(const X& key) const {
+			return std::visit([&key](auto const& v) { return iterator(v.lastLessOrEqual(key)); }, impl);
+		}
+		template <class X>
+		iterator lastLess(const X& key) const {
+			return std::visit([&key](auto const& v) { return iterator(v.lastLess(key)); }, impl);
+		}
+		void validate() {
+			std::visit([](auto& v) { v.validate(); }, impl);
+		}
+
+	private:
+		std::variant<typename PTreeMap::ViewAtVersion, typename BPlusTreeMap::ViewAtVersion> impl;
+	};
+
+	explicit SelectableVersionedMap(bool useBPlusTree) {
+		if (useBPlusTree) {
+			impl.template emplace<BPlusTreeMap>();
+		}
+	}
+
+	bool usesBPlusTree() const { return std::holds_alternative<BPlusTreeMap>(impl); }
+
+	Version getLatestVersion() const {
+		return std::visit([](auto const& m) { return m.getLatestVersion(); }, impl);
+	}
+	Version getOldestVersion() const {
+		return std::visit([](auto const& m) { return m.getOldestVersion(); }, impl);
+	}
+
+	void forgetVersionsBefore(Version newOldestVersion) {
+		std::visit([newOldestVersion](auto& m) { m.forgetVersionsBefore(newOldestVersion); }, impl);
+	}
+	Future<Void> forgetVersionsBeforeAsync(Version newOldestVersion, TaskPriority taskID = TaskPriority::DefaultYield) {
+		return std::visit([=](auto& m) { return m.forgetVersionsBeforeAsync(newOldestVersion, taskID); }, impl);
+	}
+	void createNewVersion(Version version) {
+		std::visit([version](auto& m) { m.createNewVersion(version); }, impl);
+	}
+
+	void insert(const K& k, const T& t) {
+		std::visit([&](auto& m) { m.insert(k, t); }, impl);
+	}
+	void insert(const K& k, const T& t, Version insertAt) {
+		std::visit([&](auto& m) { m.insert(k, t, insertAt); }, impl);
+	}
+	void erase(const K& begin, const K& end) {
+		std::visit([&](auto& m) { m.erase(begin, end); }, impl);
+	}
+	void erase(const K& key) {
+		std::visit([&](auto& m) { m.erase(key); }, impl);
+	}
+	void erase(iterator const& item) {
+		std::visit([&item](auto& m) { m.erase(std::get<typename std::decay_t<decltype(m)>::iterator>(item.impl)); },
+		           impl);
+	}
+
+	ViewAtVersion at(Version v) const {
+		return std::visit([v](auto const& m) { return ViewAtVersion(m.at(v)); }, impl);
+	}
+	ViewAtVersion atLatest() const {
+		return std::visit([](auto const& m) { return ViewAtVersion(m.atLatest()); }, impl);
+	}
+
+	bool isClearContaining(ViewAtVersion const& view, KeyRef key) {
+		auto i = view.lastLessOrEqual(key);
+		return i && i->isClearTo() && i->getEndKey() > key;
+	}
+
+private:
+	std::variant<PTreeMap, BPlusTreeMap> impl;
+};
+
+#endif
@@ -22,6 +22,8 @@
 #define FDBCLIENT_VERSIONEDMAP_H
 #pragma once
 
+#include <unordered_set>
+
 #include "flow/flow.h"
 #include "flow/IndexedSet.h"
 #include "fdbclient/FDBTypes.h"
@@ -706,6 +708,31 @@ public:
 	// front element should be the oldest version in the deque, hence the next oldest should be at index 1
 	Version getNextOldestVersion() const { return roots[1]->first; }
 
+	// Memory held by the nodes reachable from any version. This walks every node, so it is meant for tests and
+	// benchmarks.
+	int64_t getBytesAllocated() const {
+		std::unordered_set<PTreeT const*> nodes;
+		std::vector<PTreeT const*> stack;
+		for (auto const& root : roots) {
+			if (root.second) {
+				stack.push_back(root.second.getPtr());
+			}
+		}
+		while (!stack.empty()) {
+			PTreeT const* n = stack.back();
+			stack.pop_back();
+			if (!nodes.insert(n).second) {
+				continue;
+			}
+			for (auto const& child : n->pointer) {
+				if (child) {
+					stack.push_back(child.getPtr());
+				}
+			}
+		}
+		return int64_t(nodes.size()) * nextFastAllocatedSize(sizeof(PTreeT));
+	}
+
 	void forgetVersionsBefore(Version newOldestVersion) {
 		ASSERT(newOldestVersion <= latestVersion);
 		auto r = upper_bound(roots.begin(), roots.end(), newOldestVersion, rootsComparator());
@@ -55,6 +55,9 @@
 #include "flow/UnitTest.h"
 #include "flow/WatchFile.actor.h"
 #include "flow/IConnection.h"
+#include "flow/NetworkLoop.h"
+#include "flow/ThreadHelper.actor.h"
+#include "flow/ThreadSafeQueue.h"
 #define XXH_INLINE_ALL
 #include "flow/xxhash.h"
 #include "flow/actorcompiler.h" // This must be the last #include.
@@ -1224,6 +1227,50 @@ ACTOR static void deliver(TransportData* self,
 	}
 }
 
+// Queues a task to deliver a complete packet, whose checksum has been checked
+static void deliverPacket(TransportData* transport,
+                          Arena& arena,
+                          StringRef packet,
+                          NetworkAddress const& peerAddress,
+                          bool isTrustedPeer,
+                          ProtocolVersion peerProtocolVersion,
+                          Future<Void> disconnect) {
+	// remove object serializer flag to account for flat buffer
+	peerProtocolVersion.removeObjectSerializerFlag();
+	ArenaReader reader(arena, packet, AssumeVersion(peerProtocolVersion));
+	UID token;
+	reader >> token;
+
+	++transport->countPacketsReceived;
+
+	if (packet.size() > FLOW_KNOBS->PACKET_WARNING) {
+		TraceEvent(SevWarn, "LargePacketReceived")
+		    .suppressFor(1.0)
+		    .detail("FromPeer", peerAddress.toString())
+		    .detail("Length", packet.size())
+		    .detail("Token", token);
+	}
+
+	ASSERT(!reader.empty());
+	TaskPriority priority = transport->endpoints.getPriority(token);
+	// we ignore packets to unknown endpoints if they're not going to a stream anyways, so we can just
+	// return here. The main place where this seems to happen is if a ReplyPromise is not waited on
+	// long enough.
+	// It would be slightly more elegant/readable to put this if-block into the deliver actor, but if
+	// we have many messages to UnknownEndpoint we want to optimize earlier. As deliver is an actor it
+	// will allocate some state on the heap and this prevents it from doing that.
+	if (priority != TaskPriority::UnknownEndpoint || (token.first() & TOKEN_STREAM_FLAG) != 0) {
+		deliver(transport,
+		        Endpoint({ peerAddress }, token),
+		        priority,
+		        std::move(reader),
+		        peerAddress,
+		        isTrustedPeer,
+		        InReadSocket::True,
+		        disconnect);
+	}
+}
+
 static void scanPackets(TransportData* transport,
                         uint8_t*& unprocessed_begin,
                         const uint8_t* e,
@@ -1330,40 +1377,13 @@ static void scanPackets(TransportData* transport,
 #if VALGRIND
 		VALGRIND_CHECK_MEM_IS_DEFINED(p, packetLen);
 #endif
-		// remove object serializer flag to account for flat buffer
-		peerProtocolVersion.removeObjectSerializerFlag();
-		ArenaReader reader(arena, StringRef(p, packetLen), AssumeVersion(peerProtocolVersion));
-		UID token;
-		reader >> token;
-
-		++transport->countPacketsReceived;
-
-		if (packetLen > FLOW_KNOBS->PACKET_WARNING) {
-			TraceEvent(SevWarn, "LargePacketReceived")
-			    .suppressFor(1.0)
-			    .detail("FromPeer", peerAddress.toString())
-			    .detail("Length", (int)packetLen)
-			    .detail("Token", token);
-		}
-
-		ASSERT(!reader.empty());
-		TaskPriority priority = transport->endpoints.getPriority(token);
-		// we ignore packets to unknown endpoints if they're not going to a stream anyways, so we can just
-		// return here. The main place where this seems to happen is if a ReplyPromise is not waited on
-		// long enough.
-		// It would be slightly more elegant/readable to put this if-block into the deliver actor, but if
-		// we have many messages to UnknownEndpoint we want to optimize earlier. As deliver is an actor it
-		// will allocate some state on the heap and this prevents it from doing that.
-		if (priority != TaskPriority::UnknownEndpoint || (token.first() & TOKEN_STREAM_FLAG) != 0) {
-			deliver(transport,
-			        Endpoint({ peerAddress }, token),
-			        priority,
-			        std::move(reader),
-			        peerAddress,
-			        isTrustedPeer,
-			        InReadSocket::True,
-			        disconnect);
-		}
+		deliverPacket(transport,
+		              arena,
+		              StringRef(p, packetLen),
+		              peerAddress,
+		              isTrustedPeer,
+		              peerProtocolVersion,
+		              disconnect);
 
 		unprocessed_begin = p = p + packetLen;
 	}
@@ -1391,6 +1411,272 @@ static int getNewBufferSize(const uint8_t* begin,
 	                          packetLen + sizeof(uint32_t) * (peerAddress.isTLS() ? 2 : 3));
 }
 
+// Reads, frames and checksums the packets of a plaintext connection on the NetworkLoop its receive side is pinned to
+// (NET2_SECONDARY_LOOPS), so that the network thread only deserializes and delivers them.
+//
+// Complete packets are handed over in batches, each of which owns the arena of the buffer its packets were read into:
+// before handing a buffer over, the loop moves what is left of a partial packet to a new one, so an arena is never
+// shared between the threads. The loop stops reading while the network thread is more than
+// NET2_SECONDARY_LOOP_READ_AHEAD_BYTES behind.
+//
+// Bytes count towards Peer::bytesReceived as soon as they are read, not when their packet is complete, because
+// connectionMonitor() takes a peer that sent nothing during a ping timeout to be gone.
+struct LoopPacketReader : ThreadSafeReferenceCounted<LoopPacketReader> {
+	struct Batch {
+		Arena arena;
+		VectorRef<StringRef> packets;
+		int bytes = 0;
+		int errorCode = 0; // The connection failed after the packets
+	};
+
+	const NetworkAddress peerAddress;
+	const ProtocolVersion peerProtocolVersion;
+	NetworkLoop* const networkLoop;
+
+	// Used by the loop only
+	std::unique_ptr<NetworkLoopReceiver> receiver;
+	Arena arena;
+	VectorRef<StringRef> packets;
+	uint8_t* unprocessed_begin = nullptr;
+	uint8_t* unprocessed_end = nullptr;
+	uint8_t* buffer_end = nullptr;
+	int readBytes = 0;
+
+	ThreadSafeQueue<Batch> batches;
+	std::atomic<int64_t> unconsumedBytes = 0;
+	std::atomic<bool> paused = false;
+	std::atomic<bool> stopped = false;
+	std::atomic<int64_t> totalReadBytes = 0;
+	// A read that completed no packet is being reported to the network thread
+	std::atomic<bool> readReported = false;
+
+	// Used by the network thread only
+	Promise<Void> batchReady;
+	int64_t countedReadBytes = 0;
+
+	// Starts reading the connection on its loop, after the bytes in [begin, end) which were read on the network thread.
+	// Returns nullptr if the connection is not pinned to a loop.
+	static Reference<LoopPacketReader> start(Reference<IConnection> const& conn,
+	                                         NetworkAddress const& peerAddress,
+	                                         ProtocolVersion peerProtocolVersion,
+	                                         const uint8_t* begin,
+	                                         const uint8_t* end) {
+		std::unique_ptr<NetworkLoopReceiver> receiver = INetworkConnections::net()->pinReceiver(conn);
+		if (!receiver) {
+			return Reference<LoopPacketReader>();
+		}
+		auto reader = makeReference<LoopPacketReader>(std::move(receiver), peerAddress, peerProtocolVersion);
+		reader->newBuffer(begin, end);
+		reader->networkLoop->post([reader] { reader->read(); }, TaskPriority::ReadSocket);
+		return reader;
+	}
+
+	LoopPacketReader(std::unique_ptr<NetworkLoopReceiver>&& receiver,
+	                 NetworkAddress const& peerAddress,
+	                 ProtocolVersion peerProtocolVersion)
+	  : peerAddress(peerAddress), peerProtocolVersion(peerProtocolVersion), networkLoop(receiver->networkLoop),
+	    receiver(std::move(receiver)) {}
+
+	// On the network thread, once the packets of a batch are delivered
+	void consumed(int bytes) {
+		if (unconsumedBytes.fetch_sub(bytes) - bytes < FLOW_KNOBS->NET2_SECONDARY_LOOP_READ_AHEAD_BYTES &&
+		    paused.exchange(false)) {
+			networkLoop->post([self = Reference<LoopPacketReader>::addRef(this)] { self->read(); },
+			                  TaskPriority::ReadSocket);
+		}
+	}
+
+	// On the network thread: the bytes read since the last call
+	int64_t takeReadBytes() {
+		const int64_t total = totalReadBytes.load();
+		const int64_t bytes = total - countedReadBytes;
+		countedReadBytes = total;
+		return bytes;
+	}
+
+	// On the network thread, when the connection reader is done
+	void stop() {
+		stopped = true;
+		networkLoop->post([self = Reference<LoopPacketReader>::addRef(this)] { self->receiver.reset(); });
+	}
+
+private:
+	// Moves [begin, end) to a new buffer with room for at least the rest of the next packet
+	void newBuffer(const uint8_t* begin, const uint8_t* end) {
+		Arena newArena;
+		const int unproc_len = end - begin;
+		const int len = getNewBufferSize(begin, end, peerAddress, peerProtocolVersion);
+		uint8_t* const buffer = new (newArena) uint8_t[len];
+		if (unproc_len > 0) {
+			memcpy(buffer, begin, unproc_len);
+		}
+		arena = newArena;
+		packets = VectorRef<StringRef>();
+		unprocessed_begin = buffer;
+		unprocessed_end = buffer + unproc_len;
+		buffer_end = buffer + len;
+	}
+
+	// Adds the complete packets in [unprocessed_begin, unprocessed_end) to packets
+	void scan() {
+		uint8_t* p = unprocessed_begin;
+		loop {
+			uint32_t packetLen;
+			XXH64_hash_t packetChecksum;
+			if (unprocessed_end - p < PACKET_LEN_WIDTH + sizeof(packetChecksum))
+				break;
+			packetLen = *(uint32_t*)p;
+			packetChecksum = *(XXH64_hash_t*)(p + PACKET_LEN_WIDTH);
+
+			if (packetLen > FLOW_KNOBS->PACKET_LIMIT) {
+				TraceEvent(SevError, "PacketLimitExceeded")
+				    .detail("FromPeer", peerAddress.toString())
+				    .detail("Length", (int)packetLen);
+				throw platform_error();
+			}
+			uint8_t* packet = p + PACKET_LEN_WIDTH + sizeof(packetChecksum);
+			if (unprocessed_end - packet < packetLen)
+				break;
+			if (packetLen < sizeof(UID)) {
+				TraceEvent(SevError, "PacketTooSmall")
+				    .detail("FromPeer", peerAddress.toString())
+				    .detail("Length", packetLen);
+				throw platform_error();
+			}
+
+			XXH64_hash_t calculatedChecksum = XXH3_64bits(packet, packetLen);
+			if (calculatedChecksum != packetChecksum) {
+				TraceEvent(SevWarnAlways, "ChecksumMismatchUnexp")
+				    .detail("PacketChecksum", packetChecksum)
+				    .detail("CalculatedChecksum", calculatedChecksum);
+				throw checksum_failed();
+			}
+
+			packets.push_back(arena, StringRef(packet, packetLen));
+			unprocessed_begin = p = packet + packetLen;
+		}
+	}
+
+	// Hands the packets scanned so far, or an error, to the network thread
+	void send(int errorCode) {
+		Batch batch;
+		batch.arena = std::move(arena);
+		batch.packets = packets;
+		batch.bytes = readBytes;
+		batch.errorCode = errorCode;
+		readBytes = 0;
+		packets = VectorRef<StringRef>();
+		if (!errorCode) {
+			// The buffer still belongs to the loop until the batch is pushed
+			newBuffer(unprocessed_begin, unprocessed_end);
+		}
+		unconsumedBytes += batch.bytes;
+		if (batches.push(std::move(batch))) {
+			wake();
+		}
+	}
+
+	void wake() {
+		onMainThreadVoid(
+		    [self = Reference<LoopPacketReader>::addRef(this)] {
+			    self->readReported = false;
+			    if (self->batchReady.canBeSet()) {
+				    self->batchReady.send(Void());
+			    }
+		    },
+		    TaskPriority::ReadSocket);
+	}
+
+	// On the loop, whenever the connection is readable: reads until it would block, the network thread falls behind,
+	// or the connection fails
+	void read() {
+		if (stopped) {
+			receiver.reset();
+			return;
+		}
+		const int64_t readBytesBefore = totalReadBytes.load();
+		bool sent = false;
+		try {
+			loop {
+				if (unconsumedBytes >= FLOW_KNOBS->NET2_SECONDARY_LOOP_READ_AHEAD_BYTES) {
+					paused = true;
+					// consumed() may have missed paused being set
+					if (unconsumedBytes >= FLOW_KNOBS->NET2_SECONDARY_LOOP_READ_AHEAD_BYTES || !paused.exchange(false)) {
+						return;
+					}
+				}
+				if (buffer_end - unprocessed_end < FLOW_KNOBS->MIN_PACKET_BUFFER_FREE_BYTES) {
+					ASSERT(packets.empty());
+					newBuffer(unprocessed_begin, unprocessed_end);
+				}
+				const int len = std::min<int>(buffer_end - unprocessed_end, FLOW_KNOBS->MAX_PACKET_SEND_BYTES);
+				const int bytes = receiver->read(unprocessed_end, unprocessed_end + len);
+				if (bytes < 0) {
+					send(error_code_connection_failed);
+					return;
+				}
+				if (bytes == 0) {
+					break;
+				}
+				unprocessed_end += bytes;
+				readBytes += bytes;
+				totalReadBytes += bytes;
+				scan();
+				if (!packets.empty()) {
+					send(0);
+					sent = true;
+				}
+			}
+		} catch (Error& e) {
+			send(e.code());
+			return;
+		}
+		// Part of a packet arrived: the network thread still has to count it
+		if (!sent && totalReadBytes.load() != readBytesBefore && !readReported.exchange(true)) {
+			wake();
+		}
+		receiver->onReadable([self = Reference<LoopPacketReader>::addRef(this)] { self->read(); });
+	}
+};
+
+// Delivers the packets a LoopPacketReader hands over, in place of reading the connection on the network thread
+ACTOR static Future<Void> deliverLoopPackets(TransportData* transport,
+                                             Reference<LoopPacketReader> reader,
+                                             Reference<Peer> peer,
+                                             bool trusted) {
+	try {
+		loop {
+			peer->bytesReceived += reader->takeReadBytes();
+			state Optional<LoopPacketReader::Batch> batch = reader->batches.pop();
+			if (!batch.present()) {
+				if (reader->batches.canSleep()) {
+					reader->batchReady = Promise<Void>();
+					wait(reader->batchReady.getFuture());
+				}
+				continue;
+			}
+			for (StringRef packet : batch.get().packets) {
+				deliverPacket(transport,
+				              batch.get().arena,
+				              packet,
+				              reader->peerAddress,
+				              trusted,
+				              reader->peerProtocolVersion,
+				              peer->disconnect.getFuture());
+			}
+			if (batch.get().errorCode) {
+				throw Error(batch.get().errorCode);
+			}
+			reader->consumed(batch.get().bytes);
+			batch = Optional<LoopPacketReader::Batch>();
+			wait(yield(TaskPriority::ReadSocket));
+		}
+	} catch (Error& e) {
+		reader->stop();
+		throw;
+	}
+}
+
 // This actor exists whenever there is an open or opening connection, whether incoming or outgoing
 // For incoming connections conn is set and peer is initially nullptr; for outgoing connections it is the reverse
 ACTOR static Future<Void> connectionReader(TransportData* transport,
@@ -1408,6 +1694,7 @@ ACTOR static Future<Void> connectionReader(TransportData* transport,
 	state NetworkAddress peerAddress;
 	state ProtocolVersion peerProtocolVersion;
 	state bool trusted = transport->allowList(conn->getPeerAddress().ip) && conn->hasTrustedPeer();
+	state Reference<LoopPacketReader> loopReader;
 	peerAddress = conn->getPeerAddress();
 
 	if (!peer) {
@@ -1570,6 +1857,13 @@ ACTOR static Future<Void> connectionReader(TransportData* transport,
 						            peerProtocolVersion,
 						            peer->disconnect.getFuture(),
 						            IsStableConnection(g_network->isSimulated() && conn->isStableConnection()));
+						if (compatible) {
+							loopReader = LoopPacketReader::start(
+							    conn, peerAddress, peerProtocolVersion, unprocessed_begin, unprocessed_end);
+							if (loopReader) {
+								break;
+							}
+						}
 					} else {
 						unprocessed_begin = unprocessed_end;
 						peer->resetPing.trigger();
@@ -1582,6 +1876,9 @@ ACTOR static Future<Void> connectionReader(TransportData* transport,
 				wait(yield(TaskPriority::ReadSocket));
 			}
 
+			if (loopReader) {
+				wait(deliverLoopPackets(transport, loopReader, peer, trusted));
+			}
 			wait(conn->onReadable());
 			wait(delay(0, TaskPriority::ReadSocket)); // We don't want to call conn->read directly from the reactor - we
 			                                          // could get stuck in the reactor reading 1 packet at a time
@@ -41,6 +41,7 @@
 #include "fdbrpc/AsyncFileEncrypted.h"
 #include "fdbrpc/AsyncFileWinASIO.actor.h"
 #include "fdbrpc/AsyncFileKAIO.actor.h"
+#include "fdbrpc/AsyncFileIOUring.actor.h"
 #include "flow/AsioReactor.h"
 #include "flow/Platform.h"
 #include "fdbrpc/AsyncFileWriteChecker.actor.h"
@@ -73,7 +74,8 @@ Future<Reference<class IAsyncFile>> Net2FileSystem::open(const std::string& file
 	// EIO.
 	if ((flags & IAsyncFile::OPEN_UNBUFFERED) && !(flags & IAsyncFile::OPEN_NO_AIO) &&
 	    !FLOW_KNOBS->DISABLE_POSIX_KERNEL_AIO)
-		f = AsyncFileKAIO::open(filename, flags, mode, nullptr);
+		f = AsyncFileIOUring::isEnabled() ? AsyncFileIOUring::open(filename, flags, mode, nullptr)
+		                                  : AsyncFileKAIO::open(filename, flags, mode, nullptr);
 	else
 #endif
 		f = Net2AsyncFile::open(
@@ -117,8 +119,12 @@ void Net2FileSystem::newFileSystem(double ioTimeout, const std::string& fileSyst
 Net2FileSystem::Net2FileSystem(double ioTimeout, const std::string& fileSystemPath) {
 	Net2AsyncFile::init();
 #ifdef __linux__
-	if (!FLOW_KNOBS->DISABLE_POSIX_KERNEL_AIO)
-		AsyncFileKAIO::init(Reference<IEventFD>(N2::ASIOReactor::getEventFD()), ioTimeout);
+	if (!FLOW_KNOBS->DISABLE_POSIX_KERNEL_AIO) {
+		// Falls back to Kernel AIO if the kernel does not support io_uring
+		Reference<IEventFD> ev(N2::ASIOReactor::getEventFD());
+		if (!FLOW_KNOBS->ENABLE_IO_URING || !AsyncFileIOUring::init(ev, ioTimeout))
+			AsyncFileKAIO::init(ev, ioTimeout);
+	}
 
 	if (fileSystemPath.empty()) {
 		checkFileSystem = false;
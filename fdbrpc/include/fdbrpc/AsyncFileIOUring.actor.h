@@ -0,0 +1,866 @@
+/*
+ * AsyncFileIOUring.actor.h
+ *
+ * This source file is part of the FoundationDB open source project
+ *
+ * Copyright 2013-2024 Apple Inc. and the FoundationDB project authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+#ifdef __linux__
+
+// When actually compiled (NO_INTELLISENSE), include the generated version of this file.  In intellisense use the source
+// version.
+#if defined(NO_INTELLISENSE) && !defined(FLOW_ASYNCFILEIOURING_ACTOR_G_H)
+#define FLOW_ASYNCFILEIOURING_ACTOR_G_H
+#include "fdbrpc/AsyncFileIOUring.actor.g.h"
+#elif !defined(FLOW_ASYNCFILEIOURING_ACTOR_H)
+#define FLOW_ASYNCFILEIOURING_ACTOR_H
+
+#include "flow/IAsyncFile.h"
+
+#include <deque>
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <queue>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "fdbrpc/AsyncFileEIO.actor.h"
+#include "flow/Knobs.h"
+#include "fdbrpc/Stats.h"
+#include "flow/UnitTest.h"
+#include "flow/genericactors.actor.h"
+#include "flow/actorcompiler.h" // This must be the last #include.
+
+// Unbuffered file I/O through a single io_uring shared by all files of the process, used instead of AsyncFileKAIO
+// when ENABLE_IO_URING is set.
+//
+// Like AsyncFileKAIO, operations are queued and submitted together once per run loop iteration, but completions are
+// reaped from the completion ring without a system call, and sync() is an fdatasync on the ring rather than on the
+// EIO thread pool. Writes and syncs of a file are submitted in the order they were issued. A sync that follows a few
+// writes, while no other write of its file is in flight, is linked behind them so that the writes and the fdatasync
+// that makes them durable take a single submission.
+class AsyncFileIOUring final : public IAsyncFile, public ReferenceCounted<AsyncFileIOUring> {
+public:
+	virtual StringRef getClassName() override { return "AsyncFileIOUring"_sr; }
+
+	struct AsyncFileIOUringMetrics {
+		LatencySample readLatencySample = { "AsyncFileIOUringReadLatency",
+			                                UID(),
+			                                FLOW_KNOBS->KAIO_LATENCY_LOGGING_INTERVAL,
+			                                FLOW_KNOBS->KAIO_LATENCY_SKETCH_ACCURACY };
+		LatencySample writeLatencySample = { "AsyncFileIOUringWriteLatency",
+			                                 UID(),
+			                                 FLOW_KNOBS->KAIO_LATENCY_LOGGING_INTERVAL,
+			                                 FLOW_KNOBS->KAIO_LATENCY_SKETCH_ACCURACY };
+		LatencySample syncLatencySample = { "AsyncFileIOUringSyncLatency",
+			                                UID(),
+			                                FLOW_KNOBS->KAIO_LATENCY_LOGGING_INTERVAL,
+			                                FLOW_KNOBS->KAIO_LATENCY_SKETCH_ACCURACY };
+	};
+
+	static AsyncFileIOUringMetrics& getMetrics() {
+		static AsyncFileIOUringMetrics metrics;
+		return metrics;
+	}
+
+	static Future<Reference<IAsyncFile>> open(std::string filename, int flags, int mode, void* ignore) {
+		ASSERT(isEnabled());
+		ASSERT(flags & OPEN_UNBUFFERED);
+
+		if (flags & OPEN_LOCK)
+			mode |= 02000; // Enable mandatory locking for this file if it is supported by the filesystem
+
+		std::string open_filename = filename;
+		if (flags & OPEN_ATOMIC_WRITE_AND_CREATE) {
+			ASSERT((flags & OPEN_CREATE) && (flags & OPEN_READWRITE) && !(flags & OPEN_EXCLUSIVE));
+			open_filename = filename + ".part";
+		}
+
+		int fd = ::open(open_filename.c_str(), openFlags(flags), mode);
+		if (fd < 0) {
+			Error e = errno == ENOENT ? file_not_found() : io_error();
+			TraceEvent("AsyncFileIOUringOpenFailed")
+			    .error(e)
+			    .detail("Filename", filename)
+			    .detailf("Flags", "%x", flags)
+			    .detailf("OSFlags", "%x", openFlags(flags))
+			    .detailf("Mode", "0%o", mode)
+			    .GetLastError();
+			return e;
+		} else {
+			TraceEvent("AsyncFileIOUringOpen")
+			    .detail("Filename", filename)
+			    .detail("Flags", flags)
+			    .detail("Mode", mode)
+			    .detail("Fd", fd);
+		}
+
+		Reference<AsyncFileIOUring> r(new AsyncFileIOUring(fd, flags, filename));
+
+		if (flags & OPEN_LOCK) {
+			// Acquire a "write" lock for the entire file
+			flock lockDesc;
+			lockDesc.l_type = F_WRLCK;
+			lockDesc.l_whence = SEEK_SET;
+			lockDesc.l_start = 0;
+			lockDesc.l_len = 0; // Lock to the end of the file, no matter how large it grows
+			lockDesc.l_pid = 0;
+			if (fcntl(fd, F_SETLK, &lockDesc) == -1) {
+				TraceEvent(SevWarn, "UnableToLockFile").detail("Filename", filename).GetLastError();
+				return lock_file_failure();
+			}
+		}
+
+		struct stat buf;
+		if (fstat(fd, &buf)) {
+			TraceEvent("AsyncFileIOUringFStatError").detail("Fd", fd).detail("Filename", filename).GetLastError();
+			return io_error();
+		}
+
+		r->lastFileSize = r->nextFileSize = buf.st_size;
+		return Reference<IAsyncFile>(std::move(r));
+	}
+
+	// Sets up the ring that all files submit to, and posts its completions to ev. Returns false if the kernel does
+	// not support io_uring, in which case AsyncFileKAIO should be used instead.
+	static bool init(Reference<IEventFD> ev, double ioTimeout) {
+		if (!ctx.setupRing(FLOW_KNOBS->MAX_OUTSTANDING)) {
+			return false;
+		}
+		int evfd = ev->getFD();
+		if (syscall(__NR_io_uring_register, ctx.ringFd, IORING_REGISTER_EVENTFD, &evfd, 1) < 0) {
+			TraceEvent(SevWarnAlways, "IOUringRegisterEventFDError").GetLastError();
+			ctx.closeRing();
+			return false;
+		}
+
+		if (!g_network->isSimulated()) {
+			ctx.countSubmit.init("AsyncFile.CountIOUringSubmit"_sr);
+			ctx.countCollect.init("AsyncFile.CountIOUringCollect"_sr);
+			ctx.countLinkedSyncs.init("AsyncFile.CountIOUringLinkedSyncs"_sr);
+		}
+		setTimeout(ioTimeout);
+		poll(ev);
+
+		g_network->setGlobal(INetwork::enRunCycleFunc, (flowGlobalType)&AsyncFileIOUring::launch);
+		TraceEvent("AsyncFileIOUringInit").detail("Entries", ctx.sqEntries);
+		return true;
+	}
+
+	static bool isEnabled() { return ctx.ringFd >= 0; }
+	static void setTimeout(double ioTimeout) { ctx.setIOTimeout(ioTimeout); }
+
+	void addref() override { ReferenceCounted<AsyncFileIOUring>::addref(); }
+	void delref() override { ReferenceCounted<AsyncFileIOUring>::delref(); }
+
+	Future<int> read(void* data, int length, int64_t offset) override {
+		++countFileLogicalReads;
+		++countLogicalReads;
+
+		if (failed) {
+			return io_timeout();
+		}
+
+		IOBlock* io = new IOBlock(IORING_OP_READ, fd, data, length, offset);
+		enqueue(io);
+		ctx.queue.push(io);
+		return io->result.getFuture();
+	}
+
+	Future<Void> write(void const* data, int length, int64_t offset) override {
+		++countFileLogicalWrites;
+		++countLogicalWrites;
+
+		if (failed) {
+			return io_timeout();
+		}
+
+		IOBlock* io = new IOBlock(IORING_OP_WRITE, fd, (void*)data, length, offset);
+		nextFileSize = std::max(nextFileSize, offset + length);
+		enqueue(io);
+		enqueueOrdered(io);
+		return success(io->result.getFuture());
+	}
+
+	Future<Void> zeroRange(int64_t offset, int64_t length) override {
+		bool success = false;
+		if (ctx.fallocateZeroSupported) {
+			int rc = fallocate(fd, FALLOC_FL_ZERO_RANGE, offset, length);
+			if (rc == EOPNOTSUPP) {
+				ctx.fallocateZeroSupported = false;
+			}
+			if (rc == 0) {
+				success = true;
+			}
+		}
+		return success ? Void() : IAsyncFile::zeroRange(offset, length);
+	}
+
+	Future<Void> truncate(int64_t size) override {
+		++countFileLogicalWrites;
+		++countLogicalWrites;
+
+		if (failed) {
+			return io_timeout();
+		}
+
+		int result = -1;
+		bool completed = false;
+		if (ctx.fallocateSupported && size >= lastFileSize) {
+			result = fallocate(fd, 0, 0, size);
+			if (result != 0) {
+				int fallocateErrCode = errno;
+				TraceEvent("AsyncFileIOUringAllocateError")
+				    .detail("Fd", fd)
+				    .detail("Filename", filename)
+				    .detail("Size", size)
+				    .GetLastError();
+				if (fallocateErrCode == EOPNOTSUPP) {
+					// Mark fallocate as unsupported. Try again with truncate.
+					ctx.fallocateSupported = false;
+				} else {
+					return io_error();
+				}
+			} else {
+				completed = true;
+			}
+		}
+		if (!completed)
+			result = ftruncate(fd, size);
+
+		if (result != 0) {
+			TraceEvent("AsyncFileIOUringTruncateError").detail("Fd", fd).detail("Filename", filename).GetLastError();
+			return io_error();
+		}
+
+		lastFileSize = nextFileSize = size;
+
+		return Void();
+	}
+
+	ACTOR static Future<Void> throwErrorIfFailed(Reference<AsyncFileIOUring> self, Future<Void> sync) {
+		wait(sync);
+		if (self->failed) {
+			throw io_timeout();
+		}
+		return Void();
+	}
+
+	// Makes durable all writes issued to this file before the call, including those that have not completed yet
+	Future<Void> sync() override {
+		++countFileLogicalWrites;
+		++countLogicalWrites;
+
+		if (failed) {
+			return io_timeout();
+		}
+
+		double start_time = timer();
+		IOBlock* io = new IOBlock(IORING_OP_FSYNC, fd, nullptr, 0, 0);
+		enqueue(io);
+		enqueueOrdered(io);
+
+		// Don't close the file until the sync is done
+		Future<Void> fsync =
+		    throwErrorIfFailed(Reference<AsyncFileIOUring>::addRef(this), success(io->result.getFuture()));
+		fsync = map(fsync, [=](Void r) mutable {
+			getMetrics().syncLatencySample.addMeasurement(timer() - start_time);
+			return r;
+		});
+
+		if (flags & OPEN_ATOMIC_WRITE_AND_CREATE) {
+			flags &= ~OPEN_ATOMIC_WRITE_AND_CREATE;
+
+			return AsyncFileEIO::waitAndAtomicRename(fsync, filename + ".part", filename);
+		}
+
+		return fsync;
+	}
+
+	bool syncCoversPendingWrites() const override { return true; }
+
+	Future<int64_t> size() const override { return nextFileSize; }
+	int64_t debugFD() const override { return fd; }
+	std::string getFilename() const override { return filename; }
+	~AsyncFileIOUring() override { close(fd); }
+
+	// Submits queued operations, up to the number the ring has room for. Writes and syncs go first, in the order they
+	// were issued to each file, and then reads by priority. Entries an earlier submission left in the ring are
+	// submitted again even if there is nothing new to add.
+	static void launch() {
+		if ((ctx.ordered.empty() && ctx.queue.empty()) ||
+		    ctx.outstanding >= FLOW_KNOBS->MAX_OUTSTANDING - FLOW_KNOBS->MIN_SUBMIT) {
+			if (ctx.unsubmitted > 0) {
+				submit();
+			}
+			return;
+		}
+
+		double begin = timer_monotonic();
+		int space = FLOW_KNOBS->MAX_OUTSTANDING - ctx.outstanding;
+		int n = 0;
+		double start = timer();
+
+		for (int i = ctx.ordered.size(); i > 0 && n < space; --i) {
+			AsyncFileIOUring* file = ctx.ordered.front();
+			ctx.ordered.pop_front();
+			file->prepareOrdered(space, &n, start);
+			if (!file->orderedOps.empty()) {
+				ctx.ordered.push_back(file);
+			}
+		}
+
+		while (n < space && !ctx.queue.empty()) {
+			IOBlock* io = ctx.queue.top();
+			ctx.queue.pop();
+			prepare(io, 0, start);
+			++n;
+		}
+
+		if (n == 0) {
+			if (ctx.unsubmitted > 0) {
+				submit();
+			}
+			return;
+		}
+		if (!ctx.outstanding)
+			ctx.ioStallBegin = begin;
+
+		// Publish the new entries to the kernel, then submit them along with any that an earlier submission left
+		__atomic_store_n(ctx.sqTail, ctx.sqLocalTail, __ATOMIC_RELEASE);
+		ctx.unsubmitted += n;
+		ctx.outstanding += n;
+		submit();
+
+		++ctx.countSubmit;
+		double elapsed = timer_monotonic() - begin;
+		g_network->networkInfo.metrics.secSquaredSubmit += elapsed * elapsed / 2;
+	}
+
+	bool failed;
+
+private:
+	int fd, flags;
+	int64_t lastFileSize, nextFileSize;
+	std::string filename;
+	Int64MetricHandle countFileLogicalWrites;
+	Int64MetricHandle countFileLogicalReads;
+
+	Int64MetricHandle countLogicalWrites;
+	Int64MetricHandle countLogicalReads;
+
+	struct IOBlock;
+
+	// Writes and syncs of this file that have not been submitted, in the order they were issued
+	std::deque<IOBlock*> orderedOps;
+	// Writes of this file that were submitted and have not completed
+	int writesInFlight;
+
+	struct IOBlock : FastAllocated<IOBlock> {
+		uint8_t opcode;
+		int fd;
+		void* buf;
+		int nbytes;
+		int64_t offset;
+		Promise<int> result;
+		Reference<AsyncFileIOUring> owner;
+		int64_t prio;
+		IOBlock* prev;
+		IOBlock* next;
+		double startTime;
+
+		struct indirect_order_by_priority {
+			bool operator()(IOBlock* a, IOBlock* b) { return a->prio < b->prio; }
+		};
+
+		IOBlock(uint8_t opcode, int fd, void* buf, int nbytes, int64_t offset)
+		  : opcode(opcode), fd(fd), buf(buf), nbytes(nbytes), offset(offset), prev(nullptr), next(nullptr),
+		    startTime(0) {}
+
+		TaskPriority getTask() const { return static_cast<TaskPriority>((prio >> 32) + 1); }
+
+		void toSqe(io_uring_sqe* sqe, uint8_t sqeFlags) {
+			memset(sqe, 0, sizeof(io_uring_sqe));
+			sqe->opcode = opcode;
+			sqe->flags = sqeFlags;
+			sqe->fd = fd;
+			sqe->addr = (uint64_t)buf;
+			sqe->len = nbytes;
+			sqe->off = offset;
+			if (opcode == IORING_OP_FSYNC) {
+				sqe->fsync_flags = IORING_FSYNC_DATASYNC;
+			}
+			sqe->user_data = (uint64_t)this;
+		}
+
+		ACTOR static void deliver(Promise<int> result, bool failed, int r, TaskPriority task) {
+			wait(delay(0, task));
+			if (failed)
+				result.sendError(io_timeout());
+			else if (r < 0)
+				result.sendError(io_error());
+			else
+				result.send(r);
+		}
+
+		void setResult(int r) {
+			if (r < 0) {
+				errno = -r;
+				TraceEvent("AsyncFileIOUringIOError")
+				    .GetLastError()
+				    .detail("Fd", fd)
+				    .detail("Op", opcode)
+				    .detail("Nbytes", nbytes)
+				    .detail("Offset", offset)
+				    .detail("Ptr", int64_t(buf))
+				    .detail("Filename", owner->filename);
+			}
+			deliver(result, owner->failed, r, getTask());
+			delete this;
+		}
+
+		void timeout(bool warnOnly) {
+			TraceEvent(SevWarnAlways, "AsyncFileIOUringTimeout")
+			    .detail("Fd", fd)
+			    .detail("Op", opcode)
+			    .detail("Nbytes", nbytes)
+			    .detail("Offset", offset)
+			    .detail("Ptr", int64_t(buf))
+			    .detail("Filename", owner->filename);
+			g_network->setGlobal(INetwork::enASIOTimedOut, (flowGlobalType) true);
+
+			if (!warnOnly)
+				owner->failed = true;
+		}
+	};
+
+	struct Context {
+		int ringFd;
+		unsigned sqEntries;
+		unsigned* sqHead;
+		unsigned* sqTail;
+		unsigned sqMask;
+		unsigned* sqArray;
+		io_uring_sqe* sqes;
+		unsigned sqLocalTail;
+		unsigned* cqHead;
+		unsigned* cqTail;
+		unsigned cqMask;
+		io_uring_cqe* cqes;
+		void* sqRing;
+		size_t sqRingSize;
+		void* cqRing;
+		size_t cqRingSize;
+		size_t sqesSize;
+
+		// Entries published to the submission ring that the kernel has not consumed yet
+		int unsubmitted;
+		// Entries submitted, or published to be, whose completions have not been reaped
+		int outstanding;
+		double ioStallBegin;
+		bool fallocateSupported;
+		bool fallocateZeroSupported;
+		std::priority_queue<IOBlock*, std::vector<IOBlock*>, typename IOBlock::indirect_order_by_priority> queue;
+		// Files with writes or syncs to submit
+		std::deque<AsyncFileIOUring*> ordered;
+		Int64MetricHandle countSubmit;
+		Int64MetricHandle countCollect;
+		Int64MetricHandle countLinkedSyncs;
+
+		double ioTimeout;
+		bool timeoutWarnOnly;
+		IOBlock* submittedRequestList;
+		// Whether the run loop has been asked to come back and resubmit entries the kernel could not take
+		bool submitRetryPending;
+
+		uint32_t opsIssued;
+		Context()
+		  : ringFd(-1), sqEntries(0), sqLocalTail(0), sqRing(MAP_FAILED), cqRing(MAP_FAILED), unsubmitted(0),
+		    outstanding(0), ioStallBegin(0), fallocateSupported(true), fallocateZeroSupported(true),
+		    submittedRequestList(nullptr), submitRetryPending(false), opsIssued(0) {
+			setIOTimeout(0);
+		}
+
+		bool setupRing(unsigned entries) {
+			io_uring_params p;
+			memset(&p, 0, sizeof(p));
+			int fd = syscall(__NR_io_uring_setup, entries, &p);
+			if (fd < 0) {
+				TraceEvent(SevWarnAlways, "IOUringSetupError").GetLastError();
+				return false;
+			}
+			ringFd = fd;
+
+			sqRingSize = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+			cqRingSize = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+			bool singleMmap = p.features & IORING_FEAT_SINGLE_MMAP;
+			if (singleMmap) {
+				sqRingSize = cqRingSize = std::max(sqRingSize, cqRingSize);
+			}
+			auto map = [fd](size_t size, off_t offset) {
+				return mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, offset);
+			};
+			sqRing = map(sqRingSize, IORING_OFF_SQ_RING);
+			cqRing = singleMmap ? sqRing : map(cqRingSize, IORING_OFF_CQ_RING);
+			sqesSize = p.sq_entries * sizeof(io_uring_sqe);
+			void* sqesMem = map(sqesSize, IORING_OFF_SQES);
+			if (sqRing == MAP_FAILED || cqRing == MAP_FAILED || sqesMem == MAP_FAILED) {
+				TraceEvent(SevWarnAlways, "IOUringMmapError").GetLastError();
+				if (sqesMem != MAP_FAILED) {
+					munmap(sqesMem, sqesSize);
+				}
+				closeRing();
+				return false;
+			}
+
+			uint8_t* sq = (uint8_t*)sqRing;
+			uint8_t* cq = (uint8_t*)cqRing;
+			sqEntries = p.sq_entries;
+			sqHead = (unsigned*)(sq + p.sq_off.head);
+			sqTail = (unsigned*)(sq + p.sq_off.tail);
+			sqMask = *(unsigned*)(sq + p.sq_off.ring_mask);
+			sqArray = (unsigned*)(sq + p.sq_off.array);
+			sqes = (io_uring_sqe*)sqesMem;
+			sqLocalTail = *sqTail;
+			cqHead = (unsigned*)(cq + p.cq_off.head);
+			cqTail = (unsigned*)(cq + p.cq_off.tail);
+			cqMask = *(unsigned*)(cq + p.cq_off.ring_mask);
+			cqes = (io_uring_cqe*)(cq + p.cq_off.cqes);
+			return true;
+		}
+
+		void closeRing() {
+			if (cqRing != MAP_FAILED && cqRing != sqRing) {
+				munmap(cqRing, cqRingSize);
+			}
+			if (sqRing != MAP_FAILED) {
+				munmap(sqRing, sqRingSize);
+			}
+			sqRing = cqRing = MAP_FAILED;
+			::close(ringFd);
+			ringFd = -1;
+		}
+
+		io_uring_sqe* nextSqe() {
+			unsigned index = sqLocalTail++ & sqMask;
+			sqArray[index] = index;
+			return &sqes[index];
+		}
+
+		void setIOTimeout(double timeout) {
+			ioTimeout = fabs(timeout);
+			timeoutWarnOnly = timeout < 0;
+		}
+
+		void appendToRequestList(IOBlock* io) {
+			ASSERT(!io->next && !io->prev);
+
+			if (submittedRequestList) {
+				io->prev = submittedRequestList->prev;
+				io->prev->next = io;
+
+				submittedRequestList->prev = io;
+				io->next = submittedRequestList;
+			} else {
+				submittedRequestList = io;
+				io->next = io->prev = io;
+			}
+		}
+
+		void removeFromRequestList(IOBlock* io) {
+			if (io->next == nullptr) {
+				ASSERT(io->prev == nullptr);
+				return;
+			}
+
+			ASSERT(io->prev != nullptr);
+
+			if (io == io->next) {
+				ASSERT(io == submittedRequestList && io == io->prev);
+				submittedRequestList = nullptr;
+			} else {
+				io->next->prev = io->prev;
+				io->prev->next = io->next;
+
+				if (submittedRequestList == io) {
+					submittedRequestList = io->next;
+				}
+			}
+
+			io->next = io->prev = nullptr;
+		}
+	};
+	static Context ctx;
+
+	explicit AsyncFileIOUring(int fd, int flags, std::string const& filename)
+	  : failed(false), fd(fd), flags(flags), filename(filename), writesInFlight(0) {
+		if (!g_network->isSimulated()) {
+			countFileLogicalWrites.init("AsyncFile.CountFileLogicalWrites"_sr, filename);
+			countFileLogicalReads.init("AsyncFile.CountFileLogicalReads"_sr, filename);
+			countLogicalWrites.init("AsyncFile.CountLogicalWrites"_sr);
+			countLogicalReads.init("AsyncFile.CountLogicalReads"_sr);
+		}
+	}
+
+	void enqueue(IOBlock* io) {
+		ASSERT(int64_t(io->buf) % 4096 == 0 && io->offset % 4096 == 0 && io->nbytes % 4096 == 0);
+		io->prio = (int64_t(g_network->getCurrentTask()) << 32) - (++ctx.opsIssued);
+		io->owner = Reference<AsyncFileIOUring>::addRef(this);
+	}
+
+	void enqueueOrdered(IOBlock* io) {
+		if (orderedOps.empty()) {
+			ctx.ordered.push_back(this);
+		}
+		orderedOps.push_back(io);
+	}
+
+	// Writes io to the next submission queue entry
+	static void prepare(IOBlock* io, uint8_t sqeFlags, double start) {
+		io->startTime = start;
+		if (ctx.ioTimeout > 0) {
+			ctx.appendToRequestList(io);
+		}
+		if (io->opcode == IORING_OP_WRITE) {
+			AsyncFileIOUring* file = io->owner.getPtr();
+			++file->writesInFlight;
+			if (file->lastFileSize != file->nextFileSize) {
+				file->truncate(file->nextFileSize);
+			}
+		}
+		io->toSqe(ctx.nextSqe(), sqeFlags);
+	}
+
+	// Prepares this file's writes and syncs, in order, while there is space. A sync waits until the writes submitted
+	// before it complete, unless it can be linked behind them in the same submission.
+	void prepareOrdered(int space, int* n, double start) {
+		while (!orderedOps.empty() && *n < space) {
+			IOBlock* io = orderedOps.front();
+			if (io->opcode == IORING_OP_FSYNC) {
+				if (writesInFlight > 0) {
+					return;
+				}
+				prepare(io, 0, start);
+				orderedOps.pop_front();
+				++*n;
+				continue;
+			}
+
+			const int queued = orderedOps.size();
+			int writes = 1;
+			while (writes < queued && writes <= FLOW_KNOBS->IO_URING_MAX_LINKED_WRITES &&
+			       orderedOps[writes]->opcode == IORING_OP_WRITE) {
+				++writes;
+			}
+			if (writesInFlight == 0 && writes <= FLOW_KNOBS->IO_URING_MAX_LINKED_WRITES &&
+			    writes < queued && *n + writes + 1 <= space) {
+				// The sync only starts once all of the writes linked before it have succeeded
+				for (int i = 0; i <= writes; i++) {
+					prepare(orderedOps.front(), i < writes ? IOSQE_IO_LINK : 0, start);
+					orderedOps.pop_front();
+				}
+				*n += writes + 1;
+				++ctx.countLinkedSyncs;
+				continue;
+			}
+
+			prepare(io, 0, start);
+			orderedOps.pop_front();
+			++*n;
+		}
+	}
+
+	static void submit() {
+		while (ctx.unsubmitted > 0) {
+			int rc = syscall(__NR_io_uring_enter, ctx.ringFd, ctx.unsubmitted, 0, 0, nullptr, 0);
+			if (rc < 0) {
+				if (errno == EINTR) {
+					continue;
+				}
+				if (errno == EAGAIN || errno == EBUSY) {
+					// Entries the kernel did not consume stay in the ring and are submitted by the next launch()
+					retrySubmit();
+					return;
+				}
+				int err = errno;
+				TraceEvent(SevWarnAlways, "IOUringSubmitError").suppressFor(1.0).GetLastError();
+				failUnsubmitted(err);
+				return;
+			}
+			ctx.unsubmitted -= rc;
+			if (rc == 0) {
+				retrySubmit();
+				return;
+			}
+		}
+	}
+
+	// Makes sure launch() runs again for entries left in the ring. While some of the submitted operations are in
+	// flight, their completions wake the run loop anyway.
+	ACTOR static void retrySubmit() {
+		if (!ctx.submitRetryPending && ctx.outstanding <= ctx.unsubmitted) {
+			ctx.submitRetryPending = true;
+			wait(delay(0, TaskPriority::DiskIOComplete));
+			ctx.submitRetryPending = false;
+		}
+	}
+
+	// Withdraws the entries the kernel has not consumed from the submission ring and fails their operations with an
+	// io_error, as AsyncFileKAIO does when io_submit fails. The kernel only consumes entries in io_uring_enter, so the
+	// ring tail can safely be moved back to its head.
+	static void failUnsubmitted(int err) {
+		unsigned head = __atomic_load_n(ctx.sqHead, __ATOMIC_ACQUIRE);
+		std::vector<IOBlock*> withdrawn;
+		withdrawn.reserve(ctx.sqLocalTail - head);
+		for (unsigned i = head; i != ctx.sqLocalTail; ++i) {
+			withdrawn.push_back((IOBlock*)ctx.sqes[ctx.sqArray[i & ctx.sqMask]].user_data);
+		}
+		ctx.sqLocalTail = head;
+		__atomic_store_n(ctx.sqTail, head, __ATOMIC_RELEASE);
+		ctx.unsubmitted = 0;
+		ctx.outstanding -= withdrawn.size();
+
+		for (IOBlock* io : withdrawn) {
+			if (ctx.ioTimeout > 0) {
+				ctx.removeFromRequestList(io);
+			}
+			if (io->opcode == IORING_OP_WRITE) {
+				--io->owner->writesInFlight;
+			}
+			io->setResult(err ? -err : -1000000);
+		}
+	}
+
+	static int openFlags(int flags) {
+		int oflags = O_DIRECT | O_CLOEXEC;
+		ASSERT(bool(flags & OPEN_READONLY) != bool(flags & OPEN_READWRITE)); // readonly xor readwrite
+		if (flags & OPEN_EXCLUSIVE)
+			oflags |= O_EXCL;
+		if (flags & OPEN_CREATE)
+			oflags |= O_CREAT;
+		if (flags & OPEN_READONLY)
+			oflags |= O_RDONLY;
+		if (flags & OPEN_READWRITE)
+			oflags |= O_RDWR;
+		if (flags & OPEN_ATOMIC_WRITE_AND_CREATE)
+			oflags |= O_TRUNC;
+		return oflags;
+	}
+
+	ACTOR static void poll(Reference<IEventFD> ev) {
+		loop {
+			wait(success(ev->read()));
+
+			wait(delay(0, TaskPriority::DiskIOComplete));
+
+			double currentTime = timer();
+			++ctx.countCollect;
+
+			unsigned head = *ctx.cqHead;
+			unsigned tail = __atomic_load_n(ctx.cqTail, __ATOMIC_ACQUIRE);
+			std::vector<std::pair<IOBlock*, int>> completed;
+			completed.reserve(tail - head);
+			for (; head != tail; ++head) {
+				io_uring_cqe* cqe = &ctx.cqes[head & ctx.cqMask];
+				completed.emplace_back((IOBlock*)cqe->user_data, cqe->res);
+			}
+			__atomic_store_n(ctx.cqHead, head, __ATOMIC_RELEASE);
+
+			if (!completed.empty()) {
+				double t = timer_monotonic();
+				double elapsed = t - ctx.ioStallBegin;
+				ctx.ioStallBegin = t;
+				g_network->networkInfo.metrics.secSquaredDiskStall += elapsed * elapsed / 2;
+			}
+
+			ctx.outstanding -= completed.size();
+
+			if (ctx.ioTimeout > 0) {
+				while (ctx.submittedRequestList && currentTime - ctx.submittedRequestList->startTime > ctx.ioTimeout) {
+					ctx.submittedRequestList->timeout(ctx.timeoutWarnOnly);
+					ctx.removeFromRequestList(ctx.submittedRequestList);
+				}
+			}
+
+			for (auto& [iob, result] : completed) {
+				if (ctx.ioTimeout > 0) {
+					ctx.removeFromRequestList(iob);
+				}
+
+				switch (iob->opcode) {
+				case IORING_OP_READ:
+					getMetrics().readLatencySample.addMeasurement(currentTime - iob->startTime);
+					break;
+				case IORING_OP_WRITE:
+					--iob->owner->writesInFlight;
+					getMetrics().writeLatencySample.addMeasurement(currentTime - iob->startTime);
+					break;
+				}
+
+				iob->setResult(result);
+			}
+		}
+	}
+};
+
+TEST_CASE("/fdbrpc/AsyncFileIOUring/LinkedSync") {
+	// This test does nothing in simulation, or unless io_uring is in use
+	if (!g_network->isSimulated() && AsyncFileIOUring::isEnabled()) {
+		state Reference<IAsyncFile> f;
+		state Arena arena;
+		state int pageSize = 4096;
+		state uint8_t* buf = (uint8_t*)arena.allocate4kAlignedBuffer(pageSize * 2);
+		try {
+			Reference<IAsyncFile> f_ = wait(AsyncFileIOUring::open(
+			    "/tmp/__IOURING_TEST_FILE__",
+			    IAsyncFile::OPEN_UNBUFFERED | IAsyncFile::OPEN_READWRITE | IAsyncFile::OPEN_CREATE,
+			    0666,
+			    nullptr));
+			f = f_;
+
+			// Writes issued together with the sync that covers them
+			state int i = 0;
+			for (; i < 100; ++i) {
+				memset(buf, i, pageSize);
+				Future<Void> w = f->write(buf, pageSize, i * pageSize);
+				wait(w && f->sync());
+			}
+
+			for (i = 0; i < 100; ++i) {
+				int n = wait(f->read(buf + pageSize, pageSize, i * pageSize));
+				ASSERT(n == pageSize && buf[pageSize] == i && buf[2 * pageSize - 1] == i);
+			}
+		} catch (Error& e) {
+			state Error err = e;
+			if (f) {
+				wait(AsyncFileEIO::deleteFile(f->getFilename(), true));
+			}
+			throw err;
+		}
+
+		wait(AsyncFileEIO::deleteFile(f->getFilename(), true));
+	}
+
+	return Void();
+}
+
+AsyncFileIOUring::Context AsyncFileIOUring::ctx;
+
+#include "flow/unactorcompiler.h"
+#endif
+#endif
@@ -475,7 +475,7 @@ public:
 			value.sequence = queue->acknowledgements.sequence++;
 			queue->acknowledgements.bytesSent += value.expectedSize();
 			FlowTransport::transport().sendUnreliable(
-			    SerializeSource<ErrorOr<EnsureTable<T>>>(value), getEndpoint(), false);
+			    SerializeSource<ErrorOr<EnsureTable<T>>>(value, getReferencedArena(value)), getEndpoint(), false);
 		} else {
 			queue->send(std::forward<U>(value));
 		}
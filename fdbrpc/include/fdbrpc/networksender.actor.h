@@ -35,7 +35,8 @@ ACTOR template <class T>
 void networkSender(Future<T> input, Endpoint endpoint) {
 	try {
 		T value = wait(input);
-		FlowTransport::transport().sendUnreliable(SerializeSource<ErrorOr<EnsureTable<T>>>(value), endpoint, false);
+		FlowTransport::transport().sendUnreliable(
+		    SerializeSource<ErrorOr<EnsureTable<T>>>(value, getReferencedArena(value)), endpoint, false);
 	} catch (Error& err) {
 		// if (err.code() == error_code_broken_promise) return;
 		if (err.code() == error_code_never_reply) {
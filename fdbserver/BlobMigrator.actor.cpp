@@ -670,6 +670,10 @@ private:
 						dprint("Unsupported GetValueRequest\n");
 						req.reply.sendError(unsupported_operation());
 					}
+					when(GetValuesRequest req = waitNext(ssi.getValues.getFuture())) {
+						dprint("Unsupported GetValuesRequest\n");
+						req.reply.sendError(unsupported_operation());
+					}
 					when(GetCheckpointRequest req = waitNext(ssi.checkpoint.getFuture())) {
 						dprint("Unsupported GetCheckpoint \n");
 						req.reply.sendError(unsupported_operation());
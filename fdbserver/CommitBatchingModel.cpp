@@ -0,0 +1,145 @@
+/*
+ * CommitBatchingModel.cpp
+ *
+ * This source file is part of the FoundationDB open source project
+ *
+ * Copyright 2013-2024 Apple Inc. and the FoundationDB project authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "fdbserver/CommitBatchingModel.h"
+
+#include <algorithm>
+
+#include "fdbserver/Knobs.h"
+#include "flow/UnitTest.h"
+
+void BatchLatencyModel::addSample(double bytes, double latency) {
+	const double decay = 1.0 - alpha;
+	weight = weight * decay + 1.0;
+	sumX = sumX * decay + bytes;
+	sumY = sumY * decay + latency;
+	sumXX = sumXX * decay + bytes * bytes;
+	sumXY = sumXY * decay + bytes * latency;
+
+	const double meanX = sumX / weight;
+	const double meanY = sumY / weight;
+	const double varianceX = sumXX / weight - meanX * meanX;
+	// While recent batches all have about the same size the slope can't be told apart from noise, so keep the
+	// previous one and only move the intercept.
+	if (varianceX > 1e-4 * meanX * meanX + 1.0) {
+		perByte = std::max(0.0, (sumXY / weight - meanX * meanY) / varianceX);
+	}
+	base = std::max(0.0, meanY - perByte * meanX);
+}
+
+CommitBatchingModel::CommitBatchingModel()
+  : resolver(SERVER_KNOBS->COMMIT_BATCHING_MODEL_ALPHA), tlog(SERVER_KNOBS->COMMIT_BATCHING_MODEL_ALPHA),
+    arrivalRate(SERVER_KNOBS->COMMIT_BATCHING_ARRIVAL_RATE_WINDOW),
+    interval(SERVER_KNOBS->COMMIT_TRANSACTION_BATCH_INTERVAL_MIN),
+    desiredBytes(SERVER_KNOBS->COMMIT_TRANSACTION_BATCH_BYTES_MIN) {}
+
+void CommitBatchingModel::addArrival(int bytes, double t) {
+	arrivalRate.addDelta(bytes, t);
+}
+
+void CommitBatchingModel::addBatch(int bytes, double resolverLatency, double tlogLatency, double totalLatency) {
+	const double batchOverhead = std::max(0.0, totalLatency - resolverLatency - tlogLatency);
+	overhead = resolver.empty() ? batchOverhead
+	                            : overhead + SERVER_KNOBS->COMMIT_BATCHING_MODEL_ALPHA * (batchOverhead - overhead);
+	resolver.addSample(bytes, resolverLatency);
+	tlog.addSample(bytes, tlogLatency);
+}
+
+void CommitBatchingModel::update(double t) {
+	if (empty()) {
+		return;
+	}
+
+	const double fixedLatency = resolver.getBase() + tlog.getBase() + overhead;
+	const double perByte = resolver.getPerByte() + tlog.getPerByte();
+	const double budget = SERVER_KNOBS->COMMIT_BATCHING_LATENCY_SLO - fixedLatency;
+
+	// Largest T with T + perByte * rate * T <= budget. If the fixed part alone misses the SLO, batch as little as
+	// allowed.
+	interval = std::max(SERVER_KNOBS->COMMIT_TRANSACTION_BATCH_INTERVAL_MIN,
+	                    std::min(SERVER_KNOBS->COMMIT_TRANSACTION_BATCH_INTERVAL_MAX,
+	                             budget / (1.0 + perByte * arrivalRate.smoothRate(t))));
+
+	// Largest batch that still meets the SLO if it fills up just as the interval ends
+	const double maxBytes = SERVER_KNOBS->COMMIT_BATCHING_ADAPTIVE_BYTES_MAX;
+	const double bytes = budget <= interval ? 0.0 : perByte > 0.0 ? (budget - interval) / perByte : maxBytes;
+	desiredBytes = (int)std::max<double>(SERVER_KNOBS->COMMIT_BATCHING_ADAPTIVE_BYTES_MIN, std::min(maxBytes, bytes));
+}
+
+TEST_CASE("/fdbserver/CommitBatchingModel/LinearFit") {
+	BatchLatencyModel model(0.05);
+	ASSERT(model.empty());
+	for (int i = 0; i < 1000; i++) {
+		double bytes = deterministicRandom()->randomInt(1000, 1000000);
+		model.addSample(bytes, 0.002 + 1e-8 * bytes);
+	}
+	ASSERT(std::abs(model.getBase() - 0.002) < 1e-6);
+	ASSERT(std::abs(model.getPerByte() - 1e-8) < 1e-12);
+
+	// Once all batches have the same size the model still follows their latency
+	for (int i = 0; i < 1000; i++) {
+		model.addSample(50000, 0.004);
+	}
+	ASSERT(std::abs(model.predict(50000) - 0.004) < 1e-6);
+	return Void();
+}
+
+TEST_CASE("/fdbserver/CommitBatchingModel/LatencyTarget") {
+	const double slo = SERVER_KNOBS->COMMIT_BATCHING_LATENCY_SLO;
+	const double minInterval = SERVER_KNOBS->COMMIT_TRANSACTION_BATCH_INTERVAL_MIN;
+	const double maxInterval = SERVER_KNOBS->COMMIT_TRANSACTION_BATCH_INTERVAL_MAX;
+
+	CommitBatchingModel model;
+	ASSERT(model.empty());
+
+	// Round trips that take a fraction of the SLO, plus a cost per byte
+	const double base = slo / 10;
+	const double perByte = slo / 1e7;
+	double t = 0;
+	double lastInterval = std::max(minInterval, maxInterval);
+	for (double rate : { 1e4, 1e6, 1e7, 1e8 }) {
+		for (int i = 0; i < 2000; i++) {
+			int bytes = deterministicRandom()->randomInt(1000, 200000);
+			t += bytes / rate;
+			model.addArrival(bytes, t);
+			model.addBatch(bytes, base + perByte * bytes, base + perByte * bytes, 3 * base + 2 * perByte * bytes);
+		}
+		model.update(t);
+		const double interval = model.getInterval();
+		ASSERT(interval >= minInterval && interval <= std::max(minInterval, maxInterval));
+		ASSERT(interval <= lastInterval);
+		if (interval > minInterval) {
+			// The predicted latency of a batch that closes on the timer meets the SLO
+			ASSERT(interval + 3 * base + 2 * perByte * model.getArrivalRate(t) * interval <= slo * 1.01);
+		}
+		ASSERT(model.getDesiredBytes() >= SERVER_KNOBS->COMMIT_BATCHING_ADAPTIVE_BYTES_MIN);
+		ASSERT(model.getDesiredBytes() <= SERVER_KNOBS->COMMIT_BATCHING_ADAPTIVE_BYTES_MAX);
+		lastInterval = interval;
+	}
+
+	// Round trips that miss the SLO on their own leave the smallest batches
+	for (int i = 0; i < 2000; i++) {
+		model.addBatch(100000, slo, slo, 3 * slo);
+	}
+	model.update(t);
+	ASSERT_EQ(model.getInterval(), minInterval);
+	ASSERT_EQ(model.getDesiredBytes(), SERVER_KNOBS->COMMIT_BATCHING_ADAPTIVE_BYTES_MIN);
+	return Void();
+}
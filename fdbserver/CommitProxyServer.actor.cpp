@@ -19,6 +19,7 @@
  */
 
 #include <algorithm>
+#include <atomic>
 #include <string_view>
 #include <tuple>
 #include <variant>
@@ -385,6 +386,9 @@ ACTOR Future<Void> commitBatcher(ProxyCommitData* commitData,
 		state Future<Void> timeout;
 		state std::vector<CommitTransactionRequest> batch;
 		state int batchBytes = 0;
+		state int batchDesiredBytes = SERVER_KNOBS->COMMIT_BATCHING_ADAPTIVE && !commitData->batchingModel.empty()
+		                                  ? commitData->batchingModel.getDesiredBytes()
+		                                  : desiredBytes;
 		// TODO: Enable this assertion (currently failing with gcc)
 		// static_assert(std::is_nothrow_move_constructible_v<CommitTransactionRequest>);
 
@@ -395,7 +399,7 @@ ACTOR Future<Void> commitBatcher(ProxyCommitData* commitData,
 		}
 
 		while (!timeout.isReady() &&
-		       !(batch.size() == SERVER_KNOBS->COMMIT_TRANSACTION_BATCH_COUNT_MAX || batchBytes >= desiredBytes)) {
+		       !(batch.size() == SERVER_KNOBS->COMMIT_TRANSACTION_BATCH_COUNT_MAX || batchBytes >= batchDesiredBytes)) {
 			choose {
 				when(CommitTransactionRequest req = waitNext(in)) {
 					// WARNING: this code is run at a high priority, so it needs to do as little work as possible
@@ -452,6 +456,7 @@ ACTOR Future<Void> commitBatcher(ProxyCommitData* commitData,
 					if ((batchBytes + bytes > CLIENT_KNOBS->TRANSACTION_SIZE_LIMIT || req.firstInBatch()) &&
 					    batch.size()) {
 						commitData->triggerCommit.set(false);
+						commitData->batchingModel.addArrival(batchBytes, now());
 						out.send({ std::move(batch), batchBytes });
 						lastBatch = now();
 						timeout = delayJittered(commitData->commitBatchInterval, TaskPriority::ProxyCommitBatcher);
@@ -476,6 +481,7 @@ ACTOR Future<Void> commitBatcher(ProxyCommitData* commitData,
 			}
 		}
 		commitData->triggerCommit.set(false);
+		commitData->batchingModel.addArrival(batchBytes, now());
 		out.send({ std::move(batch), batchBytes });
 		lastBatch = now();
 	}
@@ -623,6 +629,55 @@ constexpr const std::string_view TRANSACTION_LOGGING = "transactionLogging"sv;
 constexpr const std::string_view REPLY = "reply"sv;
 constexpr const std::string_view COMPLETE = "complete"sv;
 
+// Shard lookups, cache tag checks and encryption for the transactions [beginTxn, endTxn) of a batch, computed on one
+// of the commit proxy's assignMutationsThreads. Entries are indexed by firstMutation[txn - beginTxn] + mutationNum;
+// transactions that are not written to storage servers have no entries.
+struct PreparedMutations : ThreadSafeReferenceCounted<PreparedMutations> {
+	enum { Pending, Running, Done, Cancelled };
+
+	using CipherKeys = std::unordered_map<EncryptCipherDomainId, Reference<BlobCipherKey>>;
+
+	// What the helper reads of transaction beginTxn + i, or an unassigned entry if it is not written to storage servers
+	struct Transaction {
+		bool assigned = false;
+		int64_t encryptDomain = INVALID_ENCRYPT_DOMAIN_ID;
+		VectorRef<MutationRef> mutations;
+		VectorRef<Optional<MutationRef>> encryptedMutations;
+	};
+
+	int beginTxn;
+	int endTxn;
+
+	// Inputs, owned here rather than read from the CommitBatchContext so that a cancelled batch can be freed while a
+	// helper thread still runs the chunk. inputArena holds the memory of the transactions' mutations. The shard and
+	// cache maps of pProxyCommitData outlive running chunks, since assignMutationsThreads is destroyed first and
+	// joins its threads.
+	ProxyCommitData* pProxyCommitData;
+	bool encrypt;
+	std::vector<Transaction> transactions;
+	Arena inputArena;
+	std::shared_ptr<const CipherKeys> cipherKeys;
+
+	std::vector<int> firstMutation;
+	// nullptr for clears that span more than one shard
+	std::vector<ServerCacheInfo*> shards;
+	std::vector<bool> cacheTags;
+	// Present if the mutation has been encrypted here rather than by the client
+	std::vector<Optional<MutationRef>> encrypted;
+	Arena arena;
+	double encryptionTime = 0;
+
+	std::atomic<int> state = Pending;
+
+	PreparedMutations(int beginTxn,
+	                  int endTxn,
+	                  ProxyCommitData* pProxyCommitData,
+	                  bool encrypt,
+	                  std::shared_ptr<const CipherKeys> cipherKeys)
+	  : beginTxn(beginTxn), endTxn(endTxn), pProxyCommitData(pProxyCommitData), encrypt(encrypt),
+	    cipherKeys(std::move(cipherKeys)) {}
+};
+
 struct CommitBatchContext {
 	using StoreCommit_t = std::vector<std::pair<Future<LogSystemDiskQueueAdapter::CommitMessage>, Future<Void>>>;
 
@@ -670,6 +725,10 @@ struct CommitBatchContext {
 	double computeStart;
 	double computeDuration = 0;
 
+	// Round trips of the batch to the resolvers and the TLogs, for pProxyCommitData->batchingModel
+	double resolutionLatency = 0;
+	double tlogLatency = 0;
+
 	Arena arena;
 
 	/// true if the batch is the 1st batch for this proxy, additional metadata
@@ -718,7 +777,13 @@ struct CommitBatchContext {
 
 	IdempotencyIdKVBuilder idempotencyKVBuilder;
 
+	// Chunks of the second pass handed to pProxyCommitData->assignMutationsThreads, in transaction order
+	std::vector<Reference<PreparedMutations>> preparedMutations;
+	std::vector<Future<Void>> preparedMutationsReady;
+	int nextPreparedMutations = 0;
+
 	CommitBatchContext(ProxyCommitData*, const std::vector<CommitTransactionRequest>*, const int);
+	~CommitBatchContext();
 
 	void setupTraceBatch();
 
@@ -732,6 +797,15 @@ private:
 	void evaluateBatchSize();
 };
 
+CommitBatchContext::~CommitBatchContext() {
+	// Chunks that have not started are cancelled. Those running on a helper thread own their inputs, and are released
+	// by the helper once it is done with them.
+	for (auto& prepared : preparedMutations) {
+		int expected = PreparedMutations::Pending;
+		prepared->state.compare_exchange_strong(expected, PreparedMutations::Cancelled);
+	}
+}
+
 bool CommitBatchContext::rangeLockEnabled() {
 	return pProxyCommitData->rangeLockEnabled();
 }
@@ -1167,7 +1241,8 @@ ACTOR Future<Void> getResolution(CommitBatchContext* self) {
 	std::vector<ResolveTransactionBatchReply> resolutionResp = wait(getAll(replies));
 	self->resolution.swap(*const_cast<std::vector<ResolveTransactionBatchReply>*>(&resolutionResp));
 
-	self->pProxyCommitData->stats.resolutionDist->sampleSeconds(g_network->timer_monotonic() - resolutionStart);
+	self->resolutionLatency = g_network->timer_monotonic() - resolutionStart;
+	self->pProxyCommitData->stats.resolutionDist->sampleSeconds(self->resolutionLatency);
 	if (self->debugID.present()) {
 		g_traceBatch.addEvent(
 		    "CommitDebug", self->debugID.get().first(), "CommitProxyServer.commitBatch.AfterResolution");
@@ -2041,6 +2116,162 @@ void rejectMutationsForReadLockOnRange(CommitBatchContext* self) {
 	return;
 }
 
+// Whether the mutations of trs[transactionNum] are written to storage servers by the second pass
+bool isAssignedToStorageServers(CommitBatchContext* self, int transactionNum) {
+	return self->committed[transactionNum] == ConflictBatch::TransactionCommitted &&
+	       (!self->locked || self->trs[transactionNum].isLockAware());
+}
+
+// The shard containing all of range, or nullptr if it spans more than one
+ServerCacheInfo* singleShardContaining(ProxyCommitData* pProxyCommitData, KeyRangeRef range) {
+	auto ranges = pProxyCommitData->keyInfo.intersectingRanges(range);
+	auto firstRange = ranges.begin();
+	++firstRange;
+	return firstRange == ranges.end() ? &ranges.begin().value() : nullptr;
+}
+
+int64_t getTransactionEncryptDomain(CommitBatchContext* self, int transactionNum) {
+	int64_t encryptDomain = self->trs[transactionNum].tenantInfo.tenantId;
+	if (self->pProxyCommitData->encryptMode.mode == EncryptionAtRestMode::CLUSTER_AWARE &&
+	    encryptDomain != SYSTEM_KEYSPACE_ENCRYPT_DOMAIN_ID) {
+		encryptDomain = FDB_DEFAULT_ENCRYPT_DOMAIN_ID;
+	}
+	return encryptDomain;
+}
+
+// Runs on a helper thread. Only reads the chunk's own inputs and state that does not change while
+// assignMutationsToStorageServers() runs: the shard and cache maps are only modified by the first pass, and later
+// batches wait on latestLocalCommitBatchLogging. Tags are populated, and raw access and client encrypted mutations
+// handled, by the network thread.
+void prepareMutations(PreparedMutations& prepared) {
+	ProxyCommitData* const pProxyCommitData = prepared.pProxyCommitData;
+
+	for (const PreparedMutations::Transaction& tr : prepared.transactions) {
+		prepared.firstMutation.push_back(prepared.shards.size());
+		if (!tr.assigned) {
+			continue;
+		}
+
+		const VectorRef<MutationRef>& mutations = tr.mutations;
+		const VectorRef<Optional<MutationRef>>& encryptedMutations = tr.encryptedMutations;
+		const int64_t encryptDomain = tr.encryptDomain;
+
+		for (int mutationNum = 0; mutationNum < mutations.size(); mutationNum++) {
+			const MutationRef& m = mutations[mutationNum];
+			ServerCacheInfo* shard = nullptr;
+			bool cacheTag = false;
+			if (isSingleKeyMutation((MutationRef::Type)m.type)) {
+				shard = &pProxyCommitData->keyInfo.rangeContaining(m.param1).value();
+				cacheTag = pProxyCommitData->cacheInfo[m.param1];
+			} else if (m.type == MutationRef::ClearRange) {
+				KeyRangeRef clearRange(m.param1, m.param2);
+				shard = singleShardContaining(pProxyCommitData, clearRange);
+				cacheTag = pProxyCommitData->needsCacheTag(clearRange);
+			}
+
+			Optional<MutationRef> encrypted;
+			if (prepared.encrypt && m.type != MutationRef::NoOp && encryptDomain != INVALID_ENCRYPT_DOMAIN_ID &&
+			    (encryptedMutations.empty() || !encryptedMutations[mutationNum].present())) {
+				double encryptionTime = 0;
+				encrypted = m.encrypt(
+				    *prepared.cipherKeys, encryptDomain, prepared.arena, BlobCipherMetrics::TLOG, &encryptionTime);
+				prepared.encryptionTime += encryptionTime;
+			}
+
+			prepared.shards.push_back(shard);
+			prepared.cacheTags.push_back(cacheTag);
+			prepared.encrypted.push_back(encrypted);
+		}
+	}
+	prepared.firstMutation.push_back(prepared.shards.size());
+}
+
+struct AssignMutationsWorker final : IThreadPoolReceiver {
+	void init() override {}
+
+	struct PrepareAction final : TypedAction<AssignMutationsWorker, PrepareAction> {
+		Reference<PreparedMutations> prepared;
+		ThreadReturnPromise<Void> result;
+
+		explicit PrepareAction(Reference<PreparedMutations> prepared) : prepared(prepared) {}
+
+		double getTimeEstimate() const override { return 0; }
+	};
+
+	void action(PrepareAction& a) {
+		int expected = PreparedMutations::Pending;
+		if (!a.prepared->state.compare_exchange_strong(expected, PreparedMutations::Running)) {
+			// The batch was cancelled, so nobody needs the result
+			return;
+		}
+		Optional<Error> error;
+		try {
+			prepareMutations(*a.prepared);
+		} catch (Error& e) {
+			error = e;
+		}
+		a.prepared->state.store(PreparedMutations::Done);
+		if (error.present()) {
+			a.result.sendError(error.get());
+		} else {
+			a.result.send(Void());
+		}
+	}
+};
+
+// Splits the committed transactions of the batch into chunks of about PROXY_ASSIGN_MUTATIONS_CHUNK_BYTES and hands
+// them to the helper threads. Batches smaller than a chunk are left to the network thread.
+void startPreparingMutations(CommitBatchContext* self) {
+	ProxyCommitData* const pProxyCommitData = self->pProxyCommitData;
+	const std::vector<CommitTransactionRequest>& trs = self->trs;
+	if (!pProxyCommitData->assignMutationsThreads) {
+		return;
+	}
+
+	std::vector<std::pair<int, int>> chunks;
+	int64_t chunkBytes = 0;
+	int beginTxn = self->transactionNum;
+	for (int transactionNum = self->transactionNum; transactionNum < trs.size(); transactionNum++) {
+		if (isAssignedToStorageServers(self, transactionNum)) {
+			chunkBytes += trs[transactionNum].transaction.mutations.expectedSize();
+		}
+		if (chunkBytes >= SERVER_KNOBS->PROXY_ASSIGN_MUTATIONS_CHUNK_BYTES) {
+			chunks.emplace_back(beginTxn, transactionNum + 1);
+			beginTxn = transactionNum + 1;
+			chunkBytes = 0;
+		}
+	}
+	if (chunks.empty()) {
+		return;
+	}
+	if (beginTxn < trs.size()) {
+		chunks.emplace_back(beginTxn, trs.size());
+	}
+
+	CODE_PROBE(chunks.size() > 1, "Commit proxy prepares mutations in several chunks");
+	const bool encrypt = pProxyCommitData->encryptMode.isEncryptionEnabled() && pProxyCommitData->acsBuilder == nullptr;
+	auto cipherKeys = std::make_shared<const PreparedMutations::CipherKeys>(self->cipherKeys);
+	for (const auto& [beginTxn, endTxn] : chunks) {
+		auto prepared = makeReference<PreparedMutations>(beginTxn, endTxn, pProxyCommitData, encrypt, cipherKeys);
+		prepared->transactions.resize(endTxn - beginTxn);
+		for (int transactionNum = beginTxn; transactionNum < endTxn; transactionNum++) {
+			if (!isAssignedToStorageServers(self, transactionNum)) {
+				continue;
+			}
+			PreparedMutations::Transaction& tr = prepared->transactions[transactionNum - beginTxn];
+			tr.assigned = true;
+			tr.encryptDomain = getTransactionEncryptDomain(self, transactionNum);
+			tr.mutations = trs[transactionNum].transaction.mutations;
+			tr.encryptedMutations = trs[transactionNum].transaction.encryptedMutations;
+			prepared->inputArena.dependsOn(trs[transactionNum].arena);
+		}
+		auto action = new AssignMutationsWorker::PrepareAction(prepared);
+		self->preparedMutations.push_back(prepared);
+		self->preparedMutationsReady.push_back(action->result.getFuture());
+		pProxyCommitData->assignMutationsThreads->post(action);
+	}
+}
+
 /// This second pass through committed transactions assigns the actual mutations to the appropriate storage servers'
 /// tags
 ACTOR Future<Void> assignMutationsToStorageServers(CommitBatchContext* self) {
@@ -2048,13 +2279,32 @@ ACTOR Future<Void> assignMutationsToStorageServers(CommitBatchContext* self) {
 	state std::vector<CommitTransactionRequest>& trs = self->trs;
 	state double curEncryptionTime = 0;
 	state double totalEncryptionTime = 0;
+	state int readyPreparedMutations = -1;
+
+	startPreparingMutations(self);
 
 	for (; self->transactionNum < trs.size(); self->transactionNum++) {
-		if (!(self->committed[self->transactionNum] == ConflictBatch::TransactionCommitted &&
-		      (!self->locked || trs[self->transactionNum].isLockAware()))) {
+		if (!isAssignedToStorageServers(self, self->transactionNum)) {
 			continue;
 		}
 
+		state PreparedMutations* prepared = nullptr;
+		state int firstPrepared = 0;
+		if (!self->preparedMutations.empty()) {
+			while (self->preparedMutations[self->nextPreparedMutations]->endTxn <= self->transactionNum) {
+				self->nextPreparedMutations++;
+			}
+			prepared = self->preparedMutations[self->nextPreparedMutations].getPtr();
+			if (readyPreparedMutations != self->nextPreparedMutations) {
+				self->computeDuration += g_network->timer_monotonic() - self->computeStart;
+				wait(self->preparedMutationsReady[self->nextPreparedMutations]);
+				self->computeStart = g_network->timer_monotonic();
+				readyPreparedMutations = self->nextPreparedMutations;
+				totalEncryptionTime += prepared->encryptionTime;
+			}
+			firstPrepared = prepared->firstMutation[self->transactionNum - prepared->beginTxn];
+		}
+
 		state bool checkSample = trs[self->transactionNum].commitCostEstimation.present();
 		state Optional<ClientTrCommitCostEstimation>* trCost = &trs[self->transactionNum].commitCostEstimation;
 		state int mutationNum = 0;
@@ -2066,11 +2316,7 @@ ACTOR Future<Void> assignMutationsToStorageServers(CommitBatchContext* self) {
 			ASSERT_EQ(encryptedMutations->size(), pMutations->size());
 		}
 
-		state int64_t encryptDomain = trs[self->transactionNum].tenantInfo.tenantId;
-		if (self->pProxyCommitData->encryptMode.mode == EncryptionAtRestMode::CLUSTER_AWARE &&
-		    encryptDomain != SYSTEM_KEYSPACE_ENCRYPT_DOMAIN_ID) {
-			encryptDomain = FDB_DEFAULT_ENCRYPT_DOMAIN_ID;
-		}
+		state int64_t encryptDomain = getTransactionEncryptDomain(self, self->transactionNum);
 
 		self->toCommit.addTransactionInfo(trs[self->transactionNum].spanContext);
 
@@ -2096,7 +2342,11 @@ ACTOR Future<Void> assignMutationsToStorageServers(CommitBatchContext* self) {
 			// Determine the set of tags (responsible storage servers) for the mutation, splitting it
 			// if necessary.  Serialize (splits of) the mutation into the message buffer and add the tags.
 			if (isSingleKeyMutation((MutationRef::Type)m.type)) {
-				auto& tags = pProxyCommitData->tagsForKey(m.param1);
+				ServerCacheInfo* shard = prepared ? prepared->shards[firstPrepared + mutationNum] : nullptr;
+				if (shard) {
+					shard->populateTags();
+				}
+				auto& tags = shard ? shard->tags : pProxyCommitData->tagsForKey(m.param1);
 
 				// sample single key mutation based on cost
 				// the expectation of sampling is every COMMIT_SAMPLE_COST sample once
@@ -2131,7 +2381,8 @@ ACTOR Future<Void> assignMutationsToStorageServers(CommitBatchContext* self) {
 
 				DEBUG_MUTATION("ProxyCommit", self->commitVersion, m, pProxyCommitData->dbgid).detail("To", tags);
 				self->toCommit.addTags(tags);
-				if (pProxyCommitData->cacheInfo[m.param1]) {
+				if (prepared ? prepared->cacheTags[firstPrepared + mutationNum]
+				             : pProxyCommitData->cacheInfo[m.param1]) {
 					self->toCommit.addTag(cacheTag);
 				}
 				if (encryptedMutation.present()) {
@@ -2149,29 +2400,33 @@ ACTOR Future<Void> assignMutationsToStorageServers(CommitBatchContext* self) {
 					    pProxyCommitData->dbgid);
 				}
 
-				WriteMutationRefVar var =
-				    wait(writeMutation(self, encryptDomain, &m, &encryptedMutation, &arena, &curEncryptionTime));
-				totalEncryptionTime += curEncryptionTime;
-				// FIXME: Remove assert once ClearRange RAW_ACCESS usecase handling is done
-				ASSERT(std::holds_alternative<MutationRef>(var));
-				writtenMutation = std::get<MutationRef>(var);
+				if (prepared && prepared->encrypted[firstPrepared + mutationNum].present()) {
+					writtenMutation = prepared->encrypted[firstPrepared + mutationNum].get();
+					self->toCommit.writeTypedMessage(writtenMutation);
+				} else {
+					WriteMutationRefVar var =
+					    wait(writeMutation(self, encryptDomain, &m, &encryptedMutation, &arena, &curEncryptionTime));
+					totalEncryptionTime += curEncryptionTime;
+					// FIXME: Remove assert once ClearRange RAW_ACCESS usecase handling is done
+					ASSERT(std::holds_alternative<MutationRef>(var));
+					writtenMutation = std::get<MutationRef>(var);
+				}
 			} else if (m.type == MutationRef::ClearRange) {
 				KeyRangeRef clearRange(KeyRangeRef(m.param1, m.param2));
-				auto ranges = pProxyCommitData->keyInfo.intersectingRanges(clearRange);
-				auto firstRange = ranges.begin();
-				++firstRange;
-				if (firstRange == ranges.end()) {
+				ServerCacheInfo* shard = prepared ? prepared->shards[firstPrepared + mutationNum]
+				                                  : singleShardContaining(pProxyCommitData, clearRange);
+				if (shard) {
 					// Fast path
 					DEBUG_MUTATION("ProxyCommit", self->commitVersion, m, pProxyCommitData->dbgid)
-					    .detail("To", ranges.begin().value().tags);
-					ranges.begin().value().populateTags();
-					self->toCommit.addTags(ranges.begin().value().tags);
+					    .detail("To", shard->tags);
+					shard->populateTags();
+					self->toCommit.addTags(shard->tags);
 
 					if (pProxyCommitData->acsBuilder != nullptr) {
 						updateMutationWithAcsAndAddMutationToAcsBuilder(
 						    pProxyCommitData->acsBuilder,
 						    m,
-						    ranges.begin().value().tags,
+						    shard->tags,
 						    getCommitProxyAccumulativeChecksumIndex(pProxyCommitData->commitProxyIndex),
 						    pProxyCommitData->epoch,
 						    self->commitVersion,
@@ -2181,7 +2436,7 @@ ACTOR Future<Void> assignMutationsToStorageServers(CommitBatchContext* self) {
 					// check whether clear is sampled
 					if (checkSample && !trCost->get().clearIdxCosts.empty() &&
 					    trCost->get().clearIdxCosts[0].first == mutationNum) {
-						auto const& ssInfos = ranges.begin().value().src_info;
+						auto const& ssInfos = shard->src_info;
 						for (auto const& ssInfo : ssInfos) {
 							auto id = ssInfo->interf.id();
 							pProxyCommitData->updateSSTagCost(id,
@@ -2193,6 +2448,7 @@ ACTOR Future<Void> assignMutationsToStorageServers(CommitBatchContext* self) {
 					}
 				} else {
 					CODE_PROBE(true, "A clear range extends past a shard boundary");
+					auto ranges = pProxyCommitData->keyInfo.intersectingRanges(clearRange);
 					std::set<Tag> allSources;
 					for (auto r : ranges) {
 						r.value().populateTags();
@@ -2231,15 +2487,21 @@ ACTOR Future<Void> assignMutationsToStorageServers(CommitBatchContext* self) {
 					}
 				}
 
-				if (pProxyCommitData->needsCacheTag(clearRange)) {
+				if (prepared ? prepared->cacheTags[firstPrepared + mutationNum]
+				             : pProxyCommitData->needsCacheTag(clearRange)) {
 					self->toCommit.addTag(cacheTag);
 				}
-				WriteMutationRefVar var =
-				    wait(writeMutation(self, encryptDomain, &m, &encryptedMutation, &arena, &curEncryptionTime));
-				totalEncryptionTime += curEncryptionTime;
-				// FIXME: Remove assert once ClearRange RAW_ACCESS usecase handling is done
-				ASSERT(std::holds_alternative<MutationRef>(var));
-				writtenMutation = std::get<MutationRef>(var);
+				if (prepared && prepared->encrypted[firstPrepared + mutationNum].present()) {
+					writtenMutation = prepared->encrypted[firstPrepared + mutationNum].get();
+					self->toCommit.writeTypedMessage(writtenMutation);
+				} else {
+					WriteMutationRefVar var =
+					    wait(writeMutation(self, encryptDomain, &m, &encryptedMutation, &arena, &curEncryptionTime));
+					totalEncryptionTime += curEncryptionTime;
+					// FIXME: Remove assert once ClearRange RAW_ACCESS usecase handling is done
+					ASSERT(std::holds_alternative<MutationRef>(var));
+					writtenMutation = std::get<MutationRef>(var);
+				}
 			} else if (m.type == MutationRef::NoOp) {
 				ASSERT_EQ(pProxyCommitData->getTenantMode(), TenantMode::REQUIRED);
 				continue;
@@ -2581,6 +2843,7 @@ ACTOR Future<Void> transactionLogging(CommitBatchContext* self) {
 		throw;
 	}
 
+	self->tlogLatency = g_network->timer_monotonic() - tLoggingStart;
 	pProxyCommitData->lastCommitLatency = now() - self->commitStartTime;
 	pProxyCommitData->lastCommitTime = std::max(pProxyCommitData->lastCommitTime.get(), self->commitStartTime);
 
@@ -2788,14 +3051,21 @@ ACTOR Future<Void> reply(CommitBatchContext* self) {
 	}
 
 	// Dynamic batching for commits
-	double target_latency =
-	    (now() - self->startTime) * SERVER_KNOBS->COMMIT_TRANSACTION_BATCH_INTERVAL_LATENCY_FRACTION;
-	pProxyCommitData->commitBatchInterval =
-	    std::max(SERVER_KNOBS->COMMIT_TRANSACTION_BATCH_INTERVAL_MIN,
-	             std::min(SERVER_KNOBS->COMMIT_TRANSACTION_BATCH_INTERVAL_MAX,
-	                      target_latency * SERVER_KNOBS->COMMIT_TRANSACTION_BATCH_INTERVAL_SMOOTHER_ALPHA +
-	                          pProxyCommitData->commitBatchInterval *
-	                              (1 - SERVER_KNOBS->COMMIT_TRANSACTION_BATCH_INTERVAL_SMOOTHER_ALPHA)));
+	pProxyCommitData->batchingModel.addBatch(
+	    self->currentBatchMemBytesCount, self->resolutionLatency, self->tlogLatency, now() - self->startTime);
+	if (SERVER_KNOBS->COMMIT_BATCHING_ADAPTIVE) {
+		pProxyCommitData->batchingModel.update(now());
+		pProxyCommitData->commitBatchInterval = pProxyCommitData->batchingModel.getInterval();
+	} else {
+		double target_latency =
+		    (now() - self->startTime) * SERVER_KNOBS->COMMIT_TRANSACTION_BATCH_INTERVAL_LATENCY_FRACTION;
+		pProxyCommitData->commitBatchInterval =
+		    std::max(SERVER_KNOBS->COMMIT_TRANSACTION_BATCH_INTERVAL_MIN,
+		             std::min(SERVER_KNOBS->COMMIT_TRANSACTION_BATCH_INTERVAL_MAX,
+		                      target_latency * SERVER_KNOBS->COMMIT_TRANSACTION_BATCH_INTERVAL_SMOOTHER_ALPHA +
+		                          pProxyCommitData->commitBatchInterval *
+		                              (1 - SERVER_KNOBS->COMMIT_TRANSACTION_BATCH_INTERVAL_SMOOTHER_ALPHA)));
+	}
 	pProxyCommitData->stats.commitBatchingWindowSize.addMeasurement(pProxyCommitData->commitBatchInterval);
 	pProxyCommitData->commitBatchesMemBytesCount -= self->currentBatchMemBytesCount;
 	ASSERT_ABORT(pProxyCommitData->commitBatchesMemBytesCount >= 0);
@@ -3921,13 +4191,23 @@ ACTOR Future<Void> logDetailedMetrics(ProxyCommitData* commitData) {
 			continue;
 		}
 
+		const CommitBatchingModel& batching = commitData->batchingModel;
 		TraceEvent("ProxyDetailedMetrics")
 		    .detail("Elapsed", now() - startTime)
 		    .detail("CommitBatchIn", commitBatchInReal - commitBatchInBaseline)
 		    .detail("TxnCommitIn", txnCommitInReal - txnCommitInBaseline)
 		    .detail("Mutations", mutationsReal - mutationsBaseline)
 		    .detail("MutationBytes", mutationBytesReal - mutationBytesBaseline)
-		    .detail("UniqueClients", commitData->stats.getSizeAndResetUniqueClients());
+		    .detail("UniqueClients", commitData->stats.getSizeAndResetUniqueClients())
+		    .detail("AdaptiveBatching", SERVER_KNOBS->COMMIT_BATCHING_ADAPTIVE)
+		    .detail("BatchInterval", commitData->commitBatchInterval)
+		    .detail("BatchDesiredBytes", batching.getDesiredBytes())
+		    .detail("BatchArrivalBytesPerSecond", batching.getArrivalRate(now()))
+		    .detail("ResolverLatencyBase", batching.getResolverModel().getBase())
+		    .detail("ResolverLatencyPerByte", batching.getResolverModel().getPerByte())
+		    .detail("TLogLatencyBase", batching.getTLogModel().getBase())
+		    .detail("TLogLatencyPerByte", batching.getTLogModel().getPerByte())
+		    .detail("BatchLatencyOverhead", batching.getOverhead());
 	}
 }
 
@@ -4022,6 +4302,23 @@ ACTOR Future<Void> commitProxyServerCore(CommitProxyInterface proxy,
 		TraceEvent(SevInfo, "CommitProxyRangeLockEnabled", commitData.dbgid);
 	}
 
+	if (SERVER_KNOBS->PROXY_ASSIGN_MUTATIONS_THREADS > 0) {
+		// Simulation runs the helper's work inline so that it stays deterministic
+		if (g_network->isSimulated()) {
+			commitData.assignMutationsThreads = Reference<IThreadPool>(new DummyThreadPool());
+			commitData.assignMutationsThreads->addThread(new CommitBatch::AssignMutationsWorker());
+		} else {
+			commitData.assignMutationsThreads = createGenericThreadPool();
+			for (int i = 0; i < SERVER_KNOBS->PROXY_ASSIGN_MUTATIONS_THREADS; i++) {
+				commitData.assignMutationsThreads->addThread(new CommitBatch::AssignMutationsWorker(),
+				                                             "fdb-proxy-assign");
+			}
+		}
+		TraceEvent("CommitProxyAssignMutationsThreads", commitData.dbgid)
+		    .detail("Threads", SERVER_KNOBS->PROXY_ASSIGN_MUTATIONS_THREADS)
+		    .detail("ChunkBytes", SERVER_KNOBS->PROXY_ASSIGN_MUTATIONS_CHUNK_BYTES);
+	}
+
 	addActor.send(monitorRemoteCommitted(&commitData));
 	addActor.send(tenantIdServer(proxy, addActor, &commitData));
 	addActor.send(readRequestServer(proxy, addActor, &commitData));
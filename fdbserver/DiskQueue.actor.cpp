@@ -110,12 +110,16 @@ struct SyncQueue : ReferenceCounted<SyncQueue> {
 			outstanding.push_back(Void());
 	}
 
-	Future<Void> onSync() { // Future is set when all writes completed before the call to onSync are complete
+	// Future is set when all writes completed before the call to onSync are durable, or all writes issued before it if
+	// syncCoversPendingWrites()
+	Future<Void> onSync() {
 		if (outstanding.size() <= outstandingLimit)
 			outstanding.push_back(waitAndSync(this));
 		return outstanding.back();
 	}
 
+	bool syncCoversPendingWrites() const { return file->syncCoversPendingWrites(); }
+
 private:
 	int outstandingLimit;
 	Deque<Future<Void>> outstanding;
@@ -432,6 +436,20 @@ public:
 		return waitForAllReadyThenThrow(waitfor);
 	}
 
+	static Future<Void> onSync(std::vector<Reference<SyncQueue>> const& syncFiles) {
+		Future<Void> sync = syncFiles[0]->onSync();
+		for (int i = 1; i < syncFiles.size(); i++)
+			sync = sync && syncFiles[i]->onSync();
+		return sync;
+	}
+
+	static bool syncCoversPendingWrites(std::vector<Reference<SyncQueue>> const& syncFiles) {
+		for (auto const& q : syncFiles)
+			if (!q->syncCoversPendingWrites())
+				return false;
+		return true;
+	}
+
 	// Write the given data (pageData) to the queue files of self, sync data to disk, and delete the memory (pageMem)
 	// that hold the pageData
 	ACTOR static UNCANCELLABLE Future<Void> pushAndCommit(RawDiskQueue_TwoFiles* self,
@@ -466,14 +484,20 @@ public:
 			pushing.send(Void());
 			ASSERT(syncFiles.size() >= 1 && syncFiles.size() <= 2);
 			CODE_PROBE(2 == syncFiles.size(), "push spans both files");
+
+			// If the files allow it, the sync is issued along with the writes rather than after they complete, so
+			// that the device sees both at once
+			state Future<Void> sync;
+			state bool syncWithWrites = syncCoversPendingWrites(syncFiles);
+			if (syncWithWrites)
+				sync = onSync(syncFiles);
 			wait(pushed);
 
 			delete pageMem;
 			pageMem = 0;
 
-			Future<Void> sync = syncFiles[0]->onSync();
-			for (int i = 1; i < syncFiles.size(); i++)
-				sync = sync && syncFiles[i]->onSync();
+			if (!syncWithWrites)
+				sync = onSync(syncFiles);
 			wait(sync);
 			wait(lastCommit);
 
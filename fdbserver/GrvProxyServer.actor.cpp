@@ -494,11 +494,125 @@ void dropRequestFromQueue(Deque<GetReadVersionRequest>* queue, GrvProxyStats* st
 }
 
 // Put a GetReadVersion request into the queue corresponding to its priority.
+void queueGetReadVersionRequest(GetReadVersionRequest const& req,
+                                Reference<AsyncVar<ServerDBInfo> const> const& db,
+                                Deque<GetReadVersionRequest>* systemQueue,
+                                Deque<GetReadVersionRequest>* defaultQueue,
+                                Deque<GetReadVersionRequest>* batchQueue,
+                                PromiseStream<Void> const& GRVTimer,
+                                double* lastGRVTime,
+                                double* GRVBatchTime,
+                                GrvProxyStats* stats,
+                                GrvTransactionRateInfo* batchRateInfo,
+                                GrvProxyTagThrottler* tagThrottler) {
+	// WARNING: this code is run at a high priority, so it needs to do as little work as possible
+	bool canBeQueued = true;
+	if (stats->txnRequestIn.getValue() - stats->txnRequestOut.getValue() >
+	        SERVER_KNOBS->START_TRANSACTION_MAX_QUEUE_SIZE ||
+	    (g_network->isSimulated() && !g_simulator->speedUpSimulation && deterministicRandom()->random01() < 0.01)) {
+		// When the limit is hit, try to drop requests from the lower priority queues.
+		if (req.priority == TransactionPriority::BATCH) {
+			canBeQueued = false;
+		} else if (req.priority == TransactionPriority::DEFAULT) {
+			if (!batchQueue->empty()) {
+				dropRequestFromQueue(batchQueue, stats);
+				--stats->batchGRVQueueSize;
+			} else {
+				canBeQueued = false;
+			}
+		} else {
+			if (!batchQueue->empty()) {
+				dropRequestFromQueue(batchQueue, stats);
+				--stats->batchGRVQueueSize;
+			} else if (!defaultQueue->empty()) {
+				dropRequestFromQueue(defaultQueue, stats);
+				--stats->defaultGRVQueueSize;
+			} else {
+				canBeQueued = false;
+			}
+		}
+	}
+	if (!canBeQueued) {
+		proxyGRVThresholdExceeded(&req, stats);
+	} else {
+		stats->addRequest(req.transactionCount);
+
+		if (req.debugID.present())
+			g_traceBatch.addEvent("TransactionDebug",
+			                      req.debugID.get().first(),
+			                      "GrvProxyServer.queueTransactionStartRequests.Before");
+
+		if (systemQueue->empty() && defaultQueue->empty() && batchQueue->empty()) {
+			forwardPromise(GRVTimer,
+			               delayJittered(std::max(0.0, *GRVBatchTime - (now() - *lastGRVTime)),
+			                             TaskPriority::ProxyGRVTimer));
+		}
+
+		if (req.priority >= TransactionPriority::IMMEDIATE) {
+			++stats->txnRequestIn;
+			stats->txnStartIn += req.transactionCount;
+			stats->txnSystemPriorityStartIn += req.transactionCount;
+			++stats->systemGRVQueueSize;
+			systemQueue->push_back(req);
+		} else if (req.priority >= TransactionPriority::DEFAULT) {
+			if (SERVER_KNOBS->ENFORCE_TAG_THROTTLING_ON_PROXIES && req.isTagged()) {
+				++stats->tagThrottlerGRVQueueSize;
+				stats->txnTagThrottlerIn += req.transactionCount;
+				tagThrottler->addRequest(req);
+			} else {
+				++stats->txnRequestIn;
+				stats->txnStartIn += req.transactionCount;
+				stats->txnDefaultPriorityStartIn += req.transactionCount;
+				++stats->defaultGRVQueueSize;
+				defaultQueue->push_back(req);
+			}
+		} else {
+			// Return error for batch_priority GRV requests
+			int64_t proxiesCount = std::max((int)db->get().client.grvProxies.size(), 1);
+			if (batchRateInfo->getRate() <= (1.0 / proxiesCount)) {
+				req.reply.sendError(batch_transaction_throttled());
+				stats->txnThrottled += req.transactionCount;
+			} else {
+				if (SERVER_KNOBS->ENFORCE_TAG_THROTTLING_ON_PROXIES && req.isTagged()) {
+					++stats->tagThrottlerGRVQueueSize;
+					stats->txnTagThrottlerIn += req.transactionCount;
+					tagThrottler->addRequest(req);
+				} else {
+					++stats->txnRequestIn;
+					stats->txnStartIn += req.transactionCount;
+					stats->txnBatchPriorityStartIn += req.transactionCount;
+					++stats->batchGRVQueueSize;
+					batchQueue->push_back(req);
+				}
+			}
+		}
+	}
+}
+
+// Gathers the replies to the batches of a GetReadVersionsRequest, which are queued and started like requests of their
+// own, into the reply of the request. Clients only combine batches with the same flags, so waiting for all of them
+// does not hold up a higher priority batch.
+ACTOR Future<Void> sendGrvBatchesReply(std::vector<Future<GetReadVersionReply>> batchReplies,
+                                       ReplyPromise<GetReadVersionsReply> reply) {
+	state GetReadVersionsReply rep;
+	state int i = 0;
+	rep.replies.reserve(batchReplies.size());
+	for (; i < batchReplies.size(); i++) {
+		ErrorOr<GetReadVersionReply> batchReply = wait(errorOr(batchReplies[i]));
+		rep.replies.push_back(std::move(batchReply));
+	}
+	reply.send(rep);
+	return Void();
+}
+
+// Put GetReadVersion requests into the queues corresponding to their priorities.
 ACTOR Future<Void> queueGetReadVersionRequests(Reference<AsyncVar<ServerDBInfo> const> db,
                                                Deque<GetReadVersionRequest>* systemQueue,
                                                Deque<GetReadVersionRequest>* defaultQueue,
                                                Deque<GetReadVersionRequest>* batchQueue,
                                                FutureStream<GetReadVersionRequest> readVersionRequests,
+                                               FutureStream<GetReadVersionsRequest> readVersionsRequests,
+                                               PromiseStream<Future<Void>> addActor,
                                                PromiseStream<Void> GRVTimer,
                                                double* lastGRVTime,
                                                double* GRVBatchTime,
@@ -510,91 +624,37 @@ ACTOR Future<Void> queueGetReadVersionRequests(Reference<AsyncVar<ServerDBInfo>
 	    TransactionLineage::Operation::GetConsistentReadVersion;
 	loop choose {
 		when(GetReadVersionRequest req = waitNext(readVersionRequests)) {
-			// auto lineage = make_scoped_lineage(&TransactionLineage::txID, req.spanContext.first());
-			// getCurrentLineage()->modify(&TransactionLineage::txID) =
-			// WARNING: this code is run at a high priority, so it needs to do as little work as possible
-			bool canBeQueued = true;
-			if (stats->txnRequestIn.getValue() - stats->txnRequestOut.getValue() >
-			        SERVER_KNOBS->START_TRANSACTION_MAX_QUEUE_SIZE ||
-			    (g_network->isSimulated() && !g_simulator->speedUpSimulation &&
-			     deterministicRandom()->random01() < 0.01)) {
-				// When the limit is hit, try to drop requests from the lower priority queues.
-				if (req.priority == TransactionPriority::BATCH) {
-					canBeQueued = false;
-				} else if (req.priority == TransactionPriority::DEFAULT) {
-					if (!batchQueue->empty()) {
-						dropRequestFromQueue(batchQueue, stats);
-						--stats->batchGRVQueueSize;
-					} else {
-						canBeQueued = false;
-					}
-				} else {
-					if (!batchQueue->empty()) {
-						dropRequestFromQueue(batchQueue, stats);
-						--stats->batchGRVQueueSize;
-					} else if (!defaultQueue->empty()) {
-						dropRequestFromQueue(defaultQueue, stats);
-						--stats->defaultGRVQueueSize;
-					} else {
-						canBeQueued = false;
-					}
-				}
-			}
-			if (!canBeQueued) {
-				proxyGRVThresholdExceeded(&req, stats);
-			} else {
-				stats->addRequest(req.transactionCount);
-
-				if (req.debugID.present())
-					g_traceBatch.addEvent("TransactionDebug",
-					                      req.debugID.get().first(),
-					                      "GrvProxyServer.queueTransactionStartRequests.Before");
-
-				if (systemQueue->empty() && defaultQueue->empty() && batchQueue->empty()) {
-					forwardPromise(GRVTimer,
-					               delayJittered(std::max(0.0, *GRVBatchTime - (now() - *lastGRVTime)),
-					                             TaskPriority::ProxyGRVTimer));
-				}
-
-				if (req.priority >= TransactionPriority::IMMEDIATE) {
-					++stats->txnRequestIn;
-					stats->txnStartIn += req.transactionCount;
-					stats->txnSystemPriorityStartIn += req.transactionCount;
-					++stats->systemGRVQueueSize;
-					systemQueue->push_back(req);
-				} else if (req.priority >= TransactionPriority::DEFAULT) {
-					if (SERVER_KNOBS->ENFORCE_TAG_THROTTLING_ON_PROXIES && req.isTagged()) {
-						++stats->tagThrottlerGRVQueueSize;
-						stats->txnTagThrottlerIn += req.transactionCount;
-						tagThrottler->addRequest(req);
-					} else {
-						++stats->txnRequestIn;
-						stats->txnStartIn += req.transactionCount;
-						stats->txnDefaultPriorityStartIn += req.transactionCount;
-						++stats->defaultGRVQueueSize;
-						defaultQueue->push_back(req);
-					}
-				} else {
-					// Return error for batch_priority GRV requests
-					int64_t proxiesCount = std::max((int)db->get().client.grvProxies.size(), 1);
-					if (batchRateInfo->getRate() <= (1.0 / proxiesCount)) {
-						req.reply.sendError(batch_transaction_throttled());
-						stats->txnThrottled += req.transactionCount;
-					} else {
-						if (SERVER_KNOBS->ENFORCE_TAG_THROTTLING_ON_PROXIES && req.isTagged()) {
-							++stats->tagThrottlerGRVQueueSize;
-							stats->txnTagThrottlerIn += req.transactionCount;
-							tagThrottler->addRequest(req);
-						} else {
-							++stats->txnRequestIn;
-							stats->txnStartIn += req.transactionCount;
-							stats->txnBatchPriorityStartIn += req.transactionCount;
-							++stats->batchGRVQueueSize;
-							batchQueue->push_back(req);
-						}
-					}
-				}
+			queueGetReadVersionRequest(req,
+			                           db,
+			                           systemQueue,
+			                           defaultQueue,
+			                           batchQueue,
+			                           GRVTimer,
+			                           lastGRVTime,
+			                           GRVBatchTime,
+			                           stats,
+			                           batchRateInfo,
+			                           tagThrottler);
+		}
+		when(GetReadVersionsRequest req = waitNext(readVersionsRequests)) {
+			std::vector<Future<GetReadVersionReply>> batchReplies;
+			batchReplies.reserve(req.batches.size());
+			for (const GetReadVersionBatch& batch : req.batches) {
+				GetReadVersionRequest batchReq = batch.toRequest();
+				batchReplies.push_back(batchReq.reply.getFuture());
+				queueGetReadVersionRequest(batchReq,
+				                           db,
+				                           systemQueue,
+				                           defaultQueue,
+				                           batchQueue,
+				                           GRVTimer,
+				                           lastGRVTime,
+				                           GRVBatchTime,
+				                           stats,
+				                           batchRateInfo,
+				                           tagThrottler);
 			}
+			addActor.send(sendGrvBatchesReply(std::move(batchReplies), req.reply));
 		}
 		// dynamic batching monitors reply latencies
 		when(double reply_latency = waitNext(normalGRVLatency)) {
@@ -896,6 +956,8 @@ ACTOR static Future<Void> transactionStarter(GrvProxyInterface proxy,
 	                                          &defaultQueue,
 	                                          &batchQueue,
 	                                          proxy.getConsistentReadVersion.getFuture(),
+	                                          proxy.getConsistentReadVersions.getFuture(),
+	                                          addActor,
 	                                          GRVTimer,
 	                                          &lastGRVTime,
 	                                          &GRVBatchTime,
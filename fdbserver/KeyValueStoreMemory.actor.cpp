@@ -218,6 +218,28 @@ public:
 		return Optional<Value>(it.getValue());
 	}
 
+	Future<std::vector<Optional<Value>>> readValues(VectorRef<KeyRef> keys, Optional<ReadOptions> options) override {
+		if (recovering.isError())
+			throw recovering.getError();
+		if (!recovering.isReady()) {
+			Standalone<VectorRef<KeyRef>> keyCopy;
+			keyCopy.append_deep(keyCopy.arena(), keys.begin(), keys.size());
+			return waitAndReadValues(this, keyCopy, options);
+		}
+
+		std::vector<Optional<Value>> values;
+		values.reserve(keys.size());
+		for (const auto& key : keys) {
+			auto it = data.find(key);
+			if (it == data.end()) {
+				values.push_back(Optional<Value>());
+			} else {
+				values.push_back(Optional<Value>(it.getValue()));
+			}
+		}
+		return values;
+	}
+
 	Future<Optional<Value>> readValuePrefix(KeyRef key, int maxLength, Optional<ReadOptions> options) override {
 		if (recovering.isError())
 			throw recovering.getError();
@@ -1007,6 +1029,12 @@ private:
 		wait(self->recovering);
 		return static_cast<IKeyValueStore*>(self)->readValue(key, options).get();
 	}
+	ACTOR static Future<std::vector<Optional<Value>>> waitAndReadValues(KeyValueStoreMemory* self,
+	                                                                    Standalone<VectorRef<KeyRef>> keys,
+	                                                                    Optional<ReadOptions> options) {
+		wait(self->recovering);
+		return static_cast<IKeyValueStore*>(self)->readValues(keys, options).get();
+	}
 	ACTOR static Future<Optional<Value>> waitAndReadValuePrefix(KeyValueStoreMemory* self,
 	                                                            Key key,
 	                                                            int maxLength,
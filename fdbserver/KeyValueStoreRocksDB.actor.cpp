@@ -1772,6 +1772,87 @@ struct RocksDBKeyValueStore : IKeyValueStore {
 			}
 		}
 
+		// Reads a batch of keys with one MultiGet, which looks up the keys of each block together and can read
+		// blocks in parallel
+		struct ReadValuesAction : TypedAction<Reader, ReadValuesAction> {
+			Standalone<VectorRef<KeyRef>> keys;
+			ReadType type;
+			bool throttle;
+			Optional<UID> debugID;
+			double startTime;
+			ThreadReturnPromise<std::vector<Optional<Value>>> result;
+			ReadValuesAction(VectorRef<KeyRef> keys, ReadType type, bool throttle, Optional<UID> debugID)
+			  : type(type), throttle(throttle), debugID(debugID), startTime(timer_monotonic()) {
+				this->keys.append_deep(this->keys.arena(), keys.begin(), keys.size());
+			}
+			double getTimeEstimate() const override {
+				return SERVER_KNOBS->READ_VALUE_TIME_ESTIMATE * std::max(1, keys.size());
+			}
+		};
+		void action(ReadValuesAction& a) {
+			ASSERT(cf != nullptr);
+			bool doPerfContextMetrics =
+			    SERVER_KNOBS->ROCKSDB_PERFCONTEXT_ENABLE &&
+			    (deterministicRandom()->random01() < SERVER_KNOBS->ROCKSDB_PERFCONTEXT_SAMPLE_RATE);
+			if (doPerfContextMetrics) {
+				perfContextMetrics->reset();
+			}
+			const double readBeginTime = timer_monotonic();
+			Optional<TraceBatch> traceBatch;
+			if (a.debugID.present()) {
+				traceBatch = { TraceBatch{} };
+				traceBatch.get().addEvent("GetValuesDebug", a.debugID.get().first(), "Reader.Before");
+			}
+			if (a.throttle && SERVER_KNOBS->ROCKSDB_SET_READ_TIMEOUT &&
+			    readBeginTime - a.startTime > readValueTimeout) {
+				TraceEvent(SevWarn, "KVSTimeout", id)
+				    .detail("Error", "Read values request timedout")
+				    .detail("Method", "ReadValuesAction")
+				    .detail("TimeoutValue", readValueTimeout);
+				a.result.sendError(transaction_too_old());
+				return;
+			}
+
+			rocksdb::ReadOptions readOptions = sharedState->getReadOptions();
+			if (a.throttle && SERVER_KNOBS->ROCKSDB_SET_READ_TIMEOUT) {
+				uint64_t deadlineMircos =
+				    db->GetEnv()->NowMicros() + (readValueTimeout - (readBeginTime - a.startTime)) * 1000000;
+				std::chrono::seconds deadlineSeconds(deadlineMircos / 1000000);
+				readOptions.deadline = std::chrono::duration_cast<std::chrono::microseconds>(deadlineSeconds);
+			}
+
+			const int count = a.keys.size();
+			std::vector<rocksdb::Slice> keySlices;
+			keySlices.reserve(count);
+			for (const auto& key : a.keys) {
+				keySlices.push_back(toSlice(key));
+			}
+			std::vector<rocksdb::PinnableSlice> values(count);
+			std::vector<rocksdb::Status> statuses(count);
+			db->MultiGet(readOptions, cf, count, keySlices.data(), values.data(), statuses.data());
+
+			if (a.debugID.present()) {
+				traceBatch.get().addEvent("GetValuesDebug", a.debugID.get().first(), "Reader.After");
+				traceBatch.get().dump();
+			}
+			std::vector<Optional<Value>> result(count);
+			for (int i = 0; i < count; i++) {
+				const auto& s = statuses[i];
+				if (s.ok()) {
+					result[i] = Value(toStringRef(values[i]));
+				} else if (!s.IsNotFound()) {
+					logRocksDBError(id, s, "ReadValues");
+					a.result.sendError(statusToError(s));
+					return;
+				}
+			}
+			a.result.send(std::move(result));
+
+			if (doPerfContextMetrics) {
+				perfContextMetrics->set(threadIndex);
+			}
+		}
+
 		struct ReadRangeAction : TypedAction<Reader, ReadRangeAction>, FastAllocated<ReadRangeAction> {
 			KeyRange keys;
 			int rowLimit, byteLimit;
@@ -2322,6 +2403,56 @@ struct RocksDBKeyValueStore : IKeyValueStore {
 		return read(a.release(), &semaphore, readThreads.getPtr(), &counters.failedToAcquire);
 	}
 
+	ACTOR static Future<std::vector<Optional<Value>>> read(Reader::ReadValuesAction* action,
+	                                                      FlowLock* semaphore,
+	                                                      IThreadPool* pool,
+	                                                      Counter* counter) {
+		state std::unique_ptr<Reader::ReadValuesAction> a(action);
+		state Optional<Void> slot = wait(timeout(semaphore->take(), SERVER_KNOBS->ROCKSDB_READ_QUEUE_WAIT));
+		if (!slot.present()) {
+			++(*counter);
+			throw server_overloaded();
+		}
+
+		state FlowLock::Releaser release(*semaphore);
+
+		auto fut = a->result.getFuture();
+		pool->post(a.release());
+		std::vector<Optional<Value>> result = wait(fut);
+
+		return result;
+	}
+
+	Future<std::vector<Optional<Value>>> readValues(VectorRef<KeyRef> keys, Optional<ReadOptions> options) override {
+		ReadType type = ReadType::NORMAL;
+		Optional<UID> debugID;
+
+		if (options.present()) {
+			type = options.get().type;
+			debugID = options.get().debugID;
+		}
+
+		// The batch is throttled like a readValue() of its keys would be, if any of them would be
+		bool throttle = false;
+		for (const auto& key : keys) {
+			throttle = throttle || shouldThrottle(type, key);
+		}
+
+		if (!throttle) {
+			auto a = new Reader::ReadValuesAction(keys, type, throttle, debugID);
+			auto res = a->result.getFuture();
+			readThreads->post(a);
+			return res;
+		}
+
+		auto& semaphore = (type == ReadType::FETCH) ? fetchSemaphore : readSemaphore;
+		int maxWaiters = (type == ReadType::FETCH) ? numFetchWaiters : numReadWaiters;
+
+		checkWaiters(semaphore, maxWaiters);
+		auto a = std::make_unique<Reader::ReadValuesAction>(keys, type, throttle, debugID);
+		return read(a.release(), &semaphore, readThreads.getPtr(), &counters.failedToAcquire);
+	}
+
 	ACTOR static Future<Standalone<RangeResultRef>> read(Reader::ReadRangeAction* action,
 	                                                     FlowLock* semaphore,
 	                                                     IThreadPool* pool,
@@ -3610,6 +3610,102 @@ struct ShardedRocksDBKeyValueStore : IKeyValueStore {
 			sample();
 		}
 
+		// Reads a batch of keys with one MultiGet per physical shard, which looks up the keys of each block together
+		// and can read blocks in parallel. Keys without a shard, which have a null entry in shards, are not found.
+		struct ReadValuesAction : TypedAction<Reader, ReadValuesAction> {
+			Standalone<VectorRef<KeyRef>> keys;
+			std::vector<PhysicalShard*> shards;
+			ReadType type;
+			bool throttle;
+			Optional<UID> debugID;
+			double startTime;
+			ThreadReturnPromise<std::vector<Optional<Value>>> result;
+
+			ReadValuesAction(VectorRef<KeyRef> keys,
+			                 std::vector<PhysicalShard*> shards,
+			                 ReadType type,
+			                 bool throttle,
+			                 Optional<UID> debugID)
+			  : shards(std::move(shards)), type(type), throttle(throttle), debugID(debugID),
+			    startTime(timer_monotonic()) {
+				this->keys.append_deep(this->keys.arena(), keys.begin(), keys.size());
+			}
+
+			double getTimeEstimate() const override {
+				return SERVER_KNOBS->READ_VALUE_TIME_ESTIMATE * std::max(1, keys.size());
+			}
+		};
+
+		void action(ReadValuesAction& a) {
+			double readBeginTime = timer_monotonic();
+			Optional<TraceBatch> traceBatch;
+			if (a.debugID.present()) {
+				traceBatch = { TraceBatch{} };
+				traceBatch.get().addEvent("GetValuesDebug", a.debugID.get().first(), "Reader.Before");
+			}
+			if (a.throttle && SERVER_KNOBS->ROCKSDB_SET_READ_TIMEOUT &&
+			    readBeginTime - a.startTime > readValueTimeout) {
+				TraceEvent(SevWarn, "ShardedRocksDBError")
+				    .detail("Error", "Read values request timedout")
+				    .detail("Method", "ReadValuesAction")
+				    .detail("Timeout value", readValueTimeout);
+				if (SERVER_KNOBS->ROCKSDB_RETURN_OVERLOADED_ON_TIMEOUT) {
+					a.result.sendError(server_overloaded());
+				} else {
+					a.result.sendError(key_value_store_deadline_exceeded());
+				}
+				return;
+			}
+
+			// Keys of the same physical shard are read together, in the order they were given
+			std::map<PhysicalShard*, std::vector<int>> shardKeys;
+			for (int i = 0; i < a.keys.size(); i++) {
+				if (a.shards[i] != nullptr) {
+					shardKeys[a.shards[i]].push_back(i);
+				}
+			}
+
+			std::vector<Optional<Value>> result(a.keys.size());
+			for (const auto& [shard, indexes] : shardKeys) {
+				auto options = getReadOptions();
+				auto db = shard->db;
+				if (a.throttle && SERVER_KNOBS->ROCKSDB_SET_READ_TIMEOUT) {
+					uint64_t deadlineMircos =
+					    db->GetEnv()->NowMicros() + (readValueTimeout - (timer_monotonic() - a.startTime)) * 1000000;
+					std::chrono::seconds deadlineSeconds(deadlineMircos / 1000000);
+					options.deadline = std::chrono::duration_cast<std::chrono::microseconds>(deadlineSeconds);
+				}
+
+				std::vector<rocksdb::Slice> keySlices;
+				keySlices.reserve(indexes.size());
+				for (int i : indexes) {
+					keySlices.push_back(toSlice(a.keys[i]));
+				}
+				std::vector<rocksdb::PinnableSlice> values(indexes.size());
+				std::vector<rocksdb::Status> statuses(indexes.size());
+				db->MultiGet(options, shard->cf, indexes.size(), keySlices.data(), values.data(), statuses.data());
+
+				for (int j = 0; j < indexes.size(); j++) {
+					const auto& s = statuses[j];
+					if (s.ok()) {
+						result[indexes[j]] = Value(toStringRef(values[j]));
+					} else if (!s.IsNotFound()) {
+						logRocksDBError(s, "ReadValues");
+						a.result.sendError(statusToError(s));
+						return;
+					}
+				}
+			}
+
+			if (a.debugID.present()) {
+				traceBatch.get().addEvent("GetValuesDebug", a.debugID.get().first(), "Reader.After");
+				traceBatch.get().dump();
+			}
+			a.result.send(std::move(result));
+
+			sample();
+		}
+
 		struct ReadRangeAction : TypedAction<Reader, ReadRangeAction>, FastAllocated<ReadRangeAction> {
 			KeyRange keys;
 			std::vector<std::pair<PhysicalShard*, KeyRange>> shardRanges;
@@ -4019,6 +4115,68 @@ struct ShardedRocksDBKeyValueStore : IKeyValueStore {
 		return read(a.release(), &semaphore, readThreads.getPtr(), &counters.failedToAcquire);
 	}
 
+	ACTOR static Future<std::vector<Optional<Value>>> read(Reader::ReadValuesAction* action,
+	                                                      FlowLock* semaphore,
+	                                                      IThreadPool* pool,
+	                                                      Counter* counter) {
+		state std::unique_ptr<Reader::ReadValuesAction> a(action);
+		state Optional<Void> slot = wait(timeout(semaphore->take(), SERVER_KNOBS->ROCKSDB_READ_QUEUE_WAIT));
+		if (!slot.present()) {
+			++(*counter);
+			throw server_overloaded();
+		}
+
+		state FlowLock::Releaser release(*semaphore);
+
+		auto fut = a->result.getFuture();
+		pool->post(a.release());
+		std::vector<Optional<Value>> result = wait(fut);
+
+		return result;
+	}
+
+	Future<std::vector<Optional<Value>>> readValues(VectorRef<KeyRef> keys, Optional<ReadOptions> options) override {
+		ReadType type = ReadType::NORMAL;
+		Optional<UID> debugID;
+
+		if (options.present()) {
+			type = options.get().type;
+			debugID = options.get().debugID;
+		}
+
+		std::vector<PhysicalShard*> shards;
+		shards.reserve(keys.size());
+		// The batch is throttled like a readValue() of its keys would be, if any of them would be
+		bool throttle = false;
+		for (const auto& key : keys) {
+			auto* shard = shardManager.getDataShard(key);
+			if (shard == nullptr || !shard->physicalShard->initialized()) {
+				// TODO: read non-exist system key range should not cause an error.
+				TraceEvent(SevWarn, "ShardedRocksDB", this->id)
+				    .detail("Detail", "Read non-exist key range")
+				    .detail("ReadKey", key);
+				shards.push_back(nullptr);
+			} else {
+				shards.push_back(shard->physicalShard);
+			}
+			throttle = throttle || shouldThrottle(type, key);
+		}
+
+		if (!throttle) {
+			auto a = new Reader::ReadValuesAction(keys, std::move(shards), type, throttle, debugID);
+			auto res = a->result.getFuture();
+			readThreads->post(a);
+			return res;
+		}
+
+		auto& semaphore = (type == ReadType::FETCH) ? fetchSemaphore : readSemaphore;
+		int maxWaiters = (type == ReadType::FETCH) ? numFetchWaiters : numReadWaiters;
+
+		checkWaiters(semaphore, maxWaiters);
+		auto a = std::make_unique<Reader::ReadValuesAction>(keys, std::move(shards), type, throttle, debugID);
+		return read(a.release(), &semaphore, readThreads.getPtr(), &counters.failedToAcquire);
+	}
+
 	ACTOR static Future<Standalone<RangeResultRef>> read(Reader::ReadRangeAction* action,
 	                                                     FlowLock* semaphore,
 	                                                     IThreadPool* pool,
@@ -4377,6 +4535,42 @@ TEST_CASE("noSim/ShardedRocksDB/SingleShardRead") {
 	return Void();
 }
 
+TEST_CASE("noSim/ShardedRocksDB/ReadValues") {
+	state const std::string rocksDBTestDir = "sharded-rocksdb-test-db";
+	platform::eraseDirectoryRecursive(rocksDBTestDir);
+
+	state IKeyValueStore* kvStore =
+	    new ShardedRocksDBKeyValueStore(rocksDBTestDir, deterministicRandom()->randomUniqueID());
+	wait(kvStore->init());
+
+	wait(kvStore->addRange(KeyRangeRef("a"_sr, "b"_sr), "shard-1"));
+	wait(kvStore->addRange(KeyRangeRef("b"_sr, "c"_sr), "shard-2"));
+
+	kvStore->set({ "a"_sr, "foo"_sr });
+	kvStore->set({ "ac"_sr, "bar"_sr });
+	kvStore->set({ "bc"_sr, "baz"_sr });
+	wait(kvStore->commit(false));
+
+	// Keys of both shards, out of order, with one that doesn't exist and one outside of any shard
+	state Standalone<VectorRef<KeyRef>> keys;
+	for (auto key : { "bc"_sr, "a"_sr, "ab"_sr, "ac"_sr, "d"_sr }) {
+		keys.push_back_deep(keys.arena(), key);
+	}
+	std::vector<Optional<Value>> values = wait(kvStore->readValues(keys));
+	ASSERT(values.size() == 5);
+	ASSERT(Optional<Value>("baz"_sr) == values[0]);
+	ASSERT(Optional<Value>("foo"_sr) == values[1]);
+	ASSERT(!values[2].present());
+	ASSERT(Optional<Value>("bar"_sr) == values[3]);
+	ASSERT(!values[4].present());
+
+	Future<Void> closed = kvStore->onClosed();
+	kvStore->dispose();
+	wait(closed);
+	ASSERT(!directoryExists(rocksDBTestDir));
+	return Void();
+}
+
 TEST_CASE("noSim/ShardedRocksDB/RangeOps") {
 	state std::string rocksDBTestDir = "sharded-rocksdb-kvs-test-db";
 	platform::eraseDirectoryRecursive(rocksDBTestDir);
@@ -191,7 +191,11 @@ struct Resolver : ReferenceCounted<Resolver> {
 
 	Resolver(UID dbgid, int commitProxyCount, int resolverCount, EncryptionAtRestMode encryptMode)
 	  : dbgid(dbgid), commitProxyCount(commitProxyCount), resolverCount(resolverCount), encryptMode(encryptMode),
-	    version(-1), conflictSet(newConflictSet()), iopsSample(SERVER_KNOBS->KEY_BYTES_PER_SAMPLE),
+	    version(-1),
+	    conflictSet(newConflictSet(SERVER_KNOBS->RESOLVER_CONFLICT_SET_PARTITIONS,
+	                               !g_network->isSimulated(),
+	                               SERVER_KNOBS->RESOLVER_CONFLICT_SET_PARALLEL_MIN_RANGES)),
+	    iopsSample(SERVER_KNOBS->KEY_BYTES_PER_SAMPLE),
 	    cc("Resolver", dbgid.toString()), resolveBatchIn("ResolveBatchIn", cc),
 	    resolveBatchStart("ResolveBatchStart", cc), resolvedTransactions("ResolvedTransactions", cc),
 	    resolvedBytes("ResolvedBytes", cc), resolvedReadConflictRanges("ResolvedReadConflictRanges", cc),
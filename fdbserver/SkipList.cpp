@@ -22,6 +22,9 @@
 #include <memory.h>
 #include <stdio.h>
 #include <algorithm>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
 #include <numeric>
 #include <string>
 #include <vector>
@@ -33,6 +36,7 @@
 #include "fdbclient/KeyRangeMap.h"
 #include "fdbclient/SystemData.h"
 #include "fdbserver/ConflictSet.h"
+#include "flow/UnitTest.h"
 
 static std::vector<PerfDoubleCounter*> skc;
 
@@ -60,26 +64,6 @@ static force_inline int compare(const StringRef& a, const StringRef& b) {
 	return +1;
 }
 
-struct ReadConflictRange {
-	StringRef begin, end;
-	Version version;
-	int transaction;
-	int indexInTx;
-	VectorRef<int>* conflictingKeyRange;
-	Arena* cKRArena;
-
-	ReadConflictRange(StringRef begin,
-	                  StringRef end,
-	                  Version version,
-	                  int transaction,
-	                  int indexInTx,
-	                  VectorRef<int>* cKR = nullptr,
-	                  Arena* cKRArena = nullptr)
-	  : begin(begin), end(end), version(version), transaction(transaction), indexInTx(indexInTx),
-	    conflictingKeyRange(cKR), cKRArena(cKRArena) {}
-	bool operator<(const ReadConflictRange& rhs) const { return compare(begin, rhs.begin) < 0; }
-};
-
 struct KeyInfo {
 	StringRef key;
 	int* pIndex;
@@ -309,6 +293,15 @@ private:
 	};
 
 	static force_inline bool less(const uint8_t* a, int aLen, const uint8_t* b, int bLen) {
+		// Most comparisons during a search are decided by the first 8 bytes, which can be compared as a single
+		// big endian word without the overhead of a memcmp() call.
+		if (aLen >= sizeof(uint64_t) && bLen >= sizeof(uint64_t)) {
+			uint64_t aPrefix, bPrefix;
+			memcpy(&aPrefix, a, sizeof(uint64_t));
+			memcpy(&bPrefix, b, sizeof(uint64_t));
+			if (aPrefix != bPrefix)
+				return bigEndian64(aPrefix) < bigEndian64(bPrefix);
+		}
 		int c = memcmp(a, b, std::min(aLen, bLen));
 		if (c < 0)
 			return true;
@@ -490,7 +483,6 @@ public:
 	//   partitions.  In between, operations on each partition must not touch any keys outside
 	//   the partition.  Specifically, the partition to the left of 'key' must not have a range
 	//	 [...,key) inserted, since that would insert an entry at 'key'.
-	// Note this function is not used.
 	void partition(StringRef* begin, int splitCount, SkipList* output) {
 		for (int i = splitCount - 1; i >= 0; i--) {
 			Finger f(header, begin[i]);
@@ -501,8 +493,7 @@ public:
 		swap(output[0]);
 	}
 
-	// Concatenates multiple SkipList objects into one and stores in input[0].
-	// Note this function is not used.
+	// Concatenates multiple SkipList objects into one and stores it in this SkipList.
 	void concatenate(SkipList* input, int count) {
 		std::vector<Finger> ends(count - 1);
 		for (int i = 0; i < ends.size(); i++)
@@ -782,20 +773,215 @@ private:
 	}
 };
 
-struct ConflictSet {
-	ConflictSet() : removalKey(makeString(0)), oldestVersion(0) {}
-	~ConflictSet() {}
+// Runs the partitions of a batch on a fixed set of threads.  Partition 0 always runs on the calling thread and
+// partition i on worker thread i, so that the (thread local) random levels chosen for inserted nodes do not depend on
+// scheduling.  run() blocks until every partition has completed.
+class ConflictSetWorkers : NonCopyable {
+public:
+	explicit ConflictSetWorkers(int threadCount) {
+		threads.reserve(threadCount);
+		for (int i = 0; i < threadCount; i++) {
+			threads.push_back(new Thread{ this, i + 1, THREAD_HANDLE() });
+			threads.back()->handle = startThread(&threadMain, threads.back(), 0, "fdb-resolver");
+		}
+	}
+
+	~ConflictSetWorkers() {
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			stopping = true;
+		}
+		wake.notify_all();
+		for (Thread* t : threads) {
+			waitThread(t->handle);
+			delete t;
+		}
+	}
+
+	// Calls work(i) for each i in [0, count).  count must not be more than one greater than the number of threads.
+	void run(int count, const std::function<void(int)>& work) {
+		ASSERT(count <= threads.size() + 1);
+		if (count > 1) {
+			std::unique_lock<std::mutex> lock(mutex);
+			this->work = &work;
+			this->count = count;
+			pending = threads.size();
+			generation++;
+		}
+		wake.notify_all();
+		Optional<Error> err;
+		try {
+			work(0);
+		} catch (Error& e) {
+			err = e;
+		}
+		if (count > 1) {
+			std::unique_lock<std::mutex> lock(mutex);
+			done.wait(lock, [this] { return pending == 0; });
+			this->work = nullptr;
+			if (!err.present() && workerError.present())
+				err = workerError;
+			workerError.reset();
+		}
+		if (err.present())
+			throw err.get();
+	}
+
+private:
+	struct Thread {
+		ConflictSetWorkers* pool;
+		int index;
+		THREAD_HANDLE handle;
+	};
+
+	THREAD_FUNC threadMain(void* arg) {
+		Thread* t = (Thread*)arg;
+		t->pool->workerLoop(t->index);
+		THREAD_RETURN;
+	}
+
+	void workerLoop(int index) {
+		uint64_t seen = 0;
+		std::unique_lock<std::mutex> lock(mutex);
+		while (true) {
+			wake.wait(lock, [&] { return stopping || generation != seen; });
+			if (stopping)
+				return;
+			seen = generation;
+			if (index < count) {
+				const std::function<void(int)>* w = work;
+				lock.unlock();
+				Optional<Error> err;
+				try {
+					(*w)(index);
+				} catch (Error& e) {
+					err = e;
+				}
+				lock.lock();
+				if (err.present())
+					workerError = err;
+			}
+			if (--pending == 0)
+				done.notify_one();
+		}
+	}
+
+	std::vector<Thread*> threads;
+	std::mutex mutex;
+	std::condition_variable wake, done;
+	const std::function<void(int)>* work = nullptr;
+	Optional<Error> workerError;
+	int count = 0;
+	int pending = 0;
+	uint64_t generation = 0;
+	bool stopping = false;
+};
+
+ConflictSet::ConflictSet(int partitions, bool useWorkerThreads, int parallelMinRanges)
+  : oldestVersion(0), partitions(std::max(partitions, 1)), parallelMinRanges(parallelMinRanges) {
+	if (useWorkerThreads && this->partitions > 1)
+		workers = std::make_unique<ConflictSetWorkers>(this->partitions - 1);
+}
+
+ConflictSet::~ConflictSet() {}
+
+void ConflictSet::runPartitions(int count, const std::function<void(int)>& work) {
+	if (workers) {
+		workers->run(count, work);
+	} else {
+		for (int i = 0; i < count; i++)
+			work(i);
+	}
+}
+
+class SkipListConflictSet final : public ConflictSet {
+public:
+	SkipListConflictSet(int partitions, bool useWorkerThreads, int parallelMinRanges)
+	  : ConflictSet(partitions, useWorkerThreads, parallelMinRanges), removalKey(makeString(0)) {}
+
+	void detectConflicts(ReadConflictRange* ranges, int count, bool* transactionConflictStatus) override {
+		versionHistory.detectConflicts(ranges, count, transactionConflictStatus);
+	}
+
+	void addConflictRanges(std::vector<std::pair<StringRef, StringRef>>& ranges, Version now) override {
+		// The write ranges are sorted and disjoint, so the version history can be split at the beginning of some of
+		// them and each part updated independently.  A split must not be at the end of the preceding range, since
+		// inserting that range into the left part would create an entry at the split key.
+		const int count = ranges.size();
+		const int parts = partitionsFor(count);
+		std::vector<int> bounds = { 0 };
+		for (int p = 1; p < parts; p++) {
+			int i = std::max<int>(bounds.back() + 1, int64_t(count) * p / parts);
+			while (i < count && ranges[i - 1].second == ranges[i].first)
+				i++;
+			if (i >= count)
+				break;
+			bounds.push_back(i);
+		}
+		bounds.push_back(count);
+
+		const int partCount = bounds.size() - 1;
+		if (partCount == 1) {
+			addConflictRanges(now, ranges.begin(), ranges.end(), &versionHistory);
+			return;
+		}
+
+		std::vector<StringRef> splits;
+		for (int p = 1; p < partCount; p++)
+			splits.push_back(ranges[bounds[p]].first);
+		std::vector<SkipList> partHistory(partCount);
+		versionHistory.partition(&splits[0], splits.size(), &partHistory[0]);
+		runPartitions(partCount, [&](int p) {
+			addConflictRanges(now, ranges.begin() + bounds[p], ranges.begin() + bounds[p + 1], &partHistory[p]);
+		});
+		versionHistory.concatenate(&partHistory[0], partCount);
+	}
+
+	void removeBefore(Version oldestVersion, int workHint) override {
+		SkipList::Finger finger;
+		int temp;
+		versionHistory.find(&removalKey, &finger, &temp, 1);
+		versionHistory.removeBefore(oldestVersion, finger, workHint);
+		removalKey = finger.getValue();
+	}
+
+	void clear(Version v) override { SkipList(v).swap(versionHistory); }
+
+	int count() const override { return versionHistory.count(); }
+
+private:
+	static void addConflictRanges(Version now,
+	                              std::vector<std::pair<StringRef, StringRef>>::iterator begin,
+	                              std::vector<std::pair<StringRef, StringRef>>::iterator end,
+	                              SkipList* part) {
+		const int count = end - begin;
+		static_assert(sizeof(*begin) == sizeof(StringRef) * 2,
+		              "Write Conflict Range type not convertible to two StringPtrs");
+		const StringRef* strings = reinterpret_cast<const StringRef*>(&*begin);
+		const int stringCount = count * 2;
+
+		const int stripeSize = 16;
+		SkipList::Finger fingers[stripeSize];
+		int temp[stripeSize];
+		int stripes = (stringCount + stripeSize - 1) / stripeSize;
+
+		int ss = stringCount - (stripes - 1) * stripeSize;
+		for (int s = stripes - 1; s >= 0; s--) {
+			part->find(&strings[s * stripeSize], fingers, temp, ss);
+			part->addConflictRanges(fingers, ss / 2, now);
+			ss = stripeSize;
+		}
+	}
 
 	SkipList versionHistory;
 	Key removalKey;
-	Version oldestVersion;
 };
 
-ConflictSet* newConflictSet() {
-	return new ConflictSet;
+ConflictSet* newConflictSet(int partitions, bool useWorkerThreads, int parallelMinRanges) {
+	return new SkipListConflictSet(partitions, useWorkerThreads, parallelMinRanges);
 }
 void clearConflictSet(ConflictSet* cs, Version v) {
-	SkipList(v).swap(cs->versionHistory);
+	cs->clear(v);
 }
 void destroyConflictSet(ConflictSet* cs) {
 	delete cs;
@@ -878,21 +1064,44 @@ void ConflictBatch::addTransaction(const CommitTransactionRef& tr, Version newOl
 	transactionInfo.push_back(arena, info);
 }
 
-// SOMEDAY: This should probably be replaced with a roaring bitmap.
+// A bitmap over the sorted conflict range endpoints of a batch.  Ranges are set and tested a 64-bit word at a time,
+// and the loops over whole words are simple enough for the compiler to vectorize.
 class MiniConflictSet : NonCopyable {
-	std::vector<bool> values;
+	std::vector<uint64_t> words;
+
+	// Returns a mask of the bits at or above the given bit index within its word
+	static uint64_t fromBit(int bit) { return ~uint64_t(0) << (bit & 63); }
+	// Returns a mask of the bits at or below the given bit index within its word
+	static uint64_t toBit(int bit) { return ~uint64_t(0) >> (63 - (bit & 63)); }
 
 public:
-	explicit MiniConflictSet(int size) { values.assign(size, false); }
+	explicit MiniConflictSet(int size) { words.assign((size + 63) / 64, 0); }
+
 	void set(int begin, int end) {
-		for (int i = begin; i < end; i++)
-			values[i] = true;
+		if (begin >= end)
+			return;
+		const int first = begin / 64;
+		const int last = (end - 1) / 64;
+		if (first == last) {
+			words[first] |= fromBit(begin) & toBit(end - 1);
+			return;
+		}
+		words[first] |= fromBit(begin);
+		std::fill(words.begin() + first + 1, words.begin() + last, ~uint64_t(0));
+		words[last] |= toBit(end - 1);
 	}
-	bool any(int begin, int end) {
-		for (int i = begin; i < end; i++)
-			if (values[i])
-				return true;
-		return false;
+
+	bool any(int begin, int end) const {
+		if (begin >= end)
+			return false;
+		const int first = begin / 64;
+		const int last = (end - 1) / 64;
+		if (first == last)
+			return words[first] & fromBit(begin) & toBit(end - 1);
+		uint64_t found = (words[first] & fromBit(begin)) | (words[last] & toBit(end - 1));
+		for (int i = first + 1; i < last; i++)
+			found |= words[i];
+		return found;
 	}
 };
 
@@ -971,11 +1180,7 @@ void ConflictBatch::detectConflicts(Version now,
 	t = timer();
 	if (newOldestVersion > cs->oldestVersion) {
 		cs->oldestVersion = newOldestVersion;
-		SkipList::Finger finger;
-		int temp;
-		cs->versionHistory.find(&cs->removalKey, &finger, &temp, 1);
-		cs->versionHistory.removeBefore(cs->oldestVersion, finger, combinedWriteConflictRanges.size() * 3 + 10);
-		cs->removalKey = finger.getValue();
+		cs->removeBefore(cs->oldestVersion, combinedWriteConflictRanges.size() * 3 + 10);
 	}
 	g_removeBefore += timer() - t;
 }
@@ -984,30 +1189,37 @@ void ConflictBatch::checkReadConflictRanges() {
 	if (combinedReadConflictRanges.empty())
 		return;
 
-	cs->versionHistory.detectConflicts(
-	    &combinedReadConflictRanges[0], combinedReadConflictRanges.size(), transactionConflictStatus);
-}
+	const int count = combinedReadConflictRanges.size();
+	const int parts = cs->partitionsFor(count);
+	if (parts == 1) {
+		cs->detectConflicts(&combinedReadConflictRanges[0], count, transactionConflictStatus);
+		return;
+	}
 
-void ConflictBatch::addConflictRanges(Version now,
-                                      std::vector<std::pair<StringRef, StringRef>>::iterator begin,
-                                      std::vector<std::pair<StringRef, StringRef>>::iterator end,
-                                      SkipList* part) {
-	const int count = end - begin;
-	static_assert(sizeof(*begin) == sizeof(StringRef) * 2,
-	              "Write Conflict Range type not convertible to two StringPtrs");
-	const StringRef* strings = reinterpret_cast<const StringRef*>(&*begin);
-	const int stringCount = count * 2;
-
-	const int stripeSize = 16;
-	SkipList::Finger fingers[stripeSize];
-	int temp[stripeSize];
-	int stripes = (stringCount + stripeSize - 1) / stripeSize;
-
-	int ss = stringCount - (stripes - 1) * stripeSize;
-	for (int s = stripes - 1; s >= 0; s--) {
-		part->find(&strings[s * stripeSize], fingers, temp, ss);
-		part->addConflictRanges(fingers, ss / 2, now);
-		ss = stripeSize;
+	// Checking reads does not modify the version history, so slices of the read ranges can be checked concurrently.
+	// Each slice records conflicts per range rather than per transaction, and the results are applied here so that
+	// transaction status and conflicting key ranges are only written by this thread.
+	std::vector<ReadConflictRange> ranges(combinedReadConflictRanges);
+	for (int i = 0; i < count; i++) {
+		ranges[i].transaction = i;
+		ranges[i].conflictingKeyRange = nullptr;
+		ranges[i].cKRArena = nullptr;
+	}
+	std::unique_ptr<bool[]> rangeConflicts(new bool[count]());
+	cs->runPartitions(parts, [&](int p) {
+		const int begin = int64_t(count) * p / parts;
+		const int end = int64_t(count) * (p + 1) / parts;
+		if (begin < end)
+			cs->detectConflicts(&ranges[begin], end - begin, rangeConflicts.get());
+	});
+
+	for (int i = 0; i < count; i++) {
+		if (rangeConflicts[i]) {
+			const ReadConflictRange& r = combinedReadConflictRanges[i];
+			transactionConflictStatus[r.transaction] = true;
+			if (r.conflictingKeyRange != nullptr)
+				r.conflictingKeyRange->push_back(*r.cKRArena, r.indexInTx);
+		}
 	}
 }
 
@@ -1015,7 +1227,7 @@ void ConflictBatch::mergeWriteConflictRanges(Version now) {
 	if (combinedWriteConflictRanges.empty())
 		return;
 
-	addConflictRanges(now, combinedWriteConflictRanges.begin(), combinedWriteConflictRanges.end(), &cs->versionHistory);
+	cs->addConflictRanges(combinedWriteConflictRanges, now);
 }
 
 void ConflictBatch::combineWriteConflictRanges() {
@@ -1055,15 +1267,18 @@ void miniConflictSetTest() {
 	for (int i = 0; i < 2000000; i++) {
 		int size = 64 * 5; // Also run 64*64*5 to test multiple words of andValues and orValues
 		MiniConflictSet mini(size);
+		std::vector<bool> expected(size, false);
 		for (int j = 0; j < 2; j++) {
 			int a = deterministicRandom()->randomInt(0, size);
 			int b = deterministicRandom()->randomInt(a, size);
 			mini.set(a, b);
+			std::fill(expected.begin() + a, expected.begin() + b, true);
 		}
 		for (int j = 0; j < 4; j++) {
 			int a = deterministicRandom()->randomInt(0, size);
 			int b = deterministicRandom()->randomInt(a, size);
-			mini.any(a, b); // Tests correctness internally
+			bool expectedAny = std::find(expected.begin() + a, expected.begin() + b, true) != expected.begin() + b;
+			ASSERT_EQ(mini.any(a, b), expectedAny);
 		}
 	}
 	printf("miniConflictSetTest complete\n");
@@ -1102,70 +1317,57 @@ void operatorLessThanTest() {
 		ASSERT(!(a == b));
 	}
 }
-} // namespace
-
-void skipListTest() {
-	printf("Skip list test\n");
-
-	miniConflictSetTest();
-
-	operatorLessThanTest();
-
-	setAffinity(0);
-
-	double start;
-
-	ConflictSet* cs = newConflictSet();
+// Returns a key of the form used by the tuple layer for a record in a tenant's key space, so that the keys of a
+// tenant share a long common prefix
+StringRef tenantKey(Arena& arena, int tenant, int i) {
+	const int prefixSize = 24;
+	uint8_t* s = new (arena) uint8_t[prefixSize];
+	memset(s, '.', prefixSize);
+	s[0] = 0x15;
+	*(int*)(s + 1) = bigEndian32(tenant);
+	memcpy(s + 5, "\x02records\x00\x02index", 15);
+	return StringRef(s, prefixSize).withSuffix(setK(arena, i), arena);
+}
 
-	Arena testDataArena;
-	VectorRef<VectorRef<KeyRangeRef>> testData;
-	const int batches = 500; // deterministicRandom()->randomInt(500, 5000);
-	const int data_per_batch = 5000;
-	testData.resize(testDataArena, batches);
-	std::vector<std::vector<uint8_t>> success(batches);
-	std::vector<std::vector<uint8_t>> success2(batches);
+// Generates a synthetic stream of batches, each a list of transactions with one read and one write range.  If tenants
+// is nonzero, each range is within the key space of one of that many tenants.
+std::vector<std::vector<CommitTransactionRef>> generateBatches(Arena& arena,
+                                                               int batches,
+                                                               int rangesPerBatch,
+                                                               int tenants = 0) {
+	std::vector<std::vector<CommitTransactionRef>> result(batches);
 	for (int i = 0; i < batches; i++) {
-		testData[i].resize(testDataArena, data_per_batch);
-		success[i].assign(data_per_batch, false);
-		success2[i].assign(data_per_batch, false);
-		for (int j = 0; j < data_per_batch; j++) {
-			int key = deterministicRandom()->randomInt(0, 20000000);
-			int key2 = key + 1 + deterministicRandom()->randomInt(0, 10);
-			testData[i][j] = KeyRangeRef(setK(testDataArena, key), setK(testDataArena, key2));
+		for (int j = 0; j + 2 <= rangesPerBatch; j += 2) {
+			CommitTransactionRef tr;
+			for (int k = 0; k < 2; k++) {
+				int key = deterministicRandom()->randomInt(0, 20000000);
+				int key2 = key + 1 + deterministicRandom()->randomInt(0, 10);
+				KeyRangeRef r;
+				if (tenants) {
+					int tenant = deterministicRandom()->randomInt(0, tenants);
+					r = KeyRangeRef(tenantKey(arena, tenant, key), tenantKey(arena, tenant, key2));
+				} else {
+					r = KeyRangeRef(setK(arena, key), setK(arena, key2));
+				}
+				if (k == 0)
+					tr.read_conflict_ranges.push_back(arena, r);
+				else
+					tr.write_conflict_ranges.push_back(arena, r);
+			}
+			tr.read_snapshot = i;
+			result[i].push_back(tr);
 		}
 	}
-	printf("Test data generated: %d batches, %d/batch\n", batches, data_per_batch);
-
-	printf("Running\n");
-
-	int readCount = 1, writeCount = 1;
-	int cranges = 0, tcount = 0;
+	return result;
+}
 
-	start = timer();
-	std::vector<std::vector<int>> nonConflict(batches);
+// Resolves the batches in order against the conflict set, returning the committed transactions of each batch
+std::vector<std::vector<int>> resolveBatches(ConflictSet* cs,
+                                             const std::vector<std::vector<CommitTransactionRef>>& data) {
+	std::vector<std::vector<int>> nonConflict(data.size());
 	Version version = 0;
-	for (const auto& data : testData) {
-		Arena buf;
-		std::vector<CommitTransactionRef> trs;
+	for (const auto& trs : data) {
 		double t = timer();
-		for (int j = 0; j + readCount + writeCount <= data.size(); j += readCount + writeCount) {
-			CommitTransactionRef tr;
-			for (int k = 0; k < readCount; k++) {
-				KeyRangeRef r(buf, data[j + k]);
-				tr.read_conflict_ranges.push_back(buf, r);
-			}
-			for (int k = 0; k < writeCount; k++) {
-				KeyRangeRef r(buf, data[j + readCount + k]);
-				tr.write_conflict_ranges.push_back(buf, r);
-			}
-			cranges += tr.read_conflict_ranges.size() + tr.write_conflict_ranges.size();
-			tr.read_snapshot = version;
-			trs.push_back(tr);
-		}
-		tcount += trs.size();
-		g_buildTest += timer() - t;
-
-		t = timer();
 		ConflictBatch batch(cs);
 		for (const auto& tr : trs) {
 			batch.addTransaction(tr, version);
@@ -1178,25 +1380,115 @@ void skipListTest() {
 
 		version++;
 	}
-	double elapsed = timer() - start;
-	printf("New conflict set: %0.3f sec\n", elapsed);
-	printf("                  %0.3f Mtransactions/sec\n", tcount / elapsed / 1e6);
-	printf("                  %0.3f Mkeys/sec\n", cranges * 2 / elapsed / 1e6);
-
-	elapsed = g_detectConflicts.getValue();
-	printf("Detect only:      %0.3f sec\n", elapsed);
-	printf("                  %0.3f Mtransactions/sec\n", tcount / elapsed / 1e6);
-	printf("                  %0.3f Mkeys/sec\n", cranges * 2 / elapsed / 1e6);
-
-	elapsed = g_checkRead.getValue() + g_merge.getValue();
-	printf("Skiplist only:    %0.3f sec\n", elapsed);
-	printf("                  %0.3f Mtransactions/sec\n", tcount / elapsed / 1e6);
-	printf("                  %0.3f Mkeys/sec\n", cranges * 2 / elapsed / 1e6);
-
-	printf("Performance counters:\n");
-	for (const auto& counter : skc) {
-		printf("%20s: %s\n", counter->getMetric().name().c_str(), counter->getMetric().formatted().c_str());
+	return nonConflict;
+}
+} // namespace
+
+TEST_CASE("/fdbserver/ConflictSet/partitioned") {
+	// Partitioned resolution must commit exactly the same transactions as resolving each batch in one partition
+	Arena arena;
+	const int batches = 50;
+	std::vector<std::vector<CommitTransactionRef>> data =
+	    generateBatches(arena, batches, deterministicRandom()->randomInt(2, 2000));
+	ConflictSet* serial = newConflictSet();
+	ConflictSet* partitioned =
+	    newConflictSet(deterministicRandom()->randomInt(2, 9), !g_network->isSimulated(), /*parallelMinRanges*/ 0);
+	ASSERT(resolveBatches(serial, data) == resolveBatches(partitioned, data));
+	destroyConflictSet(serial);
+	destroyConflictSet(partitioned);
+	return Void();
+}
+
+void skipListTest() {
+	printf("Skip list test\n");
+
+	miniConflictSetTest();
+
+	operatorLessThanTest();
+
+	// Replay the same batch stream with increasing partition counts, for keys spread uniformly over the key space and
+	// for keys within the key spaces of a few tenants.
+	const std::vector<int> partitionCounts = { 1, 2, 4, 8 };
+	// Worker threads are started before pinning this thread so that they are not confined to its core.
+	const std::vector<int> tenantCounts = { 0, 8 };
+	std::vector<std::vector<ConflictSet*>> conflictSets(tenantCounts.size());
+	for (auto& sets : conflictSets) {
+		for (int partitions : partitionCounts)
+			sets.push_back(newConflictSet(partitions));
 	}
+	setAffinity(0);
+
+	for (int d = 0; d < tenantCounts.size(); d++) {
+		const int tenants = tenantCounts[d];
+		const int batches = 500; // deterministicRandom()->randomInt(500, 5000);
+		const int data_per_batch = 5000;
+		Arena testDataArena;
+		g_buildTest.clear();
+		double t = timer();
+		std::vector<std::vector<CommitTransactionRef>> testData =
+		    generateBatches(testDataArena, batches, data_per_batch, tenants);
+		g_buildTest += timer() - t;
+		printf("Test data generated: %d batches, %d/batch, %d tenants\n", batches, data_per_batch, tenants);
+
+		int cranges = 0, tcount = 0;
+		for (const auto& trs : testData) {
+			tcount += trs.size();
+			for (const auto& tr : trs)
+				cranges += tr.read_conflict_ranges.size() + tr.write_conflict_ranges.size();
+		}
 
-	printf("%d entries in version history\n", cs->versionHistory.count());
+		std::vector<std::vector<int>> expected;
+		for (int i = 0; i < partitionCounts.size(); i++) {
+			ConflictSet* cs = conflictSets[d][i];
+			for (auto& counter : skc) {
+				if (counter != &g_buildTest)
+					counter->clear();
+			}
+
+			printf("Running with %d partition(s)\n", partitionCounts[i]);
+			double start = timer();
+			std::vector<std::vector<int>> nonConflict = resolveBatches(cs, testData);
+			double elapsed = timer() - start;
+			if (i == 0)
+				expected = nonConflict;
+			else
+				ASSERT(nonConflict == expected);
+
+			printf("New conflict set: %0.3f sec\n", elapsed);
+			printf("                  %0.3f Mtransactions/sec\n", tcount / elapsed / 1e6);
+			printf("                  %0.3f Mkeys/sec\n", cranges * 2 / elapsed / 1e6);
+			printf("                  %0.3f Mtransactions/sec/core\n", tcount / elapsed / 1e6 / partitionCounts[i]);
+
+			elapsed = g_detectConflicts.getValue();
+			printf("Detect only:      %0.3f sec\n", elapsed);
+			printf("                  %0.3f Mtransactions/sec\n", tcount / elapsed / 1e6);
+			printf("                  %0.3f Mkeys/sec\n", cranges * 2 / elapsed / 1e6);
+
+			elapsed = g_checkRead.getValue() + g_merge.getValue() + g_removeBefore.getValue();
+			printf("Version history:  %0.3f sec\n", elapsed);
+			printf("                  %0.3f Mtransactions/sec\n", tcount / elapsed / 1e6);
+			printf("                  %0.3f Mkeys/sec\n", cranges * 2 / elapsed / 1e6);
+
+			printf("Performance counters:\n");
+			for (const auto& counter : skc) {
+				printf("%20s: %s\n", counter->getMetric().name().c_str(), counter->getMetric().formatted().c_str());
+			}
+
+			// removeBefore() on the whole history at once, as after a recovery or a long stall moves the oldest version
+			// past every write, in calls of the size detectConflicts() makes for a batch of data_per_batch writes
+			const int entries = cs->count();
+			const int workHint = data_per_batch * 3 + 10;
+			cs->oldestVersion = batches + 50;
+			start = timer();
+			for (int calls = 2 * entries / workHint + 2; calls > 0; calls--)
+				cs->removeBefore(cs->oldestVersion, workHint);
+			elapsed = timer() - start;
+			const int removed = entries - cs->count();
+			printf("Remove before:    %0.3f sec\n", elapsed);
+			printf("                  %0.3f Mentries/sec\n", removed / elapsed / 1e6);
+
+			printf("%d entries in version history, %d removed\n", entries, removed);
+			destroyConflictSet(cs);
+		}
+	}
 }
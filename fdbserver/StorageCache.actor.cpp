@@ -2255,6 +2255,11 @@ ACTOR Future<Void> storageCacheServer(StorageServerInterface ssi,
 				// actors.add(self->readGuard(req , getValueQ));
 				actors.add(getValueQ(&self, req));
 			}
+			when(GetValuesRequest req = waitNext(ssi.getValues.getFuture())) {
+				// Batched reads are not served by cache servers, so that the client's load balancing sends them to one
+				// of the storage servers instead
+				req.reply.sendError(broken_promise());
+			}
 			when(WatchValueRequest req = waitNext(ssi.watchValue.getFuture())) {
 				ASSERT(false);
 			}
@@ -45,6 +45,7 @@
 #include "fdbserver/FDBExecHelper.actor.h"
 #include "flow/Histogram.h"
 #include "flow/DebugTrace.h"
+#include "flow/CompressionUtils.h"
 #include "flow/genericactors.actor.h"
 #include "flow/network.h"
 #include "flow/actorcompiler.h" // This must be the last #include.
@@ -285,6 +286,16 @@ struct SpilledData {
 	uint32_t mutationBytes = 0;
 };
 
+// One read of the disk queue by a peek of spilled data, which covers the queue entries of one or more versions of
+// the peeked tag and any entries between them.
+struct SpilledRead {
+	IDiskQueue::location start;
+	IDiskQueue::location end;
+	std::vector<Version> versions;
+
+	SpilledRead(IDiskQueue::location start, IDiskQueue::location end) : start(start), end(end) {}
+};
+
 struct TLogData : NonCopyable {
 	AsyncTrigger newLogData;
 	// A process has only 1 SharedTLog, which holds data for multiple logs, so that it obeys its assigned memory limit.
@@ -399,8 +410,70 @@ struct TLogData : NonCopyable {
 	}
 };
 
+// Returns the filter used to compress the messages of a TLog in memory, which is TLOG_MESSAGE_COMPRESSION_FILTER if
+// this build supports it
+CompressionFilter messageCompressionFilter() {
+	if (!SERVER_KNOBS->TLOG_COMPRESS_MESSAGES) {
+		return CompressionFilter::NONE;
+	}
+	CompressionFilter filter = CompressionUtils::fromFilterString(SERVER_KNOBS->TLOG_MESSAGE_COMPRESSION_FILTER);
+	if (!CompressionUtils::supportedFilters.count(filter)) {
+		TraceEvent(SevWarnAlways, "TLogMessageCompressionFilterUnsupported")
+		    .detail("Filter", SERVER_KNOBS->TLOG_MESSAGE_COMPRESSION_FILTER);
+		return CompressionFilter::NONE;
+	}
+	return filter;
+}
+
+// The messages of one tag for a run of consecutive versions, moved out of TagData::versionMessages and compressed
+// together when TLOG_COMPRESS_MESSAGES is set.  Uncompressed, the data is the messages in the same length prefixed
+// form as in the message blocks, so the messages of a version are a single slice of it that can be copied into a peek
+// reply as is.
+struct CompressedMessages {
+	struct VersionEntry {
+		uint32_t versionOffset; // From firstVersion
+		uint32_t offset; // Of the version's first message in the uncompressed data
+		uint32_t bytes; // Total expectedSize() of the version's messages, as counted in version_sizes
+	};
+
+	Version firstVersion;
+	std::vector<VersionEntry> versions;
+	int erased = 0; // Leading entries of versions that were popped or spilled
+	uint32_t uncompressedBytes = 0;
+	Standalone<StringRef> data;
+	int64_t bytesInput = 0; // Counted in the bytesInput of the TLog until the last version is erased
+
+	explicit CompressedMessages(Version firstVersion) : firstVersion(firstVersion) {}
+
+	int size() const { return versions.size(); }
+	Version version(int i) const { return firstVersion + versions[i].versionOffset; }
+	Version lastVersion() const { return version(versions.size() - 1); }
+	bool fullyErased() const { return erased == versions.size(); }
+
+	// Returns the index of the first entry not erased with a version >= v
+	int lowerBound(Version v) const {
+		auto it = std::lower_bound(
+		    versions.begin() + erased, versions.end(), v, [this](VersionEntry const& e, Version v) {
+			    return firstVersion + e.versionOffset < v;
+		    });
+		return it - versions.begin();
+	}
+
+	// Returns the messages of entry i, given the uncompressed data
+	StringRef messages(StringRef uncompressed, int i) const {
+		uint32_t end = i + 1 < versions.size() ? versions[i + 1].offset : uncompressedBytes;
+		return uncompressed.substr(versions[i].offset, end - versions[i].offset);
+	}
+
+	StringRef decompress(CompressionFilter filter, Arena& arena) const {
+		return CompressionUtils::decompress(filter, data, arena);
+	}
+};
+
 struct LogData : NonCopyable, public ReferenceCounted<LogData> {
 	struct TagData : NonCopyable, public ReferenceCounted<TagData> {
+		// Messages of the oldest versions, if compressed, followed by the uncompressed messages of newer versions
+		std::deque<CompressedMessages> compressedMessages;
 		std::deque<std::pair<Version, LengthPrefixedStringRef>> versionMessages;
 		bool
 		    nothingPersistent; // true means tag is *known* to have no messages in persistentData.  false means nothing.
@@ -423,11 +496,13 @@ struct LogData : NonCopyable, public ReferenceCounted<LogData> {
 		    tag(tag) {}
 
 		TagData(TagData&& r) noexcept
-		  : versionMessages(std::move(r.versionMessages)), nothingPersistent(r.nothingPersistent),
+		  : compressedMessages(std::move(r.compressedMessages)), versionMessages(std::move(r.versionMessages)),
+		    nothingPersistent(r.nothingPersistent),
 		    poppedRecently(r.poppedRecently), popped(r.popped), persistentPopped(r.persistentPopped),
 		    versionForPoppedLocation(r.versionForPoppedLocation), poppedLocation(r.poppedLocation),
 		    unpoppedRecovered(r.unpoppedRecovered), tag(r.tag) {}
 		void operator=(TagData&& r) noexcept {
+			compressedMessages = std::move(r.compressedMessages);
 			versionMessages = std::move(r.versionMessages);
 			nothingPersistent = r.nothingPersistent;
 			poppedRecently = r.poppedRecently;
@@ -439,12 +514,53 @@ struct LogData : NonCopyable, public ReferenceCounted<LogData> {
 			unpoppedRecovered = r.unpoppedRecovered;
 		}
 
+		bool hasMessages() const { return !compressedMessages.empty() || !versionMessages.empty(); }
+
+		// Returns the position (index in compressedMessages, index of the version in it) of the first compressed
+		// version >= v, with the first index equal to compressedMessages.size() if there is none
+		std::pair<int, int> findCompressedMessages(Version v) const {
+			auto it = std::lower_bound(
+			    compressedMessages.begin(), compressedMessages.end(), v, [](CompressedMessages const& c, Version v) {
+				    return c.lastVersion() < v;
+			    });
+			if (it == compressedMessages.end()) {
+				return std::make_pair(compressedMessages.size(), 0);
+			}
+			return std::make_pair(it - compressedMessages.begin(), it->lowerBound(v));
+		}
+
+		// Returns the newest version with messages, if hasMessages()
+		Version lastMessageVersion() const {
+			return versionMessages.empty() ? compressedMessages.back().lastVersion() : versionMessages.back().first;
+		}
+
 		// Erase messages not needed to update *from* versions >= before (thus, messages with toversion <= before)
 		ACTOR Future<Void> eraseMessagesBefore(TagData* self,
 		                                       Version before,
 		                                       TLogData* tlogData,
 		                                       Reference<LogData> logData,
 		                                       TaskPriority taskID) {
+			while (!self->compressedMessages.empty() &&
+			       self->compressedMessages.front().version(self->compressedMessages.front().erased) < before) {
+				CompressedMessages& chunk = self->compressedMessages.front();
+				for (; chunk.erased < chunk.size() && chunk.version(chunk.erased) < before; ++chunk.erased) {
+					std::pair<int, int>& sizes = logData->version_sizes[chunk.version(chunk.erased)];
+					if (self->tag.locality != tagLocalityTxs && self->tag != txsTag) {
+						sizes.first -= chunk.versions[chunk.erased].bytes;
+					} else {
+						sizes.second -= chunk.versions[chunk.erased].bytes;
+					}
+				}
+
+				if (chunk.fullyErased()) {
+					logData->bytesDurable += chunk.bytesInput;
+					tlogData->bytesDurable += chunk.bytesInput;
+					logData->compressedMessageBytes -= chunk.bytesInput;
+					self->compressedMessages.pop_front();
+				}
+				wait(yield(taskID));
+			}
+
 			while (!self->versionMessages.empty() && self->versionMessages.front().first < before) {
 				Version version = self->versionMessages.front().first;
 				std::pair<int, int>& sizes = logData->version_sizes[version];
@@ -479,6 +595,127 @@ struct LogData : NonCopyable, public ReferenceCounted<LogData> {
 		                                 TaskPriority taskID) {
 			return eraseMessagesBefore(this, before, tlogData, logData, taskID);
 		}
+
+		// Returns the first entry of versionMessages with a version greater than v
+		std::deque<std::pair<Version, LengthPrefixedStringRef>>::iterator versionMessagesAfter(Version v) {
+			return std::upper_bound(versionMessages.begin(),
+			                        versionMessages.end(),
+			                        std::make_pair(v, LengthPrefixedStringRef()),
+			                        [](const auto& l, const auto& r) -> bool { return l.first < r.first; });
+		}
+
+		// Calls spill(version, messages, bytes) for each version up to and including through with messages of this tag,
+		// oldest first. messages are the version's messages serialized as StringRefs if byValue is set, and bytes is
+		// their total expectedSize(). A future returned by spill that isn't ready is waited for, after which the next
+		// version is looked up again: versionMessages may have been pushed to or erased from in the meantime, which
+		// invalidates iterators into it.
+		ACTOR static Future<Void> spillMessages(TagData* self,
+		                                        Version through,
+		                                        bool byValue,
+		                                        CompressionFilter filter,
+		                                        std::function<Future<Void>(Version, StringRef, uint32_t)> spill) {
+			state Version version = invalidVersion;
+			state Future<Void> spilled;
+
+			// Compressed messages come first, since they are older than those in versionMessages
+			state std::pair<int, int> compressedPos = self->findCompressedMessages(0);
+			state Standalone<StringRef> uncompressed;
+			state Version uncompressedFirstVersion = invalidVersion;
+			while (compressedPos.first < self->compressedMessages.size()) {
+				const CompressedMessages& chunk = self->compressedMessages[compressedPos.first];
+				const int i = compressedPos.second;
+				if (chunk.version(i) > through) {
+					return Void();
+				}
+				version = chunk.version(i);
+				compressedPos = i + 1 < chunk.size() ? std::make_pair(compressedPos.first, i + 1)
+				                                     : std::make_pair(compressedPos.first + 1, 0);
+
+				StringRef messages;
+				if (byValue) {
+					if (uncompressedFirstVersion != chunk.firstVersion) {
+						Arena arena;
+						StringRef data = chunk.decompress(filter, arena);
+						uncompressed = Standalone<StringRef>(data, arena);
+						uncompressedFirstVersion = chunk.firstVersion;
+					}
+					// The messages are already in the form that serializing each one as a StringRef produces
+					messages = chunk.messages(uncompressed, i);
+				}
+				spilled = spill(version, messages, chunk.versions[i].bytes);
+				if (!spilled.isReady()) {
+					wait(spilled);
+					compressedPos = self->findCompressedMessages(version + 1);
+				}
+			}
+
+			state std::deque<std::pair<Version, LengthPrefixedStringRef>>::iterator msg =
+			    self->versionMessagesAfter(version);
+			while (msg != self->versionMessages.end() && msg->first <= through) {
+				version = msg->first;
+				uint32_t bytes = 0;
+				BinaryWriter wr(Unversioned());
+				for (; msg != self->versionMessages.end() && msg->first == version; ++msg) {
+					if (byValue) {
+						wr << msg->second.toStringRef();
+					}
+					bytes += msg->second.expectedSize();
+				}
+				spilled = spill(version, byValue ? wr.toValue() : Standalone<StringRef>(), bytes);
+				if (!spilled.isReady()) {
+					wait(spilled);
+					msg = self->versionMessagesAfter(version);
+				}
+			}
+			return Void();
+		}
+
+		Future<Void> spillMessages(Version through,
+		                           bool byValue,
+		                           CompressionFilter filter,
+		                           std::function<Future<Void>(Version, StringRef, uint32_t)> spill) {
+			return spillMessages(this, through, byValue, filter, std::move(spill));
+		}
+
+		// Moves the messages of versions up to and including through from versionMessages into compressed chunks of
+		// about chunkBytes each.  Returns the number of entries removed from versionMessages.
+		int compressMessages(Version through, CompressionFilter filter, int chunkBytes, LogData* logData) {
+			int removed = 0;
+			while (!versionMessages.empty() && versionMessages.front().first <= through) {
+				CompressedMessages chunk(versionMessages.front().first);
+				Standalone<VectorRef<uint8_t>> buffer;
+				while (!versionMessages.empty() && versionMessages.front().first <= through &&
+				       buffer.size() < chunkBytes &&
+				       versionMessages.front().first - chunk.firstVersion <= std::numeric_limits<uint32_t>::max()) {
+					const Version version = versionMessages.front().first;
+					CompressedMessages::VersionEntry entry;
+					entry.versionOffset = version - chunk.firstVersion;
+					entry.offset = buffer.size();
+					entry.bytes = 0;
+					for (; !versionMessages.empty() && versionMessages.front().first == version; ++removed) {
+						const LengthPrefixedStringRef m = versionMessages.front().second;
+						buffer.append(
+						    buffer.arena(), (const uint8_t*)m.getLengthPtr(), sizeof(uint32_t) + m.expectedSize());
+						entry.bytes += m.expectedSize();
+						versionMessages.pop_front();
+					}
+					chunk.versions.push_back(entry);
+				}
+
+				Arena arena;
+				StringRef uncompressed(buffer.begin(), buffer.size());
+				chunk.data = Standalone<StringRef>(CompressionUtils::compress(filter, uncompressed, arena), arena);
+				chunk.uncompressedBytes = buffer.size();
+				chunk.versions.shrink_to_fit();
+				chunk.bytesInput = chunk.data.size() + chunk.size() * sizeof(CompressedMessages::VersionEntry);
+				logData->compressedMessageBytes += chunk.bytesInput;
+				logData->compressedVersions += chunk.size();
+				logData->compressionInputBytes += buffer.size();
+				logData->compressionOutputBytes += chunk.data.size();
+				compressedMessages.push_back(std::move(chunk));
+			}
+			return removed;
+		}
 	};
 
 	Map<Version, std::pair<IDiskQueue::location, IDiskQueue::location>>
@@ -529,6 +766,9 @@ struct LogData : NonCopyable, public ReferenceCounted<LogData> {
 	std::deque<UnknownCommittedVersions> unknownCommittedVersions;
 
 	Deque<std::pair<Version, Standalone<VectorRef<uint8_t>>>> messageBlocks;
+	int64_t messageBlockBytes = 0; // Total size of messageBlocks
+	int64_t compressedMessageBytes = 0; // Total bytesInput of the CompressedMessages of all tags
+	CompressionFilter messageCompression = messageCompressionFilter();
 	std::vector<std::vector<Reference<TagData>>> tag_data; // tag.locality | tag.id
 	int unpoppedRecoveredTagCount;
 	std::set<Tag> unpoppedRecoveredTags;
@@ -571,6 +811,15 @@ struct LogData : NonCopyable, public ReferenceCounted<LogData> {
 	Counter blockingPeekTimeouts;
 	Counter emptyPeeks;
 	Counter nonEmptyPeeks;
+	Counter spilledVersions;
+	Counter spilledRefBytes;
+	Counter spilledPeekReads;
+	Counter spilledPeekBytesRead;
+	Counter spilledPeekBytes;
+	Counter compressedVersions; // Summed over tags
+	Counter compressionInputBytes;
+	Counter compressionOutputBytes;
+	Counter compressedPeekBytes; // Decompressed to serve peeks
 	std::map<Tag, LatencySample> blockingPeekLatencies;
 	std::map<Tag, LatencySample> peekVersionCounts;
 
@@ -660,7 +909,12 @@ struct LogData : NonCopyable, public ReferenceCounted<LogData> {
 	    unpoppedRecoveredTagCount(0), cc("TLog", interf.id().toString()), bytesInput("BytesInput", cc),
 	    bytesDurable("BytesDurable", cc), blockingPeeks("BlockingPeeks", cc),
 	    blockingPeekTimeouts("BlockingPeekTimeouts", cc), emptyPeeks("EmptyPeeks", cc),
-	    nonEmptyPeeks("NonEmptyPeeks", cc), logId(interf.id()), protocolVersion(protocolVersion),
+	    nonEmptyPeeks("NonEmptyPeeks", cc), spilledVersions("SpilledVersions", cc),
+	    spilledRefBytes("SpilledRefBytes", cc), spilledPeekReads("SpilledPeekReads", cc),
+	    spilledPeekBytesRead("SpilledPeekBytesRead", cc), spilledPeekBytes("SpilledPeekBytes", cc),
+	    compressedVersions("CompressedVersions", cc), compressionInputBytes("CompressionInputBytes", cc),
+	    compressionOutputBytes("CompressionOutputBytes", cc), compressedPeekBytes("CompressedPeekBytes", cc),
+	    logId(interf.id()), protocolVersion(protocolVersion),
 	    newPersistentDataVersion(invalidVersion), tLogData(tLogData), unrecoveredBefore(1), recoveredAt(1),
 	    recoveryTxnVersion(1), logSystem(new AsyncVar<Reference<ILogSystem>>()), remoteTag(remoteTag),
 	    isPrimary(isPrimary), logRouterTags(logRouterTags), logRouterPoppedVersion(0), logRouterPopToVersion(0),
@@ -699,6 +953,12 @@ struct LogData : NonCopyable, public ReferenceCounted<LogData> {
 		specialCounter(cc, "PeekMemoryRequestsStalled", [tLogData]() { return tLogData->peekMemoryLimiter.waiters(); });
 		specialCounter(cc, "Generation", [this]() { return this->recoveryCount; });
 		specialCounter(cc, "ActivePeekStreams", [tLogData]() { return tLogData->activePeekStreams; });
+		specialCounter(cc, "SpilledRefBytesPerVersion", [this]() {
+			int64_t versions = this->spilledVersions.getValue();
+			return versions ? this->spilledRefBytes.getValue() / versions : 0;
+		});
+		specialCounter(cc, "MessageBlockBytes", [this]() { return this->messageBlockBytes; });
+		specialCounter(cc, "CompressedMessageBytes", [this]() { return this->compressedMessageBytes; });
 	}
 
 	~LogData() {
@@ -979,7 +1239,7 @@ ACTOR Future<Void> popDiskQueue(TLogData* self, Reference<LogData> logData) {
 					minLocation = std::min(minLocation, tagData->poppedLocation);
 					minVersion = std::min(minVersion, tagData->popped);
 				}
-				if ((!tagData->nothingPersistent || tagData->versionMessages.size()) &&
+				if ((!tagData->nothingPersistent || tagData->hasMessages()) &&
 				    tagData->popped < logData->minPoppedTagVersion) {
 					logData->minPoppedTagVersion = tagData->popped;
 					logData->minPoppedTag = tagData->tag;
@@ -1002,6 +1262,43 @@ ACTOR Future<Void> popDiskQueue(TLogData* self, Reference<LogData> logData) {
 	return Void();
 }
 
+// Adds a reference to the messages of tagData at version, of the given total size, to the batch of spilled references
+// being built in wr, and writes the batch to persistentData once it is full.
+void spillByReference(TLogData* self,
+                      Reference<LogData> logData,
+                      Reference<LogData::TagData> tagData,
+                      Version version,
+                      uint32_t size,
+                      BinaryWriter& wr,
+                      int& refSpilledTagCount,
+                      Version& lastVersion,
+                      IDiskQueue::location& firstLocation) {
+	const IDiskQueue::location begin = logData->versionLocation[version].first;
+	const IDiskQueue::location end = logData->versionLocation[version].second;
+	ASSERT(end > begin && end.lo - begin.lo < std::numeric_limits<uint32_t>::max());
+	uint32_t length = static_cast<uint32_t>(end.lo - begin.lo);
+	refSpilledTagCount++;
+
+	SpilledData spilledData(version, begin, length, size);
+	wr << spilledData;
+
+	lastVersion = std::max(version, lastVersion);
+	firstLocation = std::min(begin, firstLocation);
+
+	++logData->spilledVersions;
+
+	if ((wr.getLength() + sizeof(SpilledData) > SERVER_KNOBS->TLOG_SPILL_REFERENCE_MAX_BYTES_PER_BATCH)) {
+		*(uint32_t*)wr.getData() = refSpilledTagCount;
+		self->persistentData->set(
+		    KeyValueRef(persistTagMessageRefsKey(logData->logId, tagData->tag, lastVersion), wr.toValue()));
+		logData->spilledRefBytes += wr.getLength();
+		tagData->poppedLocation = std::min(tagData->poppedLocation, firstLocation);
+		refSpilledTagCount = 0;
+		wr = BinaryWriter(AssumeVersion(logData->protocolVersion));
+		wr << uint32_t(0);
+	}
+}
+
 ACTOR Future<Void> updatePersistentData(TLogData* self, Reference<LogData> logData, Version newPersistentDataVersion) {
 	state BinaryWriter wr(Unversioned());
 	// PERSIST: Changes self->persistentDataVersion and writes and commits the relevant changes
@@ -1024,76 +1321,37 @@ ACTOR Future<Void> updatePersistentData(TLogData* self, Reference<LogData> logDa
 			state Reference<LogData::TagData> tagData = logData->tag_data[tagLocality][tagId];
 			if (tagData) {
 				wait(tagData->eraseMessagesBefore(tagData->popped, self, logData, TaskPriority::UpdateStorage));
-				state Version currentVersion = 0;
 				// Clear recently popped versions from persistentData if necessary
 				updatePersistentPopped(self, logData, tagData);
 				state Version lastVersion = std::numeric_limits<Version>::min();
 				state IDiskQueue::location firstLocation = std::numeric_limits<IDiskQueue::location>::max();
 				// Transfer unpopped messages with version numbers less than newPersistentDataVersion to persistentData
-				state std::deque<std::pair<Version, LengthPrefixedStringRef>>::iterator msg =
-				    tagData->versionMessages.begin();
 				state int refSpilledTagCount = 0;
 				wr = BinaryWriter(AssumeVersion(logData->protocolVersion));
 				// We prefix our spilled locations with a count, so that we can read this back out as a VectorRef.
 				wr << uint32_t(0);
-				while (msg != tagData->versionMessages.end() && msg->first <= newPersistentDataVersion) {
-					currentVersion = msg->first;
-					anyData = true;
-					tagData->nothingPersistent = false;
-
-					if (logData->shouldSpillByValue(tagData->tag)) {
-						wr = BinaryWriter(Unversioned());
-						for (; msg != tagData->versionMessages.end() && msg->first == currentVersion; ++msg) {
-							wr << msg->second.toStringRef();
-						}
-						self->persistentData->set(KeyValueRef(
-						    persistTagMessagesKey(logData->logId, tagData->tag, currentVersion), wr.toValue()));
-					} else {
-						// spill everything else by reference
-						const IDiskQueue::location begin = logData->versionLocation[currentVersion].first;
-						const IDiskQueue::location end = logData->versionLocation[currentVersion].second;
-						ASSERT(end > begin && end.lo - begin.lo < std::numeric_limits<uint32_t>::max());
-						uint32_t length = static_cast<uint32_t>(end.lo - begin.lo);
-						refSpilledTagCount++;
-
-						uint32_t size = 0;
-						for (; msg != tagData->versionMessages.end() && msg->first == currentVersion; ++msg) {
-							// Fast forward until we find a new version.
-							size += msg->second.expectedSize();
-						}
-
-						SpilledData spilledData(currentVersion, begin, length, size);
-						wr << spilledData;
-
-						lastVersion = std::max(currentVersion, lastVersion);
-						firstLocation = std::min(begin, firstLocation);
-
-						if ((wr.getLength() + sizeof(SpilledData) >
-						     SERVER_KNOBS->TLOG_SPILL_REFERENCE_MAX_BYTES_PER_BATCH)) {
-							*(uint32_t*)wr.getData() = refSpilledTagCount;
-							self->persistentData->set(KeyValueRef(
-							    persistTagMessageRefsKey(logData->logId, tagData->tag, lastVersion), wr.toValue()));
-							tagData->poppedLocation = std::min(tagData->poppedLocation, firstLocation);
-							refSpilledTagCount = 0;
-							wr = BinaryWriter(AssumeVersion(logData->protocolVersion));
-							wr << uint32_t(0);
-						}
-
-						Future<Void> f = yield(TaskPriority::UpdateStorage);
-						if (!f.isReady()) {
-							wait(f);
-							msg = std::upper_bound(
-							    tagData->versionMessages.begin(),
-							    tagData->versionMessages.end(),
-							    std::make_pair(currentVersion, LengthPrefixedStringRef()),
-							    [](const auto& l, const auto& r) -> bool { return l.first < r.first; });
-						}
-					}
-				}
+				wait(tagData->spillMessages(
+				    newPersistentDataVersion,
+				    logData->shouldSpillByValue(tagData->tag),
+				    logData->messageCompression,
+				    [&](Version version, StringRef messages, uint32_t bytes) -> Future<Void> {
+					    anyData = true;
+					    tagData->nothingPersistent = false;
+					    if (logData->shouldSpillByValue(tagData->tag)) {
+						    self->persistentData->set(
+						        KeyValueRef(persistTagMessagesKey(logData->logId, tagData->tag, version), messages));
+						    return Void();
+					    }
+					    // spill everything else by reference
+					    spillByReference(
+					        self, logData, tagData, version, bytes, wr, refSpilledTagCount, lastVersion, firstLocation);
+					    return yield(TaskPriority::UpdateStorage);
+				    }));
 				if (refSpilledTagCount > 0) {
 					*(uint32_t*)wr.getData() = refSpilledTagCount;
 					self->persistentData->set(
 					    KeyValueRef(persistTagMessageRefsKey(logData->logId, tagData->tag, lastVersion), wr.toValue()));
+					logData->spilledRefBytes += wr.getLength();
 					tagData->poppedLocation = std::min(tagData->poppedLocation, firstLocation);
 				}
 
@@ -1154,6 +1412,7 @@ ACTOR Future<Void> updatePersistentData(TLogData* self, Reference<LogData> logDa
 		    int64_t(logData->messageBlocks.front().second.size()) * SERVER_KNOBS->TLOG_MESSAGE_BLOCK_OVERHEAD_FACTOR;
 		logData->bytesDurable += bytesErased;
 		self->bytesDurable += bytesErased;
+		logData->messageBlockBytes -= logData->messageBlocks.front().second.size();
 		logData->messageBlocks.pop_front();
 		wait(yield(TaskPriority::UpdateStorage));
 	}
@@ -1487,6 +1746,71 @@ ACTOR Future<Void> updateStorage(TLogData* self) {
 	return Void();
 }
 
+// Compresses the messages of the oldest versions in memory while the message blocks hold more than
+// TLOG_COMPRESS_MESSAGES_MIN_UNCOMPRESSED_BYTES, so that more versions fit within TLOG_SPILL_THRESHOLD.  The messages
+// of each tag are moved into compressed chunks, after which the message blocks of those versions are freed.
+ACTOR Future<Void> compressMessages(TLogData* self, Reference<LogData> logData) {
+	state FlowLock::Releaser commitLockReleaser;
+	state Version through;
+	state int tagLocality;
+	state int tagId;
+	loop {
+		wait(delay(BUGGIFY ? SERVER_KNOBS->BUGGIFY_TLOG_STORAGE_MIN_UPDATE_INTERVAL
+		                   : SERVER_KNOBS->TLOG_STORAGE_MIN_UPDATE_INTERVAL,
+		           TaskPriority::UpdateStorage));
+		if (logData->messageBlockBytes <= SERVER_KNOBS->TLOG_COMPRESS_MESSAGES_MIN_UNCOMPRESSED_BYTES) {
+			continue;
+		}
+
+		// Moving messages out of versionMessages can't overlap with updatePersistentData spilling them
+		wait(self->persistentDataCommitLock.take());
+		commitLockReleaser = FlowLock::Releaser(self->persistentDataCommitLock);
+
+		// Compress up to a message block's worth of the oldest versions at a time
+		through = invalidVersion;
+		int64_t bytes = 0;
+		for (int i = 0; i < logData->messageBlocks.size() && bytes < SERVER_KNOBS->TLOG_MESSAGE_BLOCK_BYTES &&
+		                logData->messageBlockBytes - bytes > SERVER_KNOBS->TLOG_COMPRESS_MESSAGES_MIN_UNCOMPRESSED_BYTES;
+		     i++) {
+			through = logData->messageBlocks[i].first;
+			bytes += logData->messageBlocks[i].second.size();
+		}
+
+		for (tagLocality = 0; tagLocality < logData->tag_data.size(); tagLocality++) {
+			for (tagId = 0; tagId < logData->tag_data[tagLocality].size(); tagId++) {
+				Reference<LogData::TagData> tagData = logData->tag_data[tagLocality][tagId];
+				if (tagData) {
+					const int64_t compressedBytes = logData->compressedMessageBytes;
+					const int64_t entriesErased =
+					    tagData->compressMessages(through,
+					                              logData->messageCompression,
+					                              SERVER_KNOBS->TLOG_COMPRESSED_MESSAGES_CHUNK_BYTES,
+					                              logData.getPtr());
+					const int64_t bytesAdded = logData->compressedMessageBytes - compressedBytes;
+					const int64_t bytesErased = entriesErased * SERVER_KNOBS->VERSION_MESSAGES_ENTRY_BYTES_WITH_OVERHEAD;
+					logData->bytesInput += bytesAdded;
+					self->bytesInput += bytesAdded;
+					logData->bytesDurable += bytesErased;
+					self->bytesDurable += bytesErased;
+					self->overheadBytesDurable += bytesErased;
+					wait(yield(TaskPriority::UpdateStorage));
+				}
+			}
+		}
+
+		// No tag refers to the message blocks of these versions anymore
+		while (!logData->messageBlocks.empty() && logData->messageBlocks.front().first <= through) {
+			int64_t bytesErased =
+			    int64_t(logData->messageBlocks.front().second.size()) * SERVER_KNOBS->TLOG_MESSAGE_BLOCK_OVERHEAD_FACTOR;
+			logData->bytesDurable += bytesErased;
+			self->bytesDurable += bytesErased;
+			logData->messageBlockBytes -= logData->messageBlocks.front().second.size();
+			logData->messageBlocks.pop_front();
+		}
+		commitLockReleaser.release();
+	}
+}
+
 ACTOR Future<Void> updateStorageLoop(TLogData* self) {
 	wait(delay(0, TaskPriority::UpdateStorage));
 
@@ -1531,6 +1855,7 @@ void commitMessages(TLogData* self,
 	for (auto& msg : taggedMessages) {
 		if (msg.message.size() > block.capacity() - block.size()) {
 			logData->messageBlocks.emplace_back(version, block);
+			logData->messageBlockBytes += block.size();
 			addedBytes += int64_t(block.size()) * SERVER_KNOBS->TLOG_MESSAGE_BLOCK_OVERHEAD_FACTOR;
 			block = Standalone<VectorRef<uint8_t>>();
 			block.reserve(block.arena(), std::max<int64_t>(SERVER_KNOBS->TLOG_MESSAGE_BLOCK_BYTES, msgSize));
@@ -1600,6 +1925,7 @@ void commitMessages(TLogData* self,
 		msgSize -= msg.message.size();
 	}
 	logData->messageBlocks.emplace_back(version, block);
+	logData->messageBlockBytes += block.size();
 	addedBytes += int64_t(block.size()) * SERVER_KNOBS->TLOG_MESSAGE_BLOCK_OVERHEAD_FACTOR;
 	addedBytes += overheadBytes;
 
@@ -1645,7 +1971,7 @@ std::deque<std::pair<Version, LengthPrefixedStringRef>>& getVersionMessages(Refe
 ACTOR Future<Void> waitForMessagesForTag(Reference<LogData> self, Tag reqTag, Version reqBegin, double timeout) {
 	self->blockingPeeks += 1;
 	auto tagData = self->getTagData(reqTag);
-	if (tagData.isValid() && !tagData->versionMessages.empty() && tagData->versionMessages.back().first >= reqBegin) {
+	if (tagData.isValid() && tagData->hasMessages() && tagData->lastMessageVersion() >= reqBegin) {
 		return Void();
 	}
 	choose {
@@ -1672,12 +1998,51 @@ void peekMessagesFromMemory(Reference<LogData> self,
 	//TraceEvent("TLogPeekMem", self->dbgid).detail("Tag", req.tag1).detail("PDS", self->persistentDataSequence).detail("PDDS", self->persistentDataDurableSequence).detail("Oldest", map1.empty() ? 0 : map1.begin()->key ).detail("OldestMsgCount", map1.empty() ? 0 : map1.begin()->value.size());
 
 	begin = std::max(begin, self->persistentDataDurableVersion + 1);
-	auto it = std::lower_bound(deque.begin(),
-	                           deque.end(),
-	                           std::make_pair(begin, LengthPrefixedStringRef()),
-	                           [](const auto& l, const auto& r) -> bool { return l.first < r.first; });
 
+	// Compressed messages are older than those in the deque, so they are read first. Only the chunks with versions
+	// in the reply are decompressed.
 	Version currentVersion = -1;
+	bool reachedLimit = false;
+	auto tagData = self->getTagData(tag);
+	if (tagData) {
+		auto [c, i] = tagData->findCompressedMessages(begin);
+		for (; c < tagData->compressedMessages.size() && !reachedLimit; ++c, i = 0) {
+			const CompressedMessages& chunk = tagData->compressedMessages[c];
+			Arena arena;
+			StringRef uncompressed;
+			for (; i < chunk.size(); ++i) {
+				if (messages.getLength() >= SERVER_KNOBS->DESIRED_TOTAL_BYTES) {
+					endVersion = currentVersion + 1;
+					reachedLimit = true;
+					break;
+				}
+				if (!uncompressed.size()) {
+					uncompressed = chunk.decompress(self->messageCompression, arena);
+					self->compressedPeekBytes += uncompressed.size();
+				}
+
+				currentVersion = chunk.version(i);
+				messages << VERSION_HEADER << currentVersion;
+				// Each message is prefixed by its 4 byte length, as the StringRef serialization of the deque does
+				StringRef versionMessages = chunk.messages(uncompressed, i);
+				messages.serializeBytes(versionMessages);
+				while (versionMessages.size()) {
+					const uint32_t length = *(const uint32_t*)versionMessages.begin();
+					StringRef message = versionMessages.substr(0, sizeof(uint32_t) + length);
+					DEBUG_TAGS_AND_MESSAGE("TLogPeek", currentVersion, message, self->logId).detail("PeekTag", tag);
+					versionMessages = versionMessages.substr(message.size());
+					versionCount++;
+				}
+			}
+		}
+	}
+
+	auto it = reachedLimit ? deque.end()
+	                       : std::lower_bound(deque.begin(),
+	                                          deque.end(),
+	                                          std::make_pair(begin, LengthPrefixedStringRef()),
+	                                          [](const auto& l, const auto& r) -> bool { return l.first < r.first; });
+
 	for (; it != deque.end(); ++it) {
 		if (it->first != currentVersion) {
 			if (messages.getLength() >= SERVER_KNOBS->DESIRED_TOTAL_BYTES) {
@@ -1995,6 +2360,7 @@ Future<Void> tLogPeekMessages(PromiseType replyPromise,
 					messages << VERSION_HEADER << ver;
 					messages.serializeBytes(kv.value);
 				}
+				logData->spilledPeekBytes += kvs.expectedSize();
 
 				if (kvs.expectedSize() >= SERVER_KNOBS->DESIRED_TOTAL_BYTES) {
 					endVersion = decodeTagMessagesKey(kvs.end()[-1].key) + 1;
@@ -2012,7 +2378,9 @@ Future<Void> tLogPeekMessages(PromiseType replyPromise,
 
 				//TraceEvent("TLogPeekResults", self->dbgid).detail("ForAddress", replyPromise.getEndpoint().getPrimaryAddress()).detail("Tag1Results", s1).detail("Tag2Results", s2).detail("Tag1ResultsLim", kv1.size()).detail("Tag2ResultsLim", kv2.size()).detail("Tag1ResultsLast", kv1.size() ? kv1[0].key : "").detail("Tag2ResultsLast", kv2.size() ? kv2[0].key : "").detail("Limited", limited).detail("NextEpoch", next_pos.epoch).detail("NextSeq", next_pos.sequence).detail("NowEpoch", self->epoch()).detail("NowSeq", self->sequence.getNextSequence());
 
-				state std::vector<std::pair<IDiskQueue::location, IDiskQueue::location>> commitLocations;
+				// Versions whose queue entries are close together are read with one sequential read of the disk queue
+				// instead of one read each.
+				state std::vector<SpilledRead> spilledReads;
 				state bool earlyEnd = false;
 				uint32_t mutationBytes = 0;
 				state uint64_t commitBytes = 0;
@@ -2030,10 +2398,18 @@ Future<Void> tLogPeekMessages(PromiseType replyPromise,
 						if (sd.version >= reqBegin) {
 							firstVersion = std::min(firstVersion, sd.version);
 							const IDiskQueue::location end = sd.start.lo + sd.length;
-							commitLocations.emplace_back(sd.start, end);
 							// This isn't perfect, because we aren't accounting for page boundaries, but should be
 							// close enough.
-							commitBytes += sd.length;
+							if (!spilledReads.empty() && sd.start >= spilledReads.back().end &&
+							    sd.start.lo - spilledReads.back().end.lo <=
+							        SERVER_KNOBS->TLOG_SPILL_REFERENCE_READ_GAP_BYTES) {
+								commitBytes += end.lo - spilledReads.back().end.lo;
+								spilledReads.back().end = end;
+							} else {
+								commitBytes += sd.length;
+								spilledReads.emplace_back(sd.start, end);
+							}
+							spilledReads.back().versions.push_back(sd.version);
 							mutationBytes += sd.mutationBytes;
 						}
 					}
@@ -2044,42 +2420,60 @@ Future<Void> tLogPeekMessages(PromiseType replyPromise,
 				wait(self->peekMemoryLimiter.take(TaskPriority::TLogSpilledPeekReply, commitBytes));
 				state FlowLock::Releaser memoryReservation(self->peekMemoryLimiter, commitBytes);
 				state std::vector<Future<Standalone<StringRef>>> messageReads;
-				messageReads.reserve(commitLocations.size());
-				for (const auto& pair : commitLocations) {
-					messageReads.push_back(self->rawPersistentQueue->read(pair.first, pair.second, CheckHashes::True));
+				messageReads.reserve(spilledReads.size());
+				for (const auto& read : spilledReads) {
+					messageReads.push_back(self->rawPersistentQueue->read(read.start, read.end, CheckHashes::True));
 				}
-				commitLocations.clear();
+				logData->spilledPeekReads += spilledReads.size();
+				logData->spilledPeekBytesRead += commitBytes;
 				wait(waitForAll(messageReads));
 
 				state Version lastRefMessageVersion = 0;
 				state int index = 0;
+				state int messagesStart = messages.getLength();
 				loop {
 					if (index >= messageReads.size())
 						break;
-					Standalone<StringRef> queueEntryData = messageReads[index].get();
-					uint8_t valid;
-					const uint32_t length = *(uint32_t*)queueEntryData.begin();
-					queueEntryData = queueEntryData.substr(4, queueEntryData.size() - 4);
-					BinaryReader rd(queueEntryData, IncludeVersion());
-					state TLogQueueEntry entry;
-					rd >> entry >> valid;
-					ASSERT(valid == 0x01);
-					ASSERT(length + sizeof(valid) == queueEntryData.size());
-
-					messages << VERSION_HEADER << entry.version;
-
-					std::vector<StringRef> rawMessages =
-					    wait(parseMessagesForTag(entry.messages, reqTag, logData->logRouterTags));
-					for (const StringRef& msg : rawMessages) {
-						messages.serializeBytes(msg);
-						DEBUG_TAGS_AND_MESSAGE("TLogPeekFromDisk", entry.version, msg, logData->logId)
-						    .detail("DebugID", self->dbgid)
-						    .detail("PeekTag", reqTag);
-					}
+					state StringRef queueEntries = messageReads[index].get();
+					state int versionIndex = 0;
+					// The queue entries are framed as in TLogQueue::push(). Entries of other versions, of other
+					// generations, or left invalid by a partial commit are skipped.
+					loop {
+						if (versionIndex >= spilledReads[index].versions.size())
+							break;
+						ASSERT(queueEntries.size() >= sizeof(uint32_t));
+						const uint32_t length = *(uint32_t*)queueEntries.begin();
+						ASSERT(queueEntries.size() >= sizeof(uint32_t) + length + 1);
+						StringRef queueEntryData = queueEntries.substr(sizeof(uint32_t), length);
+						const uint8_t valid = queueEntries[sizeof(uint32_t) + length];
+						queueEntries = queueEntries.substr(sizeof(uint32_t) + length + 1);
+						if (valid != 0x01) {
+							continue;
+						}
+						BinaryReader rd(queueEntryData, IncludeVersion());
+						state TLogQueueEntry entry;
+						rd >> entry;
+						if (entry.id != logData->logId || entry.version != spilledReads[index].versions[versionIndex]) {
+							continue;
+						}
+
+						messages << VERSION_HEADER << entry.version;
+
+						std::vector<StringRef> rawMessages =
+						    wait(parseMessagesForTag(entry.messages, reqTag, logData->logRouterTags));
+						for (const StringRef& msg : rawMessages) {
+							messages.serializeBytes(msg);
+							DEBUG_TAGS_AND_MESSAGE("TLogPeekFromDisk", entry.version, msg, logData->logId)
+							    .detail("DebugID", self->dbgid)
+							    .detail("PeekTag", reqTag);
+						}
 
-					lastRefMessageVersion = entry.version;
+						lastRefMessageVersion = entry.version;
+						versionIndex++;
+					}
 					index++;
 				}
+				logData->spilledPeekBytes += messages.getLength() - messagesStart;
 
 				messageReads.clear();
 				memoryReservation.release();
@@ -3131,6 +3525,9 @@ ACTOR Future<Void> tLogCore(TLogData* self,
 	logData->addActor.send(serveTLogInterface(self, tli, logData, warningCollectorInput));
 	logData->addActor.send(cleanupPeekTrackers(logData.getPtr()));
 	logData->addActor.send(logPeekTrackers(logData.getPtr()));
+	if (SERVER_KNOBS->TLOG_COMPRESS_MESSAGES) {
+		logData->addActor.send(compressMessages(self, logData));
+	}
 
 	if (!logData->isPrimary) {
 		std::vector<Tag> tags;
@@ -3941,3 +4338,113 @@ TEST_CASE("Lfdbserver/tlogserver/VersionMessagesOverheadFactor") {
 
 	return Void();
 }
+
+namespace {
+
+// The i-th message of version v, for testing TagData
+LengthPrefixedStringRef testTagMessage(Arena& arena, Version v, int i) {
+	const std::string message = fmt::format("message {} of version {}", i, v);
+	uint32_t* length = new (arena) uint32_t[1 + (message.size() + sizeof(uint32_t) - 1) / sizeof(uint32_t)];
+	*length = message.size();
+	memcpy(length + 1, message.data(), message.size());
+	return LengthPrefixedStringRef(length);
+}
+
+void addTestTagMessages(Arena& arena, LogData::TagData& tagData, Version begin, Version end) {
+	for (Version v = begin; v < end; v++) {
+		tagData.versionMessages.emplace_back(v, testTagMessage(arena, v, 0));
+		tagData.versionMessages.emplace_back(v, testTagMessage(arena, v, 1));
+	}
+}
+
+// Like TagData::compressMessages, without compressing, and in a single chunk
+void compressTestTagMessages(LogData::TagData& tagData, Version through) {
+	CompressedMessages chunk(tagData.versionMessages.front().first);
+	Standalone<VectorRef<uint8_t>> buffer;
+	while (!tagData.versionMessages.empty() && tagData.versionMessages.front().first <= through) {
+		const Version version = tagData.versionMessages.front().first;
+		CompressedMessages::VersionEntry entry;
+		entry.versionOffset = version - chunk.firstVersion;
+		entry.offset = buffer.size();
+		entry.bytes = 0;
+		for (; !tagData.versionMessages.empty() && tagData.versionMessages.front().first == version;
+		     tagData.versionMessages.pop_front()) {
+			const LengthPrefixedStringRef m = tagData.versionMessages.front().second;
+			buffer.append(buffer.arena(), (const uint8_t*)m.getLengthPtr(), sizeof(uint32_t) + m.expectedSize());
+			entry.bytes += m.expectedSize();
+		}
+		chunk.versions.push_back(entry);
+	}
+	chunk.data = Standalone<StringRef>(StringRef(buffer.begin(), buffer.size()), buffer.arena());
+	chunk.uncompressedBytes = buffer.size();
+	tagData.compressedMessages.push_back(std::move(chunk));
+}
+
+} // namespace
+
+TEST_CASE("/fdbserver/tlogserver/spillMessages") {
+	// Versions 1 to 10 and 11 to 20 are in compressed chunks and 21 to 40 in versionMessages. Spilling through 35 stops
+	// at 5 and at 25, while more versions arrive and the spilled ones are erased from versionMessages.
+	state Arena arena;
+	state int pass = 0;
+	state bool byValue = false;
+	state Promise<Void> resume;
+	state std::vector<Version> spilled;
+	state std::vector<Standalone<StringRef>> spilledMessages;
+	for (pass = 0; pass < 2; pass++) {
+		byValue = pass == 1;
+		state Reference<LogData::TagData> tagData =
+		    makeReference<LogData::TagData>(Tag(0, 0), 0, 0, false, false, false);
+		addTestTagMessages(arena, *tagData, 1, 41);
+		compressTestTagMessages(*tagData, 10);
+		compressTestTagMessages(*tagData, 20);
+		spilled.clear();
+		spilledMessages.clear();
+
+		state Future<Void> spilling = tagData->spillMessages(
+		    35,
+		    byValue,
+		    CompressionFilter::NONE,
+		    [&](Version version, StringRef messages, uint32_t bytes) -> Future<Void> {
+			    spilled.push_back(version);
+			    spilledMessages.push_back(messages);
+			    Arena expectedArena;
+			    ASSERT_EQ(bytes,
+			              testTagMessage(expectedArena, version, 0).expectedSize() +
+			                  testTagMessage(expectedArena, version, 1).expectedSize());
+			    return version == 5 || version == 25 ? resume.getFuture() : Future<Void>(Void());
+		    });
+		ASSERT(!spilling.isReady());
+		ASSERT_EQ(spilled.back(), 5);
+		// Enough new versions that versionMessages reallocates its map of blocks
+		addTestTagMessages(arena, *tagData, 41, 10000);
+		Promise<Void> resumed = resume;
+		resume = Promise<Void>();
+		resumed.send(Void());
+
+		ASSERT(!spilling.isReady());
+		ASSERT_EQ(spilled.back(), 25);
+		while (tagData->versionMessages.front().first <= 25) {
+			tagData->versionMessages.pop_front();
+		}
+		addTestTagMessages(arena, *tagData, 10000, 20000);
+		resumed = resume;
+		resume = Promise<Void>();
+		resumed.send(Void());
+		wait(spilling);
+
+		ASSERT_EQ(spilled.size(), 35);
+		for (int i = 0; i < spilled.size(); i++) {
+			ASSERT_EQ(spilled[i], i + 1);
+			if (byValue) {
+				BinaryWriter wr(Unversioned());
+				wr << testTagMessage(arena, spilled[i], 0).toStringRef();
+				wr << testTagMessage(arena, spilled[i], 1).toStringRef();
+				ASSERT(spilledMessages[i] == wr.toValue());
+			} else {
+				ASSERT(spilledMessages[i].empty());
+			}
+		}
+	}
+	return Void();
+}
@@ -40,15 +40,18 @@
 #include "flow/Histogram.h"
 #include "flow/IAsyncFile.h"
 #include "flow/IRandom.h"
+#include "flow/IThreadPool.h"
 #include "flow/Knobs.h"
 #include "flow/ObjectSerializer.h"
 #include "flow/PriorityMultiLock.actor.h"
+#include "flow/ScopeExit.h"
 #include "flow/network.h"
 #include "flow/serialize.h"
 #include "flow/Trace.h"
 #include "flow/UnitTest.h"
 #include "fmt/format.h"
 
+#include <atomic>
 #include <boost/intrusive/list.hpp>
 #include <cinttypes>
 #include <limits>
@@ -1372,6 +1375,15 @@ struct RedwoodMetrics {
 			return eventReasons[(size_t)event][(size_t)reason];
 		}
 
+		// Fraction of the cache lookups for reason that were hits, if there were any
+		Optional<double> getHitRate(PagerEventReasons reason) const {
+			unsigned int lookups = getEventReason(PagerEvents::CacheLookup, reason);
+			if (lookups == 0) {
+				return {};
+			}
+			return (double)getEventReason(PagerEvents::CacheHit, reason) / lookups;
+		}
+
 		std::string toString(unsigned int level, double elapsed) const {
 			std::string result;
 
@@ -1393,6 +1405,16 @@ struct RedwoodMetrics {
 				prevEvent = p.first;
 			}
 
+			result += "\n";
+			result += lineStart;
+			for (const auto& p : pairs) {
+				Optional<double> hitRate;
+				if (p.first == PagerEvents::CacheLookup && (hitRate = getHitRate(p.second)).present()) {
+					std::string name = format("HitRate%s", PagerEventReasonsStrings[(int)p.second]);
+					result += format("%-15s %8.3f            ", name.c_str(), hitRate.get());
+				}
+			}
+
 			return result;
 		}
 
@@ -1404,6 +1426,13 @@ struct RedwoodMetrics {
 				    format("%s%s", PagerEventsStrings[(int)p.first], PagerEventReasonsStrings[(int)p.second]);
 				int count = getEventReason(p.first, p.second);
 				t->detail(std::move(name), count);
+
+				Optional<double> hitRate;
+				if (p.first == PagerEvents::CacheLookup && (hitRate = getHitRate(p.second)).present()) {
+					t->detail(format(level == 0 ? "" : "L%d", level) +
+					              format("HitRate%s", PagerEventReasonsStrings[(int)p.second]),
+					          hitRate.get());
+				}
 			}
 		}
 	};
@@ -1459,9 +1488,16 @@ struct RedwoodMetrics {
 		unsigned int pagerProbeMiss;
 		unsigned int pagerEvictUnhit;
 		unsigned int pagerEvictFail;
+		unsigned int pagerPrefetchHit;
+		unsigned int pagerPrefetchWaste;
 		unsigned int btreeLeafPreload;
 		unsigned int btreeLeafPreloadExt;
 		unsigned int readRequestDecryptTimeNS;
+		unsigned int commitUpdateTimeUS;
+		unsigned int commitLazyClearTimeUS;
+		unsigned int commitPagerTimeUS;
+		unsigned int pageBuildTimeUS;
+		unsigned int pageEncodeTimeUS;
 	};
 
 	RedwoodMetrics() {
@@ -1636,13 +1672,16 @@ class ObjectCache : NonCopyable {
 	typedef std::unordered_map<IndexType, Entry> CacheT;
 
 	struct Entry : public boost::intrusive::list_base_hook<> {
-		Entry() : hits(0), size(0) {}
+		Entry() : hits(0), size(0), freq(0), inMain(false) {}
 		IndexType index;
 		ObjectType item;
 		int hits;
 		int size;
 		bool ownedByEvictor;
 		CacheT* pCache;
+		// Accesses counted by the S3-FIFO policy, and whether the entry is in its main queue
+		int freq;
+		bool inMain;
 	};
 
 	typedef boost::intrusive::list<Entry> EvictionOrderT;
@@ -1652,9 +1691,18 @@ public:
 	// Not all objects tracked by the Evictor are in its evictionOrder, as ObjectCaches
 	// using this Evictor can temporarily remove entries to an external order but they
 	// must eventually give them back with moveIn() or remove them with reclaim().
+	//
+	// The eviction order is LRU, or if REDWOOD_PAGE_CACHE_S3FIFO is set, S3-FIFO. S3-FIFO admits new entries to a
+	// small FIFO queue, evictionOrder, which holds a fraction of the cache. Entries that are accessed again before they
+	// reach its head move to a main FIFO queue, where they are reinserted at the tail while they keep being accessed.
+	// Entries read once, such as the pages of a large scan, are evicted from the small queue without displacing the
+	// frequently read pages in the main queue. Keys recently evicted from the small queue are remembered in a ghost
+	// queue so that they go straight to the main queue if they are soon read again.
 	class Evictor : NonCopyable {
 	public:
-		Evictor(int64_t sizeLimit = 0) : sizeLimit(sizeLimit) {}
+		Evictor(int64_t sizeLimit = 0)
+		  : sizeLimit(sizeLimit), s3fifo(SERVER_KNOBS->REDWOOD_PAGE_CACHE_S3FIFO),
+		    smallQueueFraction(SERVER_KNOBS->REDWOOD_PAGE_CACHE_S3FIFO_SMALL_FRACTION) {}
 
 		// Evictors are normally singletons, either one per real process or one per virtual process in simulation
 		static Evictor* getEvictor() {
@@ -1672,15 +1720,24 @@ public:
 		// but the entry size is still counted against the evictor
 		void moveOut(Entry& e, EvictionOrderT& dest) {
 			ASSERT(e.ownedByEvictor);
-			dest.splice(dest.end(), evictionOrder, EvictionOrderT::s_iterator_to(e));
+			dest.splice(dest.end(), queueOf(e), EvictionOrderT::s_iterator_to(e));
+			if (!e.inMain) {
+				smallSizeUsed -= e.size;
+			}
+			e.inMain = false;
 			e.ownedByEvictor = false;
 			++movedOutCount;
 		}
 
-		// Move an entry to the back of the eviction order if it is in the eviction order
-		void moveToBack(Entry& e) {
+		// Record an access to an entry in the eviction order. Under LRU it moves to the back of the eviction order,
+		// under S3-FIFO its access count goes up.
+		void recordHit(Entry& e) {
 			ASSERT(e.ownedByEvictor);
-			evictionOrder.splice(evictionOrder.end(), evictionOrder, EvictionOrderT::s_iterator_to(e));
+			if (s3fifo) {
+				e.freq = std::min(e.freq + 1, maxFreq);
+			} else {
+				evictionOrder.splice(evictionOrder.end(), evictionOrder, EvictionOrderT::s_iterator_to(e));
+			}
 		}
 
 		// Move entire contents of an external eviction order containing entries whose size is part of
@@ -1690,15 +1747,26 @@ public:
 				ASSERT(!e.ownedByEvictor);
 				e.ownedByEvictor = true;
 				--movedOutCount;
+				// Under S3-FIFO the entries must leave the small queue rather than move to the main queue
+				e.freq = 0;
+				smallSizeUsed += e.size;
 			}
 			evictionOrder.splice(evictionOrder.begin(), otherOrder);
 		}
 
-		// Add a new item to the back of the eviction order
-		void addNew(Entry& e) {
+		// Add a new item to the back of the eviction order. If hit is false then the next access to the item
+		// is not counted by S3-FIFO, as the item is being added ahead of its first real use.
+		void addNew(Entry& e, bool hit) {
 			sizeUsed += e.size;
-			evictionOrder.push_back(e);
 			e.ownedByEvictor = true;
+			e.freq = hit ? 0 : -1;
+			e.inMain = s3fifo && ghosts.contains(ghostKey(e));
+			if (e.inMain) {
+				mainOrder.push_back(e);
+			} else {
+				evictionOrder.push_back(e);
+				smallSizeUsed += e.size;
+			}
 		}
 
 		// Claim ownership of an entry, removing its size from the current size and removing it
@@ -1707,7 +1775,11 @@ public:
 			sizeUsed -= e.size;
 			// If e is in evictionOrder then remove it
 			if (e.ownedByEvictor) {
-				evictionOrder.erase(EvictionOrderT::s_iterator_to(e));
+				queueOf(e).erase(EvictionOrderT::s_iterator_to(e));
+				if (!e.inMain) {
+					smallSizeUsed -= e.size;
+				}
+				e.inMain = false;
 				e.ownedByEvictor = false;
 			} else {
 				// Otherwise, it wasn't so it had to be a movedOut item so decrement the count
@@ -1715,12 +1787,46 @@ public:
 			}
 		}
 
+		// Under S3-FIFO, choose the queue to evict from and move entries at its head which have been accessed to
+		// their next queue until the head of the chosen queue can be evicted. Returns the queue or nullptr if both
+		// queues are empty.
+		EvictionOrderT* s3fifoVictimQueue() {
+			while (true) {
+				bool fromSmall =
+				    !evictionOrder.empty() &&
+				    (mainOrder.empty() || smallSizeUsed >= (sizeLimit - reservedSize) * smallQueueFraction);
+				if (fromSmall) {
+					Entry& e = evictionOrder.front();
+					if (e.freq <= 0) {
+						return &evictionOrder;
+					}
+					// Accessed while in the small queue, so promote it
+					mainOrder.splice(mainOrder.end(), evictionOrder, EvictionOrderT::s_iterator_to(e));
+					smallSizeUsed -= e.size;
+					e.inMain = true;
+					e.freq = 0;
+				} else if (!mainOrder.empty()) {
+					Entry& e = mainOrder.front();
+					if (e.freq <= 0) {
+						return &mainOrder;
+					}
+					mainOrder.splice(mainOrder.end(), mainOrder, EvictionOrderT::s_iterator_to(e));
+					--e.freq;
+				} else {
+					return nullptr;
+				}
+			}
+		}
+
 		void trim(int additionalSpaceNeeded = 0) {
 			int attemptsLeft = FLOW_KNOBS->MAX_EVICT_ATTEMPTS;
 			// While the cache is too big, evict the oldest entry until the oldest entry can't be evicted.
-			while (attemptsLeft-- > 0 && sizeUsed > (sizeLimit - reservedSize - additionalSpaceNeeded) &&
-			       !evictionOrder.empty()) {
-				Entry& toEvict = evictionOrder.front();
+			while (attemptsLeft-- > 0 && sizeUsed > (sizeLimit - reservedSize - additionalSpaceNeeded)) {
+				EvictionOrderT* queue = s3fifo ? s3fifoVictimQueue() : &evictionOrder;
+				if (queue == nullptr || queue->empty()) {
+					break;
+				}
+				Entry& toEvict = queue->front();
 
 				debug_printf("Evictor count=%d sizeUsed=%" PRId64 " sizeLimit=%" PRId64 " sizePenalty=%" PRId64
 				             " needed=%d  Trying to evict %s evictable %d\n",
@@ -1734,22 +1840,31 @@ public:
 
 				if (!toEvict.item.evictable()) {
 					// shift the front to the back
-					evictionOrder.shift_forward(1);
+					queue->shift_forward(1);
 					++g_redwoodMetrics.metric.pagerEvictFail;
 					break;
 				} else {
 					if (toEvict.hits == 0) {
 						++g_redwoodMetrics.metric.pagerEvictUnhit;
 					}
+					if (toEvict.item.prefetched) {
+						++g_redwoodMetrics.metric.pagerPrefetchWaste;
+					}
 					sizeUsed -= toEvict.size;
 					debug_printf("Evicting %s\n", ::toString(toEvict.index).c_str());
-					evictionOrder.pop_front();
+					if (!toEvict.inMain) {
+						smallSizeUsed -= toEvict.size;
+						if (s3fifo) {
+							addGhost(ghostKey(toEvict));
+						}
+					}
+					queue->pop_front();
 					toEvict.pCache->erase(toEvict.index);
 				}
 			}
 		}
 
-		int64_t getCountUsed() const { return evictionOrder.size() + movedOutCount; }
+		int64_t getCountUsed() const { return evictionOrder.size() + mainOrder.size() + movedOutCount; }
 		int64_t getCountMoved() const { return movedOutCount; }
 		int64_t getSizeUsed() const { return sizeUsed + reservedSize; }
 
@@ -1764,11 +1879,15 @@ public:
 			                       getCountUsed(),
 			                       reservedSize,
 			                       movedOutCount);
-			for (auto& entry : evictionOrder) {
-				s += format("\n\tindex %s  size %d  evictable %d\n",
-				            ::toString(entry.index).c_str(),
-				            entry.size,
-				            entry.item.evictable());
+			for (auto* order : { &evictionOrder, &mainOrder }) {
+				for (auto& entry : *order) {
+					s += format("\n\tindex %s  size %d  evictable %d  main %d  freq %d\n",
+					            ::toString(entry.index).c_str(),
+					            entry.size,
+					            entry.item.evictable(),
+					            entry.inMain,
+					            entry.freq);
+				}
 			}
 			s += "}\n";
 			return s;
@@ -1780,7 +1899,41 @@ public:
 		int64_t sizeLimit;
 
 	private:
+		constexpr static int maxFreq = 3;
+
+		EvictionOrderT& queueOf(Entry& e) { return e.inMain ? mainOrder : evictionOrder; }
+
+		// Ghost entries only need to tell keys apart with high probability, so they store a hash of the cache
+		// and index of the evicted entry.
+		static size_t ghostKey(const Entry& e) {
+			return std::hash<IndexType>()(e.index) ^ (std::hash<const void*>()(e.pCache) * 0x9e3779b97f4a7c15ULL);
+		}
+
+		// Remember an evicted key, forgetting the oldest ones once there are as many as cached entries
+		void addGhost(size_t key) {
+			ghostOrder.push_back(key);
+			++ghosts[key];
+			while ((int64_t)ghostOrder.size() > std::max<int64_t>(1, evictionOrder.size() + mainOrder.size())) {
+				auto i = ghosts.find(ghostOrder.front());
+				if (--i->second == 0) {
+					ghosts.erase(i);
+				}
+				ghostOrder.pop_front();
+			}
+		}
+
+		bool s3fifo;
+		double smallQueueFraction;
+
+		// The LRU eviction order, or the small FIFO queue under S3-FIFO
 		EvictionOrderT evictionOrder;
+		// The main FIFO queue under S3-FIFO
+		EvictionOrderT mainOrder;
+		// Size of the entries in evictionOrder under S3-FIFO
+		int64_t smallSizeUsed = 0;
+		// Keys recently evicted from the small queue, in eviction order and by number of occurrences
+		std::deque<size_t> ghostOrder;
+		std::unordered_map<size_t, int> ghosts;
 		// Size of all entries in the eviction order or held in external eviction orders
 		int64_t sizeUsed = 0;
 		// Number of items that have been moveOut()'d to other evictionOrders and aren't back yet
@@ -1830,9 +1983,9 @@ public:
 			// If this access is meant to be a hit
 			if (!noHit) {
 				++entry.hits;
-				// If item eviction is not prioritized, move to end of eviction order
+				// If item eviction is not prioritized, record the hit in the eviction order
 				if (entry.ownedByEvictor) {
-					pEvictor->moveToBack(entry);
+					pEvictor->recordHit(entry);
 				}
 			}
 		} else {
@@ -1845,7 +1998,7 @@ public:
 			entry.size = size;
 
 			pEvictor->trim(entry.size);
-			pEvictor->addNew(entry);
+			pEvictor->addNew(entry, !noHit);
 		}
 
 		return entry.item;
@@ -1898,6 +2051,66 @@ Future<T> forwardError(Future<T> f, Promise<Void> target) {
 
 constexpr int initialVersion = invalidVersion;
 
+// A BTree page being checksummed and possibly encrypted by ArenaPage::preWrite() on one of DWALPager's encodeThreads.
+// The page is kept alive by the writer on the network thread, as its reference count must not be touched here.
+struct PageEncodeTask : ThreadSafeReferenceCounted<PageEncodeTask> {
+	enum { Pending, Running, Done, Cancelled };
+
+	ArenaPage* page;
+	PhysicalPageID pageID;
+	double encodeTime = 0;
+	std::atomic<int> state = Pending;
+
+	PageEncodeTask(ArenaPage* page, PhysicalPageID pageID) : page(page), pageID(pageID) {}
+
+	// Must be called by a writer that stops waiting for the task. The encode is skipped if it has not started.
+	// Returns true if it is running, in which case the writer must keep the page until the task's result arrives.
+	bool cancel() {
+		int expected = Pending;
+		return !state.compare_exchange_strong(expected, Cancelled) && expected == Running;
+	}
+};
+
+// Keeps the page of a cancelled PageEncodeTask alive until the encode thread is done with it
+ACTOR void releaseAfterEncoded(Future<Void> encoded, Reference<ArenaPage> page) {
+	wait(ready(encoded));
+}
+
+struct PageEncoder final : IThreadPoolReceiver {
+	void init() override {}
+
+	struct EncodeAction final : TypedAction<PageEncoder, EncodeAction> {
+		Reference<PageEncodeTask> task;
+		ThreadReturnPromise<Void> result;
+
+		explicit EncodeAction(Reference<PageEncodeTask> task) : task(task) {}
+
+		double getTimeEstimate() const override { return 0; }
+	};
+
+	void action(EncodeAction& a) {
+		int expected = PageEncodeTask::Pending;
+		if (!a.task->state.compare_exchange_strong(expected, PageEncodeTask::Running)) {
+			// The writer was cancelled and the page may already be gone
+			return;
+		}
+		Optional<Error> error;
+		double start = timer_monotonic();
+		try {
+			a.task->page->preWrite(a.task->pageID);
+		} catch (Error& e) {
+			error = e;
+		}
+		a.task->encodeTime = timer_monotonic() - start;
+		a.task->state.store(PageEncodeTask::Done);
+		if (error.present()) {
+			a.result.sendError(error.get());
+		} else {
+			a.result.send(Void());
+		}
+	}
+};
+
 class DWALPagerSnapshot;
 
 // An implementation of IPager2 that supports atomicUpdate() of a page without forcing a change to new page ID.
@@ -1917,6 +2130,8 @@ public:
 	struct PageCacheEntry {
 		Future<Reference<ArenaPage>> readFuture;
 		Future<Void> writeFuture;
+		// Whether the page was read into the cache by a prefetch and has not been read since
+		bool prefetched = false;
 
 		bool initialized() const { return readFuture.isValid(); }
 
@@ -2034,6 +2249,19 @@ public:
 			g_redwoodMetricsActor = redwoodMetricsLogger();
 		}
 
+		if (SERVER_KNOBS->REDWOOD_PAGE_ENCODE_THREADS > 0) {
+			// Encode inline in simulation to stay deterministic
+			if (g_network->isSimulated()) {
+				encodeThreads = Reference<IThreadPool>(new DummyThreadPool());
+				encodeThreads->addThread(new PageEncoder());
+			} else {
+				encodeThreads = createGenericThreadPool();
+				for (int i = 0; i < SERVER_KNOBS->REDWOOD_PAGE_ENCODE_THREADS; ++i) {
+					encodeThreads->addThread(new PageEncoder(), "fdb-redwood-enc");
+				}
+			}
+		}
+
 		commitFuture = Void();
 		recoverFuture = forwardError(recover(this), errorPromise);
 	}
@@ -2582,7 +2810,17 @@ public:
 			page = page->clone();
 		}
 
+		// BTree pages are not modified once written, so they can be encoded on another thread. preWrite() of an
+		// unencrypted page only writes its headers, which readers of the cached page do not use.
+		if (encodeThreads && level != nonBtreeLevel && !header) {
+			Future<Void> f = encodeAndWritePhysicalPage(this, reason, level, pageIDs, page);
+			operations.push_back(f);
+			return f;
+		}
+
+		double encodeStart = timer_monotonic();
 		page->preWrite(pageIDs.front());
+		g_redwoodMetrics.metric.pageEncodeTimeUS += int64_t((timer_monotonic() - encodeStart) * 1e6);
 
 		int blockSize = header ? smallestPhysicalBlock : physicalPageSize;
 		Future<Void> f;
@@ -2601,6 +2839,36 @@ public:
 		return f;
 	}
 
+	// Encodes page on encodeThreads and then writes it
+	ACTOR static Future<Void> encodeAndWritePhysicalPage(DWALPager* self,
+	                                                     PagerEventReasons reason,
+	                                                     unsigned int level,
+	                                                     Standalone<VectorRef<PhysicalPageID>> pageIDs,
+	                                                     Reference<ArenaPage> page) {
+		state Reference<PageEncodeTask> task = makeReference<PageEncodeTask>(page.getPtr(), pageIDs.front());
+		state PageEncoder::EncodeAction* action = new PageEncoder::EncodeAction(task);
+		state Future<Void> encoded = action->result.getFuture();
+		self->encodeThreads->post(action);
+
+		try {
+			wait(encoded);
+		} catch (Error& e) {
+			if (task->cancel()) {
+				releaseAfterEncoded(encoded, page);
+			}
+			throw;
+		}
+		g_redwoodMetrics.metric.pageEncodeTimeUS += int64_t(task->encodeTime * 1e6);
+
+		std::vector<Future<Void>> writers;
+		for (int i = 0; i < pageIDs.size(); ++i) {
+			writers.push_back(
+			    writePhysicalBlock(self, page, i, self->physicalPageSize, pageIDs[i], reason, level, false));
+		}
+		wait(waitForAll(writers));
+		return Void();
+	}
+
 	Future<Void> writeHeaderPage(PhysicalPageID pageID, Reference<ArenaPage> page) {
 		return writePhysicalPage(
 		    PagerEventReasons::MetaData, nonBtreeLevel, VectorRef<PhysicalPageID>(&pageID, 1), page, true);
@@ -2651,6 +2919,7 @@ public:
 
 		// Always update the page contents immediately regardless of what happened above.
 		cacheEntry.readFuture = data;
+		cacheEntry.prefetched = false;
 	}
 
 	Future<LogicalPageID> atomicUpdatePage(PagerEventReasons reason,
@@ -3003,12 +3272,17 @@ public:
 			debug_printf("DWALPager(%s) issuing actual read of %s\n", filename.c_str(), toString(pageID).c_str());
 			cacheEntry.readFuture = forwardError(readPhysicalPage(this, pageID, priority, false, reason), errorPromise);
 			cacheEntry.writeFuture = Void();
+			cacheEntry.prefetched = reason == PagerEventReasons::RangePrefetch;
 
 			++g_redwoodMetrics.metric.pagerCacheMiss;
 			eventReasons.addEventReason(PagerEvents::CacheMiss, reason);
 		} else {
 			++g_redwoodMetrics.metric.pagerCacheHit;
 			eventReasons.addEventReason(PagerEvents::CacheHit, reason);
+			if (cacheEntry.prefetched && !noHit) {
+				++g_redwoodMetrics.metric.pagerPrefetchHit;
+				cacheEntry.prefetched = false;
+			}
 		}
 		return cacheEntry.readFuture;
 	}
@@ -3053,12 +3327,17 @@ public:
 			debug_printf("DWALPager(%s) issuing actual read of %s\n", filename.c_str(), toString(pageIDs).c_str());
 			cacheEntry.readFuture = forwardError(readPhysicalMultiPage(this, pageIDs, priority, reason), errorPromise);
 			cacheEntry.writeFuture = Void();
+			cacheEntry.prefetched = reason == PagerEventReasons::RangePrefetch;
 
 			++g_redwoodMetrics.metric.pagerCacheMiss;
 			eventReasons.addEventReason(PagerEvents::CacheMiss, reason);
 		} else {
 			++g_redwoodMetrics.metric.pagerCacheHit;
 			eventReasons.addEventReason(PagerEvents::CacheHit, reason);
+			if (cacheEntry.prefetched && !noHit) {
+				++g_redwoodMetrics.metric.pagerPrefetchHit;
+				cacheEntry.prefetched = false;
+			}
 		}
 		return cacheEntry.readFuture;
 	}
@@ -3666,6 +3945,11 @@ public:
 		}
 		self->operations.clear();
 
+		if (self->encodeThreads) {
+			debug_printf("DWALPager(%s) shutdown stop encode threads\n", self->filename.c_str());
+			wait(self->encodeThreads->stop());
+		}
+
 		debug_printf("DWALPager(%s) shutdown cancel queues\n", self->filename.c_str());
 		self->freeList.cancel();
 		self->delayedFreeList.cancel();
@@ -3884,6 +4168,9 @@ private:
 
 	Reference<PriorityMultiLock> ioLock;
 
+	// Encodes BTree pages for writing if REDWOOD_PAGE_ENCODE_THREADS is set
+	Reference<IThreadPool> encodeThreads;
+
 	int64_t pageCacheBytes;
 
 	// The header will be written to / read from disk as a smallestPhysicalBlock sized chunk.
@@ -4681,6 +4968,134 @@ struct BTreePage {
 	}
 };
 
+// An uncompressed, columnar image of the records of a leaf page. It is built from the page's DeltaTree2 the first time
+// the page is range read and is then kept with the page in ArenaPage::extra, so that range reads scan contiguous
+// arrays instead of decoding the tree one node at a time.
+//
+// Key bytes and value bytes are stored back to back in two heaps with offset arrays into them. All keys of the page
+// share the prefix common to its first and last keys, so seeks first compare the 8 bytes of each key after that
+// prefix, which are kept big endian in the heads column, and only compare whole keys where heads are equal.
+struct LeafColumns : ReferenceCounted<LeafColumns>, FastAllocated<LeafColumns> {
+	Arena arena;
+	int count = 0;
+	int prefixLen = 0;
+	std::vector<uint64_t> heads;
+	// count + 1 offsets into keyHeap and valueHeap
+	std::vector<uint32_t> keyOffsets;
+	std::vector<uint32_t> valueOffsets;
+	uint8_t* keyHeap = nullptr;
+	uint8_t* valueHeap = nullptr;
+
+	int64_t* pMemoryTracker = nullptr;
+	int usedMemory = 0;
+
+	~LeafColumns() {
+		if (pMemoryTracker != nullptr) {
+			*pMemoryTracker -= usedMemory;
+		}
+	}
+
+	KeyRef key(int i) const { return KeyRef(keyHeap + keyOffsets[i], keyOffsets[i + 1] - keyOffsets[i]); }
+	ValueRef value(int i) const { return ValueRef(valueHeap + valueOffsets[i], valueOffsets[i + 1] - valueOffsets[i]); }
+	KeyValueRef keyValue(int i) const { return KeyValueRef(key(i), value(i)); }
+
+	// The 8 bytes of key after skip as a big endian integer, zero padded, so that heads are in the same order as keys
+	// which share their first skip bytes, except that different keys can have equal heads
+	static uint64_t head(KeyRef key, int skip) {
+		uint64_t h = 0;
+		int n = std::min(8, key.size() - skip);
+		for (int i = 0; i < n; ++i) {
+			h |= (uint64_t)key[skip + i] << (56 - 8 * i);
+		}
+		return h;
+	}
+
+	// Index of the first record whose key is >= k, or count if there is none
+	int lowerBound(KeyRef k) const {
+		if (count == 0) {
+			return 0;
+		}
+		KeyRef prefix = key(0).substr(0, prefixLen);
+		if (!k.startsWith(prefix)) {
+			return k < prefix ? 0 : count;
+		}
+
+		uint64_t h = head(k, prefixLen);
+		int lo = 0;
+		int hi = count;
+		while (hi - lo > 16) {
+			int mid = (lo + hi) / 2;
+			if (heads[mid] < h) {
+				lo = mid + 1;
+			} else {
+				hi = mid;
+			}
+		}
+		// Count the remaining smaller heads without branching, which the compiler can vectorize
+		int smaller = 0;
+		for (int i = lo; i < hi; ++i) {
+			smaller += heads[i] < h;
+		}
+		lo += smaller;
+
+		while (lo < count && heads[lo] == h && key(lo) < k) {
+			++lo;
+		}
+		return lo;
+	}
+
+	static Reference<LeafColumns> build(DeltaTree2<RedwoodRecordRef>::Cursor c, int64_t* pMemoryTracker) {
+		auto r = makeReference<LeafColumns>();
+		std::vector<RedwoodRecordRef> records;
+		records.reserve(c.tree->numItems);
+		int keyBytes = 0;
+		int valueBytes = 0;
+		if (c.moveFirst()) {
+			do {
+				const RedwoodRecordRef& rec = c.get();
+				records.push_back(rec);
+				keyBytes += rec.key.size();
+				valueBytes += rec.value.present() ? rec.value.get().size() : 0;
+			} while (c.moveNext());
+		}
+
+		r->count = records.size();
+		if (r->count > 0) {
+			r->prefixLen = commonPrefixLength(records.front().key, records.back().key);
+		}
+		r->heads.reserve(r->count);
+		r->keyOffsets.reserve(r->count + 1);
+		r->valueOffsets.reserve(r->count + 1);
+		r->keyHeap = new (r->arena) uint8_t[keyBytes];
+		r->valueHeap = new (r->arena) uint8_t[valueBytes];
+
+		uint32_t keyOffset = 0;
+		uint32_t valueOffset = 0;
+		for (const RedwoodRecordRef& rec : records) {
+			r->heads.push_back(head(rec.key, r->prefixLen));
+			r->keyOffsets.push_back(keyOffset);
+			r->valueOffsets.push_back(valueOffset);
+			memcpy(r->keyHeap + keyOffset, rec.key.begin(), rec.key.size());
+			keyOffset += rec.key.size();
+			if (rec.value.present()) {
+				memcpy(r->valueHeap + valueOffset, rec.value.get().begin(), rec.value.get().size());
+				valueOffset += rec.value.get().size();
+			}
+		}
+		r->keyOffsets.push_back(keyOffset);
+		r->valueOffsets.push_back(valueOffset);
+
+		r->pMemoryTracker = pMemoryTracker;
+		r->usedMemory = sizeof(LeafColumns) + r->arena.getSize(FastInaccurateEstimate::True) +
+		                r->heads.capacity() * sizeof(uint64_t) +
+		                (r->keyOffsets.capacity() + r->valueOffsets.capacity()) * sizeof(uint32_t);
+		if (pMemoryTracker != nullptr) {
+			*pMemoryTracker += r->usedMemory;
+		}
+		return r;
+	}
+};
+
 struct BoundaryRefAndPage {
 	Standalone<RedwoodRecordRef> lowerBound;
 	Reference<ArenaPage> firstPage;
@@ -6134,8 +6549,10 @@ private:
 			             btPage->tree(),
 			             deltaTreeSpace,
 			             p->usedBytes());
+			double buildStart = timer_monotonic();
 			state int written = btPage->tree()->build(
 			    deltaTreeSpace, &entries[p->startIndex], &entries[p->endIndex()], &pageLowerBound, &pageUpperBound);
+			g_redwoodMetrics.metric.pageBuildTimeUS += int64_t((timer_monotonic() - buildStart) * 1e6);
 
 			if (written > deltaTreeSpace) {
 				debug_printf("ERROR:  Wrote %d bytes to page %s deltaTreeSpace=%d\n",
@@ -6333,7 +6750,7 @@ private:
 
 		Reference<BTreePage::BinaryTree::DecodeCache> cache;
 
-		if (page->extra.valid()) {
+		if (page->extra.valid() && extraIsDecodeCache(page)) {
 			cache = page->extra.getReference<BTreePage::BinaryTree::DecodeCache>();
 		} else {
 			cache = makeReference<BTreePage::BinaryTree::DecodeCache>(lowerBound, upperBound, m_pDecodeCacheMemory);
@@ -6351,7 +6768,7 @@ private:
 			                 .c_str());
 
 			// Store decode cache into page based on height
-			if (((BTreePage*)page->data())->height >= SERVER_KNOBS->REDWOOD_DECODECACHE_REUSE_MIN_HEIGHT) {
+			if (extraIsDecodeCache(page)) {
 				page->extra = cache;
 			}
 		}
@@ -6361,7 +6778,7 @@ private:
 
 	// Get cursor into a BTree node from a child link
 	inline BTreePage::BinaryTree::Cursor getCursor(const ArenaPage* page, const BTreePage::BinaryTree::Cursor& link) {
-		if (!page->extra.valid()) {
+		if (!page->extra.valid() || !extraIsDecodeCache(page)) {
 			return getCursor(page, link.get(), link.next().getOrUpperBound());
 		}
 
@@ -6369,6 +6786,25 @@ private:
 		                                     ((BTreePage*)page->mutateData())->tree());
 	}
 
+	// Pages at or above REDWOOD_DECODECACHE_REUSE_MIN_HEIGHT keep their DecodeCache in ArenaPage::extra. Leaf pages
+	// below it can keep their LeafColumns image there instead.
+	static bool extraIsDecodeCache(const ArenaPage* page) {
+		return ((const BTreePage*)page->data())->height >= SERVER_KNOBS->REDWOOD_DECODECACHE_REUSE_MIN_HEIGHT;
+	}
+
+	// Get the LeafColumns image of a leaf page, building it from a cursor into the page if needed.
+	// Returns an invalid reference if the page's extra object is taken by its DecodeCache.
+	Reference<LeafColumns> getLeafColumns(const ArenaPage* page, const BTreePage::BinaryTree::Cursor& cursor) {
+		ASSERT(((const BTreePage*)page->data())->isLeaf());
+		if (extraIsDecodeCache(page)) {
+			return Reference<LeafColumns>();
+		}
+		if (!page->extra.valid()) {
+			page->extra = LeafColumns::build(cursor, m_pDecodeCacheMemory);
+		}
+		return page->extra.getReference<LeafColumns>();
+	}
+
 	static void preLoadPage(IPagerSnapshot* snapshot, BTreeNodeLinkRef pageIDs, int priority) {
 		g_redwoodMetrics.metric.btreeLeafPreload += 1;
 		g_redwoodMetrics.metric.btreeLeafPreloadExt += (pageIDs.size() - 1);
@@ -6408,7 +6844,8 @@ private:
 
 		if (REDWOOD_DEBUG) {
 			const BTreePage* btPage = (const BTreePage*)page->mutateData();
-			BTreePage::BinaryTree::DecodeCache* cache = page->extra.getPtr<BTreePage::BinaryTree::DecodeCache>();
+			BTreePage::BinaryTree::DecodeCache* cache =
+			    extraIsDecodeCache(page.getPtr()) ? page->extra.getPtr<BTreePage::BinaryTree::DecodeCache>() : nullptr;
 
 			debug_printf_always(
 			    "updateBTreePage(%s, %s) start, page:\n%s\n",
@@ -6455,7 +6892,8 @@ private:
 	static Reference<ArenaPage> clonePageForUpdate(Reference<const ArenaPage> page) {
 		Reference<ArenaPage> newPage = page->clone();
 
-		if (page->extra.valid()) {
+		// A LeafColumns image would not follow updates to the new page, so it is not shared
+		if (page->extra.valid() && extraIsDecodeCache(page.getPtr())) {
 			newPage->extra = page->extra.getReference<BTreePage::BinaryTree::DecodeCache>();
 		}
 
@@ -7581,6 +8019,7 @@ private:
 
 		// Wait for the latest commit to be finished.
 		wait(previousCommit);
+		state double phaseStart = now();
 
 		// If the write version has not advanced then there can be no changes pending.
 		// If there are no changes, then the commit is a no-op.
@@ -7642,6 +8081,8 @@ private:
 
 		debug_printf("new root %s\n", toString(rootNodeLink).c_str());
 		self->m_header.root = rootNodeLink;
+		g_redwoodMetrics.metric.commitUpdateTimeUS += int64_t((now() - phaseStart) * 1e6);
+		phaseStart = now();
 
 		self->m_lazyClearStop = true;
 		wait(success(self->m_lazyClearActor));
@@ -7649,10 +8090,13 @@ private:
 
 		wait(self->m_lazyClearQueue.flush());
 		self->m_header.lazyDeleteQueue = self->m_lazyClearQueue.getState();
+		g_redwoodMetrics.metric.commitLazyClearTimeUS += int64_t((now() - phaseStart) * 1e6);
+		phaseStart = now();
 
 		debug_printf("%s: Committing pager %" PRId64 "\n", self->m_name.c_str(), writeVersion);
 		wait(self->m_pager->commit(writeVersion, ObjectWriter::toValue(self->m_header, Unversioned())));
 		debug_printf("%s: Committed version %" PRId64 "\n", self->m_name.c_str(), writeVersion);
+		g_redwoodMetrics.metric.commitPagerTimeUS += int64_t((now() - phaseStart) * 1e6);
 
 		++g_redwoodMetrics.metric.opCommit;
 		self->m_lazyClearActor = forwardError(incrementalLazyClear(self), self->m_errorPromise);
@@ -7683,6 +8127,9 @@ public:
 		Reference<IPagerSnapshot> pager;
 		bool valid;
 		std::vector<PathEntry> path;
+		// Level 2 node that scanAhead() last fetched children of, and the leaves left before it fetches more
+		Reference<const ArenaPage> scanAheadParent;
+		int scanAheadCountdown = 0;
 
 	public:
 		BTreeCursor() : reason(PagerEventReasons::MAXEVENTREASONS) {}
@@ -7690,6 +8137,11 @@ public:
 		bool initialized() const { return pager.isValid(); }
 		bool isValid() const { return valid; }
 
+		// Get the LeafColumns image of the current leaf page, or an invalid reference if it can't have one
+		Reference<LeafColumns> getLeafColumns() {
+			return btree->getLeafColumns(path.back().page.getPtr(), path.back().cursor);
+		}
+
 		// path entries at dumpHeight or below will have their entire pages printed
 		std::string toString(int dumpHeight = 0) const {
 			std::string r = format("{ptr=%p reason=%s %s ",
@@ -7795,6 +8247,7 @@ public:
 			path.clear();
 			path.reserve(6);
 			valid = false;
+			scanAheadParent.clear();
 			return root.empty() ? Void() : pushPage(root);
 		}
 
@@ -7855,11 +8308,16 @@ public:
 
 		Future<Void> seekGTE(RedwoodRecordRef query) { return seekGTE_impl(this, query); }
 
-		// Start fetching sibling nodes in the forward or backward direction, stopping after recordLimit or byteLimit
-		void prefetch(KeyRef rangeEnd, bool directionForward, int recordLimit, int byteLimit) {
+		// Start fetching sibling nodes in the forward or backward direction, stopping after recordLimit, byteLimit
+		// or pageLimit. Returns the number of siblings fetched.
+		int prefetch(KeyRef rangeEnd,
+		             bool directionForward,
+		             int recordLimit,
+		             int byteLimit,
+		             int pageLimit = std::numeric_limits<int>::max()) {
 			// Prefetch scans level 2 so if there are less than 2 nodes in the path there is no level 2
 			if (path.size() < 2) {
-				return;
+				return 0;
 			}
 
 			auto firstLeaf = path.back().btPage();
@@ -7880,9 +8338,11 @@ public:
 			BTreePage::BinaryTree::Cursor c = path[path.size() - 2].cursor;
 			ASSERT(path[path.size() - 2].btPage()->height == 2);
 
+			int pagesFetched = 0;
+
 			// The loop conditions are split apart into different if blocks for readability.
 			// While query limits are not exceeded
-			while (recordsRead < recordLimit && bytesRead < byteLimit) {
+			while (recordsRead < recordLimit && bytesRead < byteLimit && pagesFetched < pageLimit) {
 				// If prefetching right siblings
 				if (directionForward) {
 					// If there is no right sibling or its lower boundary is greater
@@ -7907,8 +8367,29 @@ public:
 					recordsRead += estRecordsPerPage;
 					// Use sibling node capacity as an estimate of bytes read.
 					bytesRead += childPage.size() * this->btree->m_blockSize;
+					++pagesFetched;
 				}
 			}
+
+			return pagesFetched;
+		}
+
+		// Keep up to pageLimit leaf pages ahead of a long range read being fetched, bounded by recordLimit and
+		// byteLimit. Fetches are issued when the cursor enters a new level 2 node and again once half of the pages
+		// fetched from it have been reached, so the scan does not wait on one leaf read at a time.
+		void scanAhead(KeyRef rangeEnd, bool directionForward, int recordLimit, int byteLimit, int pageLimit) {
+			if (path.size() < 2) {
+				return;
+			}
+
+			const Reference<const ArenaPage>& parent = path[path.size() - 2].page;
+			if (parent == scanAheadParent && --scanAheadCountdown > 0) {
+				return;
+			}
+
+			scanAheadParent = parent;
+			int pagesFetched = prefetch(rangeEnd, directionForward, recordLimit, byteLimit, pageLimit);
+			scanAheadCountdown = std::max(1, pagesFetched / 2);
 		}
 
 		ACTOR Future<Void> seekLT_impl(BTreeCursor* self, RedwoodRecordRef query) {
@@ -8024,7 +8505,9 @@ public:
 	                     Reference<IPageEncryptionKeyProvider> keyProvider = {},
 	                     int64_t pageCacheBytes = 0,
 	                     Reference<GetEncryptCipherKeysMonitor> encryptionMonitor = {})
-	  : m_filename(filename), prefetch(SERVER_KNOBS->REDWOOD_KVSTORE_RANGE_PREFETCH) {
+	  : m_filename(filename), prefetch(SERVER_KNOBS->REDWOOD_KVSTORE_RANGE_PREFETCH),
+	    columnarLeafScans(SERVER_KNOBS->REDWOOD_COLUMNAR_LEAF_SCANS),
+	    scanAheadPages(SERVER_KNOBS->REDWOOD_SCAN_AHEAD_PAGES) {
 		if (!encryptionMode.present() || encryptionMode.get().isEncryptionEnabled()) {
 			ASSERT(keyProvider.isValid() || db.isValid());
 		}
@@ -8177,6 +8660,11 @@ public:
 			return result;
 		}
 
+		// Long range reads keep the leaf pages ahead of them being read, unless their pages are not to be cached
+		state bool scanAhead = self->scanAheadPages > 0 &&
+		                       std::abs(rowLimit) >= SERVER_KNOBS->REDWOOD_SCAN_AHEAD_MIN_ROWS &&
+		                       (!options.present() || options.get().cacheResult);
+
 		if (rowLimit > 0) {
 			f = cur.seekGTE(keys.begin);
 			if (f.isReady()) {
@@ -8192,6 +8680,14 @@ public:
 			}
 
 			while (cur.isValid()) {
+				if (scanAhead) {
+					cur.scanAhead(keys.end,
+					              true,
+					              rowLimit,
+					              std::min(byteLimit - accumulatedBytes, SERVER_KNOBS->REDWOOD_SCAN_AHEAD_BYTES),
+					              self->scanAheadPages);
+				}
+
 				// Read leaf page contents without using waits by using the leaf page cursor directly
 				// and advancing it until it is no longer valid
 				BTreePage::BinaryTree::Cursor& leafCursor = cur.back().cursor;
@@ -8202,31 +8698,61 @@ public:
 				bool checkBounds = leafCursor.cache->upperBound > keys.end;
 				// Whether or not any results from this page were added to results
 				bool usedPage = false;
+				// Whether the scan stopped before the end of the page
+				bool pageRemaining;
 
-				while (leafCursor.valid()) {
-					KeyValueRef kv = leafCursor.get().toKeyValueRef();
-					if (checkBounds && kv.key.compare(keys.end) >= 0) {
-						break;
+				Reference<LeafColumns> columns;
+				if (self->columnarLeafScans) {
+					columns = cur.getLeafColumns();
+				}
+
+				if (columns.isValid()) {
+					int i = columns->lowerBound(leafCursor.get().key);
+					while (i < columns->count) {
+						KeyValueRef kv = columns->keyValue(i);
+						if (checkBounds && kv.key.compare(keys.end) >= 0) {
+							break;
+						}
+						accumulatedBytes += kv.expectedSize();
+						result.push_back(result.arena(), kv);
+						usedPage = true;
+						if (--rowLimit == 0 || accumulatedBytes >= byteLimit) {
+							break;
+						}
+						++i;
 					}
-					accumulatedBytes += kv.expectedSize();
-					result.push_back(result.arena(), kv);
-					usedPage = true;
-					if (--rowLimit == 0 || accumulatedBytes >= byteLimit) {
-						break;
+
+					if (usedPage) {
+						result.arena().dependsOn(columns->arena);
+					}
+					pageRemaining = i < columns->count;
+				} else {
+					while (leafCursor.valid()) {
+						KeyValueRef kv = leafCursor.get().toKeyValueRef();
+						if (checkBounds && kv.key.compare(keys.end) >= 0) {
+							break;
+						}
+						accumulatedBytes += kv.expectedSize();
+						result.push_back(result.arena(), kv);
+						usedPage = true;
+						if (--rowLimit == 0 || accumulatedBytes >= byteLimit) {
+							break;
+						}
+						leafCursor.moveNext();
 					}
-					leafCursor.moveNext();
-				}
 
-				// If the page was used, results must depend on the ArenaPage arena and the Mirror arena.
-				// This must be done after visiting all the results in case the Mirror arena changes.
-				if (usedPage) {
-					result.arena().dependsOn(leafCursor.cache->arena);
-					result.arena().dependsOn(cur.back().page->getArena());
+					// If the page was used, results must depend on the ArenaPage arena and the Mirror arena.
+					// This must be done after visiting all the results in case the Mirror arena changes.
+					if (usedPage) {
+						result.arena().dependsOn(leafCursor.cache->arena);
+						result.arena().dependsOn(cur.back().page->getArena());
+					}
+					pageRemaining = leafCursor.valid();
 				}
 
-				// Stop if the leaf cursor is still valid which means we hit a key or size limit or
+				// Stop if the scan did not reach the end of the page which means we hit a key or size limit or
 				// if the cursor is in the root page, in which case there are no more pages.
-				if (leafCursor.valid() || cur.inRoot()) {
+				if (pageRemaining || cur.inRoot()) {
 					break;
 				}
 				cur.popPath();
@@ -8247,6 +8773,14 @@ public:
 			}
 
 			while (cur.isValid()) {
+				if (scanAhead) {
+					cur.scanAhead(keys.begin,
+					              false,
+					              -rowLimit,
+					              std::min(byteLimit - accumulatedBytes, SERVER_KNOBS->REDWOOD_SCAN_AHEAD_BYTES),
+					              self->scanAheadPages);
+				}
+
 				// Read leaf page contents without using waits by using the leaf page cursor directly
 				// and advancing it until it is no longer valid
 				BTreePage::BinaryTree::Cursor& leafCursor = cur.back().cursor;
@@ -8257,31 +8791,61 @@ public:
 				bool checkBounds = leafCursor.cache->lowerBound < keys.begin;
 				// Whether or not any results from this page were added to results
 				bool usedPage = false;
+				// Whether the scan stopped before the start of the page
+				bool pageRemaining;
 
-				while (leafCursor.valid()) {
-					KeyValueRef kv = leafCursor.get().toKeyValueRef();
-					if (checkBounds && kv.key.compare(keys.begin) < 0) {
-						break;
+				Reference<LeafColumns> columns;
+				if (self->columnarLeafScans) {
+					columns = cur.getLeafColumns();
+				}
+
+				if (columns.isValid()) {
+					int i = columns->lowerBound(leafCursor.get().key);
+					while (i >= 0) {
+						KeyValueRef kv = columns->keyValue(i);
+						if (checkBounds && kv.key.compare(keys.begin) < 0) {
+							break;
+						}
+						accumulatedBytes += kv.expectedSize();
+						result.push_back(result.arena(), kv);
+						usedPage = true;
+						if (++rowLimit == 0 || accumulatedBytes >= byteLimit) {
+							break;
+						}
+						--i;
 					}
-					accumulatedBytes += kv.expectedSize();
-					result.push_back(result.arena(), kv);
-					usedPage = true;
-					if (++rowLimit == 0 || accumulatedBytes >= byteLimit) {
-						break;
+
+					if (usedPage) {
+						result.arena().dependsOn(columns->arena);
+					}
+					pageRemaining = i >= 0;
+				} else {
+					while (leafCursor.valid()) {
+						KeyValueRef kv = leafCursor.get().toKeyValueRef();
+						if (checkBounds && kv.key.compare(keys.begin) < 0) {
+							break;
+						}
+						accumulatedBytes += kv.expectedSize();
+						result.push_back(result.arena(), kv);
+						usedPage = true;
+						if (++rowLimit == 0 || accumulatedBytes >= byteLimit) {
+							break;
+						}
+						leafCursor.movePrev();
 					}
-					leafCursor.movePrev();
-				}
 
-				// If the page was used, results must depend on the ArenaPage arena and the Mirror arena.
-				// This must be done after visiting all the results in case the Mirror arena changes.
-				if (usedPage) {
-					result.arena().dependsOn(leafCursor.cache->arena);
-					result.arena().dependsOn(cur.back().page->getArena());
+					// If the page was used, results must depend on the ArenaPage arena and the Mirror arena.
+					// This must be done after visiting all the results in case the Mirror arena changes.
+					if (usedPage) {
+						result.arena().dependsOn(leafCursor.cache->arena);
+						result.arena().dependsOn(cur.back().page->getArena());
+					}
+					pageRemaining = leafCursor.valid();
 				}
 
-				// Stop if the leaf cursor is still valid which means we hit a key or size limit or
+				// Stop if the scan did not reach the start of the page which means we hit a key or size limit or
 				// if we started in the root page
-				if (leafCursor.valid() || cur.inRoot()) {
+				if (pageRemaining || cur.inRoot()) {
 					break;
 				}
 				cur.popPath();
@@ -8319,6 +8883,45 @@ public:
 		return catchError(readValue_impl(this, key, options));
 	}
 
+	// Looks up key with cur, a cursor of its own that may be a copy of another
+	ACTOR static Future<Optional<Value>> readValueWithCursor(VersionedBTree::BTreeCursor cur, KeyRef key) {
+		++g_redwoodMetrics.metric.opGet;
+		wait(cur.seekGTE(key));
+		if (cur.isValid() && cur.get().key == key) {
+			// Return a Value whose arena depends on the source page arena
+			Value v;
+			v.arena().dependsOn(cur.back().page->getArena());
+			v.contents() = cur.get().value.get();
+			g_redwoodMetrics.kvSizeReadByGet->sample(cur.get().kvBytes());
+			return v;
+		}
+		return Optional<Value>();
+	}
+
+	// Looks up all of the keys at once, each with a copy of one cursor, so that the snapshot and root are resolved
+	// once and pages missing from the cache are read concurrently rather than one key after another
+	ACTOR static Future<std::vector<Optional<Value>>> readValues_impl(KeyValueStoreRedwood* self,
+	                                                                  Standalone<VectorRef<KeyRef>> keys,
+	                                                                  Optional<ReadOptions> options) {
+		state VersionedBTree::BTreeCursor cur;
+		wait(self->m_tree->initBTreeCursor(
+		    &cur, self->m_tree->getLastCommittedVersion(), PagerEventReasons::PointRead, options));
+
+		state std::vector<Future<Optional<Value>>> reads;
+		reads.reserve(keys.size());
+		for (const KeyRef& key : keys) {
+			reads.push_back(readValueWithCursor(cur, key));
+		}
+		std::vector<Optional<Value>> values = wait(getAll(reads));
+		return values;
+	}
+
+	Future<std::vector<Optional<Value>>> readValues(VectorRef<KeyRef> keys, Optional<ReadOptions> options) override {
+		Standalone<VectorRef<KeyRef>> keyCopy;
+		keyCopy.append_deep(keyCopy.arena(), keys.begin(), keys.size());
+		return catchError(readValues_impl(this, keyCopy, options));
+	}
+
 	Future<Optional<Value>> readValuePrefix(KeyRef key, int maxLength, Optional<ReadOptions> options) override {
 		return catchError(map(readValue_impl(this, key, options), [maxLength](Optional<Value> v) {
 			if (v.present() && v.get().size() > maxLength) {
@@ -8337,6 +8940,10 @@ private:
 	Promise<Void> m_closed;
 	Promise<Void> m_errorPromise;
 	bool prefetch;
+	// Range reads scan the LeafColumns image of leaf pages instead of their DeltaTree2
+	bool columnarLeafScans;
+	// Max leaf pages that long range reads keep fetching ahead of their position
+	int scanAheadPages;
 	Version m_nextCommitVersion;
 	Reference<IPageEncryptionKeyProvider> m_keyProvider;
 	Future<Void> m_lastCommit = Void();
@@ -8877,12 +9484,20 @@ void RedwoodMetrics::getFields(TraceEvent* e, std::string* s, bool skipZeroes) {
 		                                               { "PagerProbeMiss", metric.pagerProbeMiss },
 		                                               { "PagerEvictUnhit", metric.pagerEvictUnhit },
 		                                               { "PagerEvictFail", metric.pagerEvictFail },
+		                                               { "PagerPrefetchHit", metric.pagerPrefetchHit },
+		                                               { "PagerPrefetchWaste", metric.pagerPrefetchWaste },
 		                                               { "", 0 },
 		                                               { "PagerRemapFree", metric.pagerRemapFree },
 		                                               { "PagerRemapCopy", metric.pagerRemapCopy },
 		                                               { "PagerRemapSkip", metric.pagerRemapSkip },
 		                                               { "", 0 },
 		                                               { "ReadRequestDecryptTimeNS", metric.readRequestDecryptTimeNS },
+		                                               { "", 0 },
+		                                               { "CommitUpdateTimeUS", metric.commitUpdateTimeUS },
+		                                               { "CommitLazyClearTimeUS", metric.commitLazyClearTimeUS },
+		                                               { "CommitPagerTimeUS", metric.commitPagerTimeUS },
+		                                               { "PageBuildTimeUS", metric.pageBuildTimeUS },
+		                                               { "PageEncodeTimeUS", metric.pageEncodeTimeUS },
 		                                               { "", 0 } };
 
 	double elapsed = now() - startTime;
@@ -9507,6 +10122,67 @@ TEST_CASE("Lredwood/correctness/unit/deltaTree/RedwoodRecordRef2") {
 	return Void();
 }
 
+TEST_CASE("/redwood/correctness/unit/LeafColumns") {
+	const int N = deterministicRandom()->randomInt(1, 1000);
+
+	RedwoodRecordRef prev;
+	RedwoodRecordRef next("\xff\xff\xff\xff"_sr);
+
+	// Keys share a prefix and use a small alphabet so that many of them have equal heads
+	Arena arena;
+	std::string prefix = deterministicRandom()->randomAlphaNumeric(deterministicRandom()->randomInt(0, 10));
+	auto randomKey = [&]() {
+		std::string k = prefix;
+		int len = deterministicRandom()->randomInt(0, 20);
+		for (int i = 0; i < len; ++i) {
+			k.push_back("ab\x00\xff"[deterministicRandom()->randomInt(0, 4)]);
+		}
+		return k;
+	};
+
+	std::set<RedwoodRecordRef> uniqueItems;
+	while (uniqueItems.size() < N) {
+		RedwoodRecordRef rec;
+		rec.key = StringRef(arena, randomKey());
+		std::string v = deterministicRandom()->randomAlphaNumeric(deterministicRandom()->randomInt(0, 30));
+		rec.value = StringRef(arena, v);
+		uniqueItems.insert(rec);
+	}
+	std::vector<RedwoodRecordRef> items(uniqueItems.begin(), uniqueItems.end());
+
+	int bufferSize = N * 100;
+	DeltaTree2<RedwoodRecordRef>* tree = (DeltaTree2<RedwoodRecordRef>*)new uint8_t[bufferSize];
+	tree->build(bufferSize, &items[0], &items[items.size()], &prev, &next);
+
+	int64_t memory = 0;
+	DeltaTree2<RedwoodRecordRef>::Cursor c(makeReference<DeltaTree2<RedwoodRecordRef>::DecodeCache>(prev, next), tree);
+	Reference<LeafColumns> columns = LeafColumns::build(c, &memory);
+	ASSERT(memory > 0 && memory == columns->usedMemory);
+
+	ASSERT(columns->count == items.size());
+	for (int i = 0; i < items.size(); ++i) {
+		ASSERT(columns->key(i) == items[i].key);
+		ASSERT(columns->value(i) == items[i].value.get());
+		ASSERT(columns->lowerBound(items[i].key) == i);
+	}
+
+	// Seek to random keys, some of which do not start with the prefix
+	for (int i = 0; i < 10000; ++i) {
+		std::string k = randomKey();
+		if (deterministicRandom()->coinflip()) {
+			k = k.substr(0, deterministicRandom()->randomInt(0, k.size() + 1));
+		}
+		int expected = std::lower_bound(items.begin(), items.end(), RedwoodRecordRef(StringRef(k))) - items.begin();
+		ASSERT(columns->lowerBound(StringRef(k)) == expected);
+	}
+
+	columns.clear();
+	ASSERT(memory == 0);
+	delete[](uint8_t*) tree;
+
+	return Void();
+}
+
 TEST_CASE("Lredwood/correctness/unit/deltaTree/IntIntPair") {
 	const int N = 200;
 	IntIntPair lowerBound = { 0, 0 };
@@ -10106,6 +10782,56 @@ TEST_CASE(":/redwood/pager/ArenaPage") {
 	return Void();
 }
 
+TEST_CASE("/redwood/correctness/unit/PageCacheEviction") {
+	auto& g_knobs = IKnobCollection::getMutableGlobalKnobCollection();
+	const bool s3fifoKnob = SERVER_KNOBS->REDWOOD_PAGE_CACHE_S3FIFO;
+	auto restoreKnob = ScopeExit([&g_knobs, s3fifoKnob]() {
+		g_knobs.setKnob("redwood_page_cache_s3fifo", KnobValueRef::create(bool{ s3fifoKnob }));
+	});
+
+	// Pages read a few times each, followed by a scan much larger than the cache which reads each page once
+	const int cacheSize = 100;
+	const int hotPages = 20;
+	const int scanPages = 1000;
+
+	for (bool s3fifo : { false, true }) {
+		g_knobs.setKnob("redwood_page_cache_s3fifo", KnobValueRef::create(bool{ s3fifo }));
+		DWALPager::PageCacheT::Evictor evictor(cacheSize);
+		DWALPager::PageCacheT cache(&evictor);
+
+		auto read = [&](LogicalPageID id) {
+			DWALPager::PageCacheEntry& entry = cache.get(id, 1);
+			if (!entry.initialized()) {
+				entry.readFuture = Reference<ArenaPage>();
+				entry.writeFuture = Void();
+			}
+		};
+
+		for (int i = 0; i < 3; ++i) {
+			for (LogicalPageID id = 0; id < hotPages; ++id) {
+				read(id);
+			}
+		}
+		for (LogicalPageID id = hotPages; id < hotPages + scanPages; ++id) {
+			read(id);
+			ASSERT(evictor.getSizeUsed() <= cacheSize);
+		}
+
+		// The scan flushes the hot pages out of an LRU cache but not out of an S3-FIFO cache
+		int hotCached = 0;
+		for (LogicalPageID id = 0; id < hotPages; ++id) {
+			hotCached += cache.getIfExists(id) != nullptr;
+		}
+		ASSERT_EQ(hotCached, s3fifo ? hotPages : 0);
+
+		Future<Void> cleared = cache.clear();
+		ASSERT(cleared.isReady());
+		ASSERT(evictor.empty());
+	}
+
+	return Void();
+}
+
 namespace {
 
 RandomKeyGenerator getDefaultKeyGenerator(int maxKeySize) {
@@ -11529,14 +12255,30 @@ TEST_CASE(":/redwood/performance/randomRangeScans") {
 	state IKeyValueStore* redwood = openKVStore(KeyValueStoreType::SSD_REDWOOD_V1, "test.redwood-v1", UID(), 0);
 	wait(prefixClusteredInsert(
 	    redwood, suffixSize, valueSize, source, writeRecordCountTarget, writePrefixesInOrder, false));
-
-	// divide targets for tiny queries by 10 because they are much slower
-	wait(randomRangeScans(redwood, suffixSize, source, valueSize, queryRecordTarget / 10, true, 10, maxByteLimit));
-	wait(randomRangeScans(redwood, suffixSize, source, valueSize, queryRecordTarget, true, 1000, maxByteLimit));
-	wait(randomRangeScans(redwood, suffixSize, source, valueSize, queryRecordTarget / 10, false, 100, maxByteLimit));
-	wait(randomRangeScans(redwood, suffixSize, source, valueSize, queryRecordTarget, false, 10000, maxByteLimit));
-	wait(randomRangeScans(redwood, suffixSize, source, valueSize, queryRecordTarget, false, 1000000, maxByteLimit));
 	wait(closeKVS(redwood));
+
+	// Compare scans of the DeltaTree2 leaf pages with scans of their LeafColumns images
+	state bool columnar = false;
+	loop {
+		IKnobCollection::getMutableGlobalKnobCollection().setKnob("redwood_columnar_leaf_scans",
+		                                                          KnobValueRef::create(bool{ columnar }));
+		printf("\ncolumnarLeafScans: %d\n", columnar);
+		redwood = openKVStore(KeyValueStoreType::SSD_REDWOOD_V1, "test.redwood-v1", UID(), 0);
+
+		// divide targets for tiny queries by 10 because they are much slower
+		wait(randomRangeScans(redwood, suffixSize, source, valueSize, queryRecordTarget / 10, true, 10, maxByteLimit));
+		wait(randomRangeScans(redwood, suffixSize, source, valueSize, queryRecordTarget, true, 1000, maxByteLimit));
+		wait(
+		    randomRangeScans(redwood, suffixSize, source, valueSize, queryRecordTarget / 10, false, 100, maxByteLimit));
+		wait(randomRangeScans(redwood, suffixSize, source, valueSize, queryRecordTarget, false, 10000, maxByteLimit));
+		wait(randomRangeScans(redwood, suffixSize, source, valueSize, queryRecordTarget, false, 1000000, maxByteLimit));
+		wait(closeKVS(redwood));
+
+		if (columnar) {
+			break;
+		}
+		columnar = true;
+	}
 	printf("\n");
 	return Void();
 }
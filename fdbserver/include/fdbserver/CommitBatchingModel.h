@@ -0,0 +1,88 @@
+/*
+ * CommitBatchingModel.h
+ *
+ * This source file is part of the FoundationDB open source project
+ *
+ * Copyright 2013-2024 Apple Inc. and the FoundationDB project authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "fdbrpc/Smoother.h"
+
+// Online estimate of a round trip's latency as a linear function of the size of a commit batch,
+//   latency = base + perByte * bytes
+// fit by exponentially weighted least squares so that it follows changes in the workload.
+class BatchLatencyModel {
+	double alpha;
+	double weight{ 0.0 };
+	double sumX{ 0.0 };
+	double sumY{ 0.0 };
+	double sumXX{ 0.0 };
+	double sumXY{ 0.0 };
+	double base{ 0.0 };
+	double perByte{ 0.0 };
+
+public:
+	// Each new sample decays the weight of the previous ones by (1 - alpha)
+	explicit BatchLatencyModel(double alpha) : alpha(alpha) {}
+
+	void addSample(double bytes, double latency);
+
+	bool empty() const { return weight == 0.0; }
+	double predict(double bytes) const { return base + perByte * bytes; }
+	double getBase() const { return base; }
+	double getPerByte() const { return perByte; }
+};
+
+// Chooses the commit batch interval and byte limit when COMMIT_BATCHING_ADAPTIVE is set.
+//
+// Resolver and TLog round trips are modeled per batch size, and the rest of a batch's commit path as a fixed
+// overhead. A transaction waits up to the batch interval T for its batch to close, so with commit bytes arriving
+// at rate r its predicted commit latency is
+//   T + base + perByte * r * T
+// Bigger batches amortize the per-batch costs of the pipeline, so the largest interval and batch size whose
+// predicted latency stays within COMMIT_BATCHING_LATENCY_SLO are chosen.
+class CommitBatchingModel {
+	BatchLatencyModel resolver;
+	BatchLatencyModel tlog;
+	double overhead{ 0.0 };
+	Smoother arrivalRate;
+
+	double interval;
+	int desiredBytes;
+
+public:
+	CommitBatchingModel();
+
+	// A batch of the given size was sent by the batcher at time t
+	void addArrival(int bytes, double t);
+
+	// Records the round trips of a committed batch, and the latency of the whole batch
+	void addBatch(int bytes, double resolverLatency, double tlogLatency, double totalLatency);
+
+	// Recomputes the interval and the batch size
+	void update(double t);
+
+	// Whether no batch has been recorded yet, in which case the interval and batch size are meaningless
+	bool empty() const { return resolver.empty(); }
+
+	double getInterval() const { return interval; }
+	int getDesiredBytes() const { return desiredBytes; }
+	double getArrivalRate(double t) const { return arrivalRate.smoothRate(t); }
+	double getOverhead() const { return overhead; }
+	const BatchLatencyModel& getResolverModel() const { return resolver; }
+	const BatchLatencyModel& getTLogModel() const { return tlog; }
+};
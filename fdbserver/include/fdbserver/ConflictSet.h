@@ -22,14 +22,69 @@
 #define CONFLICTSET_H
 #pragma once
 
+#include <functional>
+#include <memory>
 #include <utility>
 #include <vector>
 
 #include "fdbclient/CommitTransaction.h"
 #include "fdbserver/ResolverBug.h"
 
-struct ConflictSet;
-ConflictSet* newConflictSet();
+struct ReadConflictRange {
+	StringRef begin, end;
+	Version version;
+	int transaction;
+	int indexInTx;
+	VectorRef<int>* conflictingKeyRange;
+	Arena* cKRArena;
+
+	ReadConflictRange(StringRef begin,
+	                  StringRef end,
+	                  Version version,
+	                  int transaction,
+	                  int indexInTx,
+	                  VectorRef<int>* cKR = nullptr,
+	                  Arena* cKRArena = nullptr)
+	  : begin(begin), end(end), version(version), transaction(transaction), indexInTx(indexInTx),
+	    conflictingKeyRange(cKR), cKRArena(cKRArena) {}
+	bool operator<(const ReadConflictRange& rhs) const { return begin < rhs.begin; }
+};
+
+class ConflictSetWorkers;
+
+// Base of the conflict set implementations used by ConflictBatch.  The version history records, for each key, the
+// version of the last write to it; keys not written since the history was cleared have the version it was cleared to.
+struct ConflictSet : NonCopyable {
+	ConflictSet(int partitions, bool useWorkerThreads, int parallelMinRanges);
+	virtual ~ConflictSet();
+
+	// Sets transactionConflictStatus[r.transaction] for each range r that was written after r.version, and records the
+	// range in r.conflictingKeyRange if it is set.  May be called concurrently for different ranges.
+	virtual void detectConflicts(ReadConflictRange* ranges, int count, bool* transactionConflictStatus) = 0;
+	// Records writes at version now to the given sorted, non-overlapping ranges
+	virtual void addConflictRanges(std::vector<std::pair<StringRef, StringRef>>& ranges, Version now) = 0;
+	// Discards some of the history older than oldestVersion, doing an amount of work proportional to workHint
+	virtual void removeBefore(Version oldestVersion, int workHint) = 0;
+	// Resets the history as if every key was written at version v
+	virtual void clear(Version v) = 0;
+	// Returns the number of entries in the version history
+	virtual int count() const = 0;
+
+	// Returns the number of partitions to split the given number of conflict ranges into
+	int partitionsFor(int rangeCount) const { return rangeCount < parallelMinRanges ? 1 : partitions; }
+	// Calls work(i) for each partition i in [0, count), concurrently if there are worker threads
+	void runPartitions(int count, const std::function<void(int)>& work);
+
+	Version oldestVersion;
+	const int partitions;
+	const int parallelMinRanges;
+	std::unique_ptr<ConflictSetWorkers> workers;
+};
+
+// A conflict set with more than one partition splits the conflict ranges of each batch by key range and resolves the
+// partitions concurrently. Without worker threads (e.g. in simulation), the partitions are resolved one at a time on
+// the calling thread, which exercises the same code paths deterministically.
+ConflictSet* newConflictSet(int partitions = 1, bool useWorkerThreads = true, int parallelMinRanges = 0);
 void clearConflictSet(ConflictSet*, Version);
 void destroyConflictSet(ConflictSet*);
 
@@ -60,7 +115,7 @@ private:
 	std::vector<struct KeyInfo> points;
 	int transactionCount;
 	std::vector<std::pair<StringRef, StringRef>> combinedWriteConflictRanges;
-	std::vector<struct ReadConflictRange> combinedReadConflictRanges;
+	std::vector<ReadConflictRange> combinedReadConflictRanges;
 	bool* transactionConflictStatus;
 	// Stores the map: a transaction -> conflicted transactions' indices
 	std::map<int, VectorRef<int>>* conflictingKeyRangeMap;
@@ -76,10 +131,6 @@ private:
 	void combineWriteConflictRanges();
 	void checkReadConflictRanges();
 	void mergeWriteConflictRanges(Version now);
-	void addConflictRanges(Version now,
-	                       std::vector<std::pair<StringRef, StringRef>>::iterator begin,
-	                       std::vector<std::pair<StringRef, StringRef>>::iterator end,
-	                       class SkipList* part);
 };
 
 #endif
@@ -31,12 +31,14 @@
 #include "fdbclient/Tenant.h"
 #include "fdbrpc/Stats.h"
 #include "fdbserver/AccumulativeChecksumUtil.h"
+#include "fdbserver/CommitBatchingModel.h"
 #include "fdbserver/Knobs.h"
 #include "fdbserver/LogSystem.h"
 #include "fdbserver/LogSystemDiskQueueAdapter.h"
 #include "fdbserver/MasterInterface.h"
 #include "fdbserver/ResolverInterface.h"
 #include "flow/IRandom.h"
+#include "flow/IThreadPool.h"
 
 #include "flow/actorcompiler.h" // This must be the last #include.
 
@@ -231,6 +233,7 @@ struct ProxyCommitData {
 	bool locked;
 	Optional<Value> metadataVersion;
 	double commitBatchInterval;
+	CommitBatchingModel batchingModel;
 	bool provisional;
 
 	int64_t localCommitBatchesStarted;
@@ -279,6 +282,10 @@ struct ProxyCommitData {
 
 	std::shared_ptr<RangeLock> rangeLock = nullptr;
 
+	// Helper threads for assignMutationsToStorageServers(), see PROXY_ASSIGN_MUTATIONS_THREADS. Declared after the
+	// maps they read, so that the threads are joined before those maps are destroyed.
+	Reference<IThreadPool> assignMutationsThreads;
+
 	// The tag related to a storage server rarely change, so we keep a vector of tags for each key range to be slightly
 	// more CPU efficient. When a tag related to a storage server does change, we empty out all of these vectors to
 	// signify they must be repopulated. We do not repopulate them immediately to avoid a slow task.
@@ -181,6 +181,10 @@ struct ByteSampleInfo {
 // Determines whether a key-value pair should be included in a byte sample
 // Also returns size information about the sample
 ByteSampleInfo isKeyValueInSample(KeyRef key, int64_t totalKvSize);
+// Like isKeyValueInSample(key, totalKvSize), with keyHash the byteSampleKeyHash() of key
+ByteSampleInfo isKeyValueInSample(KeyRef key, int64_t totalKvSize, uint32_t keyHash);
+// The hash of key that decides whether it is sampled
+uint32_t byteSampleKeyHash(KeyRef key);
 inline ByteSampleInfo isKeyValueInSample(KeyValueRef keyValue) {
 	return isKeyValueInSample(keyValue.key, keyValue.key.size() + keyValue.value.size());
 }
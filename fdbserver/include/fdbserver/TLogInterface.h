@@ -207,6 +207,9 @@ struct TLogPeekReply {
 	Optional<Version> begin;
 	bool onlySpilled = false;
 
+	// messages is always built in arena, so FlowTransport may send it from there rather than copy it
+	Arena const* referencedArena() const { return &arena; }
+
 	template <class Ar>
 	void serialize(Ar& ar) {
 		serializer(ar, messages, end, popped, maxKnownVersion, minKnownCommittedVersion, begin, onlySpilled, arena);
@@ -247,6 +250,7 @@ struct TLogPeekStreamReply : public ReplyPromiseStreamReply {
 	explicit TLogPeekStreamReply(const TLogPeekReply& rep) : rep(rep) {}
 
 	int expectedSize() const { return rep.messages.expectedSize() + sizeof(TLogPeekStreamReply); }
+	Arena const* referencedArena() const { return rep.referencedArena(); }
 
 	template <class Ar>
 	void serialize(Ar& ar) {
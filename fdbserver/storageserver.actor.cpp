@@ -50,6 +50,7 @@
 #include "flow/PriorityMultiLock.actor.h"
 #include "flow/IRandom.h"
 #include "flow/IndexedSet.h"
+#include "flow/IThreadPool.h"
 #include "flow/SystemMonitor.h"
 #include "flow/Trace.h"
 #include "fdbclient/Tracing.h"
@@ -65,12 +66,14 @@
 #include "fdbclient/KeyRangeMap.h"
 #include "fdbclient/NativeAPI.actor.h"
 #include "fdbclient/Notified.h"
+#include "fdbclient/ParallelStream.actor.h"
 #include "fdbclient/StatusClient.h"
 #include "fdbclient/StorageServerShard.h"
 #include "fdbclient/SystemData.h"
 #include "fdbclient/Tenant.h"
 #include "fdbclient/TransactionLineage.h"
 #include "fdbclient/Tuple.h"
+#include "fdbclient/VersionedBPlusTree.h"
 #include "fdbclient/VersionedMap.h"
 #include "fdbrpc/sim_validation.h"
 #include "fdbrpc/Smoother.h"
@@ -664,6 +667,11 @@ struct StorageServerDisk {
 		++(*kvGets);
 		return storage->readValuePrefix(key, maxLength, options);
 	}
+	Future<std::vector<Optional<Value>>> readValues(VectorRef<KeyRef> keys,
+	                                                Optional<ReadOptions> options = Optional<ReadOptions>()) {
+		*kvGets += keys.size();
+		return storage->readValues(keys, options);
+	}
 	Future<RangeResult> readRange(KeyRangeRef keys,
 	                              int rowLimit = 1 << 30,
 	                              int byteLimit = 1 << 30,
@@ -795,16 +803,26 @@ const int VERSION_OVERHEAD =
          sizeof(Reference<VersionedMap<KeyRef, ValueOrClearToRef>::PTreeT>)); // versioned map [ x2 for
                                                                               // createNewVersion(version+1) ], 64b
                                                                               // overhead for map
-
-static int mvccStorageBytes(MutationRef const& m) {
-	return mvccStorageBytes(m.param1.size() + m.param2.size());
-}
+const int VERSION_OVERHEAD_BPLUS_TREE =
+    64 + sizeof(Version) + sizeof(Standalone<VerUpdateRef>) + // mutationLog, 64b overhead for map
+    2 * VersionedBPlusTree<KeyRef, ValueOrClearToRef>::overheadPerVersion; // versioned map [ x2 for
+                                                                           // createNewVersion(version+1) ]
 
 struct FetchInjectionInfo {
 	Arena arena;
 	std::vector<VerUpdateRef> changes;
 };
 
+CompressionFilter changeFeedCompressionFilter() {
+	CompressionFilter filter = CompressionUtils::fromFilterString(SERVER_KNOBS->CHANGE_FEED_DURABLE_COMPRESSION_FILTER);
+	if (!CompressionUtils::supportedFilters.count(filter)) {
+		TraceEvent(SevWarnAlways, "ChangeFeedCompressionFilterUnsupported")
+		    .detail("Filter", SERVER_KNOBS->CHANGE_FEED_DURABLE_COMPRESSION_FILTER);
+		return CompressionFilter::NONE;
+	}
+	return filter;
+}
+
 struct ChangeFeedInfo : ReferenceCounted<ChangeFeedInfo> {
 	std::deque<Standalone<EncryptedMutationsAndVersionRef>> mutations;
 	Version fetchVersion = invalidVersion; // The version that commits from a fetch have been written to storage, but
@@ -896,6 +914,12 @@ public:
 	Optional<UID> debugID;
 	int64_t tenantId;
 
+	// Only used with STORAGE_SERVER_WATCH_INDEX, see StorageServer::watchIndex
+	bool indexed = false; // in watchIndex, until the watch fires or is deleted
+	bool reading = false; // watchIndexRead() is reading the key, and will check it again if it is touched meanwhile
+	bool touched = false; // a mutation to the key has been applied since the watch was last checked
+	double touchTime = 0; // when the key was first touched since the watch was last checked
+
 	ServerWatchMetadata(Key key,
 	                    Optional<Value> value,
 	                    Version version,
@@ -1018,7 +1042,7 @@ struct TenantSSInfo {
 };
 
 struct StorageServer : public IStorageMetricsService {
-	typedef VersionedMap<KeyRef, ValueOrClearToRef> VersionedData;
+	typedef SelectableVersionedMap<KeyRef, ValueOrClearToRef> VersionedData;
 
 private:
 	// versionedData contains sets and clears.
@@ -1124,6 +1148,13 @@ public:
 	void deleteWatchMetadata(KeyRef key, int64_t tenantId);
 	void clearWatchMetadata();
 
+	// watchIndex Operations
+	void indexWatch(Reference<ServerWatchMetadata> metadata);
+	void unindexWatch(Reference<ServerWatchMetadata> metadata);
+	void touchWatches(KeyRef key);
+	void touchWatches(KeyRangeRef range);
+	void failWatches(KeyRangeRef range, int64_t tenantId, Error const& e);
+
 	// tenant map operations
 	void insertTenant(TenantMapEntry const& tenant, Version version, bool persist);
 	void clearTenants(StringRef startTenant, StringRef endTenant, Version version);
@@ -1255,6 +1286,14 @@ public:
 		}
 	}
 
+	// Memory a version and a mutation take in the mutation log and versionedData, whose cost depends on its structure
+	int versionOverhead() const {
+		return versionedData.usesBPlusTree() ? VERSION_OVERHEAD_BPLUS_TREE : VERSION_OVERHEAD;
+	}
+	int mvccStorageBytes(MutationRef const& m) const {
+		return ::mvccStorageBytes(m.param1.size() + m.param2.size(), versionedData.usesBPlusTree());
+	}
+
 	Standalone<VerUpdateRef>& addVersionToMutationLog(Version v) {
 		// return existing version...
 		auto m = mutationLog.find(v);
@@ -1267,7 +1306,7 @@ public:
 		if (lastArena.getSize() >= 65536)
 			lastArena = Arena(4096);
 		u.arena() = lastArena;
-		counters.bytesInput += VERSION_OVERHEAD;
+		counters.bytesInput += versionOverhead();
 		return u;
 	}
 
@@ -1391,6 +1430,12 @@ public:
 	AsyncMap<int64_t, bool> tenantWatches;
 	int64_t watchBytes;
 	int64_t numWatches;
+	// With STORAGE_SERVER_WATCH_INDEX the watched keys are indexed here, rather than each having an actor waiting on
+	// watches. Applying a mutation touches the watches on its keys, and the touched watches are checked together
+	// against the in-memory data once the version has been applied, see checkTouchedWatches(). An ordered map, since
+	// clears and shard moves touch ranges of keys.
+	std::multimap<KeyRef, Reference<ServerWatchMetadata>> watchIndex;
+	std::vector<Reference<ServerWatchMetadata>> touchedWatches;
 	AsyncVar<bool> noRecentUpdates;
 	double lastUpdate;
 
@@ -1408,6 +1453,8 @@ public:
 	// Extra lock that prevents too much post-initial-fetch work from building up, such as mutation applying and change
 	// feed tail fetching
 	FlowLock fetchKeysParallelismChangeFeedLock;
+	// Bytes of the sub-ranges read ahead by parallel fetches, see tryGetRangeParallel()
+	FlowLock fetchKeysParallelBytesLock;
 	int64_t fetchKeysBytesBudget;
 	AsyncVar<bool> fetchKeysBudgetUsed;
 	int64_t fetchKeysTotalCommitBytes;
@@ -1467,9 +1514,9 @@ public:
 
 	struct Counters : CommonStorageCounters {
 
-		Counter allQueries, systemKeyQueries, getKeyQueries, getValueQueries, getRangeQueries, getRangeSystemKeyQueries,
-		    getRangeStreamQueries, lowPriorityQueries, rowsQueried, watchQueries, emptyQueries, feedRowsQueried,
-		    feedBytesQueried, feedStreamQueries, rejectedFeedStreamQueries, feedVersionQueries;
+		Counter allQueries, systemKeyQueries, getKeyQueries, getValueQueries, getValuesQueries, getRangeQueries,
+		    getRangeSystemKeyQueries, getRangeStreamQueries, lowPriorityQueries, rowsQueried, watchQueries, emptyQueries,
+		    feedRowsQueried, feedBytesQueried, feedStreamQueries, rejectedFeedStreamQueries, feedVersionQueries;
 
 		// counters related to getMappedRange queries
 		Counter getMappedRangeBytesQueried, finishedGetMappedRangeSecondaryQueries, getMappedRangeQueries,
@@ -1548,6 +1595,7 @@ public:
 		LatencySample kvReadRangeLatencySample;
 		LatencySample updateLatencySample;
 		LatencySample updateEncryptionLatencySample;
+		LatencySample watchFireLatencySample; // From a watched key being touched by a mutation to its watch firing
 
 		LatencyBands readLatencyBands;
 		std::unique_ptr<LatencySample> mappedRangeSample; // Samples getMappedRange latency
@@ -1557,7 +1605,8 @@ public:
 		explicit Counters(StorageServer* self)
 		  : CommonStorageCounters("StorageServer", self->thisServerID.toString(), &self->metrics),
 		    allQueries("QueryQueue", cc), systemKeyQueries("SystemKeyQueries", cc), getKeyQueries("GetKeyQueries", cc),
-		    getValueQueries("GetValueQueries", cc), getRangeQueries("GetRangeQueries", cc),
+		    getValueQueries("GetValueQueries", cc), getValuesQueries("GetValuesQueries", cc),
+		    getRangeQueries("GetRangeQueries", cc),
 		    getRangeSystemKeyQueries("GetRangeSystemKeyQueries", cc),
 		    getMappedRangeQueries("GetMappedRangeQueries", cc), getRangeStreamQueries("GetRangeStreamQueries", cc),
 		    lowPriorityQueries("LowPriorityQueries", cc), rowsQueried("RowsQueried", cc),
@@ -1622,6 +1671,10 @@ public:
 		                                  self->thisServerID,
 		                                  SERVER_KNOBS->LATENCY_METRICS_LOGGING_INTERVAL,
 		                                  SERVER_KNOBS->LATENCY_SKETCH_ACCURACY),
+		    watchFireLatencySample("WatchFireMetrics",
+		                           self->thisServerID,
+		                           SERVER_KNOBS->LATENCY_METRICS_LOGGING_INTERVAL,
+		                           SERVER_KNOBS->LATENCY_SKETCH_ACCURACY),
 		    readLatencyBands("ReadLatencyBands", self->thisServerID, SERVER_KNOBS->STORAGE_LOGGING_DELAY),
 		    mappedRangeSample(std::make_unique<LatencySample>("GetMappedRangeMetrics",
 		                                                      self->thisServerID,
@@ -1652,6 +1705,9 @@ public:
 			specialCounter(cc, "FetchKeysFullFetchWaiting", [self]() {
 				return self->fetchKeysParallelismChangeFeedLock.waiters();
 			});
+			specialCounter(cc, "FetchKeysParallelBytes", [self]() {
+				return self->fetchKeysParallelBytesLock.activePermits();
+			});
 			specialCounter(cc, "ServeFetchCheckpointActive", [self]() {
 				return self->serveFetchCheckpointParallelismLock.activePermits();
 			});
@@ -1671,6 +1727,7 @@ public:
 			specialCounter(cc, "QueryQueueMax", [self]() { return self->getAndResetMaxQueryQueueSize(); });
 			specialCounter(cc, "ActiveWatches", [self]() { return self->numWatches; });
 			specialCounter(cc, "WatchBytes", [self]() { return self->watchBytes; });
+			specialCounter(cc, "IndexedWatches", [self]() { return self->watchIndex.size(); });
 			specialCounter(cc, "KvstoreSizeTotal", [self]() { return std::get<0>(self->storage.getSize()); });
 			specialCounter(cc, "KvstoreNodeTotal", [self]() { return std::get<1>(self->storage.getSize()); });
 			specialCounter(cc, "KvstoreInlineKey", [self]() { return std::get<2>(self->storage.getSize()); });
@@ -1690,13 +1747,29 @@ public:
 
 	std::shared_ptr<AccumulativeChecksumValidator> acsValidator = nullptr;
 
+	// Decrypt and validate the checksums of mutations pulled by update(), see PreparedUpdate
+	Reference<IThreadPool> updatePrepareThreads;
+	// The key of the mutation update() is applying and its byteSampleKeyHash(), when a helper thread computed it.
+	// byteSampleApplySet() uses the hash if it is given the same key.
+	Optional<std::pair<KeyRef, uint32_t>> preparedSampleKeyHash;
+
+	const CompressionFilter changeFeedCompression = changeFeedCompressionFilter();
+
+	// Compression of the durable value of a change feed's mutations at one version
+	CompressionFilter changeFeedDurableCompression(VectorRef<MutationRef> const& mutations) const {
+		return mutations.expectedSize() >= SERVER_KNOBS->CHANGE_FEED_DURABLE_COMPRESSION_MIN_BYTES
+		           ? changeFeedCompression
+		           : CompressionFilter::NONE;
+	}
+
 	StorageServer(IKeyValueStore* storage,
 	              Reference<AsyncVar<ServerDBInfo> const> const& db,
 	              StorageServerInterface const& ssi,
 	              Reference<GetEncryptCipherKeysMonitor> encryptionMonitor)
-	  : shardAware(false), tlogCursorReadsLatencyHistogram(Histogram::getHistogram(STORAGESERVER_HISTOGRAM_GROUP,
-	                                                                               TLOG_CURSOR_READS_LATENCY_HISTOGRAM,
-	                                                                               Histogram::Unit::milliseconds)),
+	  : versionedData(SERVER_KNOBS->STORAGE_VERSIONED_DATA_BPLUS_TREE), shardAware(false),
+	    tlogCursorReadsLatencyHistogram(Histogram::getHistogram(STORAGESERVER_HISTOGRAM_GROUP,
+	                                                            TLOG_CURSOR_READS_LATENCY_HISTOGRAM,
+	                                                            Histogram::Unit::milliseconds)),
 	    ssVersionLockLatencyHistogram(Histogram::getHistogram(STORAGESERVER_HISTOGRAM_GROUP,
 	                                                          SS_VERSION_LOCK_LATENCY_HISTOGRAM,
 	                                                          Histogram::Unit::milliseconds)),
@@ -1736,6 +1809,7 @@ public:
 	    durableInProgress(Void()), watchBytes(0), numWatches(0), noRecentUpdates(false), lastUpdate(now()),
 	    updateEagerReads(nullptr), fetchKeysParallelismLock(SERVER_KNOBS->FETCH_KEYS_PARALLELISM),
 	    fetchKeysParallelismChangeFeedLock(SERVER_KNOBS->FETCH_KEYS_PARALLELISM_CHANGE_FEED),
+	    fetchKeysParallelBytesLock(SERVER_KNOBS->FETCH_KEYS_PARALLEL_BYTES),
 	    fetchKeysBytesBudget(SERVER_KNOBS->STORAGE_FETCH_BYTES), fetchKeysBudgetUsed(false),
 	    fetchKeysTotalCommitBytes(0), fetchKeysLimiter(SERVER_KNOBS->STORAGE_FETCH_KEYS_RATE_LIMIT),
 	    serveFetchCheckpointParallelismLock(SERVER_KNOBS->SERVE_FETCH_CHECKPOINT_PARALLELISM),
@@ -2127,13 +2201,95 @@ KeyRef StorageServer::setWatchMetadata(Reference<ServerWatchMetadata> metadata)
 
 void StorageServer::deleteWatchMetadata(KeyRef key, int64_t tenantId) {
 	const WatchMapKey mapKey(tenantId, key);
+	auto it = watchMap.find(mapKey);
+	if (it != watchMap.end() && it->second->indexed) {
+		unindexWatch(it->second);
+	}
 	watchMap.erase(mapKey);
 }
 
 void StorageServer::clearWatchMetadata() {
+	for (auto& [key, metadata] : watchIndex) {
+		metadata->indexed = false;
+		metadata->watch_impl.cancel();
+	}
+	watchIndex.clear();
+	touchedWatches.clear();
 	watchMap.clear();
 }
 
+// watchIndex Operations
+static int64_t indexedWatchBytes(ServerWatchMetadata const& metadata) {
+	// A multimap node is about the size of its value plus three pointers and a color
+	return metadata.key.expectedSize() + metadata.value.expectedSize() + sizeof(ServerWatchMetadata) +
+	       sizeof(std::pair<const KeyRef, Reference<ServerWatchMetadata>>) + 4 * sizeof(void*);
+}
+
+void StorageServer::indexWatch(Reference<ServerWatchMetadata> metadata) {
+	ASSERT(!metadata->indexed);
+	watchIndex.emplace(metadata->key, metadata);
+	metadata->indexed = true;
+	watchBytes += indexedWatchBytes(*metadata);
+}
+
+void StorageServer::unindexWatch(Reference<ServerWatchMetadata> metadata) {
+	ASSERT(metadata->indexed);
+	auto range = watchIndex.equal_range(metadata->key);
+	for (auto it = range.first; it != range.second; ++it) {
+		if (it->second == metadata) {
+			watchIndex.erase(it);
+			break;
+		}
+	}
+	metadata->indexed = false;
+	metadata->reading = false;
+	watchBytes -= indexedWatchBytes(*metadata);
+}
+
+static void touchWatch(StorageServer* data, Reference<ServerWatchMetadata> const& metadata) {
+	if (!metadata->touched) {
+		metadata->touched = true;
+		metadata->touchTime = now();
+		if (!metadata->reading) {
+			data->touchedWatches.push_back(metadata);
+		}
+	}
+}
+
+void StorageServer::touchWatches(KeyRef key) {
+	if (watchIndex.empty()) {
+		return;
+	}
+	auto range = watchIndex.equal_range(key);
+	for (auto it = range.first; it != range.second; ++it) {
+		touchWatch(this, it->second);
+	}
+}
+
+void StorageServer::touchWatches(KeyRangeRef range) {
+	if (watchIndex.empty()) {
+		return;
+	}
+	for (auto it = watchIndex.lower_bound(range.begin); it != watchIndex.end() && it->first < range.end; ++it) {
+		touchWatch(this, it->second);
+	}
+}
+
+// Fires the watches of the given tenant in range with an error
+void StorageServer::failWatches(KeyRangeRef range, int64_t tenantId, Error const& e) {
+	std::vector<Reference<ServerWatchMetadata>> failed;
+	for (auto it = watchIndex.lower_bound(range.begin); it != watchIndex.end() && it->first < range.end; ++it) {
+		if (it->second->tenantId == tenantId) {
+			failed.push_back(it->second);
+		}
+	}
+	for (auto& metadata : failed) {
+		unindexWatch(metadata);
+		metadata->watch_impl.cancel();
+		metadata->versionPromise.sendError(e);
+	}
+}
+
 #ifndef __INTEL_COMPILER
 #pragma endregion
 #endif
@@ -2630,6 +2786,148 @@ ACTOR Future<Void> getValueQ(StorageServer* data, GetValueRequest req) {
 	return Void();
 }
 
+// The batched form of getValueQ. All of the keys are read after a single wait for the version, and the ones that are
+// not in the versioned data are read from the storage engine in one readValues() call, in key order. GetValueQueries
+// counts each of the keys.
+ACTOR Future<Void> getValuesQ(StorageServer* data, GetValuesRequest req) {
+	state int64_t resultSize = 0;
+	state int64_t keySize = 0;
+	state std::vector<int> order;
+	state std::vector<int> engineReads;
+	state Future<std::vector<Optional<Value>>> engineValues;
+	state GetValuesReply reply;
+	Span span("SS:getValues"_loc, req.spanContext);
+
+	try {
+		++data->counters.getValuesQueries;
+		data->counters.getValueQueries += req.keys.size();
+		++data->counters.allQueries;
+		for (const auto& key : req.keys) {
+			keySize += key.size();
+			if (key.startsWith(systemKeys.begin)) {
+				++data->counters.systemKeyQueries;
+			}
+		}
+		data->maxQueryQueue = std::max<int>(
+		    data->maxQueryQueue, data->counters.allQueries.getValue() - data->counters.finishedQueries.getValue());
+
+		// Active load balancing runs at a very high priority (to obtain accurate queue lengths)
+		// so we need to downgrade here
+		wait(data->getQueryDelay());
+		state PriorityMultiLock::Lock readLock = wait(data->getReadLock(req.options));
+
+		// Track time from requestTime through now as read queueing wait time
+		state double queueWaitEnd = g_network->timer();
+		data->counters.readQueueWaitSample.addMeasurement(queueWaitEnd - req.requestTime());
+
+		Version commitVersion = getLatestCommitVersion(req.ssLatestCommitVersions, data->tag);
+		state Version version = wait(waitForVersion(data, commitVersion, req.version, req.spanContext));
+		data->counters.readVersionWaitSample.addMeasurement(g_network->timer() - queueWaitEnd);
+
+		data->checkTenantEntry(version, req.tenantInfo, req.options.present() ? req.options.get().lockAware : false);
+		if (req.tenantInfo.hasTenant()) {
+			for (auto& key : req.keys) {
+				key = key.withPrefix(req.tenantInfo.prefix.get(), req.arena);
+			}
+		}
+		state uint64_t changeCounter = data->shardChangeCounter;
+
+		order.reserve(req.keys.size());
+		for (int i = 0; i < req.keys.size(); i++) {
+			order.push_back(i);
+		}
+		std::sort(order.begin(), order.end(), [&](int a, int b) { return req.keys[a] < req.keys[b]; });
+
+		reply.values.resize(reply.arena, req.keys.size());
+		{
+			VectorRef<KeyRef> engineKeys;
+			auto view = data->data().at(version);
+			for (int i : order) {
+				const KeyRef& key = req.keys[i];
+				if (!data->shards[key]->isReadable()) {
+					throw wrong_shard_server();
+				}
+				auto it = view.lastLessOrEqual(key);
+				if (it && it->isValue() && it.key() == key) {
+					reply.values[i] = ValueRef(reply.arena, it->getValue());
+				} else if (!it || !it->isClearTo() || it->getEndKey() <= key) {
+					engineReads.push_back(i);
+					engineKeys.push_back(req.arena, key);
+				}
+			}
+			if (!engineKeys.empty()) {
+				engineValues = data->storage.readValues(engineKeys, req.options);
+			}
+		}
+
+		if (!engineReads.empty()) {
+			wait(success(engineValues));
+			// Validate that while we were reading the data we didn't lose the version or shard
+			if (version < data->storageVersion()) {
+				CODE_PROBE(true, "transaction_too_old after readValues");
+				throw transaction_too_old();
+			}
+			for (int j = 0; j < engineReads.size(); j++) {
+				const int i = engineReads[j];
+				data->checkChangeCounter(changeCounter, req.keys[i]);
+				const Optional<Value>& v = engineValues.get()[j];
+				data->counters.kvGetBytes += v.expectedSize();
+				if (v.present()) {
+					reply.arena.dependsOn(v.get().arena());
+					reply.values[i] = v.get();
+				}
+			}
+		}
+
+		for (int i = 0; i < req.keys.size(); i++) {
+			const KeyRef& key = req.keys[i];
+			const Optional<ValueRef>& v = reply.values[i];
+			if (v.present()) {
+				++data->counters.rowsQueried;
+				resultSize += v.get().size();
+				data->counters.bytesQueried += v.get().size();
+			} else {
+				++data->counters.emptyQueries;
+			}
+
+			if (SERVER_KNOBS->READ_SAMPLING_ENABLED) {
+				// If the read yields no value, randomly sample the empty read.
+				int64_t bytesReadPerKSecond =
+				    v.present() ? std::max((int64_t)(key.size() + v.get().size()), SERVER_KNOBS->EMPTY_READ_PENALTY)
+				                : SERVER_KNOBS->EMPTY_READ_PENALTY;
+				data->metrics.notifyBytesReadPerKSecond(key, bytesReadPerKSecond);
+			}
+
+			// Check if any of the keys might be cached
+			reply.cached = reply.cached || data->cachedRangeMap[key];
+		}
+
+		reply.penalty = data->getPenalty();
+		req.reply.send(reply);
+	} catch (Error& e) {
+		if (!canReplyWith(e))
+			throw;
+		data->sendErrorWithPenalty(req.reply, e, data->getPenalty());
+	}
+
+	// Key size is not included in "BytesQueried", but still contributes to cost,
+	// so it must be accounted for here.
+	data->transactionTagCounter.addRequest(req.tags, keySize + resultSize);
+
+	++data->counters.finishedQueries;
+
+	double duration = g_network->timer() - req.requestTime();
+	data->counters.readLatencySample.addMeasurement(duration);
+	data->counters.readValueLatencySample.addMeasurement(duration);
+	if (data->latencyBandConfig.present()) {
+		int maxReadBytes =
+		    data->latencyBandConfig.get().readConfig.maxReadBytes.orDefault(std::numeric_limits<int>::max());
+		data->counters.readLatencyBands.addMeasurement(duration, 1, Filtered(resultSize > maxReadBytes));
+	}
+
+	return Void();
+}
+
 // Pessimistic estimate the number of overhead bytes used by each
 // watch. Watch key references are stored in an AsyncMap<Key,bool>, and actors
 // must be kept alive until the watch is finished.
@@ -2651,7 +2949,7 @@ ACTOR Future<Version> watchWaitForValueChange(StorageServer* data, SpanContext p
 		                      metadata->debugID.get().first(),
 		                      "watchValueSendReply.AfterVersion"); //.detail("TaskID", g_network->getCurrentTask());
 
-	state Version minVersion = data->data().latestVersion;
+	state Version minVersion = data->data().getLatestVersion();
 	state Future<Void> watchFuture = data->watches.onChange(metadata->key);
 	if (tenantId != TenantInfo::INVALID_TENANT) {
 		watchFuture = watchFuture || data->tenantWatches.onChange(tenantId);
@@ -2670,7 +2968,7 @@ ACTOR Future<Version> watchWaitForValueChange(StorageServer* data, SpanContext p
 			state Version latest = data->version.get();
 			options.debugID = metadata->debugID;
 
-			CODE_PROBE(latest >= minVersion && latest < data->data().latestVersion,
+			CODE_PROBE(latest >= minVersion && latest < data->data().getLatestVersion(),
 			           "Starting watch loop with latestVersion > data->version",
 			           probe::decoration::rare);
 			GetValueRequest getReq(
@@ -2760,7 +3058,152 @@ ACTOR Future<Version> watchWaitForValueChange(StorageServer* data, SpanContext p
 			watchFuture = watchFuture || data->tenantWatches.onChange(tenantId);
 		}
 
-		wait(data->version.whenAtLeast(data->data().latestVersion));
+		wait(data->version.whenAtLeast(data->data().getLatestVersion()));
+	}
+}
+
+// Reads a watched key, and then either fires its watch or leaves it idle in the index until a mutation touches the key.
+// Only used with STORAGE_SERVER_WATCH_INDEX.
+ACTOR Future<Version> watchIndexRead(StorageServer* data, SpanContext parent, KeyRef key, int64_t tenantId) {
+	state Span span("SS:watchIndexRead"_loc, parent);
+	state Reference<ServerWatchMetadata> metadata = data->getWatchMetadata(key, tenantId);
+	state Version minVersion = metadata->version;
+	state ReadOptions options;
+
+	if (!metadata->indexed) {
+		data->indexWatch(metadata);
+	}
+	metadata->reading = true;
+	try {
+		loop {
+			try {
+				wait(success(waitForVersionNoTooOld(data, minVersion)));
+				if (tenantId != TenantInfo::INVALID_TENANT) {
+					auto view = data->tenantMap.at(latestVersion);
+					if (view.find(tenantId) == view.end()) {
+						CODE_PROBE(true, "Watched tenant removed with the watch index");
+						throw tenant_removed();
+					}
+				}
+
+				// Mutations applied from here on touch the watch, and the ones already applied are at or below
+				// minVersion, so the key has to be read at minVersion at least for the watch to be idle.
+				metadata->touched = false;
+				minVersion = std::max(data->data().getLatestVersion(), metadata->version);
+				state Version latest = data->version.get();
+				options.debugID = metadata->debugID;
+
+				GetValueRequest getReq(
+				    span.context, TenantInfo(), metadata->key, latest, metadata->tags, options, VersionVector());
+				state Future<Void> getValue = getValueQ(data, getReq);
+				GetValueReply reply = wait(getReq.reply.getFuture());
+
+				if (reply.error.present()) {
+					ASSERT(reply.error.get().code() != error_code_future_version);
+					throw reply.error.get();
+				}
+				if (BUGGIFY) {
+					throw transaction_too_old();
+				}
+
+				if (reply.value != metadata->value && latest >= metadata->version) {
+					if (metadata->touchTime > 0) {
+						data->counters.watchFireLatencySample.addMeasurement(now() - metadata->touchTime);
+					}
+					data->unindexWatch(metadata);
+					metadata->versionPromise.send(latest);
+					return latest;
+				}
+
+				if (data->watchBytes > SERVER_KNOBS->MAX_STORAGE_SERVER_WATCH_BYTES) {
+					CODE_PROBE(true, "Too many watches in the watch index, reverting to polling");
+					throw watch_cancelled();
+				}
+
+				if (!metadata->touched && latest >= minVersion) {
+					metadata->reading = false;
+					return invalidVersion;
+				}
+			} catch (Error& e) {
+				if (e.code() != error_code_transaction_too_old) {
+					throw;
+				}
+				CODE_PROBE(true, "Reading a key watched with the watch index failed with transaction_too_old");
+			}
+		}
+	} catch (Error& e) {
+		if (e.code() == error_code_actor_cancelled || !metadata->indexed) {
+			throw;
+		}
+		data->unindexWatch(metadata);
+		metadata->versionPromise.sendError(e);
+		throw;
+	}
+}
+
+static void readIndexedWatch(StorageServer* data, Reference<ServerWatchMetadata> const& metadata) {
+	metadata->watch_impl = watchIndexRead(data, SpanContext(), metadata->key, metadata->tenantId);
+}
+
+// Starts watching a key whose metadata has just been added to watchMap
+void startWatch(StorageServer* data, SpanContext spanContext, Reference<ServerWatchMetadata> metadata) {
+	KeyRef key = data->setWatchMetadata(metadata);
+	if (SERVER_KNOBS->STORAGE_SERVER_WATCH_INDEX) {
+		metadata->watch_impl = watchIndexRead(data, spanContext, key, metadata->tenantId);
+	} else {
+		metadata->watch_impl =
+		    forward(watchWaitForValueChange(data, spanContext, key, metadata->tenantId), metadata->versionPromise);
+	}
+}
+
+// Checks the watches touched by the mutations of the versions applied since the last call against the latest version
+// of the in-memory data, firing the ones whose value changed. A touched key is almost always in the in-memory data,
+// since the mutation that touched it is; the others are read again.
+void checkTouchedWatches(StorageServer* data) {
+	if (data->touchedWatches.empty()) {
+		return;
+	}
+	std::vector<Reference<ServerWatchMetadata>> touched;
+	std::swap(touched, data->touchedWatches);
+
+	const Version version = data->version.get();
+	auto view = data->data().atLatest();
+	for (auto& metadata : touched) {
+		if (!metadata->indexed || metadata->reading || !metadata->touched) {
+			continue;
+		}
+		metadata->touched = false;
+
+		auto it = view.lastLessOrEqual(metadata->key);
+		Optional<ValueRef> value;
+		if (it && it.key() == metadata->key && it->isValue()) {
+			value = it->getValue();
+		} else if (!it || !it->isClearTo() || it->getEndKey() <= metadata->key || metadata->version > version) {
+			readIndexedWatch(data, metadata);
+			continue;
+		}
+
+		if (value != metadata->value.castTo<ValueRef>()) {
+			data->counters.watchFireLatencySample.addMeasurement(now() - metadata->touchTime);
+			data->unindexWatch(metadata);
+			metadata->versionPromise.send(version);
+		}
+	}
+}
+
+// Reads the watched keys in range again, which for instance fails their watches once the range is no longer readable
+void readIndexedWatches(StorageServer* data, KeyRangeRef range) {
+	std::vector<Reference<ServerWatchMetadata>> idle;
+	for (auto it = data->watchIndex.lower_bound(range.begin); it != data->watchIndex.end() && it->first < range.end;
+	     ++it) {
+		if (!it->second->reading) {
+			idle.push_back(it->second);
+		}
+	}
+	for (auto& metadata : idle) {
+		if (metadata->indexed && !metadata->reading) {
+			readIndexedWatch(data, metadata);
+		}
 	}
 }
 
@@ -4139,6 +4582,17 @@ void merge(Arena& arena,
 	int accumulatedBytes = 0;
 	KeyValueRef const* baseStart = base.begin();
 	KeyValueRef const* baseEnd = base.end();
+
+	// If there are no newer rows to merge and no prefix to remove, the output can share base's rows instead of
+	// copying them. A later push_back reallocates, since the capacity does not go beyond them.
+	if (output.empty() && vCount == 0 && !tenantPrefix.present()) {
+		while (baseStart != baseEnd && baseStart - base.begin() < limit && accumulatedBytes < limitBytes) {
+			accumulatedBytes += sizeof(KeyValueRef) + (baseStart++)->expectedSize();
+		}
+		output = VectorRef<KeyValueRef>(const_cast<KeyValueRef*>(base.begin()), baseStart - base.begin());
+		return;
+	}
+
 	while (baseStart != baseEnd && vCount > 0 && output.size() < adjustedLimit && accumulatedBytes < limitBytes) {
 		if (forward ? baseStart->key < vm_output[pos].key : baseStart->key > vm_output[pos].key) {
 			output.push_back(arena, removePrefix(*baseStart++, tenantPrefix));
@@ -6851,6 +7305,119 @@ ACTOR Future<Void> getMappedKeyValuesQ(StorageServer* data, GetMappedKeyValuesRe
 	return Void();
 }
 
+// Reads the chunks of a range stream in [begin, end) into chunks, taking a permit of readAheadLock for each one so that
+// only a bounded number of them wait to be sent. Ends chunks with end_of_stream after the last one, or with the error.
+ACTOR Future<Void> readRangeStreamChunks(StorageServer* data,
+                                         GetKeyValuesStreamRequest* req,
+                                         Version version,
+                                         Key begin,
+                                         Key end,
+                                         uint64_t changeCounter,
+                                         SpanContext spanContext,
+                                         Reference<FlowLock> readAheadLock,
+                                         PromiseStream<GetKeyValuesStreamReply> chunks) {
+	state int64_t resultSize = 0;
+	try {
+		loop {
+			wait(readAheadLock->take());
+			state PriorityMultiLock::Lock readLock = wait(data->getReadLock(req->options));
+
+			if (version < data->oldestVersion.get()) {
+				throw transaction_too_old();
+			}
+
+			// Even if TSS mode is Disabled, this may be the second test in a restarting test where the first run
+			// had it enabled.
+			state int byteLimit =
+			    (BUGGIFY && g_network->isSimulated() && g_simulator->tssMode == ISimulator::TSSMode::Disabled &&
+			     !data->isTss() && !data->isSSWithTSSPair())
+			        ? 1
+			        : CLIENT_KNOBS->REPLY_BYTE_LIMIT;
+			TraceEvent(SevDebug, "SSGetKeyValueStreamLimits")
+			    .detail("ByteLimit", byteLimit)
+			    .detail("ReqLimit", req->limit)
+			    .detail("Begin", begin.printable())
+			    .detail("End", end.printable());
+
+			GetKeyValuesReply _r = wait(readRange(data,
+			                                      version,
+			                                      KeyRangeRef(begin, end),
+			                                      req->limit,
+			                                      &byteLimit,
+			                                      spanContext,
+			                                      req->options,
+			                                      req->tenantInfo.prefix));
+			readLock.release();
+			GetKeyValuesStreamReply r(_r);
+
+			if (req->options.present() && req->options.get().debugID.present())
+				g_traceBatch.addEvent("TransactionDebug",
+				                      req->options.get().debugID.get().first(),
+				                      "storageserver.getKeyValuesStream.AfterReadRange");
+			//.detail("Begin",begin).detail("End",end).detail("SizeOf",r.data.size());
+			data->checkChangeCounter(
+			    changeCounter,
+			    KeyRangeRef(std::min<KeyRef>(begin, std::min<KeyRef>(req->begin.getKey(), req->end.getKey())),
+			                std::max<KeyRef>(end, std::max<KeyRef>(req->begin.getKey(), req->end.getKey()))));
+			if (EXPENSIVE_VALIDATION) {
+				for (int i = 0; i < r.data.size(); i++) {
+					if (req->tenantInfo.hasTenant()) {
+						ASSERT(r.data[i].key >= begin.removePrefix(req->tenantInfo.prefix.get()) &&
+						       r.data[i].key < end.removePrefix(req->tenantInfo.prefix.get()));
+					} else {
+						ASSERT(r.data[i].key >= begin && r.data[i].key < end);
+					}
+				}
+				ASSERT(r.data.size() <= std::abs(req->limit));
+			}
+
+			// For performance concerns, the cost of a range read is billed to the start key and end key of the
+			// range.
+			int64_t totalByteSize = 0;
+			for (int i = 0; i < r.data.size(); i++) {
+				totalByteSize += r.data[i].expectedSize();
+			}
+
+			KeyRef lastKey;
+			if (!r.data.empty()) {
+				lastKey = addPrefix(r.data.back().key, req->tenantInfo.prefix, req->arena);
+			}
+			if (totalByteSize > 0 && SERVER_KNOBS->READ_SAMPLING_ENABLED) {
+				int64_t bytesReadPerKSecond = std::max(totalByteSize, SERVER_KNOBS->EMPTY_READ_PENALTY) / 2;
+				KeyRef firstKey = addPrefix(r.data[0].key, req->tenantInfo.prefix, req->arena);
+				data->metrics.notifyBytesReadPerKSecond(firstKey, bytesReadPerKSecond);
+				data->metrics.notifyBytesReadPerKSecond(lastKey, bytesReadPerKSecond);
+			}
+
+			chunks.send(r);
+
+			data->counters.rowsQueried += r.data.size();
+			if (r.data.size() == 0) {
+				++data->counters.emptyQueries;
+			}
+			if (!r.more) {
+				chunks.sendError(end_of_stream());
+				break;
+			}
+			ASSERT(r.data.size());
+
+			if (req->limit >= 0) {
+				begin = keyAfter(lastKey);
+			} else {
+				end = lastKey;
+			}
+
+			data->transactionTagCounter.addRequest(req->tags, resultSize);
+		}
+	} catch (Error& e) {
+		if (e.code() == error_code_actor_cancelled) {
+			throw;
+		}
+		chunks.sendError(e);
+	}
+	return Void();
+}
+
 ACTOR Future<Void> getKeyValuesStreamQ(StorageServer* data, GetKeyValuesStreamRequest req)
 // Throws a wrong_shard_server if the keys in the request or result depend on data outside this server OR if a large
 // selector offset prevents all data from being read in one range read
@@ -6956,97 +7523,27 @@ ACTOR Future<Void> getKeyValuesStreamQ(StorageServer* data, GetKeyValuesStreamRe
 			req.reply.send(none);
 			req.reply.sendError(end_of_stream());
 		} else {
+			// Chunks are read ahead of the client, up to RANGESTREAM_READ_AHEAD_CHUNKS of them waiting to be sent
+			state Reference<FlowLock> readAheadLock =
+			    makeReference<FlowLock>(std::max(1, SERVER_KNOBS->RANGESTREAM_READ_AHEAD_CHUNKS));
+			state PromiseStream<GetKeyValuesStreamReply> chunks;
+			state Future<Void> reader = readRangeStreamChunks(
+			    data, &req, version, begin, end, changeCounter, span.context, readAheadLock, chunks);
 			loop {
-				wait(req.reply.onReady());
-				state PriorityMultiLock::Lock readLock = wait(data->getReadLock(req.options));
-
-				if (version < data->oldestVersion.get()) {
-					throw transaction_too_old();
-				}
-
-				// Even if TSS mode is Disabled, this may be the second test in a restarting test where the first run
-				// had it enabled.
-				state int byteLimit =
-				    (BUGGIFY && g_network->isSimulated() && g_simulator->tssMode == ISimulator::TSSMode::Disabled &&
-				     !data->isTss() && !data->isSSWithTSSPair())
-				        ? 1
-				        : CLIENT_KNOBS->REPLY_BYTE_LIMIT;
-				TraceEvent(SevDebug, "SSGetKeyValueStreamLimits")
-				    .detail("ByteLimit", byteLimit)
-				    .detail("ReqLimit", req.limit)
-				    .detail("Begin", begin.printable())
-				    .detail("End", end.printable());
-
-				GetKeyValuesReply _r = wait(readRange(data,
-				                                      version,
-				                                      KeyRangeRef(begin, end),
-				                                      req.limit,
-				                                      &byteLimit,
-				                                      span.context,
-				                                      req.options,
-				                                      req.tenantInfo.prefix));
-				readLock.release();
-				GetKeyValuesStreamReply r(_r);
-
-				if (req.options.present() && req.options.get().debugID.present())
-					g_traceBatch.addEvent("TransactionDebug",
-					                      req.options.get().debugID.get().first(),
-					                      "storageserver.getKeyValuesStream.AfterReadRange");
-				//.detail("Begin",begin).detail("End",end).detail("SizeOf",r.data.size());
-				data->checkChangeCounter(
-				    changeCounter,
-				    KeyRangeRef(std::min<KeyRef>(begin, std::min<KeyRef>(req.begin.getKey(), req.end.getKey())),
-				                std::max<KeyRef>(end, std::max<KeyRef>(req.begin.getKey(), req.end.getKey()))));
-				if (EXPENSIVE_VALIDATION) {
-					for (int i = 0; i < r.data.size(); i++) {
-						if (req.tenantInfo.hasTenant()) {
-							ASSERT(r.data[i].key >= begin.removePrefix(req.tenantInfo.prefix.get()) &&
-							       r.data[i].key < end.removePrefix(req.tenantInfo.prefix.get()));
-						} else {
-							ASSERT(r.data[i].key >= begin && r.data[i].key < end);
-						}
+				state GetKeyValuesStreamReply r;
+				try {
+					GetKeyValuesStreamReply _r = waitNext(chunks.getFuture());
+					r = _r;
+				} catch (Error& e) {
+					if (e.code() != error_code_end_of_stream) {
+						throw;
 					}
-					ASSERT(r.data.size() <= std::abs(req.limit));
-				}
-
-				// For performance concerns, the cost of a range read is billed to the start key and end key of the
-				// range.
-				int64_t totalByteSize = 0;
-				for (int i = 0; i < r.data.size(); i++) {
-					totalByteSize += r.data[i].expectedSize();
-				}
-
-				KeyRef lastKey;
-				if (!r.data.empty()) {
-					lastKey = addPrefix(r.data.back().key, req.tenantInfo.prefix, req.arena);
-				}
-				if (totalByteSize > 0 && SERVER_KNOBS->READ_SAMPLING_ENABLED) {
-					int64_t bytesReadPerKSecond = std::max(totalByteSize, SERVER_KNOBS->EMPTY_READ_PENALTY) / 2;
-					KeyRef firstKey = addPrefix(r.data[0].key, req.tenantInfo.prefix, req.arena);
-					data->metrics.notifyBytesReadPerKSecond(firstKey, bytesReadPerKSecond);
-					data->metrics.notifyBytesReadPerKSecond(lastKey, bytesReadPerKSecond);
-				}
-
-				req.reply.send(r);
-
-				data->counters.rowsQueried += r.data.size();
-				if (r.data.size() == 0) {
-					++data->counters.emptyQueries;
-				}
-				if (!r.more) {
 					req.reply.sendError(end_of_stream());
 					break;
 				}
-				ASSERT(r.data.size());
-
-				if (req.limit >= 0) {
-					begin = keyAfter(lastKey);
-				} else {
-					end = lastKey;
-				}
-
-				data->transactionTagCounter.addRequest(req.tags, resultSize);
-				// lock.release();
+				wait(req.reply.onReady());
+				req.reply.send(r);
+				readAheadLock->release();
 			}
 		}
 	} catch (Error& e) {
@@ -7211,19 +7708,29 @@ ACTOR Future<Void> doEagerReads(StorageServer* data, UpdateEagerReadInfo* eager)
 		eager->keyEnd = keyEndVal;
 	}
 
-	std::vector<Future<Optional<Value>>> value(eager->keys.size());
-	for (int i = 0; i < value.size(); i++)
-		value[i] = data->storage.readValuePrefix(eager->keys[i].first, eager->keys[i].second, options);
-
-	state Future<std::vector<Optional<Value>>> futureValues = getAll(value);
+	// The keys are sorted, so they are read with one readValues() and each value is cut to the prefix its
+	// mutations need, as readValuePrefix() would
+	state Future<std::vector<Optional<Value>>> futureValues = std::vector<Optional<Value>>();
+	if (!eager->keys.empty()) {
+		VectorRef<KeyRef> keys;
+		keys.reserve(eager->arena, eager->keys.size());
+		for (const auto& [key, _] : eager->keys) {
+			keys.push_back(eager->arena, key);
+		}
+		futureValues = data->storage.readValues(keys, options);
+	}
 	std::vector<Optional<Value>> optionalValues = wait(futureValues);
-	for (const auto& value : optionalValues) {
+	eager->value = optionalValues;
+	for (int i = 0; i < eager->value.size(); i++) {
+		auto& value = eager->value[i];
 		if (value.present()) {
 			data->counters.kvGetBytes += value.expectedSize();
+			if (value.get().size() > eager->keys[i].second) {
+				value = Value(value.get().substr(0, eager->keys[i].second), value.get().arena());
+			}
 		}
 	}
 	data->counters.eagerReadsKeys += eager->keys.size();
-	eager->value = optionalValues;
 
 	return Void();
 }
@@ -7251,9 +7758,9 @@ bool changeDurableVersion(StorageServer* data, Version desiredDurableVersion) {
 		if (verData.getLatestVersion() <= data->version.get())
 			verData.createNewVersion(data->version.get() + 1);
 
-		int64_t bytesDurable = VERSION_OVERHEAD;
+		int64_t bytesDurable = data->versionOverhead();
 		for (const auto& m : v.mutations) {
-			bytesDurable += mvccStorageBytes(m);
+			bytesDurable += data->mvccStorageBytes(m);
 			auto i = verData.atLatest().find(m.param1);
 			if (i) {
 				ASSERT(i.key() == m.param1);
@@ -7441,7 +7948,7 @@ void applyMutation(StorageServer* self,
 	// Clear split keys are added to arena
 	StorageMetrics metrics;
 	// FIXME: remove the / 2 and double the related knobs.
-	metrics.bytesWrittenPerKSecond = mvccStorageBytes(m) / 2; // comparable to counter.bytesInput / 2
+	metrics.bytesWrittenPerKSecond = self->mvccStorageBytes(m) / 2; // comparable to counter.bytesInput / 2
 	metrics.iosPerKSecond = 1;
 	self->metrics.notify(m.param1, metrics);
 
@@ -7470,7 +7977,11 @@ void applyMutation(StorageServer* self,
 			++self->counters.pTreeClearSplits;
 		}
 		data.insert(m.param1, ValueOrClearToRef::value(m.param2));
-		self->watches.trigger(m.param1);
+		if (SERVER_KNOBS->STORAGE_SERVER_WATCH_INDEX) {
+			self->touchWatches(m.param1);
+		} else {
+			self->watches.trigger(m.param1);
+		}
 		++self->counters.pTreeSets;
 	} else if (m.type == MutationRef::ClearRange) {
 		data.erase(m.param1, m.param2);
@@ -7479,11 +7990,73 @@ void applyMutation(StorageServer* self,
 			ASSERT(!data.isClearContaining(data.atLatest(), m.param1));
 		}
 		data.insert(m.param1, ValueOrClearToRef::clearTo(m.param2));
-		self->watches.triggerRange(m.param1, m.param2);
+		if (SERVER_KNOBS->STORAGE_SERVER_WATCH_INDEX) {
+			self->touchWatches(KeyRangeRef(m.param1, m.param2));
+		} else {
+			self->watches.triggerRange(m.param1, m.param2);
+		}
 		++self->counters.pTreeClears;
 	}
 }
 
+// A mutation added to several change feeds is copied once, into an arena of its own that the feeds' entries depend on,
+// so the memory of change feeds grows with the mutations written rather than with the number of feeds they overlap.
+// The copy is not made in the first feed's entry, since entries of two feeds could then end up depending on each other.
+// A mutation added to a single feed is copied into its entry, as that costs no more than a shared copy.
+class SharedFeedMutation {
+public:
+	// feeds is the number of feeds the mutation is added to
+	explicit SharedFeedMutation(int feeds) : feeds(feeds) {}
+
+	bool isShared() const { return feeds > 1 && SERVER_KNOBS->CHANGE_FEED_SHARE_MUTATIONS; }
+
+	// Returns m in memory that lives at least as long as to
+	MutationRef get(MutationRef const& m, Arena& to) {
+		if (!isShared()) {
+			return MutationRef(to, m);
+		}
+		if (!copy.present()) {
+			arena = Arena(m.expectedSize());
+			copy = MutationRef(arena, m);
+		}
+		to.dependsOn(arena);
+		return copy.get();
+	}
+
+	// Bytes of feed memory taken by adding m to one of the feeds. A shared copy is charged to the feeds in equal parts,
+	// so that the feed memory released as each of them is made durable or popped adds up to the copy.
+	int64_t feedBytes(MutationRef const& m) const {
+		return isShared() ? sizeof(MutationRef) + (m.expectedSize() + feeds - 1) / feeds : m.totalSize();
+	}
+
+private:
+	const int feeds;
+	Arena arena;
+	Optional<MutationRef> copy;
+};
+
+bool changeFeedAcceptsVersion(ChangeFeedInfo const& feed, Version version) {
+	return version < feed.stopVersion && !feed.removing && version > feed.emptyVersion;
+}
+
+// Clamps a clear to the range of a feed, and returns whether the feed gets a clear of its own rather than m
+bool clampChangeFeedClear(MutationRef const& m, KeyRangeRef feedRange, KeyRangeRef shard, MutationRef& clear) {
+	clear = m;
+	bool modified = false;
+	if (clear.param1 < feedRange.begin) {
+		clear.param1 = feedRange.begin;
+		modified = true;
+	}
+	if (clear.param2 > feedRange.end) {
+		clear.param2 = feedRange.end;
+		modified = true;
+	}
+	if (!modified && (clear.param1 == shard.begin || clear.param2 == shard.end)) {
+		modified = true;
+	}
+	return modified;
+}
+
 void applyChangeFeedMutation(StorageServer* self,
                              MutationRef const& m,
                              MutationRefAndCipherKeys const& encryptedMutation,
@@ -7493,28 +8066,39 @@ void applyChangeFeedMutation(StorageServer* self,
 	ASSERT(!self->encryptionMode.get().isEncryptionEnabled() || encryptedMutation.mutation.isEncrypted() ||
 	       isBackupLogMutation(m) || mutationForKey(m, lastEpochEndPrivateKey));
 	if (m.type == MutationRef::SetValue) {
-		for (auto& it : self->keyChangeFeed[m.param1]) {
-			if (version < it->stopVersion && !it->removing && version > it->emptyVersion) {
+		auto& feeds = self->keyChangeFeed[m.param1];
+		int sharingFeeds = 0;
+		if (feeds.size() > 1) {
+			for (auto& it : feeds) {
+				sharingFeeds += changeFeedAcceptsVersion(*it, version);
+			}
+		}
+		SharedFeedMutation shared(sharingFeeds);
+		SharedFeedMutation sharedEncrypted(sharingFeeds);
+		for (auto& it : feeds) {
+			if (changeFeedAcceptsVersion(*it, version)) {
 				if (it->mutations.empty() || it->mutations.back().version != version) {
 					it->mutations.push_back(
 					    EncryptedMutationsAndVersionRef(version, self->knownCommittedVersion.get()));
 				}
+				const int64_t feedBytes = shared.feedBytes(m);
+				auto& entry = it->mutations.back();
 				if (encryptedMutation.mutation.isValid()) {
-					if (!it->mutations.back().encrypted.present()) {
-						it->mutations.back().encrypted = it->mutations.back().mutations;
-						it->mutations.back().cipherKeys.resize(it->mutations.back().mutations.size());
+					if (!entry.encrypted.present()) {
+						entry.encrypted = entry.mutations;
+						entry.cipherKeys.resize(entry.mutations.size());
 					}
-					it->mutations.back().encrypted.get().push_back_deep(it->mutations.back().arena(),
-					                                                    encryptedMutation.mutation);
-					it->mutations.back().cipherKeys.push_back(encryptedMutation.cipherKeys);
-				} else if (it->mutations.back().encrypted.present()) {
-					it->mutations.back().encrypted.get().push_back_deep(it->mutations.back().arena(), m);
-					it->mutations.back().cipherKeys.push_back(TextAndHeaderCipherKeys());
+					entry.encrypted.get().push_back(entry.arena(),
+					                                sharedEncrypted.get(encryptedMutation.mutation, entry.arena()));
+					entry.cipherKeys.push_back(encryptedMutation.cipherKeys);
+				} else if (entry.encrypted.present()) {
+					entry.encrypted.get().push_back(entry.arena(), shared.get(m, entry.arena()));
+					entry.cipherKeys.push_back(TextAndHeaderCipherKeys());
 				}
-				it->mutations.back().mutations.push_back_deep(it->mutations.back().arena(), m);
+				entry.mutations.push_back(entry.arena(), shared.get(m, entry.arena()));
 
 				self->currentChangeFeeds.insert(it->id);
-				self->addFeedBytesAtVersion(m.totalSize(), version);
+				self->addFeedBytesAtVersion(feedBytes, version);
 
 				DEBUG_MUTATION("ChangeFeedWriteSet", version, m, self->thisServerID)
 				    .detail("Range", it->range)
@@ -7537,51 +8121,56 @@ void applyChangeFeedMutation(StorageServer* self,
 		KeyRangeRef mutationClearRange(m.param1, m.param2);
 		// FIXME: this might double-insert clears if the same feed appears in multiple sub-ranges
 		auto ranges = self->keyChangeFeed.intersectingRanges(mutationClearRange);
+		// Only the feeds that get the clear unchanged can share it
+		int sharingFeeds = 0;
+		MutationRef clearMutation;
+		for (auto& r : ranges) {
+			for (auto& it : r.value()) {
+				sharingFeeds += changeFeedAcceptsVersion(*it, version) &&
+				                !clampChangeFeedClear(m, it->range, shard, clearMutation);
+			}
+		}
+		SharedFeedMutation shared(sharingFeeds);
+		SharedFeedMutation sharedEncrypted(sharingFeeds);
 		for (auto& r : ranges) {
 			for (auto& it : r.value()) {
-				if (version < it->stopVersion && !it->removing && version > it->emptyVersion) {
+				if (changeFeedAcceptsVersion(*it, version)) {
 					// clamp feed mutation to change feed range
-					MutationRef clearMutation = m;
-					bool modified = false;
-					if (clearMutation.param1 < it->range.begin) {
-						clearMutation.param1 = it->range.begin;
-						modified = true;
-					}
-					if (clearMutation.param2 > it->range.end) {
-						clearMutation.param2 = it->range.end;
-						modified = true;
-					}
-					if (!modified && (clearMutation.param1 == shard.begin || clearMutation.param2 == shard.end)) {
-						modified = true;
-					}
+					const bool modified = clampChangeFeedClear(m, it->range, shard, clearMutation);
 					if (it->mutations.empty() || it->mutations.back().version != version) {
 						it->mutations.push_back(
 						    EncryptedMutationsAndVersionRef(version, self->knownCommittedVersion.get()));
 					}
+					// Clears clamped to the feed's range differ between feeds and are copied into each of them
+					const int64_t feedBytes = modified ? m.totalSize() : shared.feedBytes(m);
+					auto& entry = it->mutations.back();
 					if (encryptedMutation.mutation.isEncrypted()) {
-						if (!it->mutations.back().encrypted.present()) {
-							it->mutations.back().encrypted = it->mutations.back().mutations;
-							it->mutations.back().cipherKeys.resize(it->mutations.back().mutations.size());
+						if (!entry.encrypted.present()) {
+							entry.encrypted = entry.mutations;
+							entry.cipherKeys.resize(entry.mutations.size());
 						}
 						if (modified) {
-							it->mutations.back().encrypted.get().push_back_deep(
-							    it->mutations.back().arena(),
-							    clearMutation.encrypt(encryptedMutation.cipherKeys,
-							                          it->mutations.back().arena(),
-							                          BlobCipherMetrics::TLOG));
+							entry.encrypted.get().push_back_deep(
+							    entry.arena(),
+							    clearMutation.encrypt(
+							        encryptedMutation.cipherKeys, entry.arena(), BlobCipherMetrics::TLOG));
 						} else {
-							it->mutations.back().encrypted.get().push_back_deep(it->mutations.back().arena(),
-							                                                    encryptedMutation.mutation);
+							entry.encrypted.get().push_back(
+							    entry.arena(), sharedEncrypted.get(encryptedMutation.mutation, entry.arena()));
 						}
-						it->mutations.back().cipherKeys.push_back(encryptedMutation.cipherKeys);
-					} else if (it->mutations.back().encrypted.present()) {
-						it->mutations.back().encrypted.get().push_back_deep(it->mutations.back().arena(), m);
-						it->mutations.back().cipherKeys.push_back(TextAndHeaderCipherKeys());
+						entry.cipherKeys.push_back(encryptedMutation.cipherKeys);
+					} else if (entry.encrypted.present()) {
+						entry.encrypted.get().push_back(entry.arena(), shared.get(m, entry.arena()));
+						entry.cipherKeys.push_back(TextAndHeaderCipherKeys());
 					}
 
-					it->mutations.back().mutations.push_back_deep(it->mutations.back().arena(), clearMutation);
+					if (modified) {
+						entry.mutations.push_back_deep(entry.arena(), clearMutation);
+					} else {
+						entry.mutations.push_back(entry.arena(), shared.get(m, entry.arena()));
+					}
 					self->currentChangeFeeds.insert(it->id);
-					self->addFeedBytesAtVersion(m.totalSize(), version);
+					self->addFeedBytesAtVersion(feedBytes, version);
 
 					DEBUG_MUTATION("ChangeFeedWriteClear", version, m, self->thisServerID)
 					    .detail("Range", it->range)
@@ -7855,6 +8444,97 @@ ACTOR Future<Void> tryGetRange(PromiseStream<RangeResult> results, Transaction*
 	}
 }
 
+// Reads one sub-range of a parallel fetch into its fragment, see tryGetRangeParallel(). Every sub-range but the last
+// ends with a block reading through its end, so that the fetched data is written with no gap between the sub-ranges.
+ACTOR Future<Void> tryGetRangeFragment(StorageServer* data,
+                                       ParallelStream<RangeResult>::Fragment* results,
+                                       Transaction* tr,
+                                       KeyRange keys,
+                                       bool last,
+                                       int64_t permits) {
+	state FlowLock::Releaser holdingBytes(data->fetchKeysParallelBytesLock, permits);
+	state KeySelectorRef begin = firstGreaterOrEqual(keys.begin);
+	state KeySelectorRef end = firstGreaterOrEqual(keys.end);
+
+	try {
+		loop {
+			GetRangeLimits limits(GetRangeLimits::ROW_LIMIT_UNLIMITED, SERVER_KNOBS->FETCH_BLOCK_BYTES);
+			limits.minRows = 0;
+			state RangeResult rep = wait(tr->getRange(begin, end, limits, Snapshot::True));
+			state bool more = rep.more;
+			if (!more && !last) {
+				rep.more = true;
+				rep.readThrough = KeyRef(rep.arena(), keys.end);
+			}
+			if (more) {
+				begin = rep.nextBeginKeySelector();
+			}
+			results->send(rep);
+
+			if (!more) {
+				// Keep the bytes until the fragment has been merged into the fetch
+				wait(results->onEmpty());
+				results->finish();
+				return Void();
+			}
+		}
+	} catch (Error& e) {
+		if (e.code() == error_code_actor_cancelled) {
+			throw;
+		}
+		results->sendError(e);
+		return Void();
+	}
+}
+
+// Reads keys like tryGetRange(), but as sub-ranges split at the byte sample of the source servers, up to
+// FETCH_KEYS_PARALLEL_RANGES of which are read at once. Each read is load balanced on its own, so the sub-ranges are
+// spread over the source replicas. The blocks are still sent in key order, and are written as they arrive.
+ACTOR Future<Void> tryGetRangeParallel(StorageServer* data,
+                                       PromiseStream<RangeResult> results,
+                                       Transaction* tr,
+                                       KeyRange keys) {
+	state ParallelStream<RangeResult> stream(results, SERVER_KNOBS->FETCH_KEYS_PARALLEL_RANGES);
+	state std::vector<Future<Void>> fragments;
+	state Standalone<VectorRef<KeyRef>> boundaries;
+	state int64_t permits = std::min<int64_t>(SERVER_KNOBS->FETCH_KEYS_PARALLEL_RANGE_BYTES,
+	                                          SERVER_KNOBS->FETCH_KEYS_PARALLEL_BYTES);
+	state int i = 1;
+
+	try {
+		Standalone<VectorRef<KeyRef>> splitPoints =
+		    wait(tr->getRangeSplitPoints(keys, SERVER_KNOBS->FETCH_KEYS_PARALLEL_RANGE_BYTES));
+		boundaries.arena().dependsOn(splitPoints.arena());
+		for (const KeyRef& key : splitPoints) {
+			if (key > keys.begin && key < keys.end && (boundaries.empty() || key > boundaries.back())) {
+				boundaries.push_back(boundaries.arena(), key);
+			}
+		}
+	} catch (Error& e) {
+		if (e.code() == error_code_actor_cancelled) {
+			throw;
+		}
+		// The split points only speed the fetch up
+		TraceEvent(SevWarn, "FetchKeysSplitPointsError", data->thisServerID).error(e).detail("Keys", keys);
+	}
+	boundaries.push_back(boundaries.arena(), keys.end);
+
+	state KeyRef rangeBegin = keys.begin;
+	for (; i <= boundaries.size(); i++) {
+		state ParallelStream<RangeResult>::Fragment* fragment = wait(stream.createFragment());
+		wait(data->fetchKeysParallelBytesLock.take(TaskPriority::DefaultYield, permits));
+		fragments.push_back(tryGetRangeFragment(data,
+		                                        fragment,
+		                                        tr,
+		                                        KeyRangeRef(rangeBegin, boundaries[i - 1]),
+		                                        i == boundaries.size(),
+		                                        permits));
+		rangeBegin = boundaries[i - 1];
+	}
+	wait(waitForAll(fragments) && stream.finish());
+	return Void();
+}
+
 // Read blob granules metadata. It keeps retrying until reaching maxRetryCount.
 // The key range should not cross tenant boundary.
 ACTOR Future<Standalone<VectorRef<BlobGranuleChunkRef>>> tryReadBlobGranuleChunks(Transaction* tr,
@@ -8181,8 +8861,10 @@ ACTOR Future<Version> fetchChangeFeedApplier(StorageServer* data,
 					}
 					data->storage.writeKeyValue(
 					    KeyValueRef(changeFeedDurableKey(rangeId, remoteVersion),
-					                changeFeedDurableValue(remoteResult[remoteLoc].mutations,
-					                                       remoteResult[remoteLoc].knownCommittedVersion)));
+					                changeFeedDurableValue(
+					                    remoteResult[remoteLoc].mutations,
+					                    remoteResult[remoteLoc].knownCommittedVersion,
+					                    data->changeFeedDurableCompression(remoteResult[remoteLoc].mutations))));
 					++data->counters.kvSystemClearRanges;
 					changeFeedInfo->fetchVersion = std::max(changeFeedInfo->fetchVersion, remoteVersion);
 
@@ -9047,6 +9729,9 @@ ACTOR Future<Void> fetchKeys(StorageServer* data, AddingShard* shard) {
 				    wait(bulkLoadFetchKeyValueFileToLoad(data, bulkLoadLocalDir, bulkLoadTaskState));
 				hold = tryGetRangeForBulkLoad(results, keys, localFileSet.getDataFileFullPath());
 				rangeEnd = keys.end;
+			} else if (SERVER_KNOBS->FETCH_KEYS_PARALLEL_RANGES > 1 && !SERVER_KNOBS->FETCH_USING_STREAMING) {
+				hold = tryGetRangeParallel(data, results, &tr, keys);
+				rangeEnd = keys.end;
 			} else {
 				hold = tryGetRange(results, &tr, keys);
 				rangeEnd = keys.end;
@@ -9109,7 +9794,9 @@ ACTOR Future<Void> fetchKeys(StorageServer* data, AddingShard* shard) {
 					// Write this_block to storage
 					state Standalone<VectorRef<KeyValueRef>> blockData(this_block, this_block.arena());
 					state Key blockEnd =
-					    this_block.size() > 0 && this_block.more ? keyAfter(this_block.back().key) : keys.end;
+					    this_block.more && (this_block.size() > 0 || this_block.readThrough.present())
+					        ? this_block.getReadThrough()
+					        : keys.end;
 					state KeyRange blockRange(KeyRangeRef(blockBegin, blockEnd));
 					wait(data->storage.replaceRange(blockRange, blockData));
 
@@ -9140,6 +9827,8 @@ ACTOR Future<Void> fetchKeys(StorageServer* data, AddingShard* shard) {
 					data->fetchKeysBudgetUsed.set(data->fetchKeysBytesBudget <= 0);
 				}
 			} catch (Error& e) {
+				// Stop reading ahead, which would otherwise hold on to the parallel fetch budget
+				hold = Future<Void>();
 				if (!fetchKeyCanRetry(e)) {
 					throw e;
 				}
@@ -10721,6 +11410,7 @@ void changeServerKeys(StorageServer* data,
 			}
 			data->addShard(ShardInfo::newNotAssigned(range));
 			data->watches.triggerRange(range.begin, range.end);
+			readIndexedWatches(data, range);
 		} else if (!dataAvailable) {
 			// SOMEDAY: Avoid restarting adding/transferred shards
 			// bypass fetchkeys; shard is known empty at initial cluster version
@@ -10984,6 +11674,7 @@ void changeServerKeysWithPhysicalShards(StorageServer* data,
 			updatedShards.push_back(StorageServerShard::notAssigned(range, cVer));
 			data->pendingRemoveRanges[cVer].push_back(range);
 			data->watches.triggerRange(range.begin, range.end);
+			readIndexedWatches(data, range);
 			TraceEvent(sevDm, "SSUnassignShard", data->thisServerID)
 			    .detail("Range", range)
 			    .detail("NowAssigned", nowAssigned)
@@ -11810,6 +12501,7 @@ void StorageServer::clearTenants(StringRef startTenant, StringRef endTenant, Ver
 			// Trigger any watches on the prefix associated with the tenant.
 			TraceEvent("EraseTenant", thisServerID).detail("TenantID", mapKey).detail("Version", version);
 			tenantWatches.sendError(mapKey, mapKey + 1, tenant_removed());
+			failWatches(prefixRange(TenantAPI::idToPrefix(mapKey)), mapKey, tenant_removed());
 			tenantsToClear.insert(mapKey);
 		}
 		addMutationToMutationLog(mLV,
@@ -11823,6 +12515,301 @@ void StorageServer::clearTenants(StringRef startTenant, StringRef endTenant, Ver
 	}
 }
 
+// A chunk of the mutations pulled by one update(), decrypted and with their checksums validated on one of the storage
+// server's updatePrepareThreads. Both passes of update() over the pulled messages use the result, so a mutation is
+// decrypted once rather than once per pass, and neither is done on the network thread. The byte sample hash of each
+// key is computed there too. Entries are indexed by the position of the mutation in the pulled messages, minus begin.
+struct PreparedUpdateMutations : ThreadSafeReferenceCounted<PreparedUpdateMutations> {
+	enum { Pending, Running, Done, Cancelled };
+
+	int begin;
+	std::vector<MutationRef> peeked;
+	const std::unordered_map<BlobCipherDetails, Reference<BlobCipherKey>>* cipherKeys;
+
+	std::vector<MutationRef> mutations;
+	std::vector<bool> validChecksums;
+	// byteSampleKeyHash() of param1, for the mutations that are not clears
+	std::vector<uint32_t> keyHashes;
+	Arena arena;
+	double decryptionTime = 0;
+
+	std::atomic<int> state = Pending;
+
+	PreparedUpdateMutations(int begin,
+	                        const std::unordered_map<BlobCipherDetails, Reference<BlobCipherKey>>* cipherKeys)
+	  : begin(begin), cipherKeys(cipherKeys) {}
+
+	int end() const { return begin + peeked.size(); }
+};
+
+void prepareUpdateMutations(PreparedUpdateMutations& prepared) {
+	prepared.mutations.reserve(prepared.peeked.size());
+	prepared.validChecksums.reserve(prepared.peeked.size());
+	prepared.keyHashes.reserve(prepared.peeked.size());
+	for (const MutationRef& m : prepared.peeked) {
+		if (m.isEncrypted()) {
+			double decryptionTime = 0;
+			prepared.mutations.push_back(
+			    m.decrypt(*prepared.cipherKeys, prepared.arena, BlobCipherMetrics::TLOG, nullptr, &decryptionTime));
+			prepared.validChecksums.push_back(true);
+			prepared.decryptionTime += decryptionTime;
+		} else {
+			prepared.mutations.push_back(m);
+			prepared.validChecksums.push_back(m.validateChecksum());
+		}
+		const MutationRef& decrypted = prepared.mutations.back();
+		prepared.keyHashes.push_back(decrypted.type == MutationRef::ClearRange ? 0
+		                                                                       : byteSampleKeyHash(decrypted.param1));
+	}
+}
+
+struct UpdatePrepareWorker final : IThreadPoolReceiver {
+	void init() override {}
+
+	struct PrepareAction final : TypedAction<UpdatePrepareWorker, PrepareAction> {
+		Reference<PreparedUpdateMutations> prepared;
+		ThreadReturnPromise<Void> result;
+
+		explicit PrepareAction(Reference<PreparedUpdateMutations> prepared) : prepared(prepared) {}
+
+		double getTimeEstimate() const override { return 0; }
+	};
+
+	void action(PrepareAction& a) {
+		int expected = PreparedUpdateMutations::Pending;
+		if (!a.prepared->state.compare_exchange_strong(expected, PreparedUpdateMutations::Running)) {
+			// The update was cancelled, so nobody needs the result
+			return;
+		}
+		Optional<Error> error;
+		try {
+			prepareUpdateMutations(*a.prepared);
+		} catch (Error& e) {
+			error = e;
+		}
+		a.prepared->state.store(PreparedUpdateMutations::Done);
+		if (error.present()) {
+			a.result.sendError(error.get());
+		} else {
+			a.result.send(Void());
+		}
+	}
+};
+
+// Keeps what the chunks of a cancelled update() read, the pulled messages and the cipher keys, until the helper threads
+// are done with them
+ACTOR void releaseAfterPrepared(std::vector<Future<Void>> ready,
+                                Reference<ILogSystem::IPeekCursor> messages,
+                                std::shared_ptr<const std::unordered_map<BlobCipherDetails, Reference<BlobCipherKey>>>
+                                    cipherKeys) {
+	wait(waitForAllReady(ready));
+}
+
+// The chunks of one update() handed to StorageServer::updatePrepareThreads. Only the per mutation work that depends on
+// nothing but the mutation is done there: the versioned data, byte sample, change feeds and accumulative checksums are
+// still updated by the network thread in version order.
+class PreparedUpdate {
+public:
+	~PreparedUpdate() {
+		// Chunks that have not started are cancelled. Those running on a helper thread still read the pulled messages
+		// and cipher keys, which are then released once the chunks' results arrive.
+		bool running = false;
+		for (auto& chunk : chunks) {
+			int expected = PreparedUpdateMutations::Pending;
+			if (!chunk->state.compare_exchange_strong(expected, PreparedUpdateMutations::Cancelled) &&
+			    expected == PreparedUpdateMutations::Running) {
+				running = true;
+			}
+		}
+		if (running) {
+			releaseAfterPrepared(ready, messages, cipherKeys);
+		}
+	}
+
+	bool isStarted() const { return started; }
+	bool isValid() const { return !chunks.empty(); }
+
+	// Splits the mutations of cursor into chunks of about STORAGE_UPDATE_PREPARE_CHUNK_BYTES and hands them to the
+	// helper threads. Batches smaller than a chunk are left to the network thread. Encrypted mutations can only be
+	// prepared once their cipher keys have been fetched, until then nothing is started.
+	void start(StorageServer* data,
+	           Reference<ILogSystem::IPeekCursor> cursor,
+	           const std::unordered_map<BlobCipherDetails, Reference<BlobCipherKey>>* cipherKeys);
+
+	// Hands mutations to threads in chunks of about chunkBytes, regardless of their total size. messages must hold the
+	// memory of the mutations until the chunks are done.
+	void prepare(IThreadPool* threads,
+	             std::vector<MutationRef> const& mutations,
+	             int64_t chunkBytes,
+	             Reference<ILogSystem::IPeekCursor> messages,
+	             const std::unordered_map<BlobCipherDetails, Reference<BlobCipherKey>>* cipherKeys);
+
+	Future<Void> onReady() const { return waitForAll(ready); }
+
+	const PreparedUpdateMutations& chunk(int index) const {
+		auto it = std::upper_bound(chunks.begin(), chunks.end(), index, [](int index, const auto& chunk) {
+			return index < chunk->end();
+		});
+		ASSERT(it != chunks.end() && (*it)->begin <= index);
+		return **it;
+	}
+	MutationRef mutation(int index) const {
+		const PreparedUpdateMutations& c = chunk(index);
+		return c.mutations[index - c.begin];
+	}
+	bool validChecksum(int index) const {
+		const PreparedUpdateMutations& c = chunk(index);
+		return c.validChecksums[index - c.begin];
+	}
+	uint32_t keyHash(int index) const {
+		const PreparedUpdateMutations& c = chunk(index);
+		return c.keyHashes[index - c.begin];
+	}
+	double decryptionTime() const {
+		double total = 0;
+		for (const auto& chunk : chunks) {
+			total += chunk->decryptionTime;
+		}
+		return total;
+	}
+
+private:
+	bool started = false;
+	std::vector<Reference<PreparedUpdateMutations>> chunks;
+	std::vector<Future<Void>> ready;
+	// Owned by this rather than update(), so that they can outlive a cancelled update() while chunks still run
+	Reference<ILogSystem::IPeekCursor> messages;
+	std::shared_ptr<const std::unordered_map<BlobCipherDetails, Reference<BlobCipherKey>>> cipherKeys;
+};
+
+void PreparedUpdate::start(StorageServer* data,
+                           Reference<ILogSystem::IPeekCursor> cursor,
+                           const std::unordered_map<BlobCipherDetails, Reference<BlobCipherKey>>* cipherKeys) {
+	ASSERT(!started);
+	std::vector<MutationRef> mutations;
+	int64_t totalBytes = 0;
+
+	Reference<ILogSystem::IPeekCursor> clone = cursor->cloneNoMore();
+	clone->setProtocolVersion(data->logProtocol);
+	for (; clone->hasMessage(); clone->nextMessage()) {
+		ArenaReader& reader = *clone->reader();
+		if (LogProtocolMessage::isNextIn(reader)) {
+			LogProtocolMessage lpm;
+			reader >> lpm;
+			clone->setProtocolVersion(reader.protocolVersion());
+		} else if (reader.protocolVersion().hasSpanContext() && SpanContextMessage::isNextIn(reader)) {
+			SpanContextMessage scm;
+			reader >> scm;
+		} else if (reader.protocolVersion().hasOTELSpanContext() && OTELSpanContextMessage::isNextIn(reader)) {
+			OTELSpanContextMessage scm;
+			reader >> scm;
+		} else {
+			MutationRef msg;
+			reader >> msg;
+			if (msg.isEncrypted() && cipherKeys == nullptr) {
+				return;
+			}
+			mutations.push_back(msg);
+			totalBytes += msg.totalSize();
+		}
+	}
+
+	started = true;
+	if (totalBytes < SERVER_KNOBS->STORAGE_UPDATE_PREPARE_CHUNK_BYTES) {
+		return;
+	}
+	prepare(data->updatePrepareThreads.getPtr(),
+	        mutations,
+	        SERVER_KNOBS->STORAGE_UPDATE_PREPARE_CHUNK_BYTES,
+	        clone,
+	        cipherKeys);
+}
+
+void PreparedUpdate::prepare(IThreadPool* threads,
+                             std::vector<MutationRef> const& mutations,
+                             int64_t chunkBytes,
+                             Reference<ILogSystem::IPeekCursor> messages,
+                             const std::unordered_map<BlobCipherDetails, Reference<BlobCipherKey>>* cipherKeys) {
+	ASSERT(chunks.empty());
+	started = true;
+	this->messages = messages;
+	if (cipherKeys != nullptr) {
+		this->cipherKeys =
+		    std::make_shared<const std::unordered_map<BlobCipherDetails, Reference<BlobCipherKey>>>(*cipherKeys);
+	}
+
+	int64_t bytes = 0;
+	for (int index = 0; index < mutations.size(); index++) {
+		if (chunks.empty() || bytes >= chunkBytes) {
+			chunks.push_back(makeReference<PreparedUpdateMutations>(index, this->cipherKeys.get()));
+			bytes = 0;
+		}
+		chunks.back()->peeked.push_back(mutations[index]);
+		bytes += mutations[index].totalSize();
+	}
+	CODE_PROBE(chunks.size() > 1, "Storage server prepares pulled mutations in several chunks");
+	for (auto& chunk : chunks) {
+		auto action = new UpdatePrepareWorker::PrepareAction(chunk);
+		ready.push_back(action->result.getFuture());
+		threads->post(action);
+	}
+}
+
+TEST_CASE("/fdbserver/storageserver/preparedUpdate") {
+	state Reference<IThreadPool> threads;
+	if (g_network->isSimulated()) {
+		threads = Reference<IThreadPool>(new DummyThreadPool());
+		threads->addThread(new UpdatePrepareWorker());
+	} else {
+		threads = createGenericThreadPool();
+		for (int i = 0; i < 4; i++) {
+			threads->addThread(new UpdatePrepareWorker(), "fdb-ss-update");
+		}
+	}
+
+	state Arena arena;
+	state std::vector<MutationRef> mutations;
+	const MutationRef::Type types[] = { MutationRef::SetValue, MutationRef::ClearRange, MutationRef::AddValue };
+	for (int i = 0; i < 1000; i++) {
+		std::string key = deterministicRandom()->randomAlphaNumeric(deterministicRandom()->randomInt(0, 50));
+		std::string param2 = deterministicRandom()->randomAlphaNumeric(deterministicRandom()->randomInt(0, 500));
+		MutationRef m(types[deterministicRandom()->randomInt(0, 3)], StringRef(arena, key), StringRef(arena, param2));
+		if (deterministicRandom()->coinflip()) {
+			m.populateChecksum();
+		}
+		mutations.push_back(m);
+	}
+
+	// The prepared mutations must be what update() would have produced without the helper threads
+	state PreparedUpdate prepared;
+	prepared.prepare(threads.getPtr(),
+	                 mutations,
+	                 deterministicRandom()->randomInt(1, 20000),
+	                 Reference<ILogSystem::IPeekCursor>(),
+	                 nullptr);
+	wait(prepared.onReady());
+	for (int i = 0; i < mutations.size(); i++) {
+		const MutationRef& m = mutations[i];
+		MutationRef p = prepared.mutation(i);
+		ASSERT(p.type == m.type && p.param1 == m.param1 && p.param2 == m.param2);
+		ASSERT(prepared.validChecksum(i) == m.validateChecksum());
+		if (m.type != MutationRef::ClearRange) {
+			ByteSampleInfo direct = isKeyValueInSample(KeyValueRef(m.param1, m.param2));
+			ByteSampleInfo hashed = isKeyValueInSample(m.param1, direct.size, prepared.keyHash(i));
+			ASSERT(direct.inSample == hashed.inSample && direct.sampledSize == hashed.sampledSize);
+		}
+	}
+
+	// An update() cancelled while its chunks run leaves them to finish on their own
+	{
+		PreparedUpdate cancelled;
+		cancelled.prepare(threads.getPtr(), mutations, 1000, Reference<ILogSystem::IPeekCursor>(), nullptr);
+	}
+
+	wait(threads->stop());
+	return Void();
+}
+
 ACTOR Future<Void> tssDelayForever() {
 	loop {
 		wait(delay(5.0));
@@ -11906,6 +12893,13 @@ ACTOR Future<Void> update(StorageServer* data, bool* pReceivedUpdate) {
 			wait(data->byteSampleClearsTooLarge.onChange());
 		}
 
+		if (g_network->isSimulated()) {
+			double endTime = g_simulator->checkDisabled(format("%s/update", data->thisServerID.toString().c_str()));
+			if (endTime > now()) {
+				wait(delay(endTime - now(), TaskPriority::TLogPeekReply));
+			}
+		}
+
 		state Reference<ILogSystem::IPeekCursor> cursor = data->logCursor;
 
 		state double beforeTLogCursorReads = now();
@@ -11948,15 +12942,25 @@ ACTOR Future<Void> update(StorageServer* data, bool* pReceivedUpdate) {
 		state Reference<ILogSystem::IPeekCursor> cloneCursor2 = cursor->cloneNoMore();
 		state Optional<std::unordered_map<BlobCipherDetails, Reference<BlobCipherKey>>> cipherKeys;
 		state bool collectingCipherKeys = false;
+		state PreparedUpdate prepared;
 
 		// Collect eager read keys.
 		// If encrypted mutation is encountered, we collect cipher details and fetch cipher keys, then start over.
 		loop {
 			state uint64_t changeCounter = data->shardChangeCounter;
+			if (data->updatePrepareThreads && !prepared.isStarted()) {
+				prepared.start(data, cloneCursor2, cipherKeys.present() ? &cipherKeys.get() : nullptr);
+				if (prepared.isValid()) {
+					wait(prepared.onReady());
+					decryptionTime += prepared.decryptionTime();
+				}
+			}
+
 			bool epochEnd = false;
 			bool hasPrivateData = false;
 			bool firstMutation = true;
 			bool dbgLastMessageWasProtocol = false;
+			int preparedIndex = 0;
 
 			std::unordered_set<BlobCipherDetails> cipherDetails;
 
@@ -11987,7 +12991,16 @@ ACTOR Future<Void> update(StorageServer* data, bool* pReceivedUpdate) {
 					ASSERT(data->encryptionMode.present());
 					ASSERT(!data->encryptionMode.get().isEncryptionEnabled() || msg.isEncrypted() ||
 					       isBackupLogMutation(msg) || isAccumulativeChecksumMutation(msg));
-					if (msg.isEncrypted()) {
+					if (prepared.isValid()) {
+						if (!prepared.validChecksum(preparedIndex)) {
+							TraceEvent(SevError, "ValidateChecksumError", data->thisServerID)
+							    .setMaxFieldLength(-1)
+							    .setMaxEventLength(-1)
+							    .detail("Mutation", msg);
+							ASSERT(false);
+						}
+						msg = prepared.mutation(preparedIndex++);
+					} else if (msg.isEncrypted()) {
 						if (!cipherKeys.present()) {
 							msg.updateEncryptCipherDetails(cipherDetails);
 							collectingCipherKeys = true;
@@ -12107,6 +13120,7 @@ ACTOR Future<Void> update(StorageServer* data, bool* pReceivedUpdate) {
 		state SpanContext spanContext = SpanContext();
 		state double beforeTLogMsgsUpdates = now();
 		state std::set<Key> updatedChangeFeeds;
+		state int preparedIndex = 0;
 		for (; cloneCursor2->hasMessage(); cloneCursor2->nextMessage()) {
 			if (mutationBytes > SERVER_KNOBS->DESIRED_UPDATE_BYTES) {
 				mutationBytes = 0;
@@ -12164,10 +13178,17 @@ ACTOR Future<Void> update(StorageServer* data, bool* pReceivedUpdate) {
 					ASSERT(cipherKeys.present());
 					encryptedMutation.mutation = msg;
 					encryptedMutation.cipherKeys = msg.getCipherKeys(cipherKeys.get());
-					double decryptionTimeV = 0;
-					msg = msg.decrypt(
-					    encryptedMutation.cipherKeys, rd.arena(), BlobCipherMetrics::TLOG, nullptr, &decryptionTimeV);
-					decryptionTime += decryptionTimeV;
+					if (prepared.isValid()) {
+						msg = prepared.mutation(preparedIndex);
+					} else {
+						double decryptionTimeV = 0;
+						msg = msg.decrypt(encryptedMutation.cipherKeys,
+						                  rd.arena(),
+						                  BlobCipherMetrics::TLOG,
+						                  nullptr,
+						                  &decryptionTimeV);
+						decryptionTime += decryptionTimeV;
+					}
 				} else if (data->acsValidator != nullptr && msg.checksum.present() &&
 				           msg.accumulativeChecksumIndex.present() && !isAccumulativeChecksumMutation(msg)) {
 					// We have to check accumulative checksum when iterating through cloneCursor2,
@@ -12175,6 +13196,7 @@ ACTOR Future<Void> update(StorageServer* data, bool* pReceivedUpdate) {
 					data->acsValidator->addMutation(
 					    msg, data->thisServerID, data->tag, data->version.get(), cloneCursor2->version().version);
 				}
+				preparedIndex++;
 
 				Span span("SS:update"_loc, spanContext);
 
@@ -12204,7 +13226,11 @@ ACTOR Future<Void> update(StorageServer* data, bool* pReceivedUpdate) {
 						    .detail("Version", cloneCursor2->version().toString());
 					}
 
+					if (prepared.isValid() && msg.type != MutationRef::ClearRange) {
+						data->preparedSampleKeyHash = std::make_pair(msg.param1, prepared.keyHash(preparedIndex - 1));
+					}
 					updater.applyMutation(data, msg, encryptedMutation, ver, false);
+					data->preparedSampleKeyHash.reset();
 					mutationBytes += msg.totalSize();
 					data->counters.mutationBytes += msg.totalSize();
 					data->counters.logicalBytesInput += msg.expectedSize();
@@ -12313,6 +13339,7 @@ ACTOR Future<Void> update(StorageServer* data, bool* pReceivedUpdate) {
 
 			data->prevVersion = data->version.get();
 			data->version.set(ver); // Triggers replies to waiting gets for new version(s)
+			checkTouchedWatches(data);
 
 			for (auto& it : updatedChangeFeeds) {
 				auto feed = data->uidChangeFeed.find(it);
@@ -12850,10 +13877,12 @@ ACTOR Future<Void> updateStorage(StorageServer* data) {
 					} else if (it.version > newOldestVersion) {
 						break;
 					}
+					VectorRef<MutationRef> mutations = it.encrypted.present() ? it.encrypted.get() : it.mutations;
 					data->storage.writeKeyValue(
 					    KeyValueRef(changeFeedDurableKey(info->second->id, it.version),
-					                changeFeedDurableValue(it.encrypted.present() ? it.encrypted.get() : it.mutations,
-					                                       it.knownCommittedVersion)));
+					                changeFeedDurableValue(mutations,
+					                                       it.knownCommittedVersion,
+					                                       data->changeFeedDurableCompression(mutations))));
 					// FIXME: there appears to be a bug somewhere where the exact same mutation appears twice in a
 					// row in the stream. We should fix this assert to be strictly > and re-enable it
 					ASSERT(it.version >= info->second->storageVersion);
@@ -13340,7 +14369,7 @@ bool StorageServerDisk::makeVersionMutationsDurable(Version& prevStorageVersion,
 			writeMutationsBuggy(v.mutations, v.version, "makeVersionDurable");
 		}
 		for (const auto& m : v.mutations)
-			bytesLeft -= mvccStorageBytes(m);
+			bytesLeft -= ::mvccStorageBytes(m.param1.size() + m.param2.size());
 		prevStorageVersion = v.version;
 		return false;
 	} else {
@@ -13810,7 +14839,18 @@ Future<bool> StorageServerDisk::restoreDurableState() {
 //   * probability: probability we select a key-value pair of this size, at random.
 //   * sampledSize: always |key + value| / probability
 //                  represents the amount of key-value space covered by that key.
+uint32_t byteSampleKeyHash(KeyRef key) {
+	uint32_t a = 0;
+	uint32_t b = 0;
+	hashlittle2(key.begin(), key.size(), &a, &b);
+	return a;
+}
+
 ByteSampleInfo isKeyValueInSample(const KeyRef key, int64_t totalKvSize) {
+	return isKeyValueInSample(key, totalKvSize, byteSampleKeyHash(key));
+}
+
+ByteSampleInfo isKeyValueInSample(const KeyRef key, int64_t totalKvSize, uint32_t keyHash) {
 	ASSERT(totalKvSize >= key.size());
 	ByteSampleInfo info;
 
@@ -13828,16 +14868,12 @@ ByteSampleInfo isKeyValueInSample(const KeyRef key, int64_t totalKvSize) {
 
 	info.size = totalKvSize;
 
-	uint32_t a = 0;
-	uint32_t b = 0;
-	hashlittle2(key.begin(), key.size(), &a, &b);
-
 	info.probability =
 	    (double)info.size / (key.size() + SERVER_KNOBS->BYTE_SAMPLING_OVERHEAD) / SERVER_KNOBS->BYTE_SAMPLING_FACTOR;
 	// MIN_BYTE_SAMPLING_PROBABILITY is 0.99 only for testing
 	// MIN_BYTE_SAMPLING_PROBABILITY is 0 for other cases
 	info.probability = std::clamp(info.probability, SERVER_KNOBS->MIN_BYTE_SAMPLING_PROBABILITY, 1.0);
-	info.inSample = a / ((1 << 30) * 4.0) < info.probability;
+	info.inSample = keyHash / ((1 << 30) * 4.0) < info.probability;
 	info.sampledSize = info.size / info.probability;
 
 	return info;
@@ -13855,7 +14891,14 @@ void StorageServer::addMutationToMutationLogOrStorage(Version ver, MutationRef m
 void StorageServer::byteSampleApplySet(KeyValueRef kv, Version ver) {
 	// Update byteSample in memory and (eventually) on disk and notify waiting metrics
 
-	ByteSampleInfo sampleInfo = isKeyValueInSample(kv);
+	ByteSampleInfo sampleInfo;
+	if (preparedSampleKeyHash.present() && preparedSampleKeyHash.get().first.begin() == kv.key.begin() &&
+	    preparedSampleKeyHash.get().first.size() == kv.key.size()) {
+		sampleInfo =
+		    isKeyValueInSample(kv.key, kv.key.size() + kv.value.size(), preparedSampleKeyHash.get().second);
+	} else {
+		sampleInfo = isKeyValueInSample(kv);
+	}
 	auto& byteSample = metrics.byteSample.sample;
 
 	int64_t delta = 0;
@@ -14193,6 +15236,16 @@ ACTOR Future<Void> serveGetValueRequests(StorageServer* self, FutureStream<GetVa
 	}
 }
 
+ACTOR Future<Void> serveGetValuesRequests(StorageServer* self, FutureStream<GetValuesRequest> getValues) {
+	getCurrentLineage()->modify(&TransactionLineage::operation) = TransactionLineage::Operation::GetValue;
+	loop {
+		GetValuesRequest req = waitNext(getValues);
+		// Warning: This code is executed at extremely high priority (TaskPriority::LoadBalancedEndpoint), so
+		// downgrade before doing real work
+		self->actors.add(self->readGuard(req, getValuesQ));
+	}
+}
+
 ACTOR Future<Void> serveGetKeyValuesRequests(StorageServer* self, FutureStream<GetKeyValuesRequest> getKeyValues) {
 	getCurrentLineage()->modify(&TransactionLineage::operation) = TransactionLineage::Operation::GetKeyValues;
 	loop {
@@ -14273,9 +15326,7 @@ ACTOR Future<Void> serveWatchValueRequestsImpl(StorageServer* self, FutureStream
 		if (!metadata.isValid()) {
 			metadata = makeReference<ServerWatchMetadata>(
 			    req.key, req.value, req.version, req.tags, req.debugID, req.tenantInfo.tenantId);
-			KeyRef key = self->setWatchMetadata(metadata);
-			metadata->watch_impl = forward(watchWaitForValueChange(self, span.context, key, req.tenantInfo.tenantId),
-			                               metadata->versionPromise);
+			startWatch(self, span.context, metadata);
 			self->actors.add(watchValueSendReply(self, req, metadata->versionPromise.getFuture(), span.context));
 		}
 		// case 2: there is a watch in the map and it has the same value so just update version
@@ -14308,9 +15359,7 @@ ACTOR Future<Void> serveWatchValueRequestsImpl(StorageServer* self, FutureStream
 
 			metadata = makeReference<ServerWatchMetadata>(
 			    req.key, req.value, req.version, req.tags, req.debugID, req.tenantInfo.tenantId);
-			KeyRef key = self->setWatchMetadata(metadata);
-			metadata->watch_impl = forward(watchWaitForValueChange(self, span.context, key, req.tenantInfo.tenantId),
-			                               metadata->versionPromise);
+			startWatch(self, span.context, metadata);
 
 			self->actors.add(watchValueSendReply(self, req, metadata->versionPromise.getFuture(), span.context));
 		}
@@ -14342,10 +15391,7 @@ ACTOR Future<Void> serveWatchValueRequestsImpl(StorageServer* self, FutureStream
 					if (reply.value == req.value) { // valSS == valreq
 						metadata = makeReference<ServerWatchMetadata>(
 						    req.key, req.value, req.version, req.tags, req.debugID, req.tenantInfo.tenantId);
-						KeyRef key = self->setWatchMetadata(metadata);
-						metadata->watch_impl =
-						    forward(watchWaitForValueChange(self, span.context, key, req.tenantInfo.tenantId),
-						            metadata->versionPromise);
+						startWatch(self, span.context, metadata);
 						self->actors.add(
 						    watchValueSendReply(self, req, metadata->versionPromise.getFuture(), span.context));
 					} else {
@@ -14519,6 +15565,22 @@ ACTOR Future<Void> storageServerCore(StorageServer* self, StorageServerInterface
 	state Future<Void> checkLastUpdate = Void();
 	state Future<Void> updateProcessStatsTimer = delay(SERVER_KNOBS->FASTRESTORE_UPDATE_PROCESS_STATS_INTERVAL);
 
+	if (SERVER_KNOBS->STORAGE_UPDATE_PREPARE_THREADS > 0) {
+		// Simulation runs the helper's work inline so that it stays deterministic
+		if (g_network->isSimulated()) {
+			self->updatePrepareThreads = Reference<IThreadPool>(new DummyThreadPool());
+			self->updatePrepareThreads->addThread(new UpdatePrepareWorker());
+		} else {
+			self->updatePrepareThreads = createGenericThreadPool();
+			for (int i = 0; i < SERVER_KNOBS->STORAGE_UPDATE_PREPARE_THREADS; i++) {
+				self->updatePrepareThreads->addThread(new UpdatePrepareWorker(), "fdb-ss-update");
+			}
+		}
+		TraceEvent("StorageServerUpdatePrepareThreads", self->thisServerID)
+		    .detail("Threads", SERVER_KNOBS->STORAGE_UPDATE_PREPARE_THREADS)
+		    .detail("ChunkBytes", SERVER_KNOBS->STORAGE_UPDATE_PREPARE_CHUNK_BYTES);
+	}
+
 	self->actors.add(updateStorage(self));
 	self->actors.add(waitFailureServer(ssi.waitFailure.getFuture()));
 	self->actors.add(self->otherError.getFuture());
@@ -14526,6 +15588,7 @@ ACTOR Future<Void> storageServerCore(StorageServer* self, StorageServerInterface
 	self->actors.add(logLongByteSampleRecovery(self->byteSampleRecovery));
 	self->actors.add(checkBehind(self));
 	self->actors.add(serveGetValueRequests(self, ssi.getValue.getFuture()));
+	self->actors.add(serveGetValuesRequests(self, ssi.getValues.getFuture()));
 	self->actors.add(serveGetKeyValuesRequests(self, ssi.getKeyValues.getFuture()));
 	self->actors.add(serveGetMappedKeyValuesRequests(self, ssi.getMappedKeyValues.getFuture()));
 	self->actors.add(serveGetKeyValuesStreamRequests(self, ssi.getKeyValuesStream.getFuture()));
@@ -15335,7 +16398,7 @@ Possibilities:
 void versionedMapTest() {
 	VersionedMap<int, int> vm;
 
-	printf("SS Ptree node is %zu bytes\n", sizeof(StorageServer::VersionedData::PTreeT));
+	printf("SS Ptree node is %zu bytes\n", sizeof(VersionedMap<KeyRef, ValueOrClearToRef>::PTreeT));
 
 	const int NSIZE = sizeof(VersionedMap<int, int>::PTreeT);
 	const int ASIZE = NSIZE <= 64 ? 64 : nextFastAllocatedSize(NSIZE);
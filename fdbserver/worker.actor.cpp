@@ -3311,6 +3311,7 @@ ACTOR Future<Void> workerServer(Reference<IClusterConnectionRecord> connRecord,
 				DUMPTOKEN(recruited.getConsistentReadVersion);
 				DUMPTOKEN(recruited.waitFailure);
 				DUMPTOKEN(recruited.getHealthMetrics);
+				DUMPTOKEN(recruited.getConsistentReadVersions);
 
 				// printf("Recruited as grvProxyServer\n");
 				errorForwarders.add(zombie(
@@ -0,0 +1,141 @@
+/*
+ * AsyncFileSync.actor.cpp
+ *
+ * This source file is part of the FoundationDB open source project
+ *
+ * Copyright 2013-2024 Apple Inc. and the FoundationDB project authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "fdbrpc/DDSketch.h"
+#include "fdbserver/workloads/workloads.actor.h"
+#include "flow/IAsyncFile.h"
+#include "fdbserver/workloads/AsyncFile.actor.h"
+#include "flow/actorcompiler.h" // This must be the last #include.
+
+// Measures the latency of small durable appends, as the DiskQueue of a TLog makes them: several committers each
+// append a few pages and wait for them to be synced, and concurrent commits share syncs.  Run it against a real disk
+// with and without --knob-enable-io-uring=1 to compare AsyncFileKAIO with AsyncFileIOUring.
+struct AsyncFileSyncWorkload : public AsyncFileWorkload {
+	static constexpr auto NAME = "AsyncFileSync";
+
+	// Number of commits in flight at once
+	int numCommitters;
+
+	// Pages appended by each commit
+	int pagesPerCommit;
+
+	Reference<AsyncFileBuffer> writeBuffer;
+	int64_t nextOffset;
+
+	// The last sync started, and whether it has yet to be issued to the file, in which case later commits share it
+	Future<Void> lastSync;
+	bool nextSyncPending;
+
+	PerfIntCounter commits, syncs;
+	DDSketch<double> commitLatencies;
+
+	AsyncFileSyncWorkload(WorkloadContext const& wcx)
+	  : AsyncFileWorkload(wcx), nextOffset(0), lastSync(Void()), nextSyncPending(false), commits("Commits"),
+	    syncs("Syncs") {
+		numCommitters = getOption(options, "numCommitters"_sr, 16);
+		pagesPerCommit = getOption(options, "pagesPerCommit"_sr, 1);
+		fileSize = getOption(options, "fileSize"_sr, 100 << 20);
+	}
+
+	Future<Void> setup(Database const& cx) override {
+		if (enabled)
+			return _setup(this);
+
+		return Void();
+	}
+
+	ACTOR Future<Void> _setup(AsyncFileSyncWorkload* self) {
+		self->writeBuffer = self->allocateBuffer(self->pagesPerCommit * _PAGE_SIZE);
+		memset(self->writeBuffer->buffer, 0xab, self->pagesPerCommit * _PAGE_SIZE);
+		self->fileSize -= self->fileSize % (self->pagesPerCommit * _PAGE_SIZE);
+		wait(self->openFile(self, IAsyncFile::OPEN_READWRITE, 0666, self->fileSize));
+		return Void();
+	}
+
+	Future<Void> start(Database const& cx) override {
+		if (enabled)
+			return _start(this);
+
+		return Void();
+	}
+
+	ACTOR Future<Void> _start(AsyncFileSyncWorkload* self) {
+		state std::vector<Future<Void>> committers;
+		for (int i = 0; i < self->numCommitters; i++)
+			committers.push_back(self->committer(self));
+		wait(timeout(waitForAll(committers), self->testDuration, Void()));
+		return Void();
+	}
+
+	ACTOR static Future<Void> waitAndSync(AsyncFileSyncWorkload* self, Future<Void> previousSync) {
+		wait(previousSync);
+		self->nextSyncPending = false;
+		++self->syncs;
+		wait(self->fileHandle->file->sync());
+		return Void();
+	}
+
+	// Returns a sync that covers the writes issued (or, unless the file's sync covers pending writes, completed) so far
+	Future<Void> onSync() {
+		if (!nextSyncPending) {
+			nextSyncPending = true;
+			lastSync = waitAndSync(this, lastSync);
+		}
+		return lastSync;
+	}
+
+	ACTOR Future<Void> committer(AsyncFileSyncWorkload* self) {
+		state int length = self->pagesPerCommit * _PAGE_SIZE;
+		loop {
+			state double start = now();
+			int64_t offset = self->nextOffset;
+			self->nextOffset = (self->nextOffset + length) % self->fileSize;
+
+			// Don't allow the write to be cancelled (because the underlying IO may not be cancellable) and don't
+			// allow objects that the write uses to be deleted
+			Future<Void> w = self->fileHandle->file->write(self->writeBuffer->buffer, length, offset);
+			state Future<Void> write = uncancellable(holdWhile(self->fileHandle, holdWhile(self->writeBuffer, w)));
+			state Future<Void> sync;
+			if (self->fileHandle->file->syncCoversPendingWrites())
+				sync = self->onSync();
+			wait(write);
+			if (!sync.isValid())
+				sync = self->onSync();
+			wait(sync);
+
+			++self->commits;
+			self->commitLatencies.addSample(now() - start);
+		}
+	}
+
+	void getMetrics(std::vector<PerfMetric>& m) override {
+		if (enabled) {
+			m.emplace_back("Commits/sec", commits.getValue() / testDuration, Averaged::False);
+			double syncsPerCommit = double(syncs.getValue()) / std::max<int64_t>(commits.getValue(), 1);
+			m.emplace_back("Syncs per commit", syncsPerCommit, Averaged::False);
+			m.emplace_back("Mean Commit Latency (ms)", 1000 * commitLatencies.mean(), Averaged::False);
+			m.emplace_back("Median Commit Latency (ms)", 1000 * commitLatencies.median(), Averaged::False);
+			m.emplace_back("90% Commit Latency (ms)", 1000 * commitLatencies.percentile(0.90), Averaged::False);
+			m.emplace_back("99% Commit Latency (ms)", 1000 * commitLatencies.percentile(0.99), Averaged::False);
+		}
+	}
+};
+
+WorkloadFactory<AsyncFileSyncWorkload> AsyncFileSyncWorkloadFactory;
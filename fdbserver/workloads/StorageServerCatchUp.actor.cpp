@@ -0,0 +1,171 @@
+/*
+ * StorageServerCatchUp.actor.cpp
+ *
+ * This source file is part of the FoundationDB open source project
+ *
+ * Copyright 2013-2024 Apple Inc. and the FoundationDB project authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "fdbclient/NativeAPI.actor.h"
+#include "fdbclient/SystemData.h"
+#include "fdbserver/workloads/workloads.actor.h"
+#include "flow/actorcompiler.h" // This must be the last #include.
+
+// Stops one storage server from pulling mutations from the TLogs while the other clients keep writing, then measures
+// how long the storage server takes to apply the mutations it missed.
+struct StorageServerCatchUpWorkload : TestWorkload {
+	static constexpr auto NAME = "StorageServerCatchUp";
+
+	double testDuration;
+	double pauseAfter;
+	double pauseFor;
+	int actorCount;
+	int keysPerTransaction;
+	int valueBytes;
+
+	std::vector<Future<Void>> clients;
+	PerfIntCounter transactions, retries;
+
+	// Set by client 0 only
+	bool measured = false;
+	Version versionsBehind = 0;
+	double catchUpTime = 0;
+
+	StorageServerCatchUpWorkload(WorkloadContext const& wcx)
+	  : TestWorkload(wcx), transactions("Transactions"), retries("Retries") {
+		testDuration = getOption(options, "testDuration"_sr, 60.0);
+		pauseAfter = getOption(options, "pauseAfter"_sr, 5.0);
+		pauseFor = getOption(options, "pauseFor"_sr, 10.0);
+		actorCount = getOption(options, "actorCount"_sr, 8);
+		keysPerTransaction = getOption(options, "keysPerTransaction"_sr, 20);
+		valueBytes = getOption(options, "valueBytes"_sr, 100);
+	}
+
+	Future<Void> setup(Database const& cx) override { return Void(); }
+
+	Future<Void> start(Database const& cx) override {
+		if (!g_network->isSimulated()) {
+			return Void();
+		}
+		for (int c = 0; c < actorCount; c++) {
+			clients.push_back(timeout(writer(this, cx), testDuration, Void()));
+		}
+		Future<Void> pause = clientId == 0 ? pauseAndMeasure(this, cx) : Future<Void>(Void());
+		return waitForAll(clients) && pause;
+	}
+
+	Future<bool> check(Database const& cx) override { return true; }
+
+	void getMetrics(std::vector<PerfMetric>& m) override {
+		m.push_back(transactions.getMetric());
+		m.push_back(retries.getMetric());
+		if (measured) {
+			m.emplace_back("Versions behind", versionsBehind, Averaged::False);
+			m.emplace_back("Catch-up time (seconds)", catchUpTime, Averaged::False);
+			m.emplace_back(
+			    "Catch-up versions/sec", catchUpTime > 0 ? versionsBehind / catchUpTime : 0.0, Averaged::False);
+		}
+	}
+
+	ACTOR static Future<Void> writer(StorageServerCatchUpWorkload* self, Database cx) {
+		state std::string value(self->valueBytes, '.');
+		loop {
+			state Transaction tr(cx);
+			loop {
+				try {
+					for (int i = 0; i < self->keysPerTransaction; i++) {
+						tr.set(deterministicRandom()->randomUniqueID().toString(), value);
+					}
+					wait(tr.commit());
+					++self->transactions;
+					break;
+				} catch (Error& e) {
+					wait(tr.onError(e));
+					++self->retries;
+				}
+			}
+		}
+	}
+
+	ACTOR static Future<StorageServerInterface> getRandomStorage(Database cx) {
+		state Transaction tr(cx);
+		loop {
+			try {
+				tr.setOption(FDBTransactionOptions::ACCESS_SYSTEM_KEYS);
+				RangeResult range = wait(tr.getRange(serverListKeys, CLIENT_KNOBS->TOO_MANY));
+				if (range.size() > 0) {
+					return decodeServerListValue(range[deterministicRandom()->randomInt(0, range.size())].value);
+				}
+				wait(delay(1.0));
+				tr.reset();
+			} catch (Error& e) {
+				wait(tr.onError(e));
+			}
+		}
+	}
+
+	ACTOR static Future<Version> getReadVersion(Database cx) {
+		state Transaction tr(cx);
+		loop {
+			try {
+				Version v = wait(tr.getReadVersion());
+				return v;
+			} catch (Error& e) {
+				wait(tr.onError(e));
+			}
+		}
+	}
+
+	ACTOR static Future<Void> pauseAndMeasure(StorageServerCatchUpWorkload* self, Database cx) {
+		wait(delay(self->pauseAfter));
+		state StorageServerInterface ssi = wait(getRandomStorage(cx));
+		TraceEvent("StorageServerCatchUpPause").detail("Storage", ssi.id()).detail("Duration", self->pauseFor);
+		g_simulator->disableFor(format("%s/update", ssi.id().toString().c_str()), now() + self->pauseFor);
+		wait(delay(self->pauseFor));
+
+		state double resumed = now();
+		state Version target = wait(getReadVersion(cx));
+		state Version behind = -1;
+		loop {
+			Optional<StorageQueuingMetricsReply> metrics = wait(
+			    timeout(brokenPromiseToNever(ssi.getQueuingMetrics.getReply(StorageQueuingMetricsRequest{})), 1.0));
+			if (metrics.present() && behind < 0) {
+				behind = std::max<Version>(0, target - metrics.get().version);
+			}
+			if (metrics.present() && metrics.get().version >= target) {
+				break;
+			}
+			if (now() - resumed > self->testDuration) {
+				// The storage server may have been removed, e.g. by an attrition workload
+				TraceEvent(SevWarn, "StorageServerCatchUpTimedOut")
+				    .detail("Storage", ssi.id())
+				    .detail("Target", target);
+				return Void();
+			}
+			wait(delay(0.1));
+		}
+
+		self->measured = true;
+		self->versionsBehind = behind;
+		self->catchUpTime = now() - resumed;
+		TraceEvent("StorageServerCatchUp")
+		    .detail("Storage", ssi.id())
+		    .detail("VersionsBehind", self->versionsBehind)
+		    .detail("Seconds", self->catchUpTime);
+		return Void();
+	}
+};
+
+WorkloadFactory<StorageServerCatchUpWorkload> StorageServerCatchUpWorkloadFactory;
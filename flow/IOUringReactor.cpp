@@ -0,0 +1,702 @@
+/*
+ * IOUringReactor.cpp
+ *
+ * This source file is part of the FoundationDB open source project
+ *
+ * Copyright 2013-2024 Apple Inc. and the FoundationDB project authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "flow/IOUringReactor.h"
+
+#ifdef __linux__
+
+#include <deque>
+
+#include <linux/io_uring.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "flow/Knobs.h"
+#include "flow/serialize.h"
+
+namespace N2 { // No indent, it's the whole file
+
+// Multishot receives and provided buffer rings need Linux 6.0 headers
+#ifdef IORING_RECV_MULTISHOT
+
+// The state of an adopted socket. Submitted operations hold a reference to it, so it outlives the IOUringConnection
+// that owns it until the kernel is done with the socket.
+class IOUringSocket final : public ReferenceCounted<IOUringSocket> {
+public:
+	enum Op : uint64_t { Recv = 0, Send = 1, Cancel = 2 };
+	static constexpr uint64_t OpMask = 3;
+
+	IOUringSocket(IOUringReactor* reactor, boost::asio::ip::tcp::socket&& s, NetworkAddress peerAddress, UID id)
+	  : reactor(reactor), socket(std::move(s)), fd(socket.native_handle()), peerAddress(peerAddress), id(id) {}
+
+	~IOUringSocket() {
+		releaseReceived();
+		boost::system::error_code error;
+		socket.close(error);
+	}
+
+	bool needsRecv() const { return !recvArmed && !closed && !eof && !recvError && !recvBuffersFull(); }
+	// The armed receive is cancelled once the connection holds as many buffers as it may
+	bool needsRecvCancel() const { return recvArmed && !recvCancelling && !closed && recvBuffersFull(); }
+	bool needsSend() const {
+		return !sendInFlight && !closed && !sendError && (sendOffset < sending.size() || !pending.empty());
+	}
+
+	void prepareRecv(io_uring_sqe* sqe) {
+		memset(sqe, 0, sizeof(*sqe));
+		sqe->opcode = IORING_OP_RECV;
+		sqe->fd = fd;
+		sqe->ioprio = IORING_RECV_MULTISHOT;
+		sqe->flags = IOSQE_BUFFER_SELECT;
+		sqe->buf_group = 0;
+		sqe->user_data = uint64_t(this) | Recv;
+		recvArmed = true;
+		addref();
+	}
+
+	void prepareSend(io_uring_sqe* sqe) {
+		if (sendOffset == sending.size()) {
+			// Everything submitted before has been sent, so what write() has accepted since goes next
+			sending.swap(pending);
+			pending.clear();
+			sendOffset = 0;
+		}
+		memset(sqe, 0, sizeof(*sqe));
+		sqe->opcode = IORING_OP_SEND;
+		sqe->fd = fd;
+		sqe->addr = uint64_t(sending.data() + sendOffset);
+		sqe->len = sending.size() - sendOffset;
+		sqe->msg_flags = MSG_NOSIGNAL;
+		sqe->user_data = uint64_t(this) | Send;
+		sendInFlight = true;
+		addref();
+	}
+
+	void prepareRecvCancel(io_uring_sqe* sqe) {
+		memset(sqe, 0, sizeof(*sqe));
+		sqe->opcode = IORING_OP_ASYNC_CANCEL;
+		sqe->fd = -1;
+		sqe->addr = uint64_t(this) | Recv;
+		sqe->user_data = uint64_t(this) | Cancel;
+		recvCancelling = true;
+		++reactor->countRecvCancels;
+		addref();
+	}
+
+	// Returns whether the kernel will post more completions for the armed receive
+	bool onRecv(int res, uint32_t flags) {
+		if (res > 0) {
+			uint16_t bid = flags >> IORING_CQE_BUFFER_SHIFT;
+			--reactor->freeBuffers;
+			if (closed) {
+				reactor->returnBuffer(bid);
+			} else {
+				received.push_back(Received{ bid, 0, res });
+			}
+		} else if (res == 0) {
+			eof = true;
+		} else if (res == -ENOBUFS) {
+			// Armed again once read() gives buffers back
+			++reactor->countRecvBuffersExhausted;
+		} else if (res != -ECANCELED) {
+			recvError = -res;
+		}
+
+		const bool more = flags & IORING_CQE_F_MORE;
+		if (!more) {
+			recvArmed = false;
+			recvCancelling = false;
+		}
+		// A receive cancelled for holding too many buffers is armed again by read()
+		if (needsRecv() || needsRecvCancel()) {
+			reactor->queue(this);
+		}
+		notify(readable);
+		return more;
+	}
+
+	void onSend(int res) {
+		sendInFlight = false;
+		if (res >= 0) {
+			sendOffset += res;
+		} else {
+			sendError = -res;
+		}
+		if (needsSend()) {
+			reactor->queue(this);
+		}
+		notify(writable);
+	}
+
+	Future<Void> onReadable() {
+		if (!received.empty() || eof || recvError || closed) {
+			return Void();
+		}
+		return readable.getFuture();
+	}
+
+	Future<Void> onWritable() {
+		if (sendError || closed || pending.size() < FLOW_KNOBS->NET2_IO_URING_SEND_BUFFER_BYTES) {
+			return Void();
+		}
+		return writable.getFuture();
+	}
+
+	int read(uint8_t* begin, uint8_t* end) {
+		++reactor->metrics.countReads;
+		uint8_t* p = begin;
+		while (p < end && !received.empty()) {
+			Received& r = received.front();
+			int n = std::min<int>(end - p, r.end - r.begin);
+			memcpy(p, reactor->buffer(r.bid) + r.begin, n);
+			p += n;
+			r.begin += n;
+			if (r.begin == r.end) {
+				reactor->returnBuffer(r.bid);
+				received.pop_front();
+			}
+		}
+		if (p > begin) {
+			reactor->metrics.bytesReceived += p - begin;
+			if (needsRecv()) {
+				reactor->queue(this);
+			}
+			return p - begin;
+		}
+		if (closed || eof || recvError) {
+			onError("N2_ReadError", recvError);
+			throw connection_failed();
+		}
+		++reactor->metrics.countWouldBlock;
+		return 0;
+	}
+
+	int write(SendBuffer const* data, int limit) {
+		++reactor->metrics.countWrites;
+		if (closed || sendError) {
+			onError("N2_WriteError", sendError);
+			throw connection_failed();
+		}
+		int written = 0;
+		if (limit >= FLOW_KNOBS->NET2_IO_URING_DIRECT_SEND_BYTES && !sendInFlight && sendOffset == sending.size() &&
+		    pending.empty()) {
+			written = sendDirect(data, limit);
+			if (sendError) {
+				onError("N2_WriteError", sendError);
+				throw connection_failed();
+			}
+		}
+
+		// What the socket did not take right away is copied, and sent with the next submission
+		const int space = FLOW_KNOBS->NET2_IO_URING_SEND_BUFFER_BYTES - pending.size();
+		int skip = written;
+		int staged = 0;
+		for (auto p = data; p && written < limit && staged < space; p = p->next) {
+			const int unsent = p->bytes_unsent();
+			if (skip >= unsent) {
+				skip -= unsent;
+				continue;
+			}
+			const uint8_t* begin = p->data() + p->bytes_sent + skip;
+			const int n = std::min({ unsent - skip, limit - written, space - staged });
+			pending.insert(pending.end(), begin, begin + n);
+			skip = 0;
+			written += n;
+			staged += n;
+		}
+		if (staged > 0 && needsSend()) {
+			reactor->queue(this);
+		}
+		if (written == 0) {
+			++reactor->metrics.countWouldBlock;
+		}
+		return written;
+	}
+
+	void close() {
+		if (closed) {
+			return;
+		}
+		closed = true;
+		// Ends the armed receive and any send in flight; the socket itself is closed once they have completed
+		::shutdown(fd, SHUT_RDWR);
+		releaseReceived();
+		pending.clear();
+		notify(readable);
+		notify(writable);
+	}
+
+	IOUringReactor* const reactor;
+	boost::asio::ip::tcp::socket socket;
+	const int fd;
+	const NetworkAddress peerAddress;
+	const UID id;
+	bool inQueue = false;
+
+private:
+	struct Received {
+		uint16_t bid;
+		int begin, end;
+	};
+
+	bool recvBuffersFull() const {
+		return received.size() >= size_t(FLOW_KNOBS->NET2_IO_URING_RECV_BUFFERS_PER_CONNECTION);
+	}
+
+	static void notify(Promise<Void>& p) {
+		if (p.getFutureReferenceCount()) {
+			Promise<Void> waiting;
+			waiting.swap(p);
+			waiting.send(Void());
+		}
+	}
+
+	// Sends straight from the caller's buffers. Large writes gain little from being batched, and copying them costs
+	// more than the system call.
+	int sendDirect(SendBuffer const* data, int limit) {
+		iovec iov[64];
+		int count = 0;
+		int bytes = 0;
+		for (auto p = data; p && bytes < limit && count < 64; p = p->next) {
+			const int n = std::min(p->bytes_unsent(), limit - bytes);
+			if (n > 0) {
+				iov[count].iov_base = const_cast<uint8_t*>(p->data() + p->bytes_sent);
+				iov[count].iov_len = n;
+				count++;
+				bytes += n;
+			}
+		}
+		msghdr msg;
+		memset(&msg, 0, sizeof(msg));
+		msg.msg_iov = iov;
+		msg.msg_iovlen = count;
+		++reactor->countDirectSends;
+		ssize_t sent = ::sendmsg(fd, &msg, MSG_DONTWAIT | MSG_NOSIGNAL);
+		if (sent < 0) {
+			if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+				sendError = errno;
+			}
+			return 0;
+		}
+		return sent;
+	}
+
+	void releaseReceived() {
+		for (auto& r : received) {
+			reactor->returnBuffer(r.bid);
+		}
+		received.clear();
+	}
+
+	void onError(const char* type, int error) {
+		TraceEvent(SevWarn, type, id)
+		    .suppressFor(1.0)
+		    .detail("PeerAddr", peerAddress)
+		    .detail("PeerAddress", peerAddress)
+		    .detail("ErrorCode", error)
+		    .detail("Message", error ? strerror(error) : closed ? "Closed" : "End of file");
+		close();
+	}
+
+	std::deque<Received> received;
+	bool recvArmed = false;
+	bool recvCancelling = false;
+	bool eof = false;
+	int recvError = 0;
+	Promise<Void> readable;
+
+	// Accepted by write() but not submitted yet
+	std::vector<uint8_t> pending;
+	// Submitted; sent up to sendOffset
+	std::vector<uint8_t> sending;
+	size_t sendOffset = 0;
+	bool sendInFlight = false;
+	int sendError = 0;
+	Promise<Void> writable;
+
+	bool closed = false;
+};
+
+class IOUringConnection final : public IConnection, ReferenceCounted<IOUringConnection> {
+public:
+	explicit IOUringConnection(Reference<IOUringSocket> socket) : socket(socket) {}
+	~IOUringConnection() { socket->close(); }
+
+	void addref() override { ReferenceCounted<IOUringConnection>::addref(); }
+	void delref() override { ReferenceCounted<IOUringConnection>::delref(); }
+
+	void close() override { socket->close(); }
+
+	Future<Void> acceptHandshake() override { return Void(); }
+	Future<Void> connectHandshake() override { return Void(); }
+
+	Future<Void> onWritable() override { return socket->onWritable(); }
+	Future<Void> onReadable() override { return socket->onReadable(); }
+
+	int read(uint8_t* begin, uint8_t* end) override { return socket->read(begin, end); }
+	int write(SendBuffer const* data, int limit) override { return socket->write(data, limit); }
+
+	NetworkAddress getPeerAddress() const override { return socket->peerAddress; }
+	bool hasTrustedPeer() const override { return true; }
+	UID getDebugID() const override { return socket->id; }
+
+	boost::asio::ip::tcp::socket& getSocket() override { return socket->socket; }
+
+private:
+	Reference<IOUringSocket> socket;
+};
+
+std::unique_ptr<IOUringReactor> IOUringReactor::create(boost::asio::io_service& ios,
+                                                       ConnectionMetrics const& metrics) {
+	std::unique_ptr<IOUringReactor> r(new IOUringReactor(ios, metrics));
+	if (!r->setupRing(FLOW_KNOBS->NET2_IO_URING_ENTRIES) ||
+	    !r->setupBuffers(FLOW_KNOBS->NET2_IO_URING_RECV_BUFFERS, FLOW_KNOBS->NET2_IO_URING_RECV_BUFFER_BYTES)) {
+		return nullptr;
+	}
+
+	r->eventFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (r->eventFd < 0 || syscall(__NR_io_uring_register, r->ringFd, IORING_REGISTER_EVENTFD, &r->eventFd, 1) < 0) {
+		TraceEvent(SevWarnAlways, "Net2IOUringRegisterEventFDError").GetLastError();
+		return nullptr;
+	}
+	r->eventDescriptor.assign(r->eventFd);
+	r->armEventFD();
+	r->wake();
+
+	TraceEvent("Net2IOUringInit")
+	    .detail("Entries", r->sqEntries)
+	    .detail("RecvBuffers", r->bufferCount)
+	    .detail("RecvBufferBytes", r->bufferBytes)
+	    .detail("RecvBuffersPerConnection", FLOW_KNOBS->NET2_IO_URING_RECV_BUFFERS_PER_CONNECTION);
+	return r;
+}
+
+IOUringReactor::IOUringReactor(boost::asio::io_service& ios, ConnectionMetrics const& metrics)
+  : eventDescriptor(ios), metrics(metrics) {
+	countSubmit.init("Net2.CountIOUringSubmit"_sr);
+	countCollect.init("Net2.CountIOUringCollect"_sr);
+	countRecvBuffersExhausted.init("Net2.CountIOUringRecvBuffersExhausted"_sr);
+	countRecvCancels.init("Net2.CountIOUringRecvCancels"_sr);
+	countDirectSends.init("Net2.CountIOUringDirectSends"_sr);
+}
+
+// Only destroyed along with the network, so sockets that are still open are not cleaned up
+IOUringReactor::~IOUringReactor() {
+	if (eventDescriptor.is_open()) {
+		boost::system::error_code error;
+		eventDescriptor.close(error);
+	} else if (eventFd >= 0) {
+		::close(eventFd);
+	}
+	closeRing();
+}
+
+bool IOUringReactor::setupRing(unsigned entries) {
+	io_uring_params p;
+	memset(&p, 0, sizeof(p));
+	// Each armed receive can post many completions before they are reaped
+	p.flags = IORING_SETUP_CQSIZE;
+	p.cq_entries = entries * 4;
+	int fd = syscall(__NR_io_uring_setup, entries, &p);
+	if (fd < 0) {
+		TraceEvent(SevWarnAlways, "Net2IOUringSetupError").GetLastError();
+		return false;
+	}
+	ringFd = fd;
+
+	sqRingSize = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+	cqRingSize = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+	bool singleMmap = p.features & IORING_FEAT_SINGLE_MMAP;
+	if (singleMmap) {
+		sqRingSize = cqRingSize = std::max(sqRingSize, cqRingSize);
+	}
+	auto map = [fd](size_t size, off_t offset) {
+		return mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, offset);
+	};
+	sqRing = map(sqRingSize, IORING_OFF_SQ_RING);
+	cqRing = singleMmap ? sqRing : map(cqRingSize, IORING_OFF_CQ_RING);
+	sqesSize = p.sq_entries * sizeof(io_uring_sqe);
+	void* sqesMem = map(sqesSize, IORING_OFF_SQES);
+	if (sqRing == MAP_FAILED || cqRing == MAP_FAILED || sqesMem == MAP_FAILED) {
+		TraceEvent(SevWarnAlways, "Net2IOUringMmapError").GetLastError();
+		if (sqesMem != MAP_FAILED) {
+			munmap(sqesMem, sqesSize);
+		}
+		sqRing = sqRing == MAP_FAILED ? nullptr : sqRing;
+		cqRing = cqRing == MAP_FAILED ? nullptr : cqRing;
+		closeRing();
+		return false;
+	}
+
+	uint8_t* sq = (uint8_t*)sqRing;
+	uint8_t* cq = (uint8_t*)cqRing;
+	sqEntries = p.sq_entries;
+	sqHead = (unsigned*)(sq + p.sq_off.head);
+	sqTail = (unsigned*)(sq + p.sq_off.tail);
+	sqFlags = (unsigned*)(sq + p.sq_off.flags);
+	sqMask = *(unsigned*)(sq + p.sq_off.ring_mask);
+	sqArray = (unsigned*)(sq + p.sq_off.array);
+	sqes = (io_uring_sqe*)sqesMem;
+	sqLocalTail = *sqTail;
+	cqHead = (unsigned*)(cq + p.cq_off.head);
+	cqTail = (unsigned*)(cq + p.cq_off.tail);
+	cqFlags = (unsigned*)(cq + p.cq_off.flags);
+	cqMask = *(unsigned*)(cq + p.cq_off.ring_mask);
+	cqes = (io_uring_cqe*)(cq + p.cq_off.cqes);
+	return true;
+}
+
+bool IOUringReactor::setupBuffers(unsigned count, unsigned bytes) {
+	// Buffer IDs are 16 bits, and the ring size must be a power of two
+	unsigned entries = 1;
+	while (entries < count && entries < 32768) {
+		entries <<= 1;
+	}
+	bufRingSize = entries * sizeof(io_uring_buf);
+	auto map = [](size_t size) {
+		return mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	};
+	void* ringMem = map(bufRingSize);
+	void* buffersMem = map(size_t(entries) * bytes);
+	if (ringMem == MAP_FAILED || buffersMem == MAP_FAILED) {
+		TraceEvent(SevWarnAlways, "Net2IOUringBufferMmapError").GetLastError();
+		if (ringMem != MAP_FAILED) {
+			munmap(ringMem, bufRingSize);
+		}
+		if (buffersMem != MAP_FAILED) {
+			munmap(buffersMem, size_t(entries) * bytes);
+		}
+		return false;
+	}
+	bufRing = (io_uring_buf_ring*)ringMem;
+	buffers = (uint8_t*)buffersMem;
+	bufferCount = entries;
+	bufferBytes = bytes;
+
+	io_uring_buf_reg reg;
+	memset(&reg, 0, sizeof(reg));
+	reg.ring_addr = uint64_t(ringMem);
+	reg.ring_entries = entries;
+	reg.bgid = 0;
+	if (syscall(__NR_io_uring_register, ringFd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+		TraceEvent(SevWarnAlways, "Net2IOUringRegisterBuffersError").GetLastError();
+		return false;
+	}
+	for (unsigned bid = 0; bid < entries; bid++) {
+		returnBuffer(bid);
+	}
+	return true;
+}
+
+void IOUringReactor::closeRing() {
+	if (bufRing) {
+		munmap(bufRing, bufRingSize);
+		munmap(buffers, size_t(bufferCount) * bufferBytes);
+		bufRing = nullptr;
+		buffers = nullptr;
+	}
+	if (sqes) {
+		munmap(sqes, sqesSize);
+		sqes = nullptr;
+	}
+	if (cqRing && cqRing != sqRing) {
+		munmap(cqRing, cqRingSize);
+	}
+	if (sqRing) {
+		munmap(sqRing, sqRingSize);
+	}
+	sqRing = cqRing = nullptr;
+	if (ringFd >= 0) {
+		::close(ringFd);
+		ringFd = -1;
+	}
+}
+
+void IOUringReactor::armEventFD() {
+	eventDescriptor.async_read_some(boost::asio::buffer(&eventValue, sizeof(eventValue)),
+	                                [this](const boost::system::error_code& error, size_t) {
+		                                // Completions are reaped by the run loop right after the ASIOReactor runs
+		                                if (!error) {
+			                                armEventFD();
+		                                }
+	                                });
+}
+
+io_uring_sqe* IOUringReactor::nextSqe() {
+	unsigned index = sqLocalTail++ & sqMask;
+	sqArray[index] = index;
+	++unsubmitted;
+	return &sqes[index];
+}
+
+unsigned IOUringReactor::sqSpace() const {
+	return sqEntries - (sqLocalTail - __atomic_load_n(sqHead, __ATOMIC_ACQUIRE));
+}
+
+bool IOUringReactor::hasCompletions() const {
+	return *cqHead != __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+}
+
+void IOUringReactor::queue(IOUringSocket* socket) {
+	if (!socket->inQueue) {
+		socket->inQueue = true;
+		queued.push_back(Reference<IOUringSocket>::addRef(socket));
+	}
+}
+
+void IOUringReactor::returnBuffer(uint16_t bid) {
+	// Not bufRing->bufs: in C++ the kernel header's flexible array member does not start at offset 0
+	io_uring_buf* buf = reinterpret_cast<io_uring_buf*>(bufRing) + (bufTail & (bufferCount - 1));
+	buf->addr = uint64_t(buffer(bid));
+	buf->len = bufferBytes;
+	buf->bid = bid;
+	__atomic_store_n(&bufRing->tail, ++bufTail, __ATOMIC_RELEASE);
+	++freeBuffers;
+}
+
+void IOUringReactor::submit() {
+	size_t kept = 0;
+	for (size_t i = 0; i < queued.size(); i++) {
+		IOUringSocket* socket = queued[i].getPtr();
+		if (socket->needsRecv() && freeBuffers > 0 && sqSpace() > 0) {
+			socket->prepareRecv(nextSqe());
+		}
+		if (socket->needsRecvCancel() && sqSpace() > 0) {
+			socket->prepareRecvCancel(nextSqe());
+		}
+		if (socket->needsSend() && sqSpace() > 0) {
+			socket->prepareSend(nextSqe());
+		}
+		// Sockets that ran out of receive buffers or ring space wait for the next submission
+		if (socket->needsRecv() || socket->needsRecvCancel() || socket->needsSend()) {
+			if (kept != i) {
+				queued[kept] = std::move(queued[i]);
+			}
+			kept++;
+		} else {
+			socket->inQueue = false;
+		}
+	}
+	queued.resize(kept);
+
+	unsigned flags = 0;
+	if (__atomic_load_n(sqFlags, __ATOMIC_RELAXED) & IORING_SQ_CQ_OVERFLOW) {
+		// Completions that did not fit in the ring are only flushed to it by io_uring_enter
+		flags |= IORING_ENTER_GETEVENTS;
+	}
+	if (unsubmitted == 0 && !flags) {
+		return;
+	}
+	__atomic_store_n(sqTail, sqLocalTail, __ATOMIC_RELEASE);
+	++countSubmit;
+	loop {
+		int rc = syscall(__NR_io_uring_enter, ringFd, unsubmitted, 0, flags, nullptr, 0);
+		if (rc < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			// Entries the kernel did not consume stay in the ring for the next submission
+			if (errno != EAGAIN && errno != EBUSY) {
+				TraceEvent(SevWarnAlways, "Net2IOUringSubmitError").suppressFor(1.0).GetLastError();
+			}
+			return;
+		}
+		unsubmitted -= rc;
+		return;
+	}
+}
+
+int IOUringReactor::reap() {
+	unsigned head = *cqHead;
+	unsigned tail = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+	if (head == tail) {
+		return 0;
+	}
+	++countCollect;
+
+	int count = tail - head;
+	for (; head != tail; ++head) {
+		io_uring_cqe* cqe = &cqes[head & cqMask];
+		IOUringSocket* socket = (IOUringSocket*)(cqe->user_data & ~IOUringSocket::OpMask);
+		// The reference taken when the operation was submitted is released after its last completion
+		switch (cqe->user_data & IOUringSocket::OpMask) {
+		case IOUringSocket::Send:
+			socket->onSend(cqe->res);
+			socket->delref();
+			break;
+		case IOUringSocket::Cancel:
+			// The cancelled receive posts its own last completion
+			socket->delref();
+			break;
+		default:
+			if (!socket->onRecv(cqe->res, cqe->flags)) {
+				socket->delref();
+			}
+		}
+	}
+	__atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+	return count;
+}
+
+bool IOUringReactor::prepareToSleep() {
+	__atomic_and_fetch(cqFlags, ~IORING_CQ_EVENTFD_DISABLED, __ATOMIC_SEQ_CST);
+	return !hasCompletions();
+}
+
+void IOUringReactor::wake() {
+	__atomic_or_fetch(cqFlags, IORING_CQ_EVENTFD_DISABLED, __ATOMIC_RELAXED);
+}
+
+Reference<IConnection> IOUringReactor::adopt(Reference<IConnection> conn) {
+	auto socket = makeReference<IOUringSocket>(
+	    this, std::move(conn->getSocket()), conn->getPeerAddress(), conn->getDebugID());
+	queue(socket.getPtr());
+	return Reference<IConnection>(new IOUringConnection(socket));
+}
+
+#else
+
+std::unique_ptr<IOUringReactor> IOUringReactor::create(boost::asio::io_service& ios,
+                                                       ConnectionMetrics const& metrics) {
+	TraceEvent(SevWarnAlways, "Net2IOUringUnsupported").detail("Reason", "Built without multishot receive support");
+	return nullptr;
+}
+
+IOUringReactor::~IOUringReactor() {}
+Reference<IConnection> IOUringReactor::adopt(Reference<IConnection> conn) {
+	return conn;
+}
+void IOUringReactor::submit() {}
+int IOUringReactor::reap() {
+	return 0;
+}
+bool IOUringReactor::prepareToSleep() {
+	return true;
+}
+void IOUringReactor::wake() {}
+
+#endif
+
+} // namespace N2
+
+#endif
@@ -135,6 +135,9 @@ void FlowKnobs::initialize(Randomize randomize, IsSimulated isSimulated) {
 	init( TLS_HANDSHAKE_THREAD_STACKSIZE,                64 * 1024 );
 	init( TLS_MALLOC_ARENA_MAX,                                  6 );
 	init( TLS_HANDSHAKE_LIMIT,                                1000 );
+	init( TLS_CRYPTO_THREADS,                                    0 );
+	init( TLS_CRYPTO_OFFLOAD_BYTES,                          65536 );
+	init( TLS_CRYPTO_READ_AHEAD_BYTES,                  256 * 1024 );
 
 	init( NETWORK_TEST_CLIENT_COUNT,                            30 );
 	init( NETWORK_TEST_REPLY_SIZE,                           600e3 );
@@ -185,6 +188,17 @@ void FlowKnobs::initialize(Randomize randomize, IsSimulated isSimulated) {
 
 	init( PAGE_WRITE_CHECKSUM_HISTORY,                           0 ); if( randomize && BUGGIFY ) PAGE_WRITE_CHECKSUM_HISTORY = 10000000;
 	init( DISABLE_POSIX_KERNEL_AIO,                              0 );
+	init( ENABLE_IO_URING,                                       0 );
+	init( IO_URING_MAX_LINKED_WRITES,                            4 );
+	init( NET2_IO_URING,                                         0 );
+	init( NET2_IO_URING_ENTRIES,                              1024 );
+	init( NET2_IO_URING_RECV_BUFFERS,                         1024 );
+	init( NET2_IO_URING_RECV_BUFFER_BYTES,                   16384 );
+	init( NET2_IO_URING_RECV_BUFFERS_PER_CONNECTION,            64 );
+	init( NET2_IO_URING_SEND_BUFFER_BYTES,                 1 << 20 );
+	init( NET2_IO_URING_DIRECT_SEND_BYTES,                   16384 );
+	init( NET2_SECONDARY_LOOPS,                                  0 );
+	init( NET2_SECONDARY_LOOP_READ_AHEAD_BYTES,            1 << 20 );
 
 	//AsyncFileNonDurable
 	init( NON_DURABLE_MAX_WRITE_DELAY,                         2.0 ); if( randomize && BUGGIFY ) NON_DURABLE_MAX_WRITE_DELAY = 5.0;
@@ -219,6 +233,7 @@ void FlowKnobs::initialize(Randomize randomize, IsSimulated isSimulated) {
 	init( MIN_LOGGED_PRIORITY_BUSY_FRACTION,                  0.05 );
 	init( CERT_FILE_MAX_SIZE,                      5 * 1024 * 1024 );
 	init( READY_QUEUE_RESERVED_SIZE,                          8192 );
+	init( BUCKETED_TASK_QUEUE,                               false );
 	init( TASKS_PER_REACTOR_CHECK,                             100 );
 
 	//Network
@@ -228,6 +243,7 @@ void FlowKnobs::initialize(Randomize randomize, IsSimulated isSimulated) {
 	init( MAX_PACKET_SEND_BYTES,                        128 * 1024 );
 	init( MIN_PACKET_BUFFER_BYTES,                        4 * 1024 );
 	init( MIN_PACKET_BUFFER_FREE_BYTES,                        256 );
+	init( ZERO_COPY_SEND_BYTES,                                  0 ); if( randomize && BUGGIFY ) ZERO_COPY_SEND_BYTES = deterministicRandom()->randomInt(1, 64 * 1024);
 	init( FLOW_TCP_NODELAY,                                      1 );
 	init( FLOW_TCP_QUICKACK,                                     0 );
 	init( RESOLVE_PREFER_IPV4_ADDR,                          false );  // Default to prefer IPv6 addresses. Set to true to prefer IPv4 addresses.
@@ -29,6 +29,9 @@
 #include <algorithm>
 #include <memory>
 #include <string_view>
+#ifndef _WIN32
+#include <poll.h>
+#endif
 #ifndef BOOST_SYSTEM_NO_LIB
 #define BOOST_SYSTEM_NO_LIB
 #endif
@@ -53,6 +56,8 @@
 #include "flow/ChaosMetrics.h"
 #include "flow/TDMetric.actor.h"
 #include "flow/AsioReactor.h"
+#include "flow/IOUringReactor.h"
+#include "flow/NetworkLoop.h"
 #include "flow/Profiler.h"
 #include "flow/ProtocolVersion.h"
 #include "flow/SendBufferIterator.h"
@@ -64,6 +69,7 @@
 #include "flow/ScopeExit.h"
 #include "flow/IUDPSocket.h"
 #include "flow/IConnection.h"
+#include "flow/MkCert.h"
 
 #ifdef ADDRESS_SANITIZER
 #include <sanitizer/lsan_interface.h>
@@ -166,6 +172,7 @@ public:
 	std::vector<NetworkAddress> resolveTCPEndpointBlockingWithDNSCache(const std::string& host,
 	                                                                   const std::string& service) override;
 	Reference<IListener> listen(NetworkAddress localAddr) override;
+	std::unique_ptr<NetworkLoopReceiver> pinReceiver(Reference<IConnection> const& conn) override;
 
 	// INetwork interface
 	double now() const override { return currentTime; };
@@ -226,10 +233,29 @@ public:
 	// private:
 
 	ASIOReactor reactor;
+#ifdef __linux__
+	// Created when the first plaintext connection is made or accepted while NET2_IO_URING is set
+	std::unique_ptr<IOUringReactor> ioUring;
+	bool ioUringInitialized = false;
+	IOUringReactor* initIOUring() {
+		if (!ioUringInitialized) {
+			ioUringInitialized = true;
+			ioUring = IOUringReactor::create(reactor.ios,
+			                                 { bytesReceived, countReads, countWrites, countWouldBlock });
+		}
+		return ioUring.get();
+	}
+	IOUringReactor* getIOUring() { return FLOW_KNOBS->NET2_IO_URING ? initIOUring() : nullptr; }
+#endif
+	// Started when the first connection is pinned while NET2_SECONDARY_LOOPS is set
+	std::vector<std::unique_ptr<NetworkLoop>> secondaryLoops;
 	AsyncVar<Reference<ReferencedObject<boost::asio::ssl::context>>> sslContextVar;
 	Reference<IThreadPool> sslHandshakerPool;
 	int sslHandshakerThreadsStarted;
 	int sslPoolHandshakesInProgress;
+	// Started with the handshakers when TLS_CRYPTO_THREADS is set
+	Reference<IThreadPool> sslCryptoPool;
+	int sslCryptoThreadsStarted = 0;
 	TLSConfig tlsConfig;
 	Reference<TLSPolicy> activeTlsPolicy;
 	Future<Void> backgroundCertRefresh;
@@ -319,6 +345,8 @@ public:
 	Int64MetricHandle priorityMetric;
 	DoubleMetricHandle countLaunchTime;
 	DoubleMetricHandle countReactTime;
+	DoubleMetricHandle countTLSCryptoTime;
+	DoubleMetricHandle countTLSOffloadedCryptoTime;
 	BoolMetricHandle awakeMetric;
 
 	EventMetricHandle<SlowTask> slowTaskMetric;
@@ -529,10 +557,18 @@ public:
 
 	tcp::socket& getSocket() override { return socket; }
 
+	// From now on the connection is read on networkLoop, see Net2::pinReceiver()
+	std::unique_ptr<NetworkLoopReceiver> pinReceiver(NetworkLoop& networkLoop) {
+		std::unique_ptr<NetworkLoopReceiver> receiver = networkLoop.adoptReceiver(socket);
+		pinned = receiver != nullptr;
+		return receiver;
+	}
+
 private:
 	UID id;
 	tcp::socket socket;
 	NetworkAddress peer_address;
+	bool pinned = false;
 
 	void init() {
 		// Socket settings that have to be set after connect or accept succeeds
@@ -552,6 +588,10 @@ private:
 
 	void closeSocket() {
 		boost::system::error_code error;
+		if (pinned) {
+			// The loop reading the connection holds a duplicate of the socket, so closing this one would not end it
+			socket.shutdown(tcp::socket::shutdown_both, error);
+		}
 		socket.close(error);
 		if (error)
 			TraceEvent(SevWarn, "N2_CloseError", id)
@@ -760,6 +800,16 @@ private:
 	}
 };
 
+// Moves an accepted plaintext connection onto the io_uring, if one is in use
+static Reference<IConnection> adoptConnection(Reference<IConnection> conn) {
+#ifdef __linux__
+	if (IOUringReactor* ioUring = g_net2->getIOUring()) {
+		return ioUring->adopt(conn);
+	}
+#endif
+	return conn;
+}
+
 class Listener final : public IListener, ReferenceCounted<Listener> {
 	boost::asio::io_context& io_service;
 	NetworkAddress listenAddress;
@@ -799,7 +849,7 @@ private:
 			                                                    : IPAddress(peer_endpoint.address().to_v4().to_ulong());
 			conn->accept(NetworkAddress(peer_address, peer_endpoint.port()));
 
-			return conn;
+			return adoptConnection(conn);
 		} catch (...) {
 			conn->close();
 			throw;
@@ -865,6 +915,91 @@ struct SSLHandshakerThread final : IThreadPoolReceiver {
 	}
 };
 
+// Encrypts and decrypts the records of large reads and writes of TLS connections (TLS_CRYPTO_THREADS). A connection
+// hands its ssl_socket over for one action at a time, and leaves it alone until the action is done. Actions stop when
+// the socket would block, so that a peer that doesn't read can't hold up a thread.
+struct SSLCryptoThread final : IThreadPoolReceiver {
+	void init() override {}
+
+	struct Result {
+		int bytes = 0;
+		boost::system::error_code err;
+		double cryptoTime = 0;
+	};
+
+	// Sends [begin, end), or as much of it as the socket takes
+	struct Write final : TypedAction<SSLCryptoThread, Write> {
+		Write(ssl_socket& socket, const uint8_t* begin, const uint8_t* end) : socket(socket), begin(begin), end(end) {}
+		double getTimeEstimate() const override { return 0.001; }
+
+		ssl_socket& socket;
+		const uint8_t* begin;
+		const uint8_t* end;
+		ThreadReturnPromise<Result> done;
+	};
+
+	// Fills [begin, end) with what has been received, or as much of it as there is
+	struct Read final : TypedAction<SSLCryptoThread, Read> {
+		Read(ssl_socket& socket, uint8_t* begin, uint8_t* end) : socket(socket), begin(begin), end(end) {}
+		double getTimeEstimate() const override { return 0.001; }
+
+		ssl_socket& socket;
+		uint8_t* begin;
+		uint8_t* end;
+		ThreadReturnPromise<Result> done;
+	};
+
+	void action(Write& w) {
+		Result result;
+		const double begin = timer_monotonic();
+		while (w.begin + result.bytes < w.end) {
+			// Like the network thread, which waits for onWritable() before each write, only start a record when the
+			// socket has room for it: one that is cut short by a full socket can't be finished
+			if (result.bytes > 0 && !socketWritable(w.socket.next_layer().native_handle())) {
+				break;
+			}
+			const uint8_t* p = w.begin + result.bytes;
+			size_t sent = w.socket.write_some(boost::asio::const_buffer(p, w.end - p), result.err);
+			if (result.err) {
+				break;
+			}
+			result.bytes += sent;
+		}
+		if (result.err == boost::asio::error::would_block) {
+			result.err = boost::system::error_code();
+		}
+		result.cryptoTime = timer_monotonic() - begin;
+		w.done.send(result);
+	}
+
+	void action(Read& r) {
+		Result result;
+		const double begin = timer_monotonic();
+		while (r.begin + result.bytes < r.end) {
+			uint8_t* p = r.begin + result.bytes;
+			size_t size = r.socket.read_some(boost::asio::mutable_buffer(p, r.end - p), result.err);
+			if (result.err) {
+				break;
+			}
+			result.bytes += size;
+		}
+		if (result.err == boost::asio::error::would_block) {
+			result.err = boost::system::error_code();
+		}
+		result.cryptoTime = timer_monotonic() - begin;
+		r.done.send(result);
+	}
+
+	static bool socketWritable(int fd) {
+#ifndef _WIN32
+		pollfd p = { fd, POLLOUT, 0 };
+		return ::poll(&p, 1, 0) == 1 && (p.revents & POLLOUT);
+#else
+		return false;
+#endif
+	}
+};
+
 class SSLConnection final : public IConnection, ReferenceCounted<SSLConnection> {
 public:
 	void addref() override { ReferenceCounted<SSLConnection>::addref(); }
@@ -1085,28 +1220,57 @@ public:
 	// returns when write() can write at least one byte
 	Future<Void> onWritable() override {
 		++g_net2->countWriteProbes;
-		BindPromise p("N2_WriteProbeError", id);
-		auto f = p.getFuture();
-		socket.async_write_some(boost::asio::null_buffers(), std::move(p));
-		return f;
+		if (cryptoFailed) {
+			return Void();
+		}
+		if (offloaded || writeBacklogSent < writeBacklogSize) {
+			// write() takes more bytes once a crypto thread has sent the ones it took before
+			return offloadDone.onTrigger();
+		}
+		return probe(true);
 	}
 
 	// returns when read() can read at least one byte
 	Future<Void> onReadable() override {
 		++g_net2->countReadProbes;
-		BindPromise p("N2_ReadProbeError", id);
-		auto f = p.getFuture();
-		socket.async_read_some(boost::asio::null_buffers(), std::move(p));
-		return f;
+		if (cryptoFailed || readAheadBegin < readAheadEnd) {
+			return Void();
+		}
+		if (offloaded) {
+			return offloadDone.onTrigger();
+		}
+		return probe(false);
 	}
 
 	// Reads as many bytes as possible from the read buffer into [begin,end) and returns the number of bytes read (might
 	// be 0)
 	int read(uint8_t* begin, uint8_t* end) override {
-		boost::system::error_code err;
 		++g_net2->countReads;
+		if (readAheadBegin < readAheadEnd) {
+			const int size = std::min<int>(end - begin, readAheadEnd - readAheadBegin);
+			memcpy(begin, readAheadBegin, size);
+			readAheadBegin += size;
+			return size;
+		}
+		if (cryptoFailed) {
+			throw connection_failed();
+		}
+		if (offloaded) {
+			return 0;
+		}
+		if (g_net2->sslCryptoThreadsStarted > 0) {
+			boost::system::error_code availableError;
+			if (socket.available(availableError) >= FLOW_KNOBS->TLS_CRYPTO_OFFLOAD_BYTES && !availableError) {
+				offload(Reference<SSLConnection>::addRef(this), true);
+				return 0;
+			}
+		}
+
+		boost::system::error_code err;
 		size_t toRead = end - begin;
+		const double cryptoBegin = timer_monotonic();
 		size_t size = ssl_sock.read_some(boost::asio::mutable_buffers_1(begin, toRead), err);
+		addCryptoTime(timer_monotonic() - cryptoBegin);
 		g_net2->bytesReceived += size;
 		//TraceEvent("ConnRead", this->id).detail("Bytes", size);
 		if (err) {
@@ -1130,11 +1294,42 @@ public:
 		// broken pipe error.
 		limit = std::min(limit, 2016);
 #endif
-		boost::system::error_code err;
 		++g_net2->countWrites;
+		if (cryptoFailed) {
+			throw connection_failed();
+		}
+		if (offloaded || writeBacklogSent < writeBacklogSize) {
+			// The bytes taken by an earlier write() go first
+			return 0;
+		}
+		if (g_net2->sslCryptoThreadsStarted > 0 && limit >= FLOW_KNOBS->TLS_CRYPTO_OFFLOAD_BYTES) {
+			int size = 0;
+			for (auto p = data; p && size < limit; p = p->next) {
+				size += std::min(p->bytes_unsent(), limit - size);
+			}
+			if (size >= FLOW_KNOBS->TLS_CRYPTO_OFFLOAD_BYTES) {
+				// The unsent packets may be discarded before the crypto thread is done with them, so it gets a copy,
+				// which costs far less than encrypting it
+				if (size > writeBacklogCapacity) {
+					writeBacklog.reset(new uint8_t[size]);
+					writeBacklogCapacity = size;
+				}
+				writeBacklogSize = writeBacklogSent = 0;
+				for (auto p = data; p && writeBacklogSize < size; p = p->next) {
+					const int bytes = std::min(p->bytes_unsent(), size - writeBacklogSize);
+					memcpy(writeBacklog.get() + writeBacklogSize, p->data() + p->bytes_sent, bytes);
+					writeBacklogSize += bytes;
+				}
+				offload(Reference<SSLConnection>::addRef(this), false);
+				return size;
+			}
+		}
 
+		boost::system::error_code err;
+		const double cryptoBegin = timer_monotonic();
 		size_t sent = ssl_sock.write_some(
 		    boost::iterator_range<SendBufferIterator>(SendBufferIterator(data, limit), SendBufferIterator()), err);
+		addCryptoTime(timer_monotonic() - cryptoBegin);
 
 		if (err) {
 			// Since there was an error, sent's value can't be used to infer that the buffer has data and the limit is
@@ -1171,6 +1366,16 @@ public:
 
 	ssl_socket& getSSLSocket() { return ssl_sock; }
 
+	~SSLConnection() {
+		if (cryptoTime > 0 || offloadedCryptoTime > 0) {
+			TraceEvent("N2_TLSCryptoTime", id)
+			    .suppressFor(1.0)
+			    .detail("PeerAddress", peer_address)
+			    .detail("CryptoTime", cryptoTime)
+			    .detail("OffloadedCryptoTime", offloadedCryptoTime);
+		}
+	}
+
 private:
 	UID id;
 	tcp::socket socket;
@@ -1179,6 +1384,118 @@ private:
 	Reference<ReferencedObject<boost::asio::ssl::context>> sslContext;
 	bool has_trusted_peer;
 
+	// Seconds spent reading and writing records, most of it in the cipher, on the network thread and on crypto threads
+	double cryptoTime = 0;
+	double offloadedCryptoTime = 0;
+
+	// While offloaded, a crypto thread uses ssl_sock and socket, and the network thread must not touch them
+	bool offloaded = false;
+	bool closeRequested = false;
+	bool cryptoFailed = false;
+	AsyncTrigger offloadDone;
+	// Bytes decrypted by a crypto thread that read() hasn't returned yet
+	std::unique_ptr<uint8_t[]> readAhead;
+	uint8_t* readAheadBegin = nullptr;
+	uint8_t* readAheadEnd = nullptr;
+	// Bytes taken by write() that a crypto thread hasn't sent yet
+	std::unique_ptr<uint8_t[]> writeBacklog;
+	int writeBacklogCapacity = 0;
+	int writeBacklogSize = 0;
+	int writeBacklogSent = 0;
+
+	Future<Void> probe(bool writable) {
+		if (writable) {
+			BindPromise p("N2_WriteProbeError", id);
+			auto f = p.getFuture();
+			socket.async_write_some(boost::asio::null_buffers(), std::move(p));
+			return f;
+		}
+		BindPromise p("N2_ReadProbeError", id);
+		auto f = p.getFuture();
+		socket.async_read_some(boost::asio::null_buffers(), std::move(p));
+		return f;
+	}
+
+	void addCryptoTime(double seconds) {
+		cryptoTime += seconds;
+		g_net2->countTLSCryptoTime += seconds;
+	}
+
+	// Runs a read, or writes until the backlog is sent, on a crypto thread. Holds a reference to the connection, whose
+	// ssl_sock and buffers the thread uses.
+	ACTOR static void offload(Reference<SSLConnection> self, bool isRead) {
+		state SSLCryptoThread::Result result;
+		try {
+			loop {
+				self->offloaded = true;
+				Future<SSLCryptoThread::Result> done;
+				if (isRead) {
+					if (!self->readAhead) {
+						self->readAhead.reset(new uint8_t[FLOW_KNOBS->TLS_CRYPTO_READ_AHEAD_BYTES]);
+					}
+					auto read = new SSLCryptoThread::Read(self->ssl_sock,
+					                                      self->readAhead.get(),
+					                                      self->readAhead.get() +
+					                                          FLOW_KNOBS->TLS_CRYPTO_READ_AHEAD_BYTES);
+					done = read->done.getFuture();
+					g_net2->sslCryptoPool->post(read);
+				} else {
+					auto write = new SSLCryptoThread::Write(self->ssl_sock,
+					                                        self->writeBacklog.get() + self->writeBacklogSent,
+					                                        self->writeBacklog.get() + self->writeBacklogSize);
+					done = write->done.getFuture();
+					g_net2->sslCryptoPool->post(write);
+				}
+				wait(store(result, done));
+				self->offloaded = false;
+
+				self->offloadedCryptoTime += result.cryptoTime;
+				g_net2->countTLSOffloadedCryptoTime += result.cryptoTime;
+				if (isRead) {
+					self->readAheadBegin = self->readAhead.get();
+					self->readAheadEnd = self->readAheadBegin + result.bytes;
+					g_net2->bytesReceived += result.bytes;
+				} else {
+					self->writeBacklogSent += result.bytes;
+				}
+				if (result.err) {
+					self->cryptoFailed = true;
+					if (isRead) {
+						self->onReadError(result.err);
+					} else {
+						self->onWriteError(result.err);
+					}
+					break;
+				}
+				if (self->closeRequested) {
+					self->cryptoFailed = true;
+					self->closeSocket();
+					break;
+				}
+				if (isRead || self->writeBacklogSent == self->writeBacklogSize) {
+					break;
+				}
+
+				// The socket is full; send the rest once it isn't, and after a read that starts in the meantime
+				self->offloadDone.trigger();
+				wait(self->probe(true));
+				while (self->offloaded) {
+					wait(self->offloadDone.onTrigger());
+				}
+				if (self->cryptoFailed || self->closeRequested) {
+					// Closed while waiting, by close() or by the read that ran in the meantime
+					self->cryptoFailed = true;
+					break;
+				}
+			}
+		} catch (Error& e) {
+			// The connection was closed while waiting for the socket, or the crypto threads were stopped
+			self->offloaded = false;
+			self->cryptoFailed = true;
+		}
+		self->offloadDone.trigger();
+	}
+
 	void init() {
 		// Socket settings that have to be set after connect or accept succeeds
 		socket.non_blocking(true);
@@ -1187,6 +1504,12 @@ private:
 	}
 
 	void closeSocket() {
+		// Also stops a write that is waiting for the socket to take the rest of its backlog
+		closeRequested = true;
+		if (offloaded) {
+			// Closed by offload() once the crypto thread is done with the socket
+			return;
+		}
 		boost::system::error_code cancelError;
 		socket.cancel(cancelError);
 		boost::system::error_code closeError;
@@ -1410,6 +1733,14 @@ void Net2::initTLS(ETLSInitState targetState) {
 				sslHandshakerPool->addThread(new SSLHandshakerThread(), "fdb-ssl-connect");
 			}
 		}
+
+		if (FLOW_KNOBS->TLS_CRYPTO_THREADS > 0 && sslCryptoThreadsStarted == 0) {
+			sslCryptoPool = createGenericThreadPool();
+			for (int i = 0; i < FLOW_KNOBS->TLS_CRYPTO_THREADS; ++i) {
+				++sslCryptoThreadsStarted;
+				sslCryptoPool->addThread(new SSLCryptoThread(), "fdb-ssl-crypto");
+			}
+		}
 	}
 
 	tlsInitializedState = targetState;
@@ -1448,6 +1779,8 @@ void Net2::initMetrics() {
 	slowTaskMetric.init("Net2.SlowTask"_sr);
 	countLaunchTime.init("Net2.CountLaunchTime"_sr);
 	countReactTime.init("Net2.CountReactTime"_sr);
+	countTLSCryptoTime.init("Net2.CountTLSCryptoTime"_sr);
+	countTLSOffloadedCryptoTime.init("Net2.CountTLSOffloadedCryptoTime"_sr);
 	taskQueue.initMetrics();
 }
 
@@ -1503,12 +1836,22 @@ void Net2::run() {
 			countLaunchTime += taskEnd - taskBegin;
 			checkForSlowTask(tscBegin, timestampCounter(), taskEnd - taskBegin, TaskPriority::RunCycleFunction);
 		}
+#ifdef __linux__
+		if (ioUring) {
+			ioUring->submit();
+		}
+#endif
 
 		double sleepTime = 0;
 		if (taskQueue.canSleep()) {
 			sleepTime = 1e99;
 			double sleepStart = timer_monotonic();
 			sleepTime = taskQueue.getSleepTime(sleepStart);
+#ifdef __linux__
+			if (ioUring && !ioUring->prepareToSleep()) {
+				sleepTime = 0;
+			}
+#endif
 			if (sleepTime > 0) {
 #if defined(__linux__)
 				// notify the run loop monitoring thread that we have gone idle
@@ -1521,12 +1864,22 @@ void Net2::run() {
 				reactor.sleep(sleepTime);
 				awakeMetric = true;
 			}
+#ifdef __linux__
+			if (ioUring) {
+				ioUring->wake();
+			}
+#endif
 		}
 
 		tscBegin = timestampCounter();
 		taskBegin = timer_monotonic();
 		trackAtPriority(TaskPriority::ASIOReactor, taskBegin);
 		reactor.react();
+#ifdef __linux__
+		if (ioUring) {
+			ioUring->reap();
+		}
+#endif
 		tasksSinceReact = 0;
 
 		updateNow();
@@ -1544,6 +1897,18 @@ void Net2::run() {
 
 		taskQueue.processThreadReady();
 
+		// Connections read on secondary loops count towards the same metrics as those read here
+		for (auto& networkLoop : secondaryLoops) {
+			int64_t reads, bytes;
+			networkLoop->takeReads(reads, bytes);
+			if (reads) {
+				countReads += reads;
+			}
+			if (bytes) {
+				bytesReceived += bytes;
+			}
+		}
+
 		tscBegin = timestampCounter();
 		tscEnd = tscBegin + FLOW_KNOBS->TSC_YIELD_TIME;
 		taskBegin = timer_monotonic();
@@ -1578,7 +1943,17 @@ void Net2::run() {
 				if (runFunc) {
 					runFunc();
 				}
+#ifdef __linux__
+				if (ioUring) {
+					ioUring->submit();
+				}
+#endif
 				reactor.react();
+#ifdef __linux__
+				if (ioUring) {
+					ioUring->reap();
+				}
+#endif
 				tasksSinceReact = 0;
 			}
 
@@ -1847,6 +2222,12 @@ Future<Reference<IConnection>> Net2::connect(NetworkAddress toAddr, tcp::socket*
 		throw connection_failed();
 	}
 
+#ifdef __linux__
+	if (IOUringReactor* ioUring = getIOUring()) {
+		return map(Connection::connect(&this->reactor.ios, toAddr),
+		           [ioUring](Reference<IConnection> conn) { return ioUring->adopt(conn); });
+	}
+#endif
 	return Connection::connect(&this->reactor.ios, toAddr);
 }
 
@@ -1995,6 +2376,22 @@ bool Net2::isAddressOnThisHost(NetworkAddress const& addr) const {
 	}
 }
 
+std::unique_ptr<NetworkLoopReceiver> Net2::pinReceiver(Reference<IConnection> const& conn) {
+	// Only plaintext connections read by boost::asio are pinned. A TLS connection decrypts what it reads with state it
+	// shares with its writes, and a connection on the io_uring has a receive armed already.
+	if (FLOW_KNOBS->NET2_SECONDARY_LOOPS <= 0) {
+		return nullptr;
+	}
+	Connection* connection = dynamic_cast<Connection*>(conn.getPtr());
+	if (!connection) {
+		return nullptr;
+	}
+	while ((int)secondaryLoops.size() < FLOW_KNOBS->NET2_SECONDARY_LOOPS) {
+		secondaryLoops.push_back(std::make_unique<NetworkLoop>(secondaryLoops.size()));
+	}
+	return connection->pinReceiver(*secondaryLoops[conn->getDebugID().first() % secondaryLoops.size()]);
+}
+
 Reference<IListener> Net2::listen(NetworkAddress localAddr) {
 	try {
 		if (localAddr.isTLS()) {
@@ -2296,6 +2693,355 @@ TEST_CASE("noSim/flow/Net2/onMainThreadFIFO") {
 	return Void();
 }
 
+// A SendBuffer over a caller's bytes
+struct LoopbackSendBuffer : SendBuffer {
+	LoopbackSendBuffer(uint8_t* begin, int size) {
+		_data = begin;
+		next = nullptr;
+		bytes_written = size;
+		bytes_sent = 0;
+	}
+};
+
+ACTOR static Future<Void> loopbackSend(Reference<IConnection> conn, uint8_t* data, int size) {
+	state LoopbackSendBuffer buffer(data, size);
+	loop {
+		buffer.bytes_sent += conn->write(&buffer, buffer.bytes_unsent());
+		if (buffer.bytes_unsent() == 0) {
+			return Void();
+		}
+		wait(conn->onWritable());
+	}
+}
+
+ACTOR static Future<Void> loopbackReceive(Reference<IConnection> conn, uint8_t* data, int size) {
+	state int received = 0;
+	loop {
+		received += conn->read(data + received, data + size);
+		if (received == size) {
+			return Void();
+		}
+		wait(conn->onReadable());
+	}
+}
+
+// Sends size bytes from one end of a connection to the other, and checks that they arrive unchanged
+ACTOR static Future<Void> loopbackTransfer(Reference<IConnection> from, Reference<IConnection> to, int size) {
+	state std::vector<uint8_t> sent(size);
+	state std::vector<uint8_t> received(size);
+	for (int i = 0; i < size; i++) {
+		sent[i] = uint8_t(i * 7 + size);
+	}
+	wait(loopbackSend(from, sent.data(), size) && loopbackReceive(to, received.data(), size));
+	ASSERT(sent == received);
+	return Void();
+}
+
+// Returns the client and the server end of a new connection to listener
+ACTOR static Future<std::pair<Reference<IConnection>, Reference<IConnection>>> loopbackConnect(
+    Reference<IListener> listener) {
+	state Future<Reference<IConnection>> accepted = listener->accept();
+	state Reference<IConnection> client = wait(INetworkConnections::net()->connect(listener->getListenAddress()));
+	Reference<IConnection> server = wait(accepted);
+	return std::make_pair(client, server);
+}
+
+// Reads a connection pinned to a NetworkLoop, on the loop
+struct LoopbackPinnedReader : std::enable_shared_from_this<LoopbackPinnedReader> {
+	std::unique_ptr<NetworkLoopReceiver> receiver;
+	std::vector<uint8_t> data;
+	int received = 0;
+	bool ended = false;
+	std::shared_ptr<ThreadReturnPromise<Void>> done;
+
+	// Reads until data is full or the connection ends. Call on the network thread.
+	Future<Void> read() {
+		done = std::make_shared<ThreadReturnPromise<Void>>();
+		Future<Void> f = done->getFuture();
+		receiver->networkLoop->post([self = shared_from_this()] { self->readOnLoop(); });
+		return f;
+	}
+
+	void readOnLoop() {
+		while (received < data.size()) {
+			const int bytes = receiver->read(data.data() + received, data.data() + data.size());
+			if (bytes < 0) {
+				ended = true;
+				break;
+			}
+			if (bytes == 0) {
+				receiver->onReadable([self = shared_from_this()] { self->readOnLoop(); });
+				return;
+			}
+			received += bytes;
+		}
+		done->send(Void());
+	}
+};
+
+ACTOR static Future<std::shared_ptr<LoopbackPinnedReader>> loopbackPin(NetworkLoop* networkLoop,
+                                                                       Reference<IConnection> conn) {
+	state std::shared_ptr<LoopbackPinnedReader> reader = std::make_shared<LoopbackPinnedReader>();
+	// Not an asio connection when NET2_IO_URING is set
+	if (N2::Connection* connection = dynamic_cast<N2::Connection*>(conn.getPtr())) {
+		reader->receiver = connection->pinReceiver(*networkLoop);
+	}
+	return reader;
+}
+
+TEST_CASE("noSim/flow/Net2/pinReceiver") {
+	state NetworkLoop networkLoop(0);
+	state Reference<IListener> listener = INetworkConnections::net()->listen(NetworkAddress::parse("127.0.0.1:0"));
+	state std::pair<Reference<IConnection>, Reference<IConnection>> conns = wait(loopbackConnect(listener));
+	state std::shared_ptr<LoopbackPinnedReader> reader = wait(loopbackPin(&networkLoop, conns.second));
+	if (!reader->receiver) {
+		return Void();
+	}
+
+	// What the peer sends is read on the loop, and counted as reads of the loop
+	state std::vector<uint8_t> sent(8 << 20);
+	for (int i = 0; i < sent.size(); i++) {
+		sent[i] = uint8_t(i * 13);
+	}
+	reader->data.resize(sent.size());
+	wait(loopbackSend(conns.first, sent.data(), sent.size()) && reader->read());
+	ASSERT(!reader->ended);
+	ASSERT(reader->data == sent);
+	state int64_t reads;
+	state int64_t bytes;
+	networkLoop.takeReads(reads, bytes);
+	ASSERT_GE(reads, 1);
+	ASSERT_EQ(bytes, (int64_t)sent.size());
+
+	// The network thread can still write to the connection, and closing it there ends it on the loop and for the peer
+	wait(loopbackTransfer(conns.second, conns.first, 1000));
+	reader->data.resize(reader->received + 1);
+	state Future<Void> ended = reader->read();
+	conns.second->close();
+	wait(ended);
+	ASSERT(reader->ended);
+	try {
+		wait(loopbackTransfer(conns.second, conns.first, 1));
+		ASSERT(false);
+	} catch (Error& e) {
+		ASSERT_EQ(e.code(), error_code_connection_failed);
+	}
+	conns.first->close();
+
+	// The loop also sees the peer close the connection
+	wait(store(conns, loopbackConnect(listener)));
+	state std::shared_ptr<LoopbackPinnedReader> closedByPeer = wait(loopbackPin(&networkLoop, conns.second));
+	closedByPeer->data.resize(1);
+	ended = closedByPeer->read();
+	conns.first->close();
+	wait(ended);
+	ASSERT(closedByPeer->ended);
+	conns.second->close();
+
+	// Receivers are destroyed on their loop
+	wait(success(networkLoop.call([reader = reader, closedByPeer = closedByPeer] {
+		reader->receiver.reset();
+		closedByPeer->receiver.reset();
+		return 0;
+	})));
+	return Void();
+}
+
+// Replaces the TLS context with one for a self-signed certificate, with which connections to this process succeed, and
+// puts the one it replaced back when it is destroyed. Crypto threads start with the context unless TLS was used before.
+struct LoopbackSelfSignedTLS {
+	Reference<ReferencedObject<boost::asio::ssl::context>> context;
+	Reference<TLSPolicy> policy;
+
+	LoopbackSelfSignedTLS() {
+		const int cryptoThreads = FLOW_KNOBS->TLS_CRYPTO_THREADS;
+		const_cast<FlowKnobs*>(FLOW_KNOBS)->TLS_CRYPTO_THREADS = std::max(cryptoThreads, 2);
+		N2::g_net2->initTLS(INetwork::ETLSInitState::LISTEN);
+		const_cast<FlowKnobs*>(FLOW_KNOBS)->TLS_CRYPTO_THREADS = cryptoThreads;
+		context = N2::g_net2->sslContextVar.get();
+		policy = N2::g_net2->activeTlsPolicy;
+
+		Arena arena;
+		mkcert::CertChainRef chain = mkcert::makeCertChain(arena, 1, mkcert::ESide::Server);
+		TLSConfig config(TLSEndpointType::SERVER);
+		config.setCertificateBytes(chain[0].certPem.toString());
+		config.setKeyBytes(chain[0].privateKeyPem.toString());
+		config.setCABytes(chain[0].certPem.toString());
+		LoadedTLSConfig loaded = config.loadSync();
+		boost::asio::ssl::context selfSigned(boost::asio::ssl::context::tls);
+		ConfigureSSLContext(loaded, selfSigned);
+		N2::g_net2->activeTlsPolicy = makeReference<TLSPolicy>(loaded, [] {});
+		N2::g_net2->sslContextVar.set(ReferencedObject<boost::asio::ssl::context>::from(std::move(selfSigned)));
+	}
+
+	~LoopbackSelfSignedTLS() {
+		N2::g_net2->activeTlsPolicy = policy;
+		N2::g_net2->sslContextVar.set(context);
+	}
+};
+
+// Like loopbackConnect, for a TLS listener, and returns once both ends are done with the handshake
+ACTOR static Future<std::pair<Reference<IConnection>, Reference<IConnection>>> loopbackConnectTLS(
+    Reference<IListener> listener) {
+	state std::pair<Reference<IConnection>, Reference<IConnection>> conns = wait(loopbackConnect(listener));
+	wait(conns.first->connectHandshake() && conns.second->acceptHandshake());
+	return conns;
+}
+
+// Reads conn until it fails, and returns the number of bytes read, which must be the start of the size bytes of data
+ACTOR static Future<int> loopbackReceiveUntilClosed(Reference<IConnection> conn, uint8_t const* data, int size) {
+	state std::vector<uint8_t> received(size + 1);
+	state int bytes = 0;
+	try {
+		loop {
+			bytes += conn->read(received.data() + bytes, received.data() + received.size());
+			ASSERT_LE(bytes, size);
+			wait(conn->onReadable());
+		}
+	} catch (Error& e) {
+		ASSERT_EQ(e.code(), error_code_connection_failed);
+	}
+	ASSERT(memcmp(received.data(), data, bytes) == 0);
+	return bytes;
+}
+
+TEST_CASE("noSim/flow/Net2/TLS/offload") {
+	state LoopbackSelfSignedTLS tls;
+	if (N2::g_net2->sslCryptoThreadsStarted == 0) {
+		// TLS was started without crypto threads before the test
+		return Void();
+	}
+	state Reference<IListener> listener =
+	    INetworkConnections::net()->listen(NetworkAddress::parse("127.0.0.1:0:tls"));
+	state std::pair<Reference<IConnection>, Reference<IConnection>> conns = wait(loopbackConnectTLS(listener));
+
+	// Reads and writes of at least TLS_CRYPTO_OFFLOAD_BYTES are done by the crypto threads, and smaller ones aren't
+	state double offloadedCryptoTime = N2::g_net2->countTLSOffloadedCryptoTime;
+	wait(loopbackTransfer(conns.first, conns.second, 100));
+	wait(loopbackTransfer(conns.second, conns.first, 100));
+	ASSERT_EQ(N2::g_net2->countTLSOffloadedCryptoTime, offloadedCryptoTime);
+	state int size = 8 * FLOW_KNOBS->TLS_CRYPTO_READ_AHEAD_BYTES + 7;
+	wait(loopbackTransfer(conns.first, conns.second, size));
+	wait(loopbackTransfer(conns.second, conns.first, size));
+	ASSERT_GT(N2::g_net2->countTLSOffloadedCryptoTime, offloadedCryptoTime);
+
+	// A write that is closed while a crypto thread sends it stops once the thread is done, and the peer gets what was
+	// sent before the connection ends
+	state std::vector<uint8_t> sent(size);
+	for (int i = 0; i < size; i++) {
+		sent[i] = uint8_t(i * 11);
+	}
+	LoopbackSendBuffer buffer(sent.data(), size);
+	ASSERT_EQ(conns.first->write(&buffer, size), size);
+	conns.first->close();
+	state int received = wait(loopbackReceiveUntilClosed(conns.second, sent.data(), size));
+	wait(conns.first->onWritable());
+	try {
+		LoopbackSendBuffer unsent(sent.data(), size);
+		conns.first->write(&unsent, size);
+		ASSERT(false);
+	} catch (Error& e) {
+		ASSERT_EQ(e.code(), error_code_connection_failed);
+	}
+	conns.second->close();
+
+	// So does one that waits for a peer that doesn't read to make room for the rest, which the peer never gets
+	wait(store(conns, loopbackConnectTLS(listener)));
+	state int backlogSize = 64 << 20;
+	state std::vector<uint8_t> backlog(backlogSize);
+	for (int i = 0; i < backlogSize; i++) {
+		backlog[i] = uint8_t(i * 13);
+	}
+	LoopbackSendBuffer backlogBuffer(backlog.data(), backlogSize);
+	ASSERT_EQ(conns.first->write(&backlogBuffer, backlogSize), backlogSize);
+	wait(delay(0.5));
+	conns.first->close();
+	wait(conns.first->onWritable());
+	wait(store(received, loopbackReceiveUntilClosed(conns.second, backlog.data(), backlogSize)));
+	ASSERT_LT(received, backlogSize);
+	conns.second->close();
+
+	// A read that is closed while a crypto thread decrypts it returns what the thread read, and then fails
+	wait(store(conns, loopbackConnectTLS(listener)));
+	state Future<Void> sending = loopbackSend(conns.first, sent.data(), size);
+	wait(delay(0.5));
+	state std::vector<uint8_t> readBuffer(size);
+	received = conns.second->read(readBuffer.data(), readBuffer.data() + size);
+	conns.second->close();
+	try {
+		loop {
+			wait(conns.second->onReadable());
+			received += conns.second->read(readBuffer.data() + received, readBuffer.data() + size);
+		}
+	} catch (Error& e) {
+		ASSERT_EQ(e.code(), error_code_connection_failed);
+	}
+	ASSERT(memcmp(readBuffer.data(), sent.data(), received) == 0);
+	sending.cancel();
+	conns.first->close();
+	return Void();
+}
+
+#ifdef __linux__
+
+TEST_CASE("noSim/flow/Net2/IOUring/loopback") {
+	state N2::IOUringReactor* ioUring = N2::g_net2->initIOUring();
+	if (!ioUring) {
+		// The kernel does not support multishot receives
+		return Void();
+	}
+
+	// Connected by asio, and moved onto the io_uring unless NET2_IO_URING already did that
+	state Reference<IListener> listener = INetworkConnections::net()->listen(NetworkAddress::parse("127.0.0.1:0"));
+	state std::vector<Reference<IConnection>> clients;
+	state std::vector<Reference<IConnection>> servers;
+	while (clients.size() < 2) {
+		std::pair<Reference<IConnection>, Reference<IConnection>> conns = wait(loopbackConnect(listener));
+		clients.push_back(FLOW_KNOBS->NET2_IO_URING ? conns.first : ioUring->adopt(conns.first));
+		servers.push_back(FLOW_KNOBS->NET2_IO_URING ? conns.second : ioUring->adopt(conns.second));
+	}
+
+	// Small writes are staged and large ones to an idle socket are sent directly, and either may span many receive
+	// buffers. Reads and writes count towards the Net2 metrics like those of asio connections.
+	state std::vector<int> sizes = { 1, 100, FLOW_KNOBS->NET2_IO_URING_DIRECT_SEND_BYTES, 1 << 20 };
+	sizes.push_back(3 * FLOW_KNOBS->NET2_IO_URING_RECV_BUFFER_BYTES + 7);
+	state int64_t bytesReceived = N2::g_net2->bytesReceived;
+	state int64_t countReads = N2::g_net2->countReads;
+	state int64_t countWrites = N2::g_net2->countWrites;
+	state int64_t transferred = 0;
+	state int i = 0;
+	for (i = 0; i < sizes.size(); i++) {
+		wait(loopbackTransfer(clients[0], servers[0], sizes[i]));
+		wait(loopbackTransfer(servers[0], clients[0], sizes[i]));
+		transferred += 2 * sizes[i];
+	}
+	ASSERT_GE(N2::g_net2->bytesReceived - bytesReceived, transferred);
+	ASSERT_GE(N2::g_net2->countReads - countReads, 2 * (int64_t)sizes.size());
+	ASSERT_GE(N2::g_net2->countWrites - countWrites, 2 * (int64_t)sizes.size());
+
+	// A connection that is not read holds at most NET2_IO_URING_RECV_BUFFERS_PER_CONNECTION of the receive buffers,
+	// even if its peer sends more than all of them can hold, so the other connection still receives
+	state int backlogSize = (FLOW_KNOBS->NET2_IO_URING_RECV_BUFFERS + 1) * FLOW_KNOBS->NET2_IO_URING_RECV_BUFFER_BYTES;
+	state std::vector<uint8_t> backlog(backlogSize);
+	for (i = 0; i < backlogSize; i++) {
+		backlog[i] = uint8_t(i * 13);
+	}
+	state Future<Void> backlogSent = loopbackSend(clients[0], backlog.data(), backlogSize);
+	wait(delay(0.5));
+	wait(timeoutError(loopbackTransfer(clients[1], servers[1], 1000), 30.0));
+
+	state std::vector<uint8_t> backlogReceived(backlogSize);
+	wait(timeoutError(backlogSent && loopbackReceive(servers[0], backlogReceived.data(), backlogSize), 30.0));
+	ASSERT(backlog == backlogReceived);
+
+	for (i = 0; i < clients.size(); i++) {
+		clients[i]->close();
+		servers[i]->close();
+	}
+	return Void();
+}
+#endif
+
 void net2_test(){
 	/*
 	g_network = newNet2();  // for promise serialization below
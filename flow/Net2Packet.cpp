@@ -19,12 +19,16 @@
  */
 
 #include "flow/Net2Packet.h"
+#include "flow/UnitTest.h"
+#include "flow/WipedString.h"
 
 void PacketWriter::init(PacketBuffer* buf, ReliablePacket* reliable) {
 	this->buffer = buf;
 	this->reliable = reliable;
 	this->length = 0;
 	length -= buffer->bytes_written;
+	this->referenceMinBytes = FLOW_KNOBS->ZERO_COPY_SEND_BYTES;
+	this->referencedArena = nullptr;
 	if (reliable) {
 		reliable->buffer = buffer;
 		buffer->addref();
@@ -56,11 +60,15 @@ void PacketWriter::serializeBytesAcrossBoundary(const void* data, int bytes) {
 }
 
 void PacketWriter::nextBuffer(size_t size) {
+	appendBuffer(PacketBuffer::create(size));
+}
+
+void PacketWriter::appendBuffer(PacketBuffer* next) {
 	auto last_buffer_bytes_written = buffer->bytes_written;
 	length += last_buffer_bytes_written;
 
-	buffer->next = PacketBuffer::create(size);
-	buffer = buffer->nextPacketBuffer();
+	buffer->next = next;
+	buffer = next;
 
 	if (reliable) {
 		reliable->end = last_buffer_bytes_written;
@@ -72,6 +80,43 @@ void PacketWriter::nextBuffer(size_t size) {
 	}
 }
 
+// Splits the current buffer around the strings taken by reference while serializing into it. The serialized bytes
+// from the first of them on move to new buffers, with a reference buffer for each string in between, so that the
+// packet is sent as it would have been written but without copying those strings.
+void PacketWriter::spliceReferences() {
+	ASSERT(referencedArena);
+	if (!references.empty()) {
+		std::sort(references.begin(), references.end(), [](auto const& a, auto const& b) { return a.first < b.first; });
+		PacketBuffer* source = buffer;
+		uint8_t* sourceEnd = source->data() + source->bytes_written;
+		uint8_t* unspliced = references.front().first;
+		source->bytes_written = unspliced - source->data();
+
+		auto copyFromSource = [&](uint8_t* end) {
+			// Always makes a new buffer, so that the message never ends in a reference
+			nextBuffer(end - unspliced);
+			uint8_t* out = buffer->data() + buffer->bytes_written;
+			memcpy(out, unspliced, end - unspliced);
+			buffer->bytes_written += end - unspliced;
+			if (source->isMarkedForWipe(unspliced, end - unspliced)) {
+				buffer->markForWipe(out, end - unspliced);
+			}
+			unspliced = end;
+		};
+		for (auto const& [out, bytes] : references) {
+			ASSERT(unspliced <= out && out + bytes.size() <= sourceEnd);
+			if (unspliced < out) {
+				copyFromSource(out);
+			}
+			appendBuffer(PacketBuffer::createReference(bytes, *referencedArena));
+			unspliced = out + bytes.size();
+		}
+		copyFromSource(sourceEnd);
+		references.clear();
+	}
+	referencedArena = nullptr;
+}
+
 // Adds exactly bytes of unwritten length to the buffer, possibly across packet buffer boundaries,
 // and initializes buf to point to the packet buffer(s) that contain the unwritten space
 void PacketWriter::writeAhead(int bytes, struct SplitBuffer* buf) {
@@ -217,3 +262,110 @@ void ReliablePacketList::discardAll() {
 	while (reliable.next != &reliable)
 		reliable.next->remove();
 }
+
+namespace {
+
+struct ReferencedBytesMessage {
+	constexpr static FileIdentifier file_identifier = 3418925;
+	Arena arena;
+	int64_t i;
+	StringRef first;
+	VectorRef<StringRef> strings;
+	WipedString secret;
+	StringRef last;
+
+	Arena const* referencedArena() const { return &arena; }
+
+	template <class Ar>
+	void serialize(Ar& ar) {
+		serializer(ar, i, first, strings, secret, last, arena);
+	}
+};
+
+StringRef randomString(Arena& arena, int maxSize) {
+	StringRef s = makeString(deterministicRandom()->randomInt(0, maxSize), arena);
+	deterministicRandom()->randomBytes(mutateString(s), s.size());
+	return s;
+}
+
+// The bytes of a chain of buffers that are yet to be sent, as a connection writes them
+std::string unsentBytes(SendBuffer const* buffers, int limit) {
+	std::string bytes;
+	for (; buffers && bytes.size() < limit; buffers = buffers->next) {
+		int size = std::min<int>(buffers->bytes_unsent(), limit - bytes.size());
+		bytes.append(reinterpret_cast<char const*>(buffers->data()) + buffers->bytes_sent, size);
+	}
+	return bytes;
+}
+
+} // namespace
+
+TEST_CASE("/flow/Net2Packet/referencedBytes") {
+	// A packet with its large strings sent from their arena has the same bytes as one they are copied into
+	for (int iteration = 0; iteration < 100; iteration++) {
+		ReferencedBytesMessage message;
+		message.i = deterministicRandom()->randomInt64(0, std::numeric_limits<int64_t>::max());
+		message.first = randomString(message.arena, 50000);
+		for (int i = deterministicRandom()->randomInt(0, 20); i > 0; i--) {
+			message.strings.push_back(message.arena, randomString(message.arena, 20000));
+		}
+		message.secret = WipedString(randomString(message.arena, 1000));
+		message.last = randomString(message.arena, 50000);
+		std::string prefix = deterministicRandom()->randomAlphaNumeric(deterministicRandom()->randomInt(0, 20000));
+		const int minBytes = deterministicRandom()->randomInt(1, 20000);
+
+		UnsentPacketQueue copied;
+		PacketWriter copyWriter(copied.getWriteBuffer(), nullptr, AssumeVersion(g_network->protocolVersion()));
+		copyWriter.referenceMinBytes = 0;
+		copyWriter.serializeBytes(prefix.data(), prefix.size());
+		SerializeSource<ReferencedBytesMessage>(message, &message.arena).serializePacketWriter(copyWriter);
+		copied.setWriteBuffer(copyWriter.finish());
+		std::string expected = unsentBytes(copied.getUnsent(), copyWriter.size());
+		ASSERT_EQ(expected.size(), copyWriter.size());
+
+		UnsentPacketQueue referenced;
+		ReliablePacketList reliable;
+		ReliablePacket* rp = new ReliablePacket;
+		PacketWriter writer(referenced.getWriteBuffer(), rp, AssumeVersion(g_network->protocolVersion()));
+		writer.referenceMinBytes = minBytes;
+		writer.serializeBytes(prefix.data(), prefix.size());
+		SerializeSource<ReferencedBytesMessage>(message, &message.arena).serializePacketWriter(writer);
+		PacketBuffer* last = writer.finish();
+		referenced.setWriteBuffer(last);
+		reliable.insert(rp);
+		ASSERT_EQ(writer.size(), copyWriter.size());
+		ASSERT(!last->isReference() && !last->next);
+
+		int references = 0;
+		for (PacketBuffer* pb = referenced.getUnsent(); pb; pb = pb->nextPacketBuffer()) {
+			references += pb->isReference();
+		}
+		int expectedReferences = (message.first.size() >= minBytes) + (message.last.size() >= minBytes);
+		for (StringRef s : message.strings) {
+			expectedReferences += s.size() >= minBytes;
+		}
+		ASSERT_EQ(references, expectedReferences);
+
+		// The reference buffers keep the strings alive after the message is gone
+		message = ReferencedBytesMessage();
+		std::string resent;
+		for (ReliablePacket* c = rp; c; c = c->cont) {
+			resent.append(reinterpret_cast<char const*>(c->buffer->data()) + c->begin, c->end - c->begin);
+		}
+		ASSERT(resent == expected);
+
+		int sent = 0;
+		while (sent < expected.size()) {
+			int size = std::min<int>(deterministicRandom()->randomInt(1, 40000), expected.size() - sent);
+			ASSERT(unsentBytes(referenced.getUnsent(), size) == expected.substr(sent, size));
+			referenced.sent(size);
+			sent += size;
+		}
+		ASSERT(referenced.empty());
+
+		reliable.discardAll();
+		referenced.discardAll();
+		copied.discardAll();
+	}
+	return Void();
+}
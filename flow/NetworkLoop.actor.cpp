@@ -0,0 +1,176 @@
+/*
+ * NetworkLoop.actor.cpp
+ *
+ * This source file is part of the FoundationDB open source project
+ *
+ * Copyright 2013-2024 Apple Inc. and the FoundationDB project authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "flow/NetworkLoop.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/socket.h>
+#endif
+
+#include "flow/UnitTest.h"
+#include "flow/actorcompiler.h" // has to be last include
+
+namespace {
+
+thread_local NetworkLoop* currentLoop = nullptr;
+
+#ifndef _WIN32
+class SocketReceiver final : public NetworkLoopReceiver {
+public:
+	SocketReceiver(NetworkLoop* networkLoop, int fd)
+	  : NetworkLoopReceiver(networkLoop), descriptor(networkLoop->ios, fd) {}
+	~SocketReceiver() override {
+		// Closes the duplicate; the connection itself stays open until the network thread closes it too
+		boost::system::error_code ec;
+		descriptor.close(ec);
+	}
+
+	int read(uint8_t* begin, uint8_t* end) override {
+		ssize_t bytes = ::recv(descriptor.native_handle(), begin, end - begin, MSG_DONTWAIT);
+		networkLoop->countRead(std::max<ssize_t>(bytes, 0));
+		if (bytes > 0) {
+			return bytes;
+		}
+		if (bytes < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+			return 0;
+		}
+		return -1;
+	}
+
+	void onReadable(std::function<void()> fn) override {
+		descriptor.async_wait(boost::asio::posix::descriptor_base::wait_read,
+		                      [fn = std::move(fn)](const boost::system::error_code& ec) {
+			                      // Any other error shows up in read()
+			                      if (ec != boost::asio::error::operation_aborted) {
+				                      fn();
+			                      }
+		                      });
+	}
+
+private:
+	boost::asio::posix::stream_descriptor descriptor;
+};
+#endif
+
+} // namespace
+
+NetworkLoop::NetworkLoop(int index) : index(index), doNotStop(ios), stopped(false) {
+	std::string name = "fdb-netloop-" + std::to_string(index);
+	thread = g_network->startThread(start, this, 0, name.c_str());
+}
+
+NetworkLoop::~NetworkLoop() {
+	stopped = true;
+	ios.stop();
+	waitThread(thread);
+
+	taskQueue.processThreadReady();
+	while (taskQueue.hasReadyTask()) {
+		delete taskQueue.getReadyTask();
+		taskQueue.popReadyTask();
+	}
+}
+
+void NetworkLoop::post(std::function<void()> fn, TaskPriority taskID) {
+	if (taskQueue.addReadyThreadSafe(isCurrent(), taskID, new Task(std::move(fn)))) {
+		ios.post([] {});
+	}
+}
+
+bool NetworkLoop::isCurrent() const {
+	return currentLoop == this;
+}
+
+std::unique_ptr<NetworkLoopReceiver> NetworkLoop::adoptReceiver(boost::asio::ip::tcp::socket& socket) {
+#ifndef _WIN32
+	int fd = fcntl(socket.native_handle(), F_DUPFD_CLOEXEC, 0);
+	if (fd < 0) {
+		TraceEvent(SevWarnAlways, "NetworkLoopDupFailed").suppressFor(1.0).GetLastError();
+		return nullptr;
+	}
+	return std::make_unique<SocketReceiver>(this, fd);
+#else
+	return nullptr;
+#endif
+}
+
+THREAD_FUNC_RETURN NetworkLoop::start(void* self) {
+	static_cast<NetworkLoop*>(self)->run();
+	THREAD_RETURN;
+}
+
+void NetworkLoop::run() {
+	currentLoop = this;
+	while (!stopped) {
+		taskQueue.processThreadReady();
+		while (taskQueue.hasReadyTask() && !stopped) {
+			std::unique_ptr<Task> task(taskQueue.getReadyTask());
+			taskQueue.popReadyTask();
+			try {
+				task->fn();
+			} catch (Error& e) {
+				TraceEvent(SevError, "NetworkLoopError").error(e).detail("Loop", index);
+			}
+		}
+
+		while (!stopped && ios.poll_one())
+			;
+
+		if (!stopped && taskQueue.canSleep()) {
+			ios.run_one();
+		}
+	}
+}
+
+TEST_CASE("noSim/flow/NetworkLoop/call") {
+	state NetworkLoop networkLoop(0);
+
+	// Functions posted from the network thread run in order, on the loop
+	state std::shared_ptr<std::vector<int>> order = std::make_shared<std::vector<int>>();
+	for (int i = 0; i < 100; i++) {
+		networkLoop.post([order = order, i, l = &networkLoop] {
+			ASSERT(l->isCurrent() && !g_network->isOnMainThread());
+			order->push_back(i);
+		});
+	}
+	int count = wait(networkLoop.call([order = order] { return (int)order->size(); }));
+	ASSERT_EQ(count, 100);
+	for (int i = 0; i < 100; i++) {
+		ASSERT_EQ((*order)[i], i);
+	}
+
+	// A function run on the loop can post more work to it
+	int posted = wait(networkLoop.call([l = &networkLoop] {
+		l->post([] {});
+		return 1;
+	}));
+	ASSERT_EQ(posted, 1);
+
+	// Errors are delivered to the network thread too
+	try {
+		wait(success(networkLoop.call([]() -> int { throw io_error(); })));
+		ASSERT(false);
+	} catch (Error& e) {
+		ASSERT_EQ(e.code(), error_code_io_error);
+	}
+	ASSERT(!networkLoop.isCurrent());
+	return Void();
+}
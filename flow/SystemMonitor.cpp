@@ -261,6 +261,9 @@ SystemStatistics customSystemMonitor(std::string const& eventName, StatisticsSta
 			    .detail("WouldBlock", netData.countWouldBlock - statState->networkState.countWouldBlock)
 			    .detail("LaunchTime", netData.countLaunchTime - statState->networkState.countLaunchTime)
 			    .detail("ReactTime", netData.countReactTime - statState->networkState.countReactTime)
+			    .detail("TLSCryptoTime", netData.countTLSCryptoTime - statState->networkState.countTLSCryptoTime)
+			    .detail("TLSOffloadedCryptoTime",
+			            netData.countTLSOffloadedCryptoTime - statState->networkState.countTLSOffloadedCryptoTime)
 			    .detail("DCID", machineState.dcId)
 			    .detail("ZoneID", machineState.zoneId)
 			    .detail("MachineID", machineState.machineId);
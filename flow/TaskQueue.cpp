@@ -0,0 +1,127 @@
+/*
+ * TaskQueue.cpp
+ *
+ * This source file is part of the FoundationDB open source project
+ *
+ * Copyright 2013-2024 Apple Inc. and the FoundationDB project authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "flow/UnitTest.h"
+#include "flow/TaskQueue.h"
+
+namespace {
+
+struct TestTask {
+	int id;
+};
+
+TaskPriority randomPriority() {
+	// A few priorities used over and over, and now and then one not seen before
+	static const std::array<TaskPriority, 8> common = { TaskPriority::Max,          TaskPriority::RunCycleFunction,
+		                                                TaskPriority::WriteSocket,  TaskPriority::ReadSocket,
+		                                                TaskPriority::DefaultDelay, TaskPriority::DefaultEndpoint,
+		                                                TaskPriority::Low,          TaskPriority::Zero };
+	if (deterministicRandom()->random01() < 0.01) {
+		return TaskPriority(deterministicRandom()->randomInt(0, 30000));
+	}
+	return deterministicRandom()->randomChoice(common);
+}
+
+} // namespace
+
+TEST_CASE("/flow/TaskQueue/bucketed/ready") {
+	// The bucketed queue runs ready tasks in the same order as the heap
+	TaskQueue<TestTask> heap(false);
+	TaskQueue<TestTask> bucketed(true);
+	std::vector<TestTask> tasks(100000);
+
+	int added = 0;
+	int run = 0;
+	while (run < tasks.size()) {
+		if (added < tasks.size() && (run == added || deterministicRandom()->random01() < 0.55)) {
+			TaskPriority priority = randomPriority();
+			tasks[added].id = added;
+			heap.addReady(priority, &tasks[added]);
+			bucketed.addReady(priority, &tasks[added]);
+			++added;
+		} else {
+			ASSERT(bucketed.hasReadyTask());
+			ASSERT_EQ(bucketed.getNumReadyTasks(), heap.getNumReadyTasks());
+			ASSERT(bucketed.getReadyTaskID() == heap.getReadyTaskID());
+			ASSERT(bucketed.getReadyTask() == heap.getReadyTask());
+			ASSERT((bucketed.getReadyTaskPriority() > int64_t(TaskPriority::DefaultEndpoint) << 32) ==
+			       (heap.getReadyTaskPriority() > int64_t(TaskPriority::DefaultEndpoint) << 32));
+			heap.popReadyTask();
+			bucketed.popReadyTask();
+			++run;
+		}
+	}
+	ASSERT(!bucketed.hasReadyTask() && !heap.hasReadyTask());
+	return Void();
+}
+
+TEST_CASE("/flow/TaskQueue/bucketed/timers") {
+	// The timing wheel makes the same timers ready at the same time as the heap, and never sleeps past one
+	TaskQueue<TestTask> heap(false);
+	TaskQueue<TestTask> bucketed(true);
+	std::vector<TestTask> tasks(20000);
+
+	// Timers are anywhere from due right away to days out, beyond the reach of the wheel
+	static const std::array<double, 7> delays = { 0, 1e-4, 1e-2, 1, 100, 1e4, 1e6 };
+	static const std::array<double, 3> steps = { 1e-3, 1, 1e4 };
+	double now = deterministicRandom()->random01() * 1e6;
+	int added = 0;
+	int run = 0;
+	while (run < tasks.size()) {
+		for (int i = deterministicRandom()->randomInt(0, 100); i > 0 && added < tasks.size(); i--) {
+			double at = now + deterministicRandom()->random01() * deterministicRandom()->randomChoice(delays);
+			TaskPriority priority = randomPriority();
+			tasks[added].id = added;
+			heap.addTimer(at, priority, &tasks[added]);
+			bucketed.addTimer(at, priority, &tasks[added]);
+			++added;
+		}
+
+		double sleepTime = bucketed.getSleepTime(now);
+		ASSERT(sleepTime <= heap.getSleepTime(now));
+		if (deterministicRandom()->coinflip()) {
+			now += std::max(sleepTime, 0.0);
+		} else {
+			now += deterministicRandom()->random01() * deterministicRandom()->randomChoice(steps);
+		}
+
+		heap.processReadyTimers(now);
+		bucketed.processReadyTimers(now);
+		ASSERT_EQ(bucketed.getNumReadyTasks(), heap.getNumReadyTasks());
+		std::vector<TestTask*> fromHeap, fromBucketed;
+		while (heap.hasReadyTask()) {
+			fromHeap.push_back(heap.getReadyTask());
+			heap.popReadyTask();
+		}
+		TaskPriority lastPriority = TaskPriority::Max;
+		while (bucketed.hasReadyTask()) {
+			ASSERT(bucketed.getReadyTaskID() <= lastPriority);
+			lastPriority = bucketed.getReadyTaskID();
+			fromBucketed.push_back(bucketed.getReadyTask());
+			bucketed.popReadyTask();
+		}
+		std::sort(fromHeap.begin(), fromHeap.end());
+		std::sort(fromBucketed.begin(), fromBucketed.end());
+		ASSERT(fromHeap == fromBucketed);
+		run += fromHeap.size();
+	}
+	ASSERT_EQ(bucketed.getSleepTime(now), 0);
+	return Void();
+}
@@ -35,6 +35,7 @@
 #include <algorithm>
 #include <array>
 #include <boost/functional/hash.hpp>
+#include <concepts>
 #include <iterator>
 #include <stdint.h>
 #include <string_view>
@@ -786,6 +787,18 @@ inline void save(Archive& ar, const StringRef& value) {
 	ar.serializeBytes(value.begin(), value.size());
 }
 
+namespace detail {
+
+// A context that may take a string's bytes by reference, to be sent from where they are rather than copied to out
+template <class Context>
+concept can_reference_bytes = requires(Context& context) {
+	                              {
+		                              context.referenceBytes(std::declval<uint8_t*>(), std::declval<StringRef>())
+		                              } -> std::same_as<bool>;
+                              };
+
+} // namespace detail
+
 template <>
 struct dynamic_size_traits<StringRef> : std::true_type {
 	template <class Context>
@@ -793,7 +806,12 @@ struct dynamic_size_traits<StringRef> : std::true_type {
 		return t.size();
 	}
 	template <class Context>
-	static void save(uint8_t* out, const StringRef& t, Context&) {
+	static void save(uint8_t* out, const StringRef& t, Context& context) {
+		if constexpr (detail::can_reference_bytes<Context>) {
+			if (context.referenceBytes(out, t)) {
+				return;
+			}
+		}
 		std::copy(t.begin(), t.end(), out);
 	}
 
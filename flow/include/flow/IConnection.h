@@ -23,6 +23,7 @@
 
 #include <cstdint>
 #include <limits>
+#include <memory>
 
 #include <boost/asio/ip/tcp.hpp>
 
@@ -38,6 +39,9 @@ class Future;
 // forward declare SendBuffer, defined in serialize.h
 class SendBuffer;
 
+// defined in NetworkLoop.h
+class NetworkLoopReceiver;
+
 class IConnection {
 public:
 	// IConnection is reference-counted (use Reference<IConnection>), but the caller must explicitly call close()
@@ -174,6 +178,11 @@ public:
 	// Listen for connections on the given local address
 	virtual Reference<IListener> listen(NetworkAddress localAddr) = 0;
 
+	// Hands the receive side of a connection to the secondary event loop it is pinned to (NET2_SECONDARY_LOOPS), or
+	// returns nullptr if there is none or the connection must be read on the network thread. The connection is no
+	// longer read on the network thread afterwards, but is still written to and closed there.
+	virtual std::unique_ptr<NetworkLoopReceiver> pinReceiver(Reference<IConnection> const& conn);
+
 	static INetworkConnections* net() {
 		return static_cast<INetworkConnections*>((void*)g_network->global(INetwork::enNetworkConnections));
 	}
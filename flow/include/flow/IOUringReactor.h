@@ -0,0 +1,138 @@
+/*
+ * IOUringReactor.h
+ *
+ * This source file is part of the FoundationDB open source project
+ *
+ * Copyright 2013-2024 Apple Inc. and the FoundationDB project authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FLOW_IOURINGREACTOR_H
+#define FLOW_IOURINGREACTOR_H
+#pragma once
+
+#ifdef __linux__
+
+#include <memory>
+#include <vector>
+
+#include <boost/asio.hpp>
+
+#include "flow/IConnection.h"
+#include "flow/TDMetric.actor.h"
+#include "flow/flow.h"
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+struct io_uring_buf_ring;
+
+namespace N2 { // No indent, it's the whole file
+
+class IOUringSocket;
+
+// Socket I/O of plaintext connections through an io_uring, used by Net2 alongside the ASIOReactor when NET2_IO_URING
+// is set.
+//
+// Connections are still established by boost::asio, and then handed over with adopt(). Each adopted socket keeps a
+// multishot receive armed, which fills buffers from a ring shared by all sockets, so that data is read without a
+// readiness notification or a read system call. Bytes passed to write() are staged per socket, and the sends of all
+// sockets are submitted together once per run loop iteration; only large writes to an idle socket are sent right
+// away. Completions are reaped from the completion ring without a system call, and the ring only signals an eventfd
+// registered with the ASIOReactor while the run loop sleeps.
+//
+// A connection stops receiving once it holds NET2_IO_URING_RECV_BUFFERS_PER_CONNECTION buffers that read() has not
+// emptied, so that a peer which is not being read cannot take the buffers of every other connection.
+class IOUringReactor {
+public:
+	// The Net2 metrics that reads and writes of connections update, whichever reactor they are on
+	struct ConnectionMetrics {
+		Int64MetricHandle bytesReceived;
+		Int64MetricHandle countReads;
+		Int64MetricHandle countWrites;
+		Int64MetricHandle countWouldBlock;
+	};
+
+	// Returns nullptr if the kernel or its headers do not support multishot receives into provided buffers
+	static std::unique_ptr<IOUringReactor> create(boost::asio::io_service& ios, ConnectionMetrics const& metrics);
+	~IOUringReactor();
+
+	// Takes over the socket of a plaintext connection that was just connected or accepted
+	Reference<IConnection> adopt(Reference<IConnection> conn);
+
+	// Submits the receives and sends queued since the last call with one system call
+	void submit();
+
+	// Delivers the completions posted since the last call, and returns how many there were
+	int reap();
+
+	// Before the run loop sleeps: lets completions wake it, and returns false if some are already waiting
+	bool prepareToSleep();
+	// After the run loop wakes up
+	void wake();
+
+private:
+	friend class IOUringSocket;
+
+	IOUringReactor(boost::asio::io_service& ios, ConnectionMetrics const& metrics);
+	bool setupRing(unsigned entries);
+	bool setupBuffers(unsigned count, unsigned bytes);
+	void closeRing();
+	void armEventFD();
+
+	io_uring_sqe* nextSqe();
+	unsigned sqSpace() const;
+	bool hasCompletions() const;
+
+	void queue(IOUringSocket* socket);
+	uint8_t* buffer(uint16_t bid) const { return buffers + size_t(bid) * bufferBytes; }
+	void returnBuffer(uint16_t bid);
+
+	int ringFd = -1;
+	void* sqRing = nullptr;
+	void* cqRing = nullptr;
+	size_t sqRingSize = 0, cqRingSize = 0, sqesSize = 0;
+	unsigned sqEntries = 0, sqMask = 0, cqMask = 0;
+	unsigned sqLocalTail = 0, unsubmitted = 0;
+	unsigned *sqHead = nullptr, *sqTail = nullptr, *sqFlags = nullptr, *sqArray = nullptr;
+	unsigned *cqHead = nullptr, *cqTail = nullptr, *cqFlags = nullptr;
+	io_uring_sqe* sqes = nullptr;
+	io_uring_cqe* cqes = nullptr;
+
+	// Receive buffers, handed to the kernel through a provided buffer ring
+	io_uring_buf_ring* bufRing = nullptr;
+	size_t bufRingSize = 0;
+	uint8_t* buffers = nullptr;
+	unsigned bufferCount = 0, bufferBytes = 0;
+	uint16_t bufTail = 0;
+	unsigned freeBuffers = 0;
+
+	int eventFd = -1;
+	boost::asio::posix::stream_descriptor eventDescriptor;
+	uint64_t eventValue = 0;
+
+	// Sockets with a receive to arm or a send to submit
+	std::vector<Reference<IOUringSocket>> queued;
+
+	ConnectionMetrics metrics;
+	Int64MetricHandle countSubmit;
+	Int64MetricHandle countCollect;
+	Int64MetricHandle countRecvBuffersExhausted;
+	Int64MetricHandle countRecvCancels;
+	Int64MetricHandle countDirectSends;
+};
+
+} // namespace N2
+
+#endif
+#endif
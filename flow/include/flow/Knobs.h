@@ -201,6 +201,9 @@ public:
 	int TLS_HANDSHAKE_THREAD_STACKSIZE;
 	int TLS_MALLOC_ARENA_MAX;
 	int TLS_HANDSHAKE_LIMIT;
+	int TLS_CRYPTO_THREADS; // Encrypt and decrypt the records of large reads and writes off the network thread
+	int TLS_CRYPTO_OFFLOAD_BYTES; // Writes, and reads with as many bytes waiting on the socket, that are offloaded
+	int TLS_CRYPTO_READ_AHEAD_BYTES; // Per connection, bytes decrypted by an offloaded read
 
 	int NETWORK_TEST_CLIENT_COUNT;
 	int NETWORK_TEST_REPLY_SIZE;
@@ -250,6 +253,17 @@ public:
 
 	int PAGE_WRITE_CHECKSUM_HISTORY;
 	int DISABLE_POSIX_KERNEL_AIO;
+	int ENABLE_IO_URING; // Use AsyncFileIOUring rather than AsyncFileKAIO for unbuffered files, if the kernel allows
+	int IO_URING_MAX_LINKED_WRITES; // Most writes submitted together with the sync that follows them
+	int NET2_IO_URING; // Move plaintext connections onto an io_uring rather than boost::asio, if the kernel allows
+	int NET2_IO_URING_ENTRIES;
+	int NET2_IO_URING_RECV_BUFFERS; // Shared by all connections; rounded up to a power of two
+	int NET2_IO_URING_RECV_BUFFER_BYTES;
+	int NET2_IO_URING_RECV_BUFFERS_PER_CONNECTION; // Receive buffers a connection may fill before read() empties them
+	int NET2_IO_URING_SEND_BUFFER_BYTES; // Bytes a connection accepts from write() before it waits for its sends
+	int NET2_IO_URING_DIRECT_SEND_BYTES; // Writes at least this large to an idle connection skip the ring
+	int NET2_SECONDARY_LOOPS; // Event loop threads that read and frame the packets of plaintext connections
+	int NET2_SECONDARY_LOOP_READ_AHEAD_BYTES; // Per connection, bytes read but not yet delivered by the network thread
 
 	// AsyncFileNonDurable
 	double NON_DURABLE_MAX_WRITE_DELAY;
@@ -285,6 +299,7 @@ public:
 	double MIN_LOGGED_PRIORITY_BUSY_FRACTION;
 	int CERT_FILE_MAX_SIZE;
 	int READY_QUEUE_RESERVED_SIZE;
+	bool BUCKETED_TASK_QUEUE; // Run loops queue tasks in a FIFO ring per priority and timers in a timing wheel
 	int TASKS_PER_REACTOR_CHECK;
 
 	// Network
@@ -294,6 +309,7 @@ public:
 	int MAX_PACKET_SEND_BYTES;
 	int MIN_PACKET_BUFFER_BYTES;
 	int MIN_PACKET_BUFFER_FREE_BYTES;
+	int ZERO_COPY_SEND_BYTES; // Strings this large in replies that opt in are sent from their arena, not copied; 0 is off
 	int FLOW_TCP_NODELAY;
 	int FLOW_TCP_QUICKACK;
 	bool RESOLVE_PREFER_IPV4_ADDR;
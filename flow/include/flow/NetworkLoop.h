@@ -0,0 +1,130 @@
+/*
+ * NetworkLoop.h
+ *
+ * This source file is part of the FoundationDB open source project
+ *
+ * Copyright 2013-2024 Apple Inc. and the FoundationDB project authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef FLOW_NETWORKLOOP_H
+#define FLOW_NETWORKLOOP_H
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <type_traits>
+
+#include <boost/asio.hpp>
+
+#include "flow/IThreadPool.h"
+#include "flow/TaskQueue.h"
+#include "flow/flow.h"
+
+class NetworkLoopReceiver;
+
+// A secondary event loop, run by its own thread next to the network thread. Net2 starts NET2_SECONDARY_LOOPS of them.
+//
+// Like the network thread, a loop has a TaskQueue and an asio reactor, but its tasks are plain functions rather than
+// actors: futures, arenas shared between actors and g_network itself may only be used on the network thread. Work
+// moves between threads by message passing instead. post() queues a function on a loop from any thread, call() also
+// delivers what the function returns to a future on the network thread, and a loop hands results back on its own with
+// ThreadReturnPromise or onMainThreadVoid().
+class NetworkLoop : NonCopyable {
+public:
+	explicit NetworkLoop(int index);
+	// Stops the loop and waits for its thread. Functions still queued are destroyed without being run.
+	~NetworkLoop();
+
+	// Queues fn to run on this loop. Can be called from any thread.
+	void post(std::function<void()> fn, TaskPriority taskID = TaskPriority::DefaultOnMainThread);
+
+	// Runs fn on this loop and delivers the value it returns, or the Error it throws, to the returned future. Call only
+	// on the network thread.
+	template <class F>
+	Future<std::invoke_result_t<F>> call(F fn, TaskPriority taskID = TaskPriority::DefaultOnMainThread) {
+		using T = std::invoke_result_t<F>;
+		auto result = std::make_shared<ThreadReturnPromise<T>>();
+		Future<T> f = result->getFuture();
+		post(
+		    [fn = std::move(fn), result]() mutable {
+			    try {
+				    result->send(fn());
+			    } catch (Error& e) {
+				    result->sendError(e);
+			    }
+		    },
+		    taskID);
+		return f;
+	}
+
+	// True on the thread running this loop
+	bool isCurrent() const;
+
+	// Returns a receiver that reads a duplicate of socket on this loop, or nullptr if it can't be duplicated
+	std::unique_ptr<NetworkLoopReceiver> adoptReceiver(boost::asio::ip::tcp::socket& socket);
+
+	// Counts a read by a receiver of this loop. Called on the loop.
+	void countRead(int64_t bytes) {
+		readCount.fetch_add(1, std::memory_order_relaxed);
+		readBytes.fetch_add(bytes, std::memory_order_relaxed);
+	}
+	// Returns the reads counted since the last call, for Net2 to add to its metrics on the network thread
+	void takeReads(int64_t& count, int64_t& bytes) {
+		count = readCount.load(std::memory_order_relaxed) ? readCount.exchange(0, std::memory_order_relaxed) : 0;
+		bytes = readBytes.load(std::memory_order_relaxed) ? readBytes.exchange(0, std::memory_order_relaxed) : 0;
+	}
+
+	const int index;
+
+	// The reactor of the loop. Sockets and handlers registered with it are run by the loop's thread.
+	boost::asio::io_service ios;
+
+private:
+	struct Task {
+		std::function<void()> fn;
+		explicit Task(std::function<void()>&& fn) : fn(std::move(fn)) {}
+	};
+
+	THREAD_FUNC start(void* self);
+	void run();
+
+	boost::asio::io_service::work doNotStop;
+	TaskQueue<Task> taskQueue;
+	std::atomic<bool> stopped;
+	std::atomic<int64_t> readCount = 0;
+	std::atomic<int64_t> readBytes = 0;
+	THREAD_HANDLE thread;
+};
+
+// The receive side of a connection, read by a NetworkLoop. Net2 creates it from a duplicate of the connection's socket,
+// so that the network thread can keep writing to and close the connection itself. All members except networkLoop must
+// only be used on the loop, which is also where the receiver must be destroyed.
+class NetworkLoopReceiver : NonCopyable {
+public:
+	explicit NetworkLoopReceiver(NetworkLoop* networkLoop) : networkLoop(networkLoop) {}
+	virtual ~NetworkLoopReceiver() = default;
+
+	// Reads into [begin, end) without blocking. Returns the number of bytes read, 0 if none are available yet, or -1 if
+	// the connection was closed or failed.
+	virtual int read(uint8_t* begin, uint8_t* end) = 0;
+
+	// Calls fn on the loop once there is something to read. fn is not called if the receiver is destroyed first.
+	virtual void onReadable(std::function<void()> fn) = 0;
+
+	NetworkLoop* const networkLoop;
+};
+
+#endif
@@ -159,8 +159,9 @@ private:
 // A single-use class for serializing an object with a serialize() member function or a serializable trait
 // Allocates from arena by default, with the ability to
 // a) optionally override default allocation function, and/or
-// b) optionally mark parts of memory after use for wiping: i.e. zeroing out
-// both a) and b) requires passing a dedicated function pointer for each operation.
+// b) optionally mark parts of memory after use for wiping: i.e. zeroing out, and/or
+// c) optionally leave strings out of the allocated memory, for the caller to send from where they are
+// each of a), b) and c) requires passing a dedicated function pointer for each operation.
 // Optionally, a pointer to an allocation context shared by both function may be passed.
 // Allocation is expected to happen exactly once during serialization.
 class ObjectWriter {
@@ -201,6 +202,11 @@ class ObjectWriter {
 			}
 		}
 
+		bool referenceBytes(uint8_t* out, StringRef bytes) {
+			return pObjectWriter->referenceBytesFunc &&
+			       pObjectWriter->referenceBytesFunc(out, bytes, pObjectWriter->allocatorContext);
+		}
+
 		int getNumAllocations() const { return numAllocations; }
 
 	private:
@@ -227,6 +233,9 @@ public:
 
 		void markForWipe(uint8_t* begin, size_t size) { memoryHelper.markForWipe(begin, size); }
 
+		// Returns true if [out, out + bytes.size()) is to be left unwritten, and bytes sent in its place
+		bool referenceBytes(uint8_t* out, StringRef bytes) { return memoryHelper.referenceBytes(out, bytes); }
+
 		SaveContext& context() { return *this; }
 	};
 
@@ -236,6 +245,23 @@ public:
 	// takes (wipe begin pointer, wipe length, allocator context pointer)
 	typedef void (*MarkForWipeFuncType)(uint8_t*, size_t, void*);
 
+	// takes (position in the allocated memory, string to be serialized there, allocator context pointer), returns
+	// true if the string's bytes were taken by reference and are not to be copied
+	typedef bool (*ReferenceBytesFuncType)(uint8_t*, StringRef, void*);
+
+	// Overload that also enables serializer traits to leave strings out of the allocated memory.
+	// ReferenceBytesFunc shares allocator context with allocatorFunc
+	template <class VersionOptions>
+	explicit ObjectWriter(AllocatorFuncType allocatorFunc,
+	                      MarkForWipeFuncType markForWipeFunc,
+	                      ReferenceBytesFuncType referenceBytesFunc,
+	                      void* allocatorContext,
+	                      VersionOptions vo)
+	  : arena(), allocatorFunc(allocatorFunc), markForWipeFunc(markForWipeFunc), referenceBytesFunc(referenceBytesFunc),
+	    allocatorContext(allocatorContext), data(nullptr), size(0) {
+		vo.write(*this);
+	}
+
 	// Overload that enables serializer traits to mark the buffers for wiping (zeroing out) after use.
 	// MarkForWipeFunc shares allocator context with allocatorFunc
 	// Simpler (lambda wrapped in std::function) was avoided by past PR to reduce compilation time
@@ -244,10 +270,7 @@ public:
 	                      MarkForWipeFuncType markForWipeFunc,
 	                      void* allocatorContext,
 	                      VersionOptions vo)
-	  : arena(), allocatorFunc(allocatorFunc), markForWipeFunc(markForWipeFunc), allocatorContext(allocatorContext),
-	    data(nullptr), size(0) {
-		vo.write(*this);
-	}
+	  : ObjectWriter(allocatorFunc, markForWipeFunc, nullptr /*referenceBytesFunc*/, allocatorContext, vo) {}
 
 	template <class VersionOptions>
 	explicit ObjectWriter(AllocatorFuncType allocatorFunc, void* allocatorContext, VersionOptions vo)
@@ -296,6 +319,7 @@ private:
 	Arena arena;
 	AllocatorFuncType allocatorFunc;
 	MarkForWipeFuncType markForWipeFunc;
+	ReferenceBytesFuncType referenceBytesFunc;
 	void* allocatorContext;
 	uint8_t* data;
 	int size;
@@ -95,6 +95,8 @@ struct NetworkData {
 	int64_t countTLSPolicyFailures;
 	double countLaunchTime;
 	double countReactTime;
+	double countTLSCryptoTime;
+	double countTLSOffloadedCryptoTime;
 
 	void init() {
 		bytesSent = Int64Metric::getValueOrDefault("Net2.BytesSent"_sr);
@@ -123,6 +125,8 @@ struct NetworkData {
 		countTLSPolicyFailures = Int64Metric::getValueOrDefault("Net2.CountTLSPolicyFailures"_sr);
 		countLaunchTime = DoubleMetric::getValueOrDefault("Net2.CountLaunchTime"_sr);
 		countReactTime = DoubleMetric::getValueOrDefault("Net2.CountReactTime"_sr);
+		countTLSCryptoTime = DoubleMetric::getValueOrDefault("Net2.CountTLSCryptoTime"_sr);
+		countTLSOffloadedCryptoTime = DoubleMetric::getValueOrDefault("Net2.CountTLSOffloadedCryptoTime"_sr);
 		countFileLogicalWrites = Int64Metric::getValueOrDefault("AsyncFile.CountLogicalWrites"_sr);
 		countFileLogicalReads = Int64Metric::getValueOrDefault("AsyncFile.CountLogicalReads"_sr);
 		countAIOSubmit = Int64Metric::getValueOrDefault("AsyncFile.CountAIOSubmit"_sr);
@@ -22,24 +22,45 @@
 #define FLOW_TASK_QUEUE_H
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <limits>
 #include <queue>
 #include <vector>
 #include "flow/TDMetric.actor.h"
 #include "flow/network.h"
+#include "flow/Deque.h"
 #include "flow/ThreadSafeQueue.h"
 
 template <typename Task>
 // A queue of ordered tasks, both ready to execute, and delayed for later execution.
 // All functions must be called on the main thread, except for addReadyThreadSafe() which can be called from any thread.
+//
+// Ready tasks run in order of priority, and tasks of the same priority in the order they were added. By default ready
+// tasks and timers are each kept in a heap. A bucketed queue (BUCKETED_TASK_QUEUE) instead keeps a FIFO ring of ready
+// tasks per priority and the timers in a timing wheel, which makes adding and running a task O(1) however many are
+// queued. The one difference in order is that a timer which comes due joins the back of its priority's ring, where the
+// heap would order it by the time it was added.
 class TaskQueue {
 public:
-	TaskQueue() : tasksIssued(0), ready(FLOW_KNOBS->READY_QUEUE_RESERVED_SIZE) {}
+	explicit TaskQueue(bool bucketed = FLOW_KNOBS->BUCKETED_TASK_QUEUE)
+	  : bucketed(bucketed), tasksIssued(0), ready(bucketed ? 0 : FLOW_KNOBS->READY_QUEUE_RESERVED_SIZE) {}
 
 	// Add a task that is ready to be executed.
-	void addReady(TaskPriority taskId, Task* t) { this->ready.push(OrderedTask(getFIFOPriority(taskId), taskId, t)); }
+	void addReady(TaskPriority taskId, Task* t) {
+		if (bucketed) {
+			readyBuckets.push(taskId, t);
+		} else {
+			this->ready.push(OrderedTask(getFIFOPriority(taskId), taskId, t));
+		}
+	}
 	// Add a task to be executed at a given future time instant (a "timer").
 	void addTimer(double at, TaskPriority taskId, Task* t) {
-		this->timers.push(DelayedTask(at, getFIFOPriority(taskId), taskId, t));
+		if (bucketed) {
+			timerWheel.add(DelayedTask(at, getFIFOPriority(taskId), taskId, t));
+		} else {
+			this->timers.push(DelayedTask(at, getFIFOPriority(taskId), taskId, t));
+		}
 	}
 	// Add a task that is ready to be executed, potentially called from a thread that is different from main.
 	// Returns true iff the main thread need to be woken up to execute this task.
@@ -55,7 +76,7 @@ public:
 	}
 	// Returns true if the there are no tasks that are ready to be executed.
 	bool canSleep() {
-		bool b = ready.empty();
+		bool b = !hasReadyTask();
 		if (b) {
 			b = threadReady.canSleep();
 			if (!b)
@@ -66,6 +87,9 @@ public:
 	}
 	// Returns a time interval a caller should sleep from now until the next timer.
 	double getSleepTime(double now) const {
+		if (bucketed) {
+			return timerWheel.getSleepTime(now);
+		}
 		if (!timers.empty()) {
 			return timers.top().at - now;
 		}
@@ -75,6 +99,13 @@ public:
 	// Moves all timers that are scheduled to be executed at or before now to the ready queue.
 	void processReadyTimers(double now) {
 		[[maybe_unused]] int numTimers = 0;
+		if (bucketed) {
+			timerWheel.popTimers(now + INetwork::TIME_EPS, [&](DelayedTask const& t) {
+				++numTimers;
+				++countTimers;
+				readyBuckets.push(t.taskID, t.task);
+			});
+		}
 		while (!timers.empty() && timers.top().at <= now + INetwork::TIME_EPS) {
 			++numTimers;
 			++countTimers;
@@ -98,12 +129,22 @@ public:
 		FDB_TRACE_PROBE(run_loop_thread_ready, numReady);
 	}
 
-	bool hasReadyTask() const { return !ready.empty(); }
-	size_t getNumReadyTasks() const { return ready.size(); }
-	TaskPriority getReadyTaskID() const { return ready.top().taskID; }
-	int64_t getReadyTaskPriority() const { return ready.top().priority; }
-	Task* getReadyTask() const { return ready.top().task; }
-	void popReadyTask() { ready.pop(); }
+	bool hasReadyTask() const { return bucketed ? !readyBuckets.empty() : !ready.empty(); }
+	size_t getNumReadyTasks() const { return bucketed ? readyBuckets.size() : ready.size(); }
+	TaskPriority getReadyTaskID() const { return bucketed ? readyBuckets.topID() : ready.top().taskID; }
+	// Compares like the value of getFIFOPriority(): greater than for any task of a lower priority, and less than for
+	// any of a higher one.
+	int64_t getReadyTaskPriority() const {
+		return bucketed ? (int64_t(readyBuckets.topID()) << 32) - 1 : ready.top().priority;
+	}
+	Task* getReadyTask() const { return bucketed ? readyBuckets.topTask() : ready.top().task; }
+	void popReadyTask() {
+		if (bucketed) {
+			readyBuckets.pop();
+		} else {
+			ready.pop();
+		}
+	}
 
 	void initMetrics() {
 		countTimers.init("Net2.CountTimers"_sr);
@@ -116,6 +157,8 @@ public:
 		ready.swap(_1);
 		decltype(timers) _2;
 		timers.swap(_2);
+		readyBuckets.clear();
+		timerWheel.clear();
 	}
 
 private:
@@ -143,9 +186,207 @@ private:
 		void reserve(size_type capacity) { this->c.reserve(capacity); }
 	};
 
+	// Ready tasks in a FIFO ring per priority. Rings are created the first time a priority is used and kept from the
+	// highest priority down, with a bitmap of those that are not empty to find the next task.
+	class BucketedReadyQueue {
+	public:
+		BucketedReadyQueue() : count(0), top(NONE) { cache.fill({ NO_PRIORITY, 0 }); }
+
+		void push(TaskPriority taskID, Task* t) {
+			int b = getBucket(taskID);
+			if (rings[b].empty()) {
+				nonEmpty[b / 64] |= uint64_t(1) << (b % 64);
+				top = std::min(top, b);
+			}
+			rings[b].push_back(t);
+			++count;
+		}
+		bool empty() const { return count == 0; }
+		size_t size() const { return count; }
+		TaskPriority topID() const { return priorities[top]; }
+		Task* topTask() const { return rings[top].front(); }
+		void pop() {
+			rings[top].pop_front();
+			--count;
+			if (rings[top].empty()) {
+				nonEmpty[top / 64] &= ~(uint64_t(1) << (top % 64));
+				top = firstNonEmpty();
+			}
+		}
+		void clear() { *this = BucketedReadyQueue(); }
+
+	private:
+		static constexpr int NONE = std::numeric_limits<int>::max();
+		static constexpr TaskPriority NO_PRIORITY = TaskPriority(-1);
+
+		int getBucket(TaskPriority taskID) {
+			auto& cached = cache[(uint32_t(taskID) * 2654435761u) >> 24];
+			if (cached.first == taskID) {
+				return cached.second;
+			}
+			auto it = std::lower_bound(priorities.begin(), priorities.end(), taskID, std::greater<>());
+			int b = it - priorities.begin();
+			if (it == priorities.end() || *it != taskID) {
+				priorities.insert(it, taskID);
+				rings.insert(rings.begin() + b, Deque<Task*>());
+				nonEmpty.assign((rings.size() + 63) / 64, 0);
+				for (int i = 0; i < rings.size(); i++) {
+					if (!rings[i].empty()) {
+						nonEmpty[i / 64] |= uint64_t(1) << (i % 64);
+					}
+				}
+				top = firstNonEmpty();
+				// The rings after b moved
+				cache.fill({ NO_PRIORITY, 0 });
+			}
+			cached = { taskID, b };
+			return b;
+		}
+		int firstNonEmpty() const {
+			for (int w = 0; w < nonEmpty.size(); w++) {
+				if (nonEmpty[w]) {
+					return w * 64 + ctzll(nonEmpty[w]);
+				}
+			}
+			return NONE;
+		}
+
+		std::vector<TaskPriority> priorities; // In descending order
+		std::vector<Deque<Task*>> rings;
+		std::vector<uint64_t> nonEmpty;
+		size_t count;
+		int top; // The first non-empty ring, or NONE
+		std::array<std::pair<TaskPriority, int>, 256> cache; // The rings of recently used priorities, by their hash
+	};
+
+	// Timers in a hierarchical timing wheel. Time is counted in ticks of 1/TICKS_PER_SECOND seconds, and level k of the
+	// wheel has SLOTS slots of SLOTS^k ticks each. A timer is filed at the lowest level whose slots tell its tick apart
+	// from the current one, so adding it is O(1), and whenever the wheel turns to a slot its timers are refiled a level
+	// or more lower, at most LEVELS times in all. Only the timers of the current tick are kept in a heap, by their exact
+	// time, which is also where timers wait that are further out than the wheel reaches (over 4 hours).
+	class TimerWheel {
+	public:
+		TimerWheel() : current(0), count(0) { occupied.fill(0); }
+
+		void add(DelayedTask const& t) {
+			file(t);
+			++count;
+		}
+
+		// Returns the time from now until the first timer, or until the start of its slot if that is still to come.
+		// Either way it is no later than the timer is due.
+		double getSleepTime(double now) const {
+			if (!due.empty()) {
+				return due.top().at - now;
+			}
+			int level;
+			int64_t tick = nextTick(&level);
+			if (tick == NO_TICK) {
+				return 0;
+			}
+			return tick / TICKS_PER_SECOND - now;
+		}
+
+		// Turns the wheel up to until, and calls f with each timer due by then, in order of time
+		template <class F>
+		void popTimers(double until, F const& f) {
+			turn(toTick(until));
+			while (!due.empty() && due.top().at <= until) {
+				f(due.top());
+				due.pop();
+				--count;
+			}
+		}
+
+		void clear() { *this = TimerWheel(); }
+
+	private:
+		static constexpr int SLOT_BITS = 6;
+		static constexpr int SLOTS = 1 << SLOT_BITS;
+		static constexpr int LEVELS = 4;
+		static constexpr double TICKS_PER_SECOND = 1024;
+		static constexpr int64_t NO_TICK = std::numeric_limits<int64_t>::max();
+
+		// Puts the earliest timer on top, and of timers due at the same time the one added first
+		struct Later {
+			bool operator()(DelayedTask const& a, DelayedTask const& b) const {
+				return a.at > b.at || (a.at == b.at && a.priority < b.priority);
+			}
+		};
+		typedef std::priority_queue<DelayedTask, std::vector<DelayedTask>, Later> TimerHeap;
+
+		static int64_t toTick(double at) { return int64_t(at * TICKS_PER_SECOND); }
+
+		void file(DelayedTask const& t) {
+			int64_t tick = toTick(t.at);
+			if (tick <= current) {
+				due.push(t);
+				return;
+			}
+			int level = (63 - clzll(tick ^ current)) / SLOT_BITS;
+			if (level >= LEVELS) {
+				beyond.push(t);
+				return;
+			}
+			int slot = (tick >> (level * SLOT_BITS)) & (SLOTS - 1);
+			slots[level][slot].push_back(t);
+			occupied[level] |= uint64_t(1) << slot;
+		}
+
+		// Returns the first tick after the current one that starts an occupied slot, and its level (LEVELS for the
+		// timers beyond the wheel), or NO_TICK if there is none
+		int64_t nextTick(int* level) const {
+			for (*level = 0; *level < LEVELS; ++*level) {
+				int shift = *level * SLOT_BITS;
+				int slot = (current >> shift) & (SLOTS - 1);
+				uint64_t after = occupied[*level] & ~((uint64_t(2) << slot) - 1);
+				if (after) {
+					return (current & -(int64_t(SLOTS) << shift)) | (int64_t(ctzll(after)) << shift);
+				}
+			}
+			if (!beyond.empty()) {
+				return toTick(beyond.top().at) & -(int64_t(1) << (LEVELS * SLOT_BITS));
+			}
+			return NO_TICK;
+		}
+
+		void turn(int64_t target) {
+			int level;
+			for (int64_t tick = nextTick(&level); tick <= target; tick = nextTick(&level)) {
+				current = tick;
+				if (level < LEVELS) {
+					int slot = (current >> (level * SLOT_BITS)) & (SLOTS - 1);
+					// Refiling never puts a timer back into the same slot
+					for (auto const& t : slots[level][slot]) {
+						file(t);
+					}
+					slots[level][slot].clear();
+					occupied[level] &= ~(uint64_t(1) << slot);
+				} else {
+					const int shift = LEVELS * SLOT_BITS;
+					while (!beyond.empty() && toTick(beyond.top().at) >> shift == current >> shift) {
+						DelayedTask t = beyond.top();
+						beyond.pop();
+						file(t);
+					}
+				}
+			}
+			current = std::max(current, target);
+		}
+
+		int64_t current; // Timers up to and including this tick are in due
+		size_t count;
+		std::array<uint64_t, LEVELS> occupied;
+		std::array<std::vector<DelayedTask>, SLOTS> slots[LEVELS];
+		TimerHeap due;
+		TimerHeap beyond;
+	};
+
 	// Returns a unique priority value for a task which preserves FIFO ordering
 	// for tasks with the same priority.
 	int64_t getFIFOPriority(TaskPriority taskId) { return (int64_t(taskId) << 32) - (++tasksIssued); }
+
+	const bool bucketed;
 	uint64_t tasksIssued;
 
 	ReadyQueue<OrderedTask> ready;
@@ -153,6 +394,9 @@ private:
 
 	std::priority_queue<DelayedTask, std::vector<DelayedTask>> timers;
 
+	BucketedReadyQueue readyBuckets;
+	TimerWheel timerWheel;
+
 	Int64MetricHandle countTimers;
 	Int64MetricHandle countCantSleep;
 	Int64MetricHandle countWontSleep;
@@ -840,6 +840,18 @@ public:
 		return new (mem) PacketBuffer{ size };
 	}
 
+	// Creates a full buffer that holds none of its bytes, but sends them from arena and keeps it alive until freed
+	static PacketBuffer* createReference(StringRef bytes, Arena const& arena) {
+		uint8_t* mem = allocateAndMaybeKeepalive(sizeof(Arena) + PACKET_BUFFER_OVERHEAD);
+		PacketBuffer* pb = new (mem) PacketBuffer{ size_t(bytes.size()) };
+		new (pb + 1) Arena(arena);
+		pb->_data = const_cast<uint8_t*>(bytes.begin());
+		pb->bytes_written = bytes.size();
+		return pb;
+	}
+
+	bool isReference() const { return data() != reinterpret_cast<uint8_t const*>(this + 1); }
+
 	PacketBuffer* nextPacketBuffer() { return static_cast<PacketBuffer*>(next); }
 
 	void markForWipe(uint8_t* begin, size_t size) {
@@ -863,12 +875,19 @@ public:
 		}
 	}
 
+	bool isMarkedForWipe(uint8_t const* begin, size_t size) const {
+		return wipe_len > 0 && begin < data() + wipe_begin + wipe_len && data() + wipe_begin < begin + size;
+	}
+
 	void addref() { ++reference_count; }
 	void delref() {
 		if (!--reference_count) {
 			if (wipe_len > 0) {
 				::memset(data() + wipe_begin, 0, wipe_len);
 			}
+			if (isReference()) {
+				reinterpret_cast<Arena*>(this + 1)->~Arena();
+			}
 			freeOrMaybeKeepalive(reinterpret_cast<uint8_t*>(this));
 		}
 	}
@@ -886,6 +905,12 @@ struct PacketWriter {
 	int length;
 	ProtocolVersion m_protocolVersion;
 
+	// Strings at least this large, in messages serialized with a referencedArena, are sent from that arena rather
+	// than copied. Zero turns this off.
+	int referenceMinBytes;
+	Arena const* referencedArena;
+	std::vector<std::pair<uint8_t*, StringRef>> references; // Where each string taken by reference is left unwritten
+
 	// reliable is nullptr if this is an unreliable packet, or points to a ReliablePacket.  PacketWriter is responsible
 	//   for filling in reliable->buffer, ->cont, ->begin, and ->end, but not ->prev or ->next.
 	template <class VersionOptions>
@@ -941,9 +966,22 @@ struct PacketWriter {
 		static_cast<PacketWriter*>(self)->buffer->markForWipe(begin, size);
 	}
 
+	// This is used by MakeSerializeSource::serializePacketWriter to take large strings by reference.
+	// Precondition: out is part of current buffer (PacketWriter::buffer)
+	static bool packetWriterReferenceBytes(uint8_t* out, StringRef bytes, void* self) {
+		PacketWriter* writer = static_cast<PacketWriter*>(self);
+		if (bytes.size() < writer->referenceMinBytes) {
+			return false;
+		}
+		writer->references.emplace_back(out, bytes);
+		return true;
+	}
+
 private:
 	void serializeBytesAcrossBoundary(const void* data, int bytes);
 	void nextBuffer(size_t size = 0 /* downstream it will default to at least 4k minus some padding */);
+	void appendBuffer(PacketBuffer* next);
+	void spliceReferences();
 	template <class, class>
 	friend class MakeSerializeSource;
 
@@ -964,24 +1002,50 @@ public:
 		if (FLOW_KNOBS->WIPE_SENSITIVE_DATA_FROM_PACKET_BUFFER) {
 			markForWipeFunc = &PacketWriter::packetWriterMarkForWipe;
 		}
+		ObjectWriter::ReferenceBytesFuncType referenceBytesFunc = nullptr;
+		if (referencedArena() && packetWriter.referenceMinBytes > 0) {
+			packetWriter.referencedArena = referencedArena();
+			referenceBytesFunc = &PacketWriter::packetWriterReferenceBytes;
+		}
 		ObjectWriter objectWriter(&PacketWriter::packetWriterAlloc,
 		                          markForWipeFunc,
+		                          referenceBytesFunc,
 		                          &packetWriter,
 		                          AssumeVersion(packetWriter.protocolVersion()));
 
 		// Writes directly into buffer supplied by packetWriter
 		objectWriter.serialize(get());
+		if (referenceBytesFunc) {
+			// Links the strings left unwritten into the packet, in between the serialized bytes around them
+			packetWriter.spliceReferences();
+		}
 	}
 	virtual value_type const& get() const = 0;
+	// If not null, an arena that owns every byte the strings of get() point to, and that may be kept alive until those
+	// bytes are sent
+	virtual Arena const* referencedArena() const { return nullptr; }
 };
 
 template <class T>
 struct SerializeSource : MakeSerializeSource<SerializeSource<T>, T> {
 	using value_type = T;
 	T const& value;
-	SerializeSource(T const& value) : value(value) {}
+	Arena const* arena;
+	SerializeSource(T const& value, Arena const* arena = nullptr) : value(value), arena(arena) {}
 	void serializeObjectWriter(ObjectWriter& w) const override { w.serialize(value); }
 	T const& get() const override { return value; }
+	Arena const* referencedArena() const override { return arena; }
 };
 
+// Messages whose arena owns every byte their strings point to opt in to having large strings sent straight from it,
+// by defining `Arena const* referencedArena() const`
+template <class T>
+Arena const* getReferencedArena(T const& value) {
+	if constexpr (requires { value.referencedArena(); }) {
+		return value.referencedArena();
+	} else {
+		return nullptr;
+	}
+}
+
 #endif
@@ -26,6 +26,7 @@
 #include "flow/ChaosMetrics.h"
 #include "flow/UnitTest.h"
 #include "flow/IConnection.h"
+#include "flow/NetworkLoop.h"
 
 ChaosMetrics::ChaosMetrics() {
 	clear();
@@ -374,6 +375,10 @@ Future<Reference<IConnection>> INetworkConnections::connect(const std::string& h
 	});
 }
 
+std::unique_ptr<NetworkLoopReceiver> INetworkConnections::pinReceiver(Reference<IConnection> const& conn) {
+	return nullptr;
+}
+
 IUDPSocket::~IUDPSocket() {}
 
 const std::vector<int> NetworkMetrics::starvationBins = { 1, 3500, 7000, 7500, 8500, 8900, 10500 };
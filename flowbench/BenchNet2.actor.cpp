@@ -20,10 +20,13 @@
 
 #include "benchmark/benchmark.h"
 
+#include "fdbclient/IKnobCollection.h"
+#include "flow/IConnection.h"
 #include "flow/IRandom.h"
 #include "flow/flow.h"
 #include "flow/DeterministicRandom.h"
 #include "flow/network.h"
+#include "flow/serialize.h"
 #include "flow/ThreadHelper.actor.h"
 
 #include "flow/actorcompiler.h" // This must be the last #include.
@@ -91,3 +94,163 @@ static void bench_delay(benchmark::State& benchState) {
 
 BENCHMARK_TEMPLATE(bench_delay, DELAY)->Range(0, 1 << 16)->ReportAggregatesOnly(true);
 BENCHMARK_TEMPLATE(bench_delay, YIELD)->Range(0, 1 << 16)->ReportAggregatesOnly(true);
+
+static constexpr bool ASIO = false;
+static constexpr bool IO_URING = true;
+
+// A SendBuffer over a caller's bytes
+struct BenchSendBuffer : SendBuffer {
+	BenchSendBuffer(uint8_t* begin, int size) {
+		_data = begin;
+		next = nullptr;
+		bytes_written = size;
+		bytes_sent = 0;
+	}
+};
+
+ACTOR static Future<Void> sendAll(Reference<IConnection> conn, uint8_t* data, int size) {
+	state BenchSendBuffer buffer(data, size);
+	loop {
+		buffer.bytes_sent += conn->write(&buffer, buffer.bytes_unsent());
+		if (buffer.bytes_unsent() == 0) {
+			return Void();
+		}
+		wait(conn->onWritable());
+	}
+}
+
+ACTOR static Future<Void> receiveAll(Reference<IConnection> conn, uint8_t* data, int size) {
+	state int received = 0;
+	loop {
+		received += conn->read(data + received, data + size);
+		if (received == size) {
+			return Void();
+		}
+		wait(conn->onReadable());
+	}
+}
+
+ACTOR static Future<Void> echo(Reference<IConnection> conn, int size) {
+	state std::vector<uint8_t> message(size);
+	loop {
+		wait(receiveAll(conn, message.data(), size));
+		wait(sendAll(conn, message.data(), size));
+	}
+}
+
+// Messages of range(0) bytes echoed over a loopback connection, range(1) of them in flight at a time. Both ends of the
+// connection run on the network thread, which makes the CPU time the process spent per message comparable between
+// reactors.
+ACTOR template <bool useIOUring>
+static Future<Void> benchLoopback(benchmark::State* benchState) {
+	state int size = benchState->range(0);
+	state int depth = benchState->range(1);
+	state Reference<IListener> listener;
+	state Reference<IConnection> client;
+	state Reference<IConnection> server;
+	state Future<Void> echoing;
+	state std::vector<uint8_t> messages(size * depth);
+	state double cpuBegin;
+
+	IKnobCollection::getMutableGlobalKnobCollection().setKnob("net2_io_uring", KnobValueRef::create(int{ useIOUring }));
+	listener = INetworkConnections::net()->listen(NetworkAddress::parse("127.0.0.1:0"));
+	state Future<Reference<IConnection>> accepted = listener->accept();
+	wait(store(client, INetworkConnections::net()->connect(listener->getListenAddress())));
+	wait(store(server, accepted));
+	echoing = echo(server, size);
+
+	cpuBegin = getProcessorTimeProcess();
+	while (benchState->KeepRunning()) {
+		wait(sendAll(client, messages.data(), messages.size()));
+		wait(receiveAll(client, messages.data(), messages.size()));
+	}
+	const double messageCount = static_cast<double>(depth) * benchState->iterations();
+	benchState->SetItemsProcessed(static_cast<long>(messageCount));
+	benchState->counters["CPUPerMessage"] = (getProcessorTimeProcess() - cpuBegin) / messageCount;
+
+	echoing.cancel();
+	client->close();
+	server->close();
+	IKnobCollection::getMutableGlobalKnobCollection().setKnob("net2_io_uring", KnobValueRef::create(int{ 0 }));
+	return Void();
+}
+
+template <bool useIOUring>
+static void bench_net2_loopback(benchmark::State& benchState) {
+	onMainThread([&benchState] { return benchLoopback<useIOUring>(&benchState); }).blockUntilReady();
+}
+
+BENCHMARK_TEMPLATE(bench_net2_loopback, ASIO)
+    ->Ranges({ { 1 << 6, 1 << 16 }, { 1, 64 } })
+    ->ReportAggregatesOnly(true)
+    ->UseRealTime();
+BENCHMARK_TEMPLATE(bench_net2_loopback, IO_URING)
+    ->Ranges({ { 1 << 6, 1 << 16 }, { 1, 64 } })
+    ->ReportAggregatesOnly(true)
+    ->UseRealTime();
+
+static constexpr bool INLINE_CRYPTO = false;
+static constexpr bool OFFLOADED_CRYPTO = true;
+
+// Like bench_net2_loopback, over TLS. The records of reads and writes of at least TLS_CRYPTO_OFFLOAD_BYTES are
+// encrypted and decrypted on the network thread, or on TLS_CRYPTO_THREADS. NetworkThreadCPUPerMessage leaves out the
+// time spent on the crypto threads, which CPUPerMessage includes.
+ACTOR template <bool offloadCrypto>
+static Future<Void> benchTLSLoopback(benchmark::State* benchState) {
+	state int size = benchState->range(0);
+	state int depth = benchState->range(1);
+	state int offloadBytes = FLOW_KNOBS->TLS_CRYPTO_OFFLOAD_BYTES;
+	state Reference<IListener> listener;
+	state Reference<IConnection> client;
+	state Reference<IConnection> server;
+	state Future<Void> echoing;
+	state std::vector<uint8_t> messages(size * depth);
+	state double cpuBegin;
+	state double networkThreadCpuBegin;
+
+	// The crypto threads start with the first TLS connection, and are only used by reads and writes of at least
+	// TLS_CRYPTO_OFFLOAD_BYTES
+	IKnobCollection::getMutableGlobalKnobCollection().setKnob("tls_crypto_threads", KnobValueRef::create(int{ 2 }));
+	IKnobCollection::getMutableGlobalKnobCollection().setKnob(
+	    "tls_crypto_offload_bytes",
+	    KnobValueRef::create(int{ offloadCrypto ? offloadBytes : std::numeric_limits<int>::max() }));
+	listener = INetworkConnections::net()->listen(NetworkAddress::parse("127.0.0.1:0:tls"));
+	state Future<Reference<IConnection>> accepted = listener->accept();
+	wait(store(client, INetworkConnections::net()->connect(listener->getListenAddress())));
+	wait(store(server, accepted));
+	wait(client->connectHandshake() && server->acceptHandshake());
+	echoing = echo(server, size);
+
+	cpuBegin = getProcessorTimeProcess();
+	networkThreadCpuBegin = getProcessorTimeThread();
+	while (benchState->KeepRunning()) {
+		wait(sendAll(client, messages.data(), messages.size()));
+		wait(receiveAll(client, messages.data(), messages.size()));
+	}
+	const double messageCount = static_cast<double>(depth) * benchState->iterations();
+	benchState->SetItemsProcessed(static_cast<long>(messageCount));
+	benchState->counters["CPUPerMessage"] = (getProcessorTimeProcess() - cpuBegin) / messageCount;
+	benchState->counters["NetworkThreadCPUPerMessage"] =
+	    (getProcessorTimeThread() - networkThreadCpuBegin) / messageCount;
+
+	echoing.cancel();
+	client->close();
+	server->close();
+	IKnobCollection::getMutableGlobalKnobCollection().setKnob("tls_crypto_offload_bytes",
+	                                                          KnobValueRef::create(int{ offloadBytes }));
+	return Void();
+}
+
+template <bool offloadCrypto>
+static void bench_net2_tls_loopback(benchmark::State& benchState) {
+	onMainThread([&benchState] { return benchTLSLoopback<offloadCrypto>(&benchState); }).blockUntilReady();
+}
+
+BENCHMARK_TEMPLATE(bench_net2_tls_loopback, INLINE_CRYPTO)
+    ->Ranges({ { 1 << 12, 1 << 20 }, { 1, 16 } })
+    ->ReportAggregatesOnly(true)
+    ->UseRealTime();
+BENCHMARK_TEMPLATE(bench_net2_tls_loopback, OFFLOADED_CRYPTO)
+    ->Ranges({ { 1 << 12, 1 << 20 }, { 1, 16 } })
+    ->ReportAggregatesOnly(true)
+    ->UseRealTime();
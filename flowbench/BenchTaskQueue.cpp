@@ -0,0 +1,155 @@
+/*
+ * BenchTaskQueue.cpp
+ *
+ * This source file is part of the FoundationDB open source project
+ *
+ * Copyright 2013-2024 Apple Inc. and the FoundationDB project authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "benchmark/benchmark.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "flow/Platform.h"
+#include "flow/TaskQueue.h"
+
+static constexpr bool HEAP = false;
+static constexpr bool BUCKETED = true;
+
+namespace {
+
+struct BenchTask {
+	int id;
+};
+
+// Priorities of tasks, roughly in the proportions a busy storage server runs them
+std::vector<TaskPriority> samplePriorities(int count) {
+	static const std::pair<TaskPriority, int> weights[] = { { TaskPriority::ReadSocket, 20 },
+		                                                    { TaskPriority::WriteSocket, 10 },
+		                                                    { TaskPriority::DefaultEndpoint, 20 },
+		                                                    { TaskPriority::DefaultDelay, 15 },
+		                                                    { TaskPriority::DefaultYield, 10 },
+		                                                    { TaskPriority::DiskRead, 10 },
+		                                                    { TaskPriority::UpdateStorage, 5 },
+		                                                    { TaskPriority::FetchKeys, 5 },
+		                                                    { TaskPriority::Low, 5 } };
+	std::vector<TaskPriority> pool;
+	for (auto const& [priority, weight] : weights) {
+		pool.insert(pool.end(), weight, priority);
+	}
+	std::vector<TaskPriority> priorities;
+	for (int i = 0; i < count; i++) {
+		priorities.push_back(deterministicRandom()->randomChoice(pool));
+	}
+	return priorities;
+}
+
+// Reports percentiles of the time each step of a benchmark took
+void reportLatency(benchmark::State& state, std::vector<int64_t>& cycles) {
+	if (cycles.empty()) {
+		return;
+	}
+	std::sort(cycles.begin(), cycles.end());
+	auto percentile = [&](double p) { return double(cycles[std::min<size_t>(cycles.size() * p, cycles.size() - 1)]); };
+	state.counters["P50Cycles"] = percentile(0.5);
+	state.counters["P99Cycles"] = percentile(0.99);
+	state.counters["P999Cycles"] = percentile(0.999);
+	state.counters["MaxCycles"] = double(cycles.back());
+}
+
+} // namespace
+
+// Runs a ready task and queues another, with range(0) tasks kept waiting, as a run loop does under load
+template <bool Bucketed>
+static void bench_task_queue_ready(benchmark::State& state) {
+	const int queued = state.range(0);
+	TaskQueue<BenchTask> queue(Bucketed);
+	std::vector<TaskPriority> priorities = samplePriorities(1 << 16);
+	BenchTask task{ 0 };
+	for (int i = 0; i < queued; i++) {
+		queue.addReady(priorities[i % priorities.size()], &task);
+	}
+
+	std::vector<int64_t> cycles;
+	cycles.reserve(1 << 20);
+	size_t next = 0;
+	for (auto _ : state) {
+		int64_t begin = timestampCounter();
+		benchmark::DoNotOptimize(queue.getReadyTask());
+		queue.popReadyTask();
+		queue.addReady(priorities[next++ % priorities.size()], &task);
+		if (cycles.size() < cycles.capacity()) {
+			cycles.push_back(timestampCounter() - begin);
+		}
+	}
+	state.SetItemsProcessed(static_cast<long>(state.iterations()));
+	reportLatency(state, cycles);
+}
+
+// Keeps range(0) timers pending, with delays from that of coalescing a packet to seconds. Each step advances the clock
+// by about the time between two timers, runs the timers that came due and sets each one again.
+template <bool Bucketed>
+static void bench_task_queue_timers(benchmark::State& state) {
+	const int pending = state.range(0);
+	TaskQueue<BenchTask> queue(Bucketed);
+	std::vector<TaskPriority> priorities = samplePriorities(1 << 16);
+	static const std::vector<double> scales = { 1e-5, 1e-3, 0.1, 1, 10 };
+	std::vector<double> delays;
+	double totalDelay = 0;
+	for (int i = 0; i < 1 << 16; i++) {
+		delays.push_back(deterministicRandom()->random01() * deterministicRandom()->randomChoice(scales));
+		totalDelay += delays.back();
+	}
+	// The mean delay, over the number of timers, is the time between two of them coming due
+	double step = totalDelay / delays.size() / pending;
+
+	// Like a run loop, which processes timers all along, the queue starts out up to date
+	double now = 1e6;
+	queue.processReadyTimers(now);
+	BenchTask task{ 0 };
+	size_t next = 0;
+	for (int i = 0; i < pending; i++) {
+		queue.addTimer(now + delays[next % delays.size()], priorities[next % priorities.size()], &task);
+		++next;
+	}
+
+	std::vector<int64_t> cycles;
+	cycles.reserve(1 << 20);
+	int64_t fired = 0;
+	for (auto _ : state) {
+		int64_t begin = timestampCounter();
+		now += step;
+		queue.processReadyTimers(now);
+		while (queue.hasReadyTask()) {
+			benchmark::DoNotOptimize(queue.getReadyTask());
+			queue.popReadyTask();
+			queue.addTimer(now + delays[next % delays.size()], priorities[next % priorities.size()], &task);
+			++next;
+			++fired;
+		}
+		benchmark::DoNotOptimize(queue.getSleepTime(now));
+		if (cycles.size() < cycles.capacity()) {
+			cycles.push_back(timestampCounter() - begin);
+		}
+	}
+	state.SetItemsProcessed(fired);
+	reportLatency(state, cycles);
+}
+
+BENCHMARK_TEMPLATE(bench_task_queue_ready, HEAP)->Range(1, 1 << 18)->ReportAggregatesOnly(true);
+BENCHMARK_TEMPLATE(bench_task_queue_ready, BUCKETED)->Range(1, 1 << 18)->ReportAggregatesOnly(true);
+BENCHMARK_TEMPLATE(bench_task_queue_timers, HEAP)->Range(1 << 6, 1 << 18)->ReportAggregatesOnly(true);
+BENCHMARK_TEMPLATE(bench_task_queue_timers, BUCKETED)->Range(1 << 6, 1 << 18)->ReportAggregatesOnly(true);
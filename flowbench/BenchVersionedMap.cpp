@@ -0,0 +1,140 @@
+/*
+ * BenchVersionedMap.cpp
+ *
+ * This source file is part of the FoundationDB open source project
+ *
+ * Copyright 2013-2024 Apple Inc. and the FoundationDB project authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "benchmark/benchmark.h"
+
+#include "fdbclient/VersionedBPlusTree.h"
+#include "fdbclient/VersionedMap.h"
+#include "flow/Arena.h"
+#include "flow/IRandom.h"
+
+using PTreeData = VersionedMap<KeyRef, ValueOrClearToRef>;
+using BPlusTreeData = VersionedBPlusTree<KeyRef, ValueOrClearToRef>;
+
+// The window of versions a storage server keeps in memory: every version sets a batch of random keys, and versions
+// older than the window are forgotten.
+template <class Map>
+struct VersionWindow {
+	static constexpr int versions = 100;
+
+	Arena arena;
+	std::vector<KeyRef> keys;
+	ValueOrClearToRef value;
+	Map map;
+	int setsPerVersion;
+	int next = 0;
+
+	explicit VersionWindow(int setsPerVersion)
+	  : value(ValueOrClearToRef::value("value"_sr)), setsPerVersion(setsPerVersion) {
+		keys.reserve(versions * setsPerVersion);
+		for (int i = 0; i < versions * setsPerVersion; i++) {
+			keys.push_back(StringRef(arena, deterministicRandom()->randomAlphaNumeric(16)));
+		}
+		for (int v = 0; v < versions; v++) {
+			addVersion();
+		}
+	}
+
+	void addVersion() {
+		map.createNewVersion(map.getLatestVersion() + 1);
+		for (int i = 0; i < setsPerVersion; i++) {
+			map.insert(keys[next], value);
+			next = (next + 1) % keys.size();
+		}
+	}
+
+	void forget() { map.forgetVersionsBefore(std::max<Version>(map.getLatestVersion() - versions, 0)); }
+
+	// The memory the map holds for the window, in total and per set it keeps
+	void reportMemory(benchmark::State& state) const {
+		int64_t bytes = map.getBytesAllocated();
+		state.counters["BytesAllocated"] = bytes;
+		state.counters["BytesPerSet"] = double(bytes) / (versions * setsPerVersion);
+	}
+
+	KeyRef randomKey() const { return keys[deterministicRandom()->randomInt(0, keys.size())]; }
+	Version randomVersion() const {
+		return deterministicRandom()->randomInt64(map.getOldestVersion(), map.getLatestVersion() + 1);
+	}
+};
+
+template <class Map>
+static void bench_versioned_map_insert(benchmark::State& state) {
+	VersionWindow<Map> window(state.range(0));
+	for (auto _ : state) {
+		window.addVersion();
+		window.forget();
+	}
+	state.SetItemsProcessed(state.range(0) * static_cast<long>(state.iterations()));
+	window.reportMemory(state);
+}
+
+template <class Map>
+static void bench_versioned_map_point_read(benchmark::State& state) {
+	VersionWindow<Map> window(state.range(0));
+	window.forget();
+	for (auto _ : state) {
+		auto i = window.map.at(window.randomVersion()).find(window.randomKey());
+		benchmark::DoNotOptimize(i);
+	}
+	state.SetItemsProcessed(static_cast<long>(state.iterations()));
+}
+
+template <class Map>
+static void bench_versioned_map_scan(benchmark::State& state) {
+	VersionWindow<Map> window(state.range(0));
+	window.forget();
+	const int rows = state.range(1);
+	for (auto _ : state) {
+		auto view = window.map.at(window.randomVersion());
+		auto i = view.lower_bound(window.randomKey());
+		for (int n = 0; n < rows && i; n++, ++i) {
+			benchmark::DoNotOptimize(*i);
+		}
+	}
+	state.SetItemsProcessed(rows * static_cast<long>(state.iterations()));
+}
+
+// Forgetting the oldest version, after another one has been added
+template <class Map>
+static void bench_versioned_map_gc(benchmark::State& state) {
+	VersionWindow<Map> window(state.range(0));
+	window.forget();
+	for (auto _ : state) {
+		state.PauseTiming();
+		window.addVersion();
+		state.ResumeTiming();
+		window.forget();
+	}
+	state.SetItemsProcessed(state.range(0) * static_cast<long>(state.iterations()));
+}
+
+BENCHMARK_TEMPLATE(bench_versioned_map_insert, PTreeData)->Range(1 << 4, 1 << 12)->ReportAggregatesOnly(true);
+BENCHMARK_TEMPLATE(bench_versioned_map_insert, BPlusTreeData)->Range(1 << 4, 1 << 12)->ReportAggregatesOnly(true);
+BENCHMARK_TEMPLATE(bench_versioned_map_point_read, PTreeData)->Range(1 << 4, 1 << 12)->ReportAggregatesOnly(true);
+BENCHMARK_TEMPLATE(bench_versioned_map_point_read, BPlusTreeData)->Range(1 << 4, 1 << 12)->ReportAggregatesOnly(true);
+BENCHMARK_TEMPLATE(bench_versioned_map_scan, PTreeData)
+    ->Ranges({ { 1 << 4, 1 << 12 }, { 1, 1 << 10 } })
+    ->ReportAggregatesOnly(true);
+BENCHMARK_TEMPLATE(bench_versioned_map_scan, BPlusTreeData)
+    ->Ranges({ { 1 << 4, 1 << 12 }, { 1, 1 << 10 } })
+    ->ReportAggregatesOnly(true);
+BENCHMARK_TEMPLATE(bench_versioned_map_gc, PTreeData)->Range(1 << 4, 1 << 12)->ReportAggregatesOnly(true);
+BENCHMARK_TEMPLATE(bench_versioned_map_gc, BPlusTreeData)->Range(1 << 4, 1 << 12)->ReportAggregatesOnly(true);
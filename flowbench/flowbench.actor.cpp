@@ -21,7 +21,9 @@
 #include "benchmark/benchmark.h"
 #include "fdbclient/NativeAPI.actor.h"
 #include "fdbclient/ThreadSafeTransaction.h"
+#include "flow/MkCert.h"
 #include "flow/ThreadHelper.actor.h"
+#include <string_view>
 #include <thread>
 
 ACTOR template <class T>
@@ -36,11 +38,37 @@ Future<T> stopNetworkAfter(Future<T> what) {
 	}
 }
 
+// Only bench_net2_tls_loopback connects over TLS, to itself with a self-signed certificate. The certificate has to be
+// set before the network starts, so it is left out when --benchmark_filter is given and does not mention tls.
+static bool runsTLSBenchmarks(int argc, char** argv) {
+	const std::string_view flag = "--benchmark_filter=";
+	std::string_view filter;
+	for (int i = 1; i < argc; i++) {
+		if (std::string_view(argv[i]).substr(0, flag.size()) == flag) {
+			filter = std::string_view(argv[i]).substr(flag.size());
+		}
+	}
+	return filter.empty() || filter == "all" || filter == "." || filter.find("tls") != std::string_view::npos;
+}
+
+static void setSelfSignedCertificate() {
+	Arena arena;
+	mkcert::CertChainRef chain = mkcert::makeCertChain(arena, 1, mkcert::ESide::Server);
+	setNetworkOption(FDBNetworkOptions::TLS_CERT_BYTES, chain[0].certPem);
+	setNetworkOption(FDBNetworkOptions::TLS_KEY_BYTES, chain[0].privateKeyPem);
+	setNetworkOption(FDBNetworkOptions::TLS_CA_BYTES, chain[0].certPem);
+}
+
 int main(int argc, char** argv) {
+	// Initialize() removes the flags it knows from argv
+	const bool setCertificate = runsTLSBenchmarks(argc, argv);
 	benchmark::Initialize(&argc, argv);
 	if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
 		return 1;
 	}
+	if (setCertificate) {
+		setSelfSignedCertificate();
+	}
 	setupNetwork();
 	Promise<Void> benchmarksDone;
 	std::thread benchmarkThread([&]() {